@@ -0,0 +1,137 @@
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Micro-benchmark of a model of the per-sample dispatch from a global sample index to the port that replays it.
+ * Compares the former lookups (stream name map, stream index map and a callback per sample) with the
+ * dense stream table of the LogTaskManager. Only the dispatch is measured, the port work is a counter.
+ * The tasks, ports and streams are stand-ins, not LogTask and LogTaskManager, so this benchmark does not notice changes
+ * of the real replay path. The real LogTaskManager::setIndex and replaySample are benchmarked by BM_LogTaskManagerDispatch
+ * in replay_benchmark.
+ *
+ */
+
+/**
+ * @brief Stand-in for a PortHandle.
+ *
+ */
+struct Port
+{
+    uint64_t replayedSamples = 0;
+};
+
+/**
+ * @brief Stand-in for a LogTask.
+ *
+ */
+struct Task
+{
+    std::map<uint64_t, std::unique_ptr<Port>> streamIdx2Port;
+
+    bool replaySample(Port& port, uint64_t indexInStream)
+    {
+        port.replayedSamples += indexInStream & 1;
+        return true;
+    }
+
+    bool replaySample(uint64_t streamIndex, uint64_t indexInStream)
+    {
+        return replaySample(*streamIdx2Port.at(streamIndex), indexInStream);
+    }
+};
+
+/**
+ * @brief Stand-in for a stream of the MultiFileIndex.
+ *
+ */
+struct Stream
+{
+    std::string name;
+    uint64_t index;
+};
+
+/**
+ * @brief Stand-in for an entry of the stream table.
+ *
+ */
+struct StreamEntry
+{
+    Task* task;
+    Port* port;
+};
+
+constexpr size_t numTasks = 20;
+constexpr size_t portsPerTask = 5;
+constexpr size_t numSamples = 5000000;
+
+template <typename Dispatch> double measure(const std::vector<uint64_t>& samples, Dispatch dispatch)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for(uint64_t i = 0; i < samples.size(); i++)
+    {
+        dispatch(samples[i], i);
+    }
+    const auto duration = std::chrono::steady_clock::now() - start;
+
+    return std::chrono::duration<double, std::nano>(duration).count() / samples.size();
+}
+
+int main()
+{
+    std::vector<Stream> streams;
+    std::map<std::string, std::shared_ptr<Task>> streamName2Task;
+    std::vector<StreamEntry> streamTable;
+
+    for(size_t taskIdx = 0; taskIdx < numTasks; taskIdx++)
+    {
+        auto task = std::make_shared<Task>();
+        for(size_t portIdx = 0; portIdx < portsPerTask; portIdx++)
+        {
+            Stream stream = {"robot/task_" + std::to_string(taskIdx) + ".port_" + std::to_string(portIdx), streams.size()};
+            task->streamIdx2Port.emplace(stream.index, std::unique_ptr<Port>(new Port()));
+            streamName2Task.emplace(stream.name, task);
+            streamTable.push_back({task.get(), task->streamIdx2Port.at(stream.index).get()});
+            streams.push_back(stream);
+        }
+    }
+
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<uint64_t> distribution(0, streams.size() - 1);
+    std::vector<uint64_t> samples(numSamples);
+    for(auto& sample : samples)
+    {
+        sample = distribution(generator);
+    }
+
+    std::function<bool()> replayCallback;
+    const double mapNs = measure(samples, [&](uint64_t globalStreamIdx, uint64_t indexInStream) {
+        const Stream* stream = &streams[globalStreamIdx];
+        replayCallback = [=, &streamName2Task]() { return streamName2Task.at(stream->name)->replaySample(stream->index, indexInStream); };
+        replayCallback();
+    });
+
+    StreamEntry* replayEntry = nullptr;
+    const double tableNs = measure(samples, [&](uint64_t globalStreamIdx, uint64_t indexInStream) {
+        replayEntry = &streamTable[globalStreamIdx];
+        replayEntry->task->replaySample(*replayEntry->port, indexInStream);
+    });
+
+    uint64_t replayedSamples = 0;
+    for(const auto& entry : streamTable)
+    {
+        replayedSamples += entry.port->replayedSamples;
+    }
+
+    std::cout << "dispatch of " << numSamples << " samples over " << streams.size() << " streams (checksum " << replayedSamples << ")"
+              << std::endl;
+    std::cout << "  name and index maps with callback: " << mapNs << " ns/sample" << std::endl;
+    std::cout << "  stream table:                      " << tableNs << " ns/sample" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,30 @@
+#include "SyntheticLog.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+int main(int argc, char** argv)
+{
+    if(argc < 6 || argc > 7)
+    {
+        std::cerr << "usage: " << argv[0] << " <logfile.log> <number of streams> <rate in Hz> <payload size in bytes> <duration in s> [task name]"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const size_t numStreams = std::strtoull(argv[2], nullptr, 10);
+    const double rate = std::atof(argv[3]);
+    const size_t payloadSize = std::strtoull(argv[4], nullptr, 10);
+    const double duration = std::atof(argv[5]);
+    const std::string taskName = argc > 6 ? argv[6] : SyntheticLog::defaultTaskName;
+
+    const uint64_t numSamples = SyntheticLog::write(argv[1], SyntheticLog::createStreams(numStreams, rate, payloadSize, taskName), duration);
+    if(!numSamples)
+    {
+        std::cerr << "cannot write " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "wrote " << numSamples << " samples to " << argv[1] << std::endl;
+    return EXIT_SUCCESS;
+}
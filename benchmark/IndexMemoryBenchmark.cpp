@@ -0,0 +1,144 @@
+#include "SampleIndex.hpp"
+#include "SampleTable.hpp"
+#include "SyntheticLog.hpp"
+
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <pocolog_cpp/LogFile.hpp>
+#include <random>
+#include <sys/resource.h>
+
+/**
+ * @brief Memory benchmark of the SampleIndex. Builds the index of a synthetic logfile with the given number of samples
+ * (10^7 by default) over 100 streams and reports the build time and the growth of the peak resident memory during building,
+ * next to the memory of the built table and of buffering the timestamps of all samples. The logfile is generated once in
+ * ROCK_REPLAY_BENCHMARK_DIR (default: <tmp>/rock_replay_benchmark). Then appends samples (10^9 by default) to the compact
+ * sample table behind the index and reports the memory per sample, the peak resident memory of the process and the time of
+ * random accesses. The uncompressed entry (64 bit time, 32 bit stream index and 32 bit position) is given for comparison.
+ * Usage: index_memory_benchmark [table samples] [indexed samples]
+ *
+ */
+
+constexpr size_t numStreams = 100;
+constexpr size_t numLookups = 10000000;
+constexpr size_t uncompressedEntrySize = 16;
+
+constexpr size_t indexedPayloadSize = 8;
+constexpr double gib = 1024. * 1024. * 1024.;
+
+double getPeakMemoryGiB()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / (1024. * 1024.);
+}
+
+/**
+ * @brief Builds the index of a synthetic logfile and reports its time and memory. Runs before the table is filled,
+ * so that the peak resident memory is not yet raised by the table.
+ *
+ * @param numSamples: Number of samples of the logfile.
+ * @return bool True if the index was built, false if the logfile cannot be written or indexed.
+ */
+bool benchmarkBuild(uint64_t numSamples)
+{
+    const char* directory = std::getenv("ROCK_REPLAY_BENCHMARK_DIR");
+    const std::string fileName = SyntheticLog::getOrCreate(
+        directory && *directory ? directory : (boost::filesystem::temp_directory_path() / "rock_replay_benchmark").string(), numSamples,
+        numStreams, indexedPayloadSize);
+    if(fileName.empty())
+    {
+        std::cout << "cannot write synthetic logfile" << std::endl;
+        return false;
+    }
+
+    pocolog_cpp::LogFile logFile(fileName);
+    std::vector<pocolog_cpp::InputDataStream*> inputStreams;
+    for(pocolog_cpp::Stream* stream : logFile.getStreams())
+    {
+        if(auto inputStream = dynamic_cast<pocolog_cpp::InputDataStream*>(stream))
+        {
+            inputStreams.push_back(inputStream);
+        }
+    }
+
+    std::mutex fileMutex;
+    SampleIndex index;
+    const double peakMemoryBefore = getPeakMemoryGiB();
+    const auto start = std::chrono::steady_clock::now();
+    const bool complete = index.build({inputStreams}, {&fileMutex});
+    const double buildNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / index.getSize();
+    if(!complete)
+    {
+        std::cout << "cannot index synthetic logfile " << fileName << std::endl;
+        return false;
+    }
+
+    std::cout << "sample index of " << index.getSize() << " samples over " << inputStreams.size() << " streams" << std::endl;
+    std::cout << "  build:                " << buildNs << " ns/sample" << std::endl;
+    std::cout << "  peak memory growth:   " << getPeakMemoryGiB() - peakMemoryBefore << " GiB" << std::endl;
+    std::cout << "  built table:          " << index.getMemoryUsage() / gib << " GiB" << std::endl;
+    std::cout << "  all timestamps:       " << index.getSize() * sizeof(int64_t) / gib << " GiB" << std::endl;
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const size_t numSamples = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000000;
+    const uint64_t numIndexedSamples = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000000;
+    if(!benchmarkBuild(numIndexedSamples))
+    {
+        return 1;
+    }
+
+    SampleTable table;
+    table.reset(numSamples, numStreams);
+
+    // streams with different rates and a timestamp resolution of microseconds
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<uint32_t> streamDistribution(0, numStreams - 1);
+    std::uniform_int_distribution<int64_t> gapDistribution(0, 200);
+    int64_t time = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < numSamples; i++)
+    {
+        const uint32_t streamIdx = streamDistribution(generator);
+        time += gapDistribution(generator);
+        table.append(time, streamIdx % 10 ? streamIdx : 0);
+    }
+    const double appendNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / numSamples;
+
+    std::uniform_int_distribution<size_t> indexDistribution(0, numSamples - 1);
+    uint64_t checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < numLookups; i++)
+    {
+        const size_t index = indexDistribution(generator);
+        checksum += table.getTime(index) + table.getStreamIdx(index) + table.getPosInStream(index);
+    }
+    const double lookupNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / numLookups;
+
+    start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < numLookups / 10; i++)
+    {
+        checksum += table.getIndexForTime(indexDistribution(generator) % time, numSamples);
+    }
+    const double searchNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (numLookups / 10);
+
+    std::cout << "sample table of " << numSamples << " samples over " << numStreams << " streams (checksum " << checksum << ")" << std::endl;
+    std::cout << "  compact table:        " << table.getMemoryUsage() / gib << " GiB, "
+              << static_cast<double>(table.getMemoryUsage()) / numSamples << " bytes/sample" << std::endl;
+    std::cout << "  uncompressed entries: " << numSamples * uncompressedEntrySize / gib << " GiB, " << uncompressedEntrySize
+              << " bytes/sample" << std::endl;
+    std::cout << "  peak resident memory: " << getPeakMemoryGiB() << " GiB" << std::endl;
+    std::cout << "  append:               " << appendNs << " ns/sample" << std::endl;
+    std::cout << "  random access:        " << lookupNs << " ns/sample" << std::endl;
+    std::cout << "  search by time:       " << searchNs << " ns/search" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,390 @@
+#include "LatencyHistogram.hpp"
+#include "LogTask.hpp"
+#include "LogTaskManager.hpp"
+#include "ReplayHandler.hpp"
+#include "SyntheticLog.hpp"
+
+#include <benchmark/benchmark.h>
+#include <boost/filesystem.hpp>
+#include <orocos_cpp/orocos_cpp.hpp>
+#include <pocolog_cpp/MultiFileIndex.hpp>
+#include <rtt/ConnPolicy.hpp>
+#include <rtt/base/InputPortInterface.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+/**
+ * @brief Benchmarks of the replay hot paths on synthetic logfiles with 10 streams at 100 Hz each.
+ * The logfiles are generated once in ROCK_REPLAY_BENCHMARK_DIR (default: <tmp>/rock_replay_benchmark)
+ * and reused by later runs. The largest log has ROCK_REPLAY_BENCHMARK_SAMPLES samples (default: 10^6),
+ * e.g. 100000000 for a benchmark at 10^8 samples. The index caches are kept in the same directory.
+ *
+ */
+
+constexpr size_t numStreams = 10;
+constexpr size_t defaultPayloadSize = 64;
+
+/**
+ * @brief Returns the directory of the generated logfiles and index caches.
+ *
+ * @return std::string Benchmark directory.
+ */
+std::string getBenchmarkDirectory()
+{
+    const char* directory = std::getenv("ROCK_REPLAY_BENCHMARK_DIR");
+    if(directory && *directory)
+    {
+        return directory;
+    }
+
+    return (boost::filesystem::temp_directory_path() / "rock_replay_benchmark").string();
+}
+
+/**
+ * @brief Returns the sample counts of the benchmarked logfiles, from 10^4 up to ROCK_REPLAY_BENCHMARK_SAMPLES growing by factors of 100.
+ *
+ * @return std::vector<int64_t> Sample counts.
+ */
+std::vector<int64_t> getSampleCounts()
+{
+    const char* maxSamplesVariable = std::getenv("ROCK_REPLAY_BENCHMARK_SAMPLES");
+    const int64_t maxSamples = maxSamplesVariable ? std::strtoll(maxSamplesVariable, nullptr, 10) : 1000000;
+    std::vector<int64_t> sampleCounts;
+    for(int64_t numSamples = 10000; numSamples < maxSamples; numSamples *= 100)
+    {
+        sampleCounts.push_back(numSamples);
+    }
+    sampleCounts.push_back(maxSamples);
+
+    return sampleCounts;
+}
+
+/**
+ * @brief Adds the sample counts as argument.
+ *
+ * @param benchmark: Benchmark to add the arguments to.
+ */
+void addSampleCounts(benchmark::internal::Benchmark* benchmark)
+{
+    for(int64_t numSamples : getSampleCounts())
+    {
+        benchmark->Arg(numSamples);
+    }
+}
+
+/**
+ * @brief Adds the sample counts as first argument, each combined with 0 and 1 as second argument.
+ *
+ * @param benchmark: Benchmark to add the arguments to.
+ */
+void addSampleCountsWithFlag(benchmark::internal::Benchmark* benchmark)
+{
+    for(int64_t numSamples : getSampleCounts())
+    {
+        benchmark->Args({numSamples, 0});
+        benchmark->Args({numSamples, 1});
+    }
+}
+
+/**
+ * @brief Returns a synthetic logfile, generating it if needed. Skips the benchmark if the logfile cannot be written.
+ *
+ * @param state: State of the benchmark.
+ * @param numSamples: Number of samples of the logfile.
+ * @param payloadSize: Marshaled size of each sample in bytes.
+ * @return std::string Name of the logfile, empty if it cannot be written.
+ */
+std::string getLog(benchmark::State& state, uint64_t numSamples, size_t payloadSize = defaultPayloadSize)
+{
+    const std::string fileName = SyntheticLog::getOrCreate(getBenchmarkDirectory(), numSamples, numStreams, payloadSize);
+    if(fileName.empty())
+    {
+        state.SkipWithError("cannot write synthetic logfile");
+    }
+
+    return fileName;
+}
+
+/**
+ * @brief Times the read, unmarshal and write stages of a replayed sample like LogTask does when built with LATENCY_HISTOGRAMS,
+ * so that the overhead of the histograms can be measured in a build without them.
+ *
+ */
+struct StageTiming
+{
+    /**
+     * @brief Records the stage durations of one sample: four clock reads and three histogram records.
+     *
+     */
+    void record()
+    {
+        auto start = std::chrono::steady_clock::now();
+        for(LatencyHistogram* histogram : {&readLatency, &unmarshalLatency, &writeLatency})
+        {
+            const auto now = std::chrono::steady_clock::now();
+            histogram->record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count());
+            start = now;
+        }
+    }
+
+    /**
+     * @brief Histograms of the three stages.
+     *
+     */
+    LatencyHistogram readLatency, unmarshalLatency, writeLatency;
+};
+
+/**
+ * @brief Replays the samples of a connected port with LogTask::replaySample: reading, unmarshaling and writing to a local connection.
+ * Arguments: marshaled sample size in bytes, 1 to time the stages in latency histograms, 0 without histograms.
+ *
+ */
+void BM_LogTaskReplaySample(benchmark::State& state)
+{
+    // with LATENCY_HISTOGRAMS the stages are always timed by LogTask, otherwise the timing is added here
+    const bool histograms = state.range(1);
+    if(!histograms && LatencyHistogram::enabled)
+    {
+        state.SkipWithError("the latency histograms are compiled in, build with -DLATENCY_HISTOGRAMS=OFF to replay without them");
+        return;
+    }
+    const bool addTiming = histograms && !LatencyHistogram::enabled;
+    StageTiming timing;
+
+    // large samples are benchmarked on shorter logs, so that the logfiles stay below 100 MB
+    const size_t payloadSize = state.range(0);
+    const uint64_t numSamples = std::max<uint64_t>(1000, std::min<uint64_t>(100000, 100000000 / payloadSize)) / numStreams * numStreams;
+    const std::string fileName = getLog(state, numSamples, payloadSize);
+    if(fileName.empty())
+    {
+        return;
+    }
+
+    orocos_cpp::OrocosCpp orocos;
+    orocos_cpp::OrocosCppConfig config;
+    config.package_initialization_whitelist = {SyntheticLog::defaultTaskName};
+    orocos.initialize(config);
+    orocos.loadAllTypekitsForModel(SyntheticLog::defaultTaskName);
+
+    pocolog_cpp::MultiFileIndex multiFileIndex(false);
+    multiFileIndex.registerStreamCheck([](pocolog_cpp::Stream* stream) { return dynamic_cast<pocolog_cpp::InputDataStream*>(stream); });
+    multiFileIndex.createIndex({fileName});
+
+    LogTask task(SyntheticLog::defaultTaskName, "");
+    auto* stream = dynamic_cast<pocolog_cpp::InputDataStream*>(multiFileIndex.getSampleStream(0));
+    if(!task.addStream(*stream))
+    {
+        state.SkipWithError("cannot add stream, the typekits of the synthetic streams are missing");
+        return;
+    }
+
+    LogTask::PortHandle* portHandle = task.getPortHandle(stream->getIndex());
+    std::unique_ptr<RTT::base::InputPortInterface> reader(dynamic_cast<RTT::base::InputPortInterface*>(portHandle->port->antiClone()));
+    reader->connectTo(portHandle->port, RTT::ConnPolicy());
+
+    const size_t numStreamSamples = stream->getSize();
+    size_t indexInStream = 0;
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(task.replaySample(*portHandle, indexInStream));
+        if(addTiming)
+        {
+            timing.record();
+        }
+        indexInStream = (indexInStream + 1) % numStreamSamples;
+    }
+
+    reader->disconnect();
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * payloadSize);
+}
+BENCHMARK(BM_LogTaskReplaySample)->ArgsProduct({{64, 4096, 1 << 16}, {0, 1}})->ArgNames({"payload", "histograms"})->Unit(benchmark::kMicrosecond);
+
+/**
+ * @brief Seeks to random samples with LogTaskManager::setIndex. Argument: number of samples of the logfile.
+ *
+ */
+void BM_LogTaskManagerSetIndex(benchmark::State& state)
+{
+    const std::string fileName = getLog(state, state.range(0));
+    if(fileName.empty())
+    {
+        return;
+    }
+
+    LogTaskManager manager;
+    manager.init({fileName}, "");
+
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<size_t> indexDistribution(0, manager.getNumSamples() - 1);
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(manager.setIndex(indexDistribution(generator)));
+    }
+
+    manager.clear();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LogTaskManagerSetIndex)->Apply(addSampleCounts);
+
+/**
+ * @brief Connects a reader to every port of the synthetic task.
+ *
+ * @param orocos: Initialized orocos_cpp instance.
+ * @return std::vector<std::unique_ptr<RTT::base::InputPortInterface>> Connected readers.
+ */
+std::vector<std::unique_ptr<RTT::base::InputPortInterface>> connectReaders(orocos_cpp::OrocosCpp& orocos)
+{
+    RTT::TaskContext* task = orocos.getTaskContext(SyntheticLog::defaultTaskName);
+    std::vector<std::unique_ptr<RTT::base::InputPortInterface>> readers;
+    for(RTT::base::PortInterface* port : task->ports()->getPorts())
+    {
+        readers.emplace_back(dynamic_cast<RTT::base::InputPortInterface*>(port->antiClone()));
+        readers.back()->setName(port->getName() + "_reader");
+        task->addPort(*readers.back());
+        readers.back()->connectTo(port, RTT::ConnPolicy());
+    }
+
+    return readers;
+}
+
+/**
+ * @brief Dispatches the samples in replay order with LogTaskManager::setIndex and LogTaskManager::replaySample, the per-sample path
+ * of the sequential replay. Arguments: number of samples of the logfile, and 1 if a reader is connected to every port, so that the
+ * samples are read, unmarshaled and written, 0 if the unconnected ports are skipped, so that only the dispatch is measured.
+ *
+ */
+void BM_LogTaskManagerDispatch(benchmark::State& state)
+{
+    const std::string fileName = getLog(state, state.range(0));
+    if(fileName.empty())
+    {
+        return;
+    }
+
+    LogTaskManager manager;
+    manager.init({fileName}, "");
+
+    orocos_cpp::OrocosCpp orocos;
+    orocos.initialize(orocos_cpp::OrocosCppConfig());
+    std::vector<std::unique_ptr<RTT::base::InputPortInterface>> readers;
+    if(state.range(1))
+    {
+        readers = connectReaders(orocos);
+    }
+
+    const size_t numSamples = manager.getNumSamples();
+    size_t index = 0;
+    for(auto _ : state)
+    {
+        manager.setIndex(index);
+        benchmark::DoNotOptimize(manager.replaySample());
+        index = (index + 1) % numSamples;
+    }
+
+    for(auto& reader : readers)
+    {
+        reader->disconnect();
+    }
+    manager.clear();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LogTaskManagerDispatch)->Apply(addSampleCountsWithFlag)->ArgNames({"samples", "connected"});
+
+/**
+ * @brief Loads a logfile with LogTaskManager::init. Arguments: number of samples of the logfile, and 1 if the pocolog index and
+ * the session index cache are removed before each load, 0 if they are reused.
+ *
+ */
+void BM_LogTaskManagerInit(benchmark::State& state)
+{
+    const std::string fileName = getLog(state, state.range(0));
+    if(fileName.empty())
+    {
+        return;
+    }
+
+    const bool cold = state.range(1);
+    const boost::filesystem::path cacheDirectory = std::getenv("XDG_CACHE_HOME");
+    LogTaskManager manager;
+    for(auto _ : state)
+    {
+        if(cold)
+        {
+            state.PauseTiming();
+            boost::filesystem::remove(boost::filesystem::path(fileName).replace_extension(".id2"));
+            boost::filesystem::remove_all(cacheDirectory / "rock_replay");
+            state.ResumeTiming();
+        }
+
+        manager.init({fileName}, "");
+        benchmark::DoNotOptimize(manager.getNumSamples());
+
+        state.PauseTiming();
+        manager.clear();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LogTaskManagerInit)->Apply(addSampleCountsWithFlag)->ArgNames({"samples", "cold"})->Unit(benchmark::kMillisecond);
+
+/**
+ * @brief Plays a logfile from start to end with the ReplayHandler at maximum speed, with a reader connected to every port.
+ * Arguments: number of samples of the logfile, and 1 for the pipelined replay, 0 for the sequential one.
+ *
+ */
+void BM_ReplayHandlerPlay(benchmark::State& state)
+{
+    const std::string fileName = getLog(state, state.range(0));
+    if(fileName.empty())
+    {
+        return;
+    }
+
+    ReplayHandler replayHandler;
+    replayHandler.init({fileName}, "");
+    replayHandler.setUnthrottled(true);
+    replayHandler.setPipelined(state.range(1));
+
+    orocos_cpp::OrocosCpp orocos;
+    orocos.initialize(orocos_cpp::OrocosCppConfig());
+    const auto readers = connectReaders(orocos);
+
+    for(auto _ : state)
+    {
+        replayHandler.play();
+        while(replayHandler.isPlaying())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        state.PauseTiming();
+        replayHandler.stop();
+        state.ResumeTiming();
+    }
+
+    replayHandler.deinit();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ReplayHandlerPlay)->Apply(addSampleCountsWithFlag)->ArgNames({"samples", "pipelined"})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+int main(int argc, char** argv)
+{
+    // the index caches of the benchmark logs are kept apart from the user's caches
+    const std::string cacheDirectory = (boost::filesystem::path(getBenchmarkDirectory()) / "cache").string();
+    setenv("XDG_CACHE_HOME", cacheDirectory.c_str(), 1);
+
+    benchmark::Initialize(&argc, argv);
+    if(benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include "SyntheticLog.hpp"
+
+#include "PocologFormat.hpp"
+
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <queue>
+
+const std::string SyntheticLog::defaultTaskName = "trajectory_follower";
+constexpr int64_t SyntheticLog::startTime;
+
+/**
+ * @brief Type registry of /std/vector</double>, as declared by the std typekit.
+ *
+ */
+static const std::string vectorRegistry = R"(<?xml version="1.0"?>
+<typelib>
+  <numeric name="/double" category="float" size="8" />
+  <container name="/std/vector&lt;/double&gt;" of="/double" size="24" kind="/std/vector" />
+</typelib>
+)";
+
+/**
+ * @brief Appends a value to a buffer.
+ *
+ * @param buffer: Buffer to append to.
+ * @param value: Value to append.
+ * @param size: Size of the value in bytes.
+ */
+static void append(std::vector<char>& buffer, const void* value, size_t size)
+{
+    buffer.insert(buffer.end(), static_cast<const char*>(value), static_cast<const char*>(value) + size);
+}
+
+/**
+ * @brief Appends a string with its 32 bit length to a buffer.
+ *
+ * @param buffer: Buffer to append to.
+ * @param value: String to append.
+ */
+static void appendString(std::vector<char>& buffer, const std::string& value)
+{
+    const uint32_t size = value.size();
+    append(buffer, &size, sizeof(size));
+    append(buffer, value.data(), value.size());
+}
+
+std::vector<SyntheticLog::Stream> SyntheticLog::createStreams(size_t numStreams, double rate, size_t payloadSize, const std::string& taskName)
+{
+    std::vector<Stream> streams;
+    for(size_t streamIdx = 0; streamIdx < numStreams; streamIdx++)
+    {
+        streams.push_back({taskName + ".stream_" + std::to_string(streamIdx), rate, payloadSize});
+    }
+
+    return streams;
+}
+
+uint64_t SyntheticLog::write(const std::string& fileName, const std::vector<Stream>& streams, double duration)
+{
+    if(streams.size() > std::numeric_limits<uint16_t>::max())
+    {
+        return 0;
+    }
+
+    std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+    std::vector<char> buffer;
+    const PocologFormat::Prologue prologue = {{'P', 'O', 'C', 'O', 'S', 'I', 'M'}, 0, 2, 0};
+    append(buffer, &prologue, sizeof(prologue));
+
+    for(size_t streamIdx = 0; streamIdx < streams.size(); streamIdx++)
+    {
+        std::vector<char> declaration;
+        declaration.push_back(PocologFormat::StreamBlock);
+        appendString(declaration, streams[streamIdx].name);
+        appendString(declaration, "/std/vector</double>");
+        appendString(declaration, vectorRegistry);
+        appendString(declaration, "rock_cxx_type_name: array\n");
+
+        const PocologFormat::BlockHeader blockHeader = {
+            PocologFormat::StreamBlock, 0, static_cast<uint16_t>(streamIdx), static_cast<uint32_t>(declaration.size())};
+        append(buffer, &blockHeader, sizeof(blockHeader));
+        append(buffer, declaration.data(), declaration.size());
+    }
+
+    // the next sample of each stream is kept in a queue ordered by time
+    using NextSample = std::pair<int64_t, size_t>;
+    std::priority_queue<NextSample, std::vector<NextSample>, std::greater<NextSample>> nextSamples;
+    std::vector<uint64_t> numStreamSamples(streams.size(), 0);
+    for(size_t streamIdx = 0; streamIdx < streams.size(); streamIdx++)
+    {
+        if(streams[streamIdx].rate > 0 && duration > 0)
+        {
+            nextSamples.emplace(startTime + streamIdx, streamIdx);
+        }
+    }
+
+    constexpr size_t flushSize = 1 << 20;
+    const int64_t endTime = startTime + static_cast<int64_t>(duration * 1e6);
+    uint64_t numSamples = 0;
+    while(!nextSamples.empty())
+    {
+        const int64_t time = nextSamples.top().first;
+        const size_t streamIdx = nextSamples.top().second;
+        nextSamples.pop();
+
+        const uint64_t numElements = (std::max<size_t>(8, streams[streamIdx].payloadSize) - 8) / 8;
+        const uint32_t payloadSize = 8 + numElements * 8;
+        const PocologFormat::BlockHeader blockHeader = {
+            PocologFormat::DataBlock, 0, static_cast<uint16_t>(streamIdx),
+            static_cast<uint32_t>(sizeof(PocologFormat::SampleHeader) + payloadSize)};
+        const PocologFormat::Time timeStamp = {static_cast<uint32_t>(time / 1000000), static_cast<uint32_t>(time % 1000000)};
+        const PocologFormat::SampleHeader sampleHeader = {timeStamp, timeStamp, payloadSize, 0};
+        append(buffer, &blockHeader, sizeof(blockHeader));
+        append(buffer, &sampleHeader, sizeof(sampleHeader));
+        append(buffer, &numElements, sizeof(numElements));
+        buffer.resize(buffer.size() + numElements * 8, 0);
+        numSamples++;
+
+        if(buffer.size() >= flushSize)
+        {
+            file.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+
+        // times are computed from the sample count, so that rounding errors do not accumulate
+        const int64_t nextTime = startTime + streamIdx + std::llround(++numStreamSamples[streamIdx] * 1e6 / streams[streamIdx].rate);
+        if(nextTime < endTime + static_cast<int64_t>(streamIdx))
+        {
+            nextSamples.emplace(nextTime, streamIdx);
+        }
+    }
+
+    file.write(buffer.data(), buffer.size());
+    file.close();
+    return file ? numSamples : 0;
+}
+
+std::string SyntheticLog::getOrCreate(const std::string& directory, uint64_t numSamples, size_t numStreams, size_t payloadSize)
+{
+    const std::string baseName =
+        "synthetic_" + std::to_string(numSamples) + "_" + std::to_string(numStreams) + "_" + std::to_string(payloadSize) + ".log";
+    const std::string fileName = (boost::filesystem::path(directory) / baseName).string();
+    if(boost::filesystem::exists(fileName))
+    {
+        return fileName;
+    }
+
+    // the logfile is written under a temporary name, so that an interrupted run leaves no truncated log behind
+    constexpr double rate = 100.;
+    const std::string tmpFileName = fileName + ".tmp";
+    boost::filesystem::create_directories(directory);
+    if(!numStreams || !write(tmpFileName, createStreams(numStreams, rate, payloadSize), numSamples / numStreams / rate))
+    {
+        boost::filesystem::remove(tmpFileName);
+        return "";
+    }
+
+    boost::filesystem::rename(tmpFileName, fileName);
+    return fileName;
+}
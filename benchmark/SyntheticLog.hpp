@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Writes synthetic pocolog logfiles for benchmarks, so that large logs need not be shipped as fixtures.
+ * All streams are of type /std/vector</double>, whose typekit is loaded with the models of the test logs,
+ * and their samples are written in timestamp order. Samples are written in large blocks, so that logs
+ * of 10^8 samples are generated in minutes.
+ *
+ */
+class SyntheticLog
+{
+public:
+    /**
+     * @brief Description of a synthetic stream.
+     *
+     */
+    struct Stream
+    {
+        /**
+         * @brief Name of the stream as task.port. The task name selects the typekits, see discoverModelName in the LogTaskManager.
+         *
+         */
+        std::string name;
+
+        /**
+         * @brief Number of samples per second of log time.
+         *
+         */
+        double rate;
+
+        /**
+         * @brief Marshaled size of a sample in bytes. Is rounded down to the 8 byte size field plus a multiple of 8 bytes.
+         *
+         */
+        size_t payloadSize;
+    };
+
+    /**
+     * @brief Task name of the generated streams by default, as its typekits are available wherever the tests run.
+     *
+     */
+    static const std::string defaultTaskName;
+
+    /**
+     * @brief Log time of the first sample in microseconds since the epoch.
+     *
+     */
+    static constexpr int64_t startTime = 1600000000000000;
+
+    /**
+     * @brief Creates streams with the same rate and payload size, named task.stream_<n>.
+     *
+     * @param numStreams: Number of streams.
+     * @param rate: Number of samples per second of each stream.
+     * @param payloadSize: Marshaled size of each sample in bytes.
+     * @param taskName: Task name of the streams.
+     * @return std::vector<Stream> Stream descriptions.
+     */
+    static std::vector<Stream> createStreams(size_t numStreams, double rate, size_t payloadSize, const std::string& taskName = defaultTaskName);
+
+    /**
+     * @brief Writes a logfile. The streams start at startTime, shifted by one microsecond per stream index so that
+     * timestamps are distinct, and write their samples at their rate until the duration is over.
+     *
+     * @param fileName: Name of the logfile.
+     * @param streams: Streams of the logfile, at most 65535.
+     * @param duration: Log time covered by the logfile in seconds.
+     * @return uint64_t Number of written samples, 0 if the logfile cannot be written.
+     */
+    static uint64_t write(const std::string& fileName, const std::vector<Stream>& streams, double duration);
+
+    /**
+     * @brief Returns a logfile with the given number of samples, spread evenly over the given number of streams at 100 Hz each.
+     * The logfile is generated in the directory if it does not exist, so that it is shared by benchmark runs.
+     *
+     * @param directory: Directory of the generated logfiles.
+     * @param numSamples: Number of samples of the logfile.
+     * @param numStreams: Number of streams.
+     * @param payloadSize: Marshaled size of each sample in bytes.
+     * @return std::string Name of the logfile, empty if it cannot be written.
+     */
+    static std::string getOrCreate(const std::string& directory, uint64_t numSamples, size_t numStreams, size_t payloadSize);
+};
@@ -20,7 +20,43 @@ bool ArgParser::parseArguments(int argc, char* argv[])
         ("no-exit", bool_switch(&no_exit), "keep running when replay is finished, only relevant in headless mode")
         ("rename", value<std::vector<std::string>>(&renamingInput), "rename task, e.g. trajectory_follower:traj_follower")
         ("log-files", value<std::vector<std::string>>(&fileArgs), "log files")
-        ("quiet", bool_switch(&quiet), "Don't print verbose status updates to stdout");
+        ("quiet", bool_switch(&quiet), "Don't print verbose status updates to stdout")
+        ("pipeline", bool_switch(&pipeline), "read and unmarshal samples ahead of their replay in separate threads")
+        ("max-speed", bool_switch(&maxSpeed), "replay as fast as possible without sleeping, only relevant in headless mode")
+        ("lockstep", bool_switch(&lockstep),
+            "wait until buffered consumers accept each sample instead of dropping it, only relevant in headless mode")
+        ("lockstep-window", value<size_t>(&lockstepWindow),
+            "number of samples a consumer may leave unread before lockstep waits for it, default 1")
+        ("prime-on-seek", bool_switch(&primeOnSeek), "replay the latest sample of every stream before the start time first")
+        ("follow", bool_switch(&follow),
+            "keep replaying samples written to the log files after loading, starting at the newest sample unless a start time is given, "
+            "only relevant in headless mode")
+        ("start-time", value<std::string>(&startTime),
+            "log time to start replay at, as seconds since log start (90.5), time of day (14:32:05.120) "
+            "or date and time (20161118-14:32:05.120), earlier samples are not loaded")
+        ("end-time", value<std::string>(&endTime), "log time to finish replay at, same formats as start-time, later samples are not loaded")
+        ("export", value<std::string>(&exportDirectory),
+            "copy the samples between start-time and end-time to new log files in the given directory instead of replaying them, "
+            "only relevant in headless mode")
+        ("stats", bool_switch(&stats),
+            "print the sample count, periods, jitter, largest gaps and out-of-order timestamps of each stream instead of replaying, "
+            "only relevant in headless mode")
+        ("stats-json", value<std::string>(&statsJsonFile), "write the stream statistics as JSON to the given file, - for stdout, implies stats")
+        ("timing-csv", value<std::string>(&timingCsvFile),
+            "write the lateness of the replayed samples over time as CSV to the given file, only relevant in headless mode")
+        ("catch-up", value<std::string>(&catchUp),
+            "policy for samples that are due after their deadline: burst writes them back-to-back until replay is on schedule, "
+            "drop skips them on droppable ports, stretch delays the following samples instead, only relevant in headless mode")
+        ("droppable", value<std::string>(&droppableInput),
+            "comma-separated list of regular expressions matching the ports whose overdue samples are skipped by the drop policy")
+        ("auto-speed", value<double>(&autoSpeedLag),
+            "continuously adjust the speed to the highest one that keeps the lag of the replayed samples below the given milliseconds, "
+            "only relevant in headless mode")
+        ("decimate", value<std::vector<std::string>>(&decimationInput),
+            "replay only every Nth sample or at most a rate of the ports matching a regular expression, "
+            "e.g. .*camera.*:10 or .*camera.*:5Hz, can be given multiple times")
+        ("cache-size", value<uint64_t>(&cacheSize),
+            "maximum size of the sample index cache in MB, the least recently used entries are removed beyond it, default 2048");
 
     positional_options_description p;
     p.add("log-files", -1);
@@ -36,6 +72,35 @@ bool ArgParser::parseArguments(int argc, char* argv[])
         return false;
     }
 
+    stats |= !statsJsonFile.empty();
+
+    if(catchUp != "burst" && catchUp != "drop" && catchUp != "stretch")
+    {
+        std::cout << "invalid catch-up policy " << catchUp << ", expected burst, drop or stretch" << std::endl;
+        return false;
+    }
+
+    if(vm.count("droppable"))
+    {
+        boost::tokenizer<boost::char_separator<char>> tokens(droppableInput, boost::char_separator<char>(","));
+        droppablePorts.assign(tokens.begin(), tokens.end());
+    }
+
+    for(const auto& decimation : decimationInput)
+    {
+        // the specification follows the last colon, as the regular expression may contain colons itself
+        const size_t separator = decimation.rfind(':');
+        uint64_t keepEvery;
+        double maxRate;
+        if(separator == std::string::npos || !LogFileHelper::parseDecimation(decimation.substr(separator + 1), keepEvery, maxRate))
+        {
+            std::cout << "invalid decimation " << decimation << ", expected <regex>:<N> or <regex>:<rate>Hz" << std::endl;
+            return false;
+        }
+
+        decimations.emplace_back(decimation.substr(0, separator), decimation.substr(separator + 1));
+    }
+
     if(vm.count("whitelist"))
     {
         boost::tokenizer<boost::char_separator<char>> tokens(whiteListInput, boost::char_separator<char>(","));
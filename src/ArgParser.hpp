@@ -22,9 +22,28 @@ public:
     bool headless = false;
     bool no_exit = false;
     bool quiet = false;
+    bool pipeline = false;
+    bool maxSpeed = false;
+    bool lockstep = false;
+    size_t lockstepWindow = 1;
+    bool primeOnSeek = false;
+    bool follow = false;
+    std::string startTime;
+    std::string endTime;
+    std::string exportDirectory;
+    bool stats = false;
+    std::string statsJsonFile;
+    std::string timingCsvFile;
+    std::string catchUp = "burst";
+    std::vector<std::string> droppablePorts;
+    double autoSpeedLag = 0;
+    std::vector<std::pair<std::string, std::string>> decimations;
+    uint64_t cacheSize = 2048;
 
 private:
     std::string whiteListInput;
+    std::string droppableInput;
     std::vector<std::string> renamingInput;
+    std::vector<std::string> decimationInput;
     std::vector<std::string> fileArgs;
 };
@@ -0,0 +1,35 @@
+#include "CompressedLogFile.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    if(argc < 3 || argc > 5)
+    {
+        std::cerr << "usage: " << argv[0] << " <logfile.log> <logfile.log.zst> [frame size in bytes] [compression level]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const size_t frameSize = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : CompressedLogFile::defaultFrameSize;
+    const int level = argc > 4 ? std::atoi(argv[4]) : 3;
+    if(!frameSize)
+    {
+        std::cerr << "invalid frame size " << argv[3] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if(!CompressedLogFile::isCompressedLog(argv[2]))
+    {
+        std::cerr << "warning: " << argv[2] << " does not end with .log.zst and is not recognized as compressed logfile" << std::endl;
+    }
+
+    if(!CompressedLogFile::compress(argv[1], argv[2], frameSize, level))
+    {
+        std::cerr << "cannot compress " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
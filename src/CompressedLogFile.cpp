@@ -0,0 +1,557 @@
+#include "CompressedLogFile.hpp"
+
+#include "IndexCache.hpp"
+#include "PocologFormat.hpp"
+
+#include <algorithm>
+#include <base-logging/Logging.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zstd.h>
+
+constexpr size_t CompressedLogFile::defaultFrameSize;
+constexpr size_t CompressedLogFile::defaultCacheSize;
+
+/**
+ * @brief Start of the skippable frame holding the header log and the sample locations, followed by both compressed as one zstd frame.
+ *
+ */
+struct IndexHeader
+{
+    /**
+     * @brief Magic of a zstd skippable frame.
+     *
+     */
+    uint32_t frameMagic;
+
+    /**
+     * @brief Size of the skippable frame without its magic and size.
+     *
+     */
+    uint32_t frameSize;
+
+    /**
+     * @brief Magic "RRLOGIDX", without terminating null character.
+     *
+     */
+    char magic[8];
+
+    /**
+     * @brief Format version.
+     *
+     */
+    uint32_t version;
+
+    /**
+     * @brief Unused.
+     *
+     */
+    uint32_t padding;
+
+    /**
+     * @brief Size of the decompressed header log in bytes.
+     *
+     */
+    uint64_t headerLogSize;
+
+    /**
+     * @brief Size of the decompressed header log and sample locations in bytes.
+     *
+     */
+    uint64_t indexSize;
+};
+
+/**
+ * @brief End of the seek table of the zstd seekable format.
+ *
+ */
+struct SeekTableFooter
+{
+    /**
+     * @brief Number of frames listed in the seek table.
+     *
+     */
+    uint32_t numFrames;
+
+    /**
+     * @brief Flags of the seek table, e.g. whether its entries hold checksums.
+     *
+     */
+    uint8_t descriptor;
+
+    /**
+     * @brief Magic of the seekable format.
+     *
+     */
+    uint32_t magic;
+} __attribute__((packed));
+
+static const char pocologMagic[7] = {'P', 'O', 'C', 'O', 'S', 'I', 'M'};
+static const char indexMagic[8] = {'R', 'R', 'L', 'O', 'G', 'I', 'D', 'X'};
+static const uint32_t indexVersion = 1;
+static const uint32_t skippableFrameMagic = 0x184D2A50;
+static const uint32_t seekTableFrameMagic = 0x184D2A5E;
+static const uint32_t seekableMagic = 0x8F92EAB1;
+static const uint8_t seekTableChecksumFlag = 0x80;
+static const std::string compressedLogExtension = ".log.zst";
+
+template <typename T>
+static void appendValue(std::string& data, const T& value)
+{
+    data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool CompressedLogFile::isCompressedLog(const std::string& fileName)
+{
+    return fileName.size() > compressedLogExtension.size() &&
+           !fileName.compare(fileName.size() - compressedLogExtension.size(), compressedLogExtension.size(), compressedLogExtension);
+}
+
+bool CompressedLogFile::compress(const std::string& logFileName, const std::string& fileName, size_t frameSize, int level)
+{
+    std::ifstream input(logFileName, std::ios::binary);
+    PocologFormat::Prologue prologue;
+    if(!input.read(reinterpret_cast<char*>(&prologue), sizeof(prologue)) || std::memcmp(prologue.magic, pocologMagic, sizeof(pocologMagic)) ||
+       (prologue.flags & PocologFormat::bigEndianFlag))
+    {
+        LOG_WARN_S << "not a little endian pocolog logfile: " << logFileName;
+        return false;
+    }
+
+    frameSize = std::max<size_t>(1, std::min<size_t>(frameSize, std::numeric_limits<uint32_t>::max() / 2));
+    const std::string tmpFileName = fileName + "." + std::to_string(getpid()) + ".tmp";
+    std::ofstream output(tmpFileName, std::ios::binary | std::ios::trunc);
+
+    // compressed and decompressed size of each frame, as listed in the seek table
+    std::vector<std::pair<uint32_t, uint32_t>> seekEntries;
+    std::string frame;
+    std::vector<char> compressed(ZSTD_compressBound(frameSize));
+    uint64_t decompressedOffset = 0;
+    bool failed = false;
+
+    auto writeFrame = [&]() {
+        const size_t size = ZSTD_compress(compressed.data(), compressed.size(), frame.data(), frame.size(), level);
+        failed |= ZSTD_isError(size);
+        if(!failed)
+        {
+            output.write(compressed.data(), size);
+            seekEntries.emplace_back(size, frame.size());
+        }
+        frame.clear();
+    };
+
+    // the logfile is split into frames of equal size regardless of its blocks
+    auto append = [&](const char* data, size_t size) {
+        decompressedOffset += size;
+        while(size)
+        {
+            const size_t part = std::min(size, frameSize - frame.size());
+            frame.append(data, part);
+            data += part;
+            size -= part;
+            if(frame.size() == frameSize)
+            {
+                writeFrame();
+            }
+        }
+    };
+
+    std::string headerLog(reinterpret_cast<const char*>(&prologue), sizeof(prologue));
+    std::vector<StreamSamples> streamSamples;
+    append(headerLog.data(), headerLog.size());
+
+    PocologFormat::BlockHeader blockHeader;
+    std::vector<char> payload;
+    while(input.read(reinterpret_cast<char*>(&blockHeader), sizeof(blockHeader)))
+    {
+        payload.resize(blockHeader.dataSize);
+        if(!input.read(payload.data(), payload.size()))
+        {
+            break;
+        }
+
+        const uint64_t blockOffset = decompressedOffset;
+        append(reinterpret_cast<const char*>(&blockHeader), sizeof(blockHeader));
+        append(payload.data(), payload.size());
+
+        if(blockHeader.type != PocologFormat::DataBlock || payload.size() < sizeof(PocologFormat::SampleHeader))
+        {
+            headerLog.append(reinterpret_cast<const char*>(&blockHeader), sizeof(blockHeader));
+            headerLog.append(payload.data(), payload.size());
+            continue;
+        }
+
+        // the header log keeps the timestamps of a sample, but not the marshalled sample
+        PocologFormat::SampleHeader sampleHeader;
+        std::memcpy(&sampleHeader, payload.data(), sizeof(sampleHeader));
+        const uint32_t sampleSize = std::min<uint64_t>(sampleHeader.dataSize, payload.size() - sizeof(sampleHeader));
+        blockHeader.dataSize = sizeof(sampleHeader);
+        sampleHeader.dataSize = 0;
+        appendValue(headerLog, blockHeader);
+        appendValue(headerLog, sampleHeader);
+
+        if(blockHeader.streamIdx >= streamSamples.size())
+        {
+            streamSamples.resize(blockHeader.streamIdx + 1);
+        }
+        streamSamples[blockHeader.streamIdx].offsets.push_back(blockOffset + sizeof(blockHeader) + sizeof(sampleHeader));
+        streamSamples[blockHeader.streamIdx].sizes.push_back(sampleSize);
+    }
+
+    if(!frame.empty())
+    {
+        writeFrame();
+    }
+
+    // the header log and the sample locations are stored compressed in a skippable frame, which zstd skips on decompression,
+    // they are streamed into the frame from where they are, so that the index is never held twice
+    std::string counts;
+    appendValue(counts, static_cast<uint32_t>(streamSamples.size()));
+    for(const auto& samples : streamSamples)
+    {
+        appendValue(counts, static_cast<uint64_t>(samples.offsets.size()));
+    }
+
+    std::vector<std::pair<const char*, size_t>> indexParts = {{headerLog.data(), headerLog.size()}, {counts.data(), sizeof(uint32_t)}};
+    for(size_t streamIdx = 0; streamIdx < streamSamples.size(); streamIdx++)
+    {
+        const auto& samples = streamSamples[streamIdx];
+        indexParts.emplace_back(counts.data() + sizeof(uint32_t) + streamIdx * sizeof(uint64_t), sizeof(uint64_t));
+        indexParts.emplace_back(reinterpret_cast<const char*>(samples.offsets.data()), samples.offsets.size() * sizeof(uint64_t));
+        indexParts.emplace_back(reinterpret_cast<const char*>(samples.sizes.data()), samples.sizes.size() * sizeof(uint32_t));
+    }
+
+    uint64_t indexSize = 0;
+    for(const auto& indexPart : indexParts)
+    {
+        indexSize += indexPart.second;
+    }
+
+    // the size of the frame is known after the compression, so its header is written again then
+    const std::streampos indexHeaderPos = output.tellp();
+    IndexHeader indexHeader = {skippableFrameMagic, 0, {}, indexVersion, 0, headerLog.size(), indexSize};
+    std::memcpy(indexHeader.magic, indexMagic, sizeof(indexMagic));
+    output.write(reinterpret_cast<const char*>(&indexHeader), sizeof(indexHeader));
+
+    std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx*)> context(ZSTD_createCCtx(), ZSTD_freeCCtx);
+    failed |= !context || ZSTD_isError(ZSTD_CCtx_setParameter(context.get(), ZSTD_c_compressionLevel, level)) ||
+              ZSTD_isError(ZSTD_CCtx_setPledgedSrcSize(context.get(), indexSize));
+    compressed.resize(std::max(compressed.size(), ZSTD_CStreamOutSize()));
+    uint64_t compressedIndexSize = 0;
+    for(size_t partIdx = 0; !failed && partIdx <= indexParts.size(); partIdx++)
+    {
+        // the frame is finished after the last part
+        const bool last = partIdx == indexParts.size();
+        ZSTD_inBuffer in = {last ? nullptr : indexParts[partIdx].first, last ? 0 : indexParts[partIdx].second, 0};
+        size_t remaining;
+        do
+        {
+            ZSTD_outBuffer out = {compressed.data(), compressed.size(), 0};
+            remaining = ZSTD_compressStream2(context.get(), &out, &in, last ? ZSTD_e_end : ZSTD_e_continue);
+            failed |= ZSTD_isError(remaining);
+            output.write(compressed.data(), out.pos);
+            compressedIndexSize += out.pos;
+        } while(!failed && (last ? remaining : in.pos < in.size));
+    }
+
+    const uint64_t indexFrameSize = sizeof(IndexHeader) + compressedIndexSize;
+    failed |= indexFrameSize > std::numeric_limits<uint32_t>::max();
+    if(!failed)
+    {
+        indexHeader.frameSize = indexFrameSize - 2 * sizeof(uint32_t);
+        const std::streampos indexEndPos = output.tellp();
+        output.seekp(indexHeaderPos);
+        output.write(reinterpret_cast<const char*>(&indexHeader), sizeof(indexHeader));
+        output.seekp(indexEndPos);
+        seekEntries.emplace_back(indexFrameSize, 0);
+    }
+
+    std::string seekTable;
+    appendValue(seekTable, seekTableFrameMagic);
+    appendValue(seekTable, static_cast<uint32_t>(seekEntries.size() * 2 * sizeof(uint32_t) + sizeof(SeekTableFooter)));
+    for(const auto& seekEntry : seekEntries)
+    {
+        appendValue(seekTable, seekEntry.first);
+        appendValue(seekTable, seekEntry.second);
+    }
+    appendValue(seekTable, SeekTableFooter{static_cast<uint32_t>(seekEntries.size()), 0, seekableMagic});
+    output.write(seekTable.data(), seekTable.size());
+    output.close();
+
+    if(failed || !output || std::rename(tmpFileName.c_str(), fileName.c_str()))
+    {
+        LOG_WARN_S << "cannot write compressed logfile " << fileName;
+        std::remove(tmpFileName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+CompressedLogFile::CompressedLogFile(const std::string& fileName, size_t cacheSize)
+    : fileName(fileName)
+    , fd(open(fileName.c_str(), O_RDONLY | O_CLOEXEC))
+    , cacheSize(std::max<size_t>(cacheSize, 1))
+{
+    if(fd < 0)
+    {
+        throw std::runtime_error("cannot open compressed logfile " + fileName);
+    }
+
+    try
+    {
+        readIndex();
+    }
+    catch(...)
+    {
+        close(fd);
+        throw;
+    }
+}
+
+CompressedLogFile::~CompressedLogFile()
+{
+    close(fd);
+}
+
+void CompressedLogFile::readIndex()
+{
+    const std::runtime_error invalid("invalid compressed logfile " + fileName);
+
+    struct stat fileStat;
+    std::vector<char> data;
+    SeekTableFooter footer;
+    if(fstat(fd, &fileStat) || static_cast<size_t>(fileStat.st_size) < sizeof(footer) ||
+       !read(fileStat.st_size - sizeof(footer), sizeof(footer), data))
+    {
+        throw invalid;
+    }
+
+    std::memcpy(&footer, data.data(), sizeof(footer));
+    const size_t entrySize = (footer.descriptor & seekTableChecksumFlag ? 3 : 2) * sizeof(uint32_t);
+    const uint64_t seekTableSize = 2 * sizeof(uint32_t) + static_cast<uint64_t>(footer.numFrames) * entrySize + sizeof(footer);
+    if(footer.magic != seekableMagic || seekTableSize > static_cast<uint64_t>(fileStat.st_size) ||
+       !read(fileStat.st_size - seekTableSize, seekTableSize - sizeof(footer), data))
+    {
+        throw invalid;
+    }
+
+    // the frames follow each other, the skippable frame with the index has no decompressed content
+    uint64_t offset = 0;
+    uint64_t decompressedOffset = 0;
+    uint64_t indexOffset = 0;
+    uint32_t indexFrameSize = 0;
+    for(uint32_t frameIdx = 0; frameIdx < footer.numFrames; frameIdx++)
+    {
+        uint32_t sizes[2];
+        std::memcpy(sizes, data.data() + 2 * sizeof(uint32_t) + frameIdx * entrySize, sizeof(sizes));
+        if(sizes[1])
+        {
+            frames.push_back({offset, sizes[0], decompressedOffset, sizes[1]});
+            decompressedOffset += sizes[1];
+        }
+        else
+        {
+            indexOffset = offset;
+            indexFrameSize = sizes[0];
+        }
+        offset += sizes[0];
+    }
+
+    IndexHeader indexHeader;
+    if(offset + seekTableSize != static_cast<uint64_t>(fileStat.st_size) || indexFrameSize < sizeof(indexHeader) ||
+       !read(indexOffset, indexFrameSize, data))
+    {
+        throw invalid;
+    }
+
+    std::memcpy(&indexHeader, data.data(), sizeof(indexHeader));
+    if((indexHeader.frameMagic & 0xFFFFFFF0) != skippableFrameMagic || std::memcmp(indexHeader.magic, indexMagic, sizeof(indexMagic)) ||
+       indexHeader.version != indexVersion || indexHeader.headerLogSize > indexHeader.indexSize)
+    {
+        throw invalid;
+    }
+
+    std::string index(indexHeader.indexSize, '\0');
+    const size_t indexSize = ZSTD_decompress(&index[0], index.size(), data.data() + sizeof(indexHeader), indexFrameSize - sizeof(indexHeader));
+    if(ZSTD_isError(indexSize) || indexSize != index.size())
+    {
+        throw invalid;
+    }
+
+    // the sample locations follow the header log
+    size_t pos = indexHeader.headerLogSize;
+    auto readValues = [&](void* values, size_t size) {
+        if(size > index.size() - pos)
+        {
+            throw invalid;
+        }
+        std::memcpy(values, index.data() + pos, size);
+        pos += size;
+    };
+
+    uint32_t numStreams;
+    readValues(&numStreams, sizeof(numStreams));
+    streamSamples.resize(numStreams);
+    for(auto& samples : streamSamples)
+    {
+        uint64_t numSamples;
+        readValues(&numSamples, sizeof(numSamples));
+        if(numSamples > (index.size() - pos) / (sizeof(uint64_t) + sizeof(uint32_t)))
+        {
+            throw invalid;
+        }
+
+        samples.offsets.resize(numSamples);
+        samples.sizes.resize(numSamples);
+        readValues(samples.offsets.data(), numSamples * sizeof(uint64_t));
+        readValues(samples.sizes.data(), numSamples * sizeof(uint32_t));
+        for(size_t sampleNr = 0; sampleNr < numSamples; sampleNr++)
+        {
+            if(samples.offsets[sampleNr] + samples.sizes[sampleNr] > decompressedOffset)
+            {
+                throw invalid;
+            }
+        }
+    }
+
+    index.resize(indexHeader.headerLogSize);
+    extractHeaderLog(index);
+}
+
+void CompressedLogFile::extractHeaderLog(const std::string& headerLog)
+{
+    headerLogFileName = IndexCache::getCacheFileName("header log\n" + IndexCache::getSessionKey({fileName}, {}), ".log");
+    if(headerLogFileName.empty())
+    {
+        throw std::runtime_error("no cache directory for the header log of " + fileName);
+    }
+
+    struct stat fileStat;
+    if(!stat(headerLogFileName.c_str(), &fileStat) && static_cast<size_t>(fileStat.st_size) == headerLog.size())
+    {
+        IndexCache::touch(headerLogFileName);
+        return;
+    }
+
+    // written to a temporary file first, so that concurrent sessions never open a partial header log
+    const std::string tmpFileName = headerLogFileName + "." + std::to_string(getpid()) + ".tmp";
+    std::ofstream file(tmpFileName, std::ios::binary | std::ios::trunc);
+    file.write(headerLog.data(), headerLog.size());
+    file.close();
+
+    if(!file || std::rename(tmpFileName.c_str(), headerLogFileName.c_str()))
+    {
+        std::remove(tmpFileName.c_str());
+        throw std::runtime_error("cannot write the header log of " + fileName);
+    }
+
+    IndexCache::evict(headerLogFileName);
+}
+
+bool CompressedLogFile::getSampleData(size_t streamIdx, size_t sampleNr, std::vector<uint8_t>& data)
+{
+    if(streamIdx >= streamSamples.size() || sampleNr >= streamSamples[streamIdx].offsets.size())
+    {
+        return false;
+    }
+
+    uint64_t offset = streamSamples[streamIdx].offsets[sampleNr];
+    size_t remaining = streamSamples[streamIdx].sizes[sampleNr];
+    data.resize(remaining);
+    if(!remaining)
+    {
+        return true;
+    }
+
+    // a sample may span several frames
+    auto frame = std::upper_bound(
+        frames.begin(), frames.end(), offset, [](uint64_t offset, const Frame& frame) { return offset < frame.decompressedOffset; });
+    uint8_t* dest = data.data();
+    for(size_t frameIdx = frame - frames.begin() - 1; remaining; frameIdx++)
+    {
+        const std::vector<char>* content = frameIdx < frames.size() ? getFrame(frameIdx) : nullptr;
+        if(!content)
+        {
+            return false;
+        }
+
+        const size_t begin = offset - frames[frameIdx].decompressedOffset;
+        const size_t part = std::min(remaining, content->size() - begin);
+        std::memcpy(dest, content->data() + begin, part);
+        dest += part;
+        offset += part;
+        remaining -= part;
+    }
+
+    return true;
+}
+
+const std::vector<char>* CompressedLogFile::getFrame(size_t frameIdx)
+{
+    useCounter++;
+    for(auto& cachedFrame : cache)
+    {
+        if(cachedFrame.frameIdx == frameIdx)
+        {
+            cachedFrame.lastUse = useCounter;
+            return &cachedFrame.data;
+        }
+    }
+
+    // the cache grows until it is full, then the least recently used frame is replaced
+    CachedFrame* cachedFrame;
+    if(cache.size() < cacheSize)
+    {
+        cache.push_back({std::numeric_limits<size_t>::max(), useCounter, {}});
+        cachedFrame = &cache.back();
+    }
+    else
+    {
+        cachedFrame = &*std::min_element(
+            cache.begin(), cache.end(), [](const CachedFrame& a, const CachedFrame& b) { return a.lastUse < b.lastUse; });
+    }
+
+    const Frame& frame = frames[frameIdx];
+    cachedFrame->frameIdx = std::numeric_limits<size_t>::max();
+    cachedFrame->data.resize(frame.decompressedSize);
+    if(!read(frame.offset, frame.size, compressedFrame))
+    {
+        return nullptr;
+    }
+
+    const size_t size = ZSTD_decompress(cachedFrame->data.data(), cachedFrame->data.size(), compressedFrame.data(), compressedFrame.size());
+    if(ZSTD_isError(size) || size != frame.decompressedSize)
+    {
+        return nullptr;
+    }
+
+    cachedFrame->frameIdx = frameIdx;
+    cachedFrame->lastUse = useCounter;
+    numDecompressedFrames++;
+    return &cachedFrame->data;
+}
+
+bool CompressedLogFile::read(uint64_t offset, size_t size, std::vector<char>& data)
+{
+    data.resize(size);
+    size_t done = 0;
+    while(done < size)
+    {
+        const ssize_t result = pread(fd, data.data() + done, size - done, offset + done);
+        if(result <= 0)
+        {
+            return false;
+        }
+        done += result;
+    }
+
+    return true;
+}
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Pocolog logfile compressed in independent zstd frames, so that a sample is read by decompressing only the frame holding it.
+ * The file is a valid zstd file in the seekable format: decompressing it with zstd restores the original logfile,
+ * and a seek table at its end locates the frames. A skippable frame holds a header log, i.e. the logfile without
+ * the marshalled samples, and the position of each marshalled sample in the original logfile.
+ * The header log is extracted to the index cache, so that pocolog can open the streams and index the samples,
+ * while the marshalled samples are read from the compressed frames. Decompressed frames are kept in a small cache,
+ * so that sequential replay decompresses each frame once.
+ *
+ * The class is not thread-safe, accesses are serialized with the mutex of the logfile.
+ *
+ */
+class CompressedLogFile
+{
+public:
+    /**
+     * @brief Default size of the decompressed frames in bytes.
+     *
+     */
+    static constexpr size_t defaultFrameSize = 1 << 20;
+
+    /**
+     * @brief Default number of decompressed frames kept in the cache.
+     *
+     */
+    static constexpr size_t defaultCacheSize = 8;
+
+    /**
+     * @brief Checks whether the given file is a compressed logfile by its extension .log.zst.
+     *
+     * @param fileName: Name of the file.
+     * @return bool True if the file is a compressed logfile, false otherwise.
+     */
+    static bool isCompressedLog(const std::string& fileName);
+
+    /**
+     * @brief Compresses a logfile. A sample that is only partially written at the end of the logfile is dropped.
+     * The compressed file is written to a temporary file first and renamed afterwards.
+     *
+     * @param logFileName: Name of the logfile to compress.
+     * @param fileName: Name of the compressed logfile, should end with .log.zst.
+     * @param frameSize: Size of the decompressed frames in bytes. Smaller frames speed up random access, larger frames compress better.
+     * @param level: Zstd compression level.
+     * @return bool True if the logfile was compressed, false if it cannot be read or is not a little endian pocolog logfile.
+     */
+    static bool compress(const std::string& logFileName, const std::string& fileName, size_t frameSize = defaultFrameSize, int level = 3);
+
+    /**
+     * @brief Opens a compressed logfile and extracts its header log, unless it was extracted before.
+     * Throws std::runtime_error if the file is not a compressed logfile or the header log cannot be written.
+     *
+     * @param fileName: Name of the compressed logfile.
+     * @param cacheSize: Number of decompressed frames kept in the cache.
+     */
+    explicit CompressedLogFile(const std::string& fileName, size_t cacheSize = defaultCacheSize);
+
+    /**
+     * @brief Destructor. Closes the compressed logfile, the header log is kept for the next time.
+     *
+     */
+    ~CompressedLogFile();
+
+    CompressedLogFile(const CompressedLogFile&) = delete;
+    CompressedLogFile& operator=(const CompressedLogFile&) = delete;
+
+    /**
+     * @brief Returns the name of the compressed logfile.
+     *
+     * @return const std::string& Name of the compressed logfile.
+     */
+    const std::string& getFileName() const
+    {
+        return fileName;
+    };
+
+    /**
+     * @brief Returns the name of the header log, a pocolog logfile with the streams and sample headers of the compressed logfile.
+     * Its marshalled samples are empty.
+     *
+     * @return const std::string& Name of the header log.
+     */
+    const std::string& getHeaderLogFileName() const
+    {
+        return headerLogFileName;
+    };
+
+    /**
+     * @brief Reads a marshalled sample, decompressing the frames holding it unless they are cached.
+     *
+     * @param streamIdx: Index of the sample's stream, as declared in the logfile.
+     * @param sampleNr: Position of the sample in its stream.
+     * @param data: Read sample.
+     * @return bool True if the sample was read, false if it does not exist or its frames cannot be decompressed.
+     */
+    bool getSampleData(size_t streamIdx, size_t sampleNr, std::vector<uint8_t>& data);
+
+    /**
+     * @brief Returns the number of frames decompressed so far, including decompressing a frame again after it left the cache.
+     *
+     * @return size_t Number of decompressed frames.
+     */
+    size_t getNumDecompressedFrames() const
+    {
+        return numDecompressedFrames;
+    };
+
+private:
+    /**
+     * @brief Compressed frame holding a part of the original logfile.
+     *
+     */
+    struct Frame
+    {
+        /**
+         * @brief Position of the frame in the compressed logfile.
+         *
+         */
+        uint64_t offset;
+
+        /**
+         * @brief Size of the compressed frame in bytes.
+         *
+         */
+        uint32_t size;
+
+        /**
+         * @brief Position of the frame's content in the original logfile.
+         *
+         */
+        uint64_t decompressedOffset;
+
+        /**
+         * @brief Size of the frame's content in bytes.
+         *
+         */
+        uint32_t decompressedSize;
+    };
+
+    /**
+     * @brief Decompressed frame in the cache.
+     *
+     */
+    struct CachedFrame
+    {
+        /**
+         * @brief Index of the frame.
+         *
+         */
+        size_t frameIdx;
+
+        /**
+         * @brief Value of the use counter at the last access, the least recently used frame is replaced first.
+         *
+         */
+        uint64_t lastUse;
+
+        /**
+         * @brief Content of the frame.
+         *
+         */
+        std::vector<char> data;
+    };
+
+    /**
+     * @brief Location of the marshalled samples of a stream in the original logfile.
+     *
+     */
+    struct StreamSamples
+    {
+        /**
+         * @brief Position of each marshalled sample in the original logfile.
+         *
+         */
+        std::vector<uint64_t> offsets;
+
+        /**
+         * @brief Size of each marshalled sample in bytes.
+         *
+         */
+        std::vector<uint32_t> sizes;
+    };
+
+    /**
+     * @brief Reads the seek table and the skippable frame with the header log and the sample locations.
+     * Throws std::runtime_error if they are invalid.
+     *
+     */
+    void readIndex();
+
+    /**
+     * @brief Extracts the header log to the index cache, unless it was extracted before.
+     * Throws std::runtime_error if it cannot be written.
+     *
+     * @param headerLog: Content of the header log.
+     */
+    void extractHeaderLog(const std::string& headerLog);
+
+    /**
+     * @brief Returns a decompressed frame from the cache, decompressing it if necessary.
+     *
+     * @param frameIdx: Index of the frame.
+     * @return const std::vector<char>* Content of the frame, valid until the next call, or nullptr if it cannot be decompressed.
+     */
+    const std::vector<char>* getFrame(size_t frameIdx);
+
+    /**
+     * @brief Reads bytes from the compressed logfile.
+     *
+     * @param offset: Position in the compressed logfile.
+     * @param size: Number of bytes to read.
+     * @param data: Read bytes.
+     * @return bool True if all bytes were read, false otherwise.
+     */
+    bool read(uint64_t offset, size_t size, std::vector<char>& data);
+
+    /**
+     * @brief Name of the compressed logfile.
+     *
+     */
+    std::string fileName;
+
+    /**
+     * @brief Name of the extracted header log.
+     *
+     */
+    std::string headerLogFileName;
+
+    /**
+     * @brief File descriptor of the compressed logfile.
+     *
+     */
+    int fd;
+
+    /**
+     * @brief Frames holding the original logfile, ordered by their position.
+     *
+     */
+    std::vector<Frame> frames;
+
+    /**
+     * @brief Location of the marshalled samples, addressed by the stream index declared in the logfile.
+     *
+     */
+    std::vector<StreamSamples> streamSamples;
+
+    /**
+     * @brief Decompressed frames.
+     *
+     */
+    std::vector<CachedFrame> cache;
+
+    /**
+     * @brief Buffer for the compressed frame that is decompressed.
+     *
+     */
+    std::vector<char> compressedFrame;
+
+    /**
+     * @brief Maximum number of decompressed frames in the cache.
+     *
+     */
+    size_t cacheSize;
+
+    /**
+     * @brief Counter of cache accesses.
+     *
+     */
+    uint64_t useCounter = 0;
+
+    /**
+     * @brief Number of frames decompressed so far.
+     *
+     */
+    size_t numDecompressedFrames = 0;
+};
@@ -0,0 +1,171 @@
+#include "IndexCache.hpp"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <sys/stat.h>
+
+constexpr uint64_t IndexCache::defaultMaxSize;
+std::atomic<uint64_t> IndexCache::maxSize{IndexCache::defaultMaxSize};
+
+std::string IndexCache::getSessionKey(
+    const std::vector<std::string>& fileNames, const std::vector<std::vector<pocolog_cpp::InputDataStream*>>& fileStreams,
+    const base::Time& windowStart, const base::Time& windowEnd)
+{
+    std::ostringstream key;
+    for(const auto& fileName : fileNames)
+    {
+        key << "file " << fileName;
+
+        struct stat fileStat;
+        if(!stat(fileName.c_str(), &fileStat))
+        {
+            key << " " << fileStat.st_size << " " << fileStat.st_mtim.tv_sec << "." << fileStat.st_mtim.tv_nsec;
+        }
+        key << "\n";
+    }
+
+    for(const auto& streams : fileStreams)
+    {
+        key << "streams";
+        for(const auto stream : streams)
+        {
+            key << " " << stream->getName() << ":" << stream->getSize();
+        }
+        key << "\n";
+    }
+
+    if(!windowStart.isNull() || !windowEnd.isNull())
+    {
+        key << "window " << windowStart.toMicroseconds() << " " << windowEnd.toMicroseconds() << "\n";
+    }
+
+    return key.str();
+}
+
+std::string IndexCache::getCacheFileName(const std::string& key, const std::string& extension)
+{
+    const boost::filesystem::path directory = getCacheDirectory();
+    if(directory.empty())
+    {
+        return "";
+    }
+
+    boost::system::error_code error;
+    boost::filesystem::create_directories(directory, error);
+    if(error)
+    {
+        return "";
+    }
+
+    std::ostringstream fileName;
+    fileName << "session_" << std::hex << std::setw(16) << std::setfill('0') << hash(key) << extension;
+    return (directory / fileName.str()).string();
+}
+
+void IndexCache::touch(const std::string& fileName)
+{
+    boost::system::error_code error;
+    boost::filesystem::last_write_time(fileName, std::time(nullptr), error);
+}
+
+void IndexCache::evict(const std::string& writtenFileName)
+{
+    const boost::filesystem::path directory = getCacheDirectory();
+    boost::system::error_code error;
+    if(directory.empty() || !boost::filesystem::is_directory(directory, error))
+    {
+        return;
+    }
+
+    struct CacheFile
+    {
+        std::time_t lastUse;
+        uint64_t size;
+        boost::filesystem::path path;
+    };
+
+    // the temporary files of concurrent sessions are neither counted nor removed
+    std::vector<CacheFile> cacheFiles;
+    uint64_t totalSize = 0;
+    for(boost::filesystem::directory_iterator entry(directory, error), end; !error && entry != end; entry.increment(error))
+    {
+        const boost::filesystem::path& path = entry->path();
+        const std::string extension = path.extension().string();
+        if(path.filename().string().compare(0, 8, "session_") || (extension != ".idx" && extension != ".log"))
+        {
+            continue;
+        }
+
+        boost::system::error_code sizeError, timeError;
+        const uint64_t size = boost::filesystem::file_size(path, sizeError);
+        const std::time_t lastUse = boost::filesystem::last_write_time(path, timeError);
+        if(sizeError || timeError)
+        {
+            continue;
+        }
+
+        totalSize += size;
+        if(path != boost::filesystem::path(writtenFileName))
+        {
+            cacheFiles.push_back({lastUse, size, path});
+        }
+    }
+
+    std::sort(cacheFiles.begin(), cacheFiles.end(), [](const CacheFile& a, const CacheFile& b) { return a.lastUse < b.lastUse; });
+    const uint64_t limit = getMaxSize();
+    for(const auto& cacheFile : cacheFiles)
+    {
+        if(totalSize <= limit)
+        {
+            break;
+        }
+
+        boost::system::error_code removeError;
+        if(boost::filesystem::remove(cacheFile.path, removeError))
+        {
+            totalSize -= cacheFile.size;
+        }
+    }
+}
+
+void IndexCache::setMaxSize(uint64_t bytes)
+{
+    maxSize = bytes;
+}
+
+uint64_t IndexCache::getMaxSize()
+{
+    return maxSize;
+}
+
+uint64_t IndexCache::hash(const std::string& data)
+{
+    uint64_t value = 14695981039346656037ull;
+    for(const unsigned char byte : data)
+    {
+        value ^= byte;
+        value *= 1099511628211ull;
+    }
+
+    return value;
+}
+
+boost::filesystem::path IndexCache::getCacheDirectory()
+{
+    const char* cacheHome = std::getenv("XDG_CACHE_HOME");
+    const char* home = std::getenv("HOME");
+    if(cacheHome && *cacheHome)
+    {
+        return boost::filesystem::path(cacheHome) / "rock_replay";
+    }
+    else if(home && *home)
+    {
+        return boost::filesystem::path(home) / ".cache" / "rock_replay";
+    }
+
+    return boost::filesystem::path();
+}
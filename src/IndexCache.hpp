@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <base/Time.hpp>
+#include <boost/filesystem/path.hpp>
+#include <cstdint>
+#include <pocolog_cpp/InputDataStream.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Helper class to locate the cache files of replay sessions.
+ * A session is identified by its logfiles, including their sizes and modification times,
+ * by the indexed streams and by the time window, so any change of the input leads to a different cache file.
+ *
+ */
+class IndexCache
+{
+public:
+    /**
+     * @brief Returns the key of a replay session.
+     *
+     * @param fileNames: Names of the logfiles of the session.
+     * @param fileStreams: Indexed streams, grouped by their logfile.
+     * @param windowStart: Start of the indexed time window, a null time leaves the window open.
+     * @param windowEnd: End of the indexed time window, a null time leaves the window open.
+     * @return std::string Session key.
+     */
+    static std::string getSessionKey(
+        const std::vector<std::string>& fileNames, const std::vector<std::vector<pocolog_cpp::InputDataStream*>>& fileStreams,
+        const base::Time& windowStart = base::Time(), const base::Time& windowEnd = base::Time());
+
+    /**
+     * @brief Returns the cache file of a replay session. Cache files are stored in $XDG_CACHE_HOME/rock_replay,
+     * or in ~/.cache/rock_replay if XDG_CACHE_HOME is not set. The directory is created if necessary,
+     * its size is limited by evicting the least recently used files, see evict.
+     *
+     * @param key: Session key.
+     * @param extension: Extension of the cache file.
+     * @return std::string Name of the cache file, or an empty string if there is no usable cache directory.
+     */
+    static std::string getCacheFileName(const std::string& key, const std::string& extension = ".idx");
+
+    /**
+     * @brief Marks a cache file as used, so that it is evicted after the files that were used less recently.
+     *
+     * @param fileName: Name of the cache file.
+     */
+    static void touch(const std::string& fileName);
+
+    /**
+     * @brief Removes the least recently used cache files, the sample indexes and the header logs of compressed logfiles,
+     * until the cache fits into its maximum size again. Should be called after a cache file was written.
+     *
+     * @param writtenFileName: Name of the written cache file, which is kept even if it exceeds the maximum size on its own.
+     */
+    static void evict(const std::string& writtenFileName);
+
+    /**
+     * @brief Sets the maximum size of the cache directory.
+     *
+     * @param bytes: Maximum size in bytes.
+     */
+    static void setMaxSize(uint64_t bytes);
+
+    /**
+     * @brief Returns the maximum size of the cache directory.
+     *
+     * @return uint64_t Maximum size in bytes.
+     */
+    static uint64_t getMaxSize();
+
+    /**
+     * @brief Default maximum size of the cache directory in bytes.
+     *
+     */
+    static constexpr uint64_t defaultMaxSize = 2048ull << 20;
+
+    /**
+     * @brief Calculates the 64 bit FNV-1a hash of the given data.
+     *
+     * @param data: Data to hash.
+     * @return uint64_t Hash value.
+     */
+    static uint64_t hash(const std::string& data);
+
+private:
+    /**
+     * @brief Returns the cache directory, $XDG_CACHE_HOME/rock_replay or ~/.cache/rock_replay.
+     *
+     * @return boost::filesystem::path Cache directory, or an empty path if neither XDG_CACHE_HOME nor HOME is set.
+     */
+    static boost::filesystem::path getCacheDirectory();
+
+    /**
+     * @brief Maximum size of the cache directory in bytes.
+     *
+     */
+    static std::atomic<uint64_t> maxSize;
+};
@@ -0,0 +1,76 @@
+#include "LatencyHistogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr size_t LatencyHistogram::numSubBuckets;
+constexpr size_t LatencyHistogram::numBuckets;
+constexpr bool LatencyHistogram::enabled;
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+LatencyHistogram::Summary LatencyHistogram::getSummary() const
+{
+    // the buckets are copied first, so that all quantiles are taken from the same counts
+    std::array<uint64_t, numBuckets> counts;
+    uint64_t total = 0;
+    for(size_t bucket = 0; bucket < numBuckets; bucket++)
+    {
+        counts[bucket] = buckets[bucket].load(std::memory_order_relaxed);
+        total += counts[bucket];
+    }
+
+    Summary summary = {};
+    if(!total)
+    {
+        return summary;
+    }
+
+    const uint64_t maxValue = max.load(std::memory_order_relaxed);
+    auto getQuantile = [&](double quantile) {
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantile * total)));
+        uint64_t seen = 0;
+        for(size_t bucket = 0; bucket < numBuckets; bucket++)
+        {
+            seen += counts[bucket];
+            if(seen >= rank)
+            {
+                return std::chrono::nanoseconds(std::min(getBucketUpperBound(bucket), maxValue));
+            }
+        }
+        return std::chrono::nanoseconds(maxValue);
+    };
+
+    summary.count = total;
+    summary.mean = std::chrono::nanoseconds(sum.load(std::memory_order_relaxed) / total);
+    summary.p50 = getQuantile(0.5);
+    summary.p90 = getQuantile(0.9);
+    summary.p99 = getQuantile(0.99);
+    summary.max = std::chrono::nanoseconds(maxValue);
+    return summary;
+}
+
+void LatencyHistogram::reset()
+{
+    for(auto& bucket : buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getBucketUpperBound(size_t bucket)
+{
+    if(bucket < numSubBuckets)
+    {
+        return bucket;
+    }
+
+    const int shift = bucket / numSubBuckets - 1;
+    const uint64_t lower = static_cast<uint64_t>(numSubBuckets + bucket % numSubBuckets) << shift;
+    return lower + (uint64_t(1) << shift) - 1;
+}
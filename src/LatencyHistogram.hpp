@@ -0,0 +1,262 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief Histogram of durations in nanoseconds with logarithmic buckets, each power of two is split into 16 linear sub-buckets.
+ * So quantiles are reported with a relative error below 7%, durations of more than 2^36 ns (about 69 s) fall into the last bucket.
+ * Each histogram has a single writer, which records without atomic read-modify-write operations, while other threads
+ * read it concurrently. Histograms with several writers use recordShared instead.
+ *
+ */
+class LatencyHistogram
+{
+public:
+    /**
+     * @brief Measures the time between consecutive stages of a sample's replay.
+     * If ROCK_REPLAY_LATENCY_HISTOGRAMS is not defined, the timer does nothing and is compiled out.
+     *
+     */
+    class Timer
+    {
+    public:
+        /**
+         * @brief Constructor. Starts the first stage.
+         *
+         */
+        Timer()
+#ifdef ROCK_REPLAY_LATENCY_HISTOGRAMS
+            : start(std::chrono::steady_clock::now())
+#endif
+        {
+        }
+
+        /**
+         * @brief Records the duration of the current stage and starts the next one.
+         *
+         * @param histogram: Histogram of the finished stage.
+         */
+        void lap(LatencyHistogram& histogram)
+        {
+#ifdef ROCK_REPLAY_LATENCY_HISTOGRAMS
+            const auto now = std::chrono::steady_clock::now();
+            histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count());
+            start = now;
+#else
+            (void)histogram;
+#endif
+        }
+
+        /**
+         * @brief Records the duration of the current stage in a histogram with several writers and starts the next one.
+         *
+         * @param histogram: Histogram of the finished stage.
+         */
+        void lapShared(LatencyHistogram& histogram)
+        {
+#ifdef ROCK_REPLAY_LATENCY_HISTOGRAMS
+            const auto now = std::chrono::steady_clock::now();
+            histogram.recordShared(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count());
+            start = now;
+#else
+            (void)histogram;
+#endif
+        }
+
+    private:
+#ifdef ROCK_REPLAY_LATENCY_HISTOGRAMS
+        /**
+         * @brief Start of the current stage.
+         *
+         */
+        std::chrono::steady_clock::time_point start;
+#endif
+    };
+
+    /**
+     * @brief Summary of the recorded durations.
+     *
+     */
+    struct Summary
+    {
+        /**
+         * @brief Number of recorded durations.
+         *
+         */
+        uint64_t count;
+
+        /**
+         * @brief Mean duration.
+         *
+         */
+        std::chrono::nanoseconds mean;
+
+        /**
+         * @brief Median duration.
+         *
+         */
+        std::chrono::nanoseconds p50;
+
+        /**
+         * @brief 90th percentile.
+         *
+         */
+        std::chrono::nanoseconds p90;
+
+        /**
+         * @brief 99th percentile.
+         *
+         */
+        std::chrono::nanoseconds p99;
+
+        /**
+         * @brief Largest recorded duration.
+         *
+         */
+        std::chrono::nanoseconds max;
+    };
+
+    /**
+     * @brief Indicates whether the replay records its stages, i.e. whether ROCK_REPLAY_LATENCY_HISTOGRAMS is defined.
+     *
+     */
+#ifdef ROCK_REPLAY_LATENCY_HISTOGRAMS
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    /**
+     * @brief Constructor. Creates an empty histogram.
+     *
+     */
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    /**
+     * @brief Records a duration. Must only be called by the single writer of the histogram, as the counters are updated
+     * with plain loads and stores, which are much cheaper than atomic read-modify-write operations.
+     *
+     * @param nanoseconds: Duration in nanoseconds, negative durations are recorded as 0.
+     */
+    void record(int64_t nanoseconds)
+    {
+        const uint64_t value = nanoseconds > 0 ? nanoseconds : 0;
+        std::atomic<uint64_t>& bucket = buckets[getBucket(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum.store(sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        if(value > max.load(std::memory_order_relaxed))
+        {
+            max.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Records a duration. Can be called concurrently by several writers.
+     *
+     * @param nanoseconds: Duration in nanoseconds, negative durations are recorded as 0.
+     */
+    void recordShared(int64_t nanoseconds)
+    {
+        const uint64_t value = nanoseconds > 0 ? nanoseconds : 0;
+        buckets[getBucket(value)].fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(value, std::memory_order_relaxed);
+
+        uint64_t curMax = max.load(std::memory_order_relaxed);
+        while(value > curMax && !max.compare_exchange_weak(curMax, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    /**
+     * @brief Returns a summary of the recorded durations. Quantiles are reported as the upper bound of their bucket,
+     * but not above the largest recorded duration. Durations recorded concurrently may be partially included.
+     *
+     * @return Summary Summary of the histogram, all zero if it is empty.
+     */
+    Summary getSummary() const;
+
+    /**
+     * @brief Removes all recorded durations. Durations recorded concurrently may survive the reset.
+     *
+     */
+    void reset();
+
+    /**
+     * @brief Returns the bucket of a duration.
+     *
+     * @param value: Duration in nanoseconds.
+     * @return size_t Index of the bucket.
+     */
+    static size_t getBucket(uint64_t value)
+    {
+        if(value < numSubBuckets)
+        {
+            return value;
+        }
+
+        const int exponent = 63 - __builtin_clzll(value);
+        if(exponent > maxExponent)
+        {
+            return numBuckets - 1;
+        }
+
+        return numSubBuckets * (exponent - subBucketBits + 1) + ((value >> (exponent - subBucketBits)) - numSubBuckets);
+    }
+
+    /**
+     * @brief Returns the largest duration of a bucket.
+     *
+     * @param bucket: Index of the bucket.
+     * @return uint64_t Upper bound of the bucket in nanoseconds.
+     */
+    static uint64_t getBucketUpperBound(size_t bucket);
+
+private:
+    /**
+     * @brief Number of bits resolved within each power of two.
+     *
+     */
+    static constexpr int subBucketBits = 4;
+
+    /**
+     * @brief Number of sub-buckets of each power of two.
+     *
+     */
+    static constexpr size_t numSubBuckets = 1 << subBucketBits;
+
+    /**
+     * @brief Exponent of the largest resolved power of two.
+     *
+     */
+    static constexpr int maxExponent = 36;
+
+    /**
+     * @brief Number of buckets. Durations below numSubBuckets are counted exactly.
+     *
+     */
+    static constexpr size_t numBuckets = numSubBuckets * (maxExponent - subBucketBits + 2);
+
+    /**
+     * @brief Number of durations in each bucket.
+     *
+     */
+    std::array<std::atomic<uint64_t>, numBuckets> buckets;
+
+    /**
+     * @brief Sum of the recorded durations in nanoseconds.
+     *
+     */
+    std::atomic<uint64_t> sum;
+
+    /**
+     * @brief Largest recorded duration in nanoseconds.
+     *
+     */
+    std::atomic<uint64_t> max;
+};
@@ -1,6 +1,10 @@
 #include "LogFileHelper.hpp"
 
+#include "CompressedLogFile.hpp"
+
 #include <boost/filesystem.hpp>
+#include <cmath>
+#include <ctime>
 #include <regex>
 
 std::vector<std::string> LogFileHelper::parseFileNames(const std::vector<std::string> commandLineArgs)
@@ -17,7 +21,8 @@ std::vector<std::string> LogFileHelper::parseFileNames(const std::vector<std::st
             {
                 for(const auto& entry : recursive_directory_iterator(arg))
                 {
-                    if(is_regular_file(entry) && entry.path().extension() == ".log")
+                    if(is_regular_file(entry) &&
+                       (entry.path().extension() == ".log" || CompressedLogFile::isCompressedLog(entry.path().string())))
                     {
                         filenames.emplace_back(arg + entry.path().filename().string());
                     }
@@ -65,3 +70,67 @@ bool LogFileHelper::isWhiteListed(const std::string& streamName, const std::vect
 
     return false;
 }
+
+bool LogFileHelper::parseTime(const std::string& input, const base::Time& logStart, base::Time& time)
+{
+    std::smatch match;
+    if(std::regex_match(input, match, std::regex(R"(\+?(\d+(\.\d+)?))")))
+    {
+        time = logStart + base::Time::fromMicroseconds(std::llround(std::stod(match[1]) * 1e6));
+        return true;
+    }
+
+    // the fraction may be separated by a colon, as in the timestamps shown during replay
+    if(!std::regex_match(input, match, std::regex(R"((?:(\d{4})(\d{2})(\d{2})-)?(\d{1,2}):(\d{2}):(\d{2})(?:[.:](\d{1,6}))?)")))
+    {
+        return false;
+    }
+
+    std::tm date;
+    const time_t startSeconds = logStart.toTimeval().tv_sec;
+    localtime_r(&startSeconds, &date);
+
+    if(match[1].matched)
+    {
+        date.tm_year = std::stoi(match[1]) - 1900;
+        date.tm_mon = std::stoi(match[2]) - 1;
+        date.tm_mday = std::stoi(match[3]);
+    }
+
+    date.tm_hour = std::stoi(match[4]);
+    date.tm_min = std::stoi(match[5]);
+    date.tm_sec = std::stoi(match[6]);
+    date.tm_isdst = -1;
+
+    const time_t seconds = std::mktime(&date);
+    if(seconds == -1)
+    {
+        return false;
+    }
+
+    std::string fraction = match[7];
+    fraction.resize(6, '0');
+    time = base::Time::fromMicroseconds(static_cast<int64_t>(seconds) * 1000000 + std::stoll(fraction));
+
+    return true;
+}
+
+bool LogFileHelper::parseDecimation(const std::string& input, uint64_t& keepEvery, double& maxRate)
+{
+    std::smatch match;
+    if(input.empty() || std::regex_match(input, match, std::regex(R"(\s*(\d{1,18})\s*)")))
+    {
+        keepEvery = input.empty() ? 1 : std::stoull(match[1]);
+        maxRate = 0;
+        return keepEvery > 0;
+    }
+
+    if(std::regex_match(input, match, std::regex(R"(\s*(\d{1,18}(\.\d+)?)\s*[hH][zZ]\s*)")))
+    {
+        keepEvery = 1;
+        maxRate = std::stod(match[1]);
+        return maxRate > 0;
+    }
+
+    return false;
+}
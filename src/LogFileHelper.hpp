@@ -1,4 +1,5 @@
 #pragma once
+#include <base/Time.hpp>
 #include <map>
 #include <regex>
 #include <string>
@@ -25,7 +26,7 @@ public:
     ~LogFileHelper() = default;
 
     /**
-     * @brief Parses the command line arguments for log files or folders that contain log files.
+     * @brief Parses the command line arguments for log files or folders that contain log files, including compressed ones.
      *
      * @param commandLineArgs: List of command line arguments.
      * @return std::vector<std::string> List of filenames with absolute paths.
@@ -49,4 +50,27 @@ public:
      * @return True is stream is whitelisted, false otherwise.
      */
     static bool isWhiteListed(const std::string& streamName, const std::vector<std::string>& whiteListRegEx);
+
+    /**
+     * @brief Parses a log time given either as seconds relative to the log start (90.5),
+     * as time of day on the date of the log start (14:32:05.120) or as date and time (20161118-14:32:05.120).
+     * Times of day are interpreted in local time, like the timestamps shown during replay.
+     *
+     * @param input: Time to parse.
+     * @param logStart: Timestamp of the first sample.
+     * @param time: Parsed log time.
+     * @return True if the input could be parsed, false otherwise.
+     */
+    static bool parseTime(const std::string& input, const base::Time& logStart, base::Time& time);
+
+    /**
+     * @brief Parses a decimation of a port, given either as number of samples per replayed sample (10)
+     * or as maximum replay rate in log time (50Hz). An empty input means no decimation.
+     *
+     * @param input: Decimation to parse.
+     * @param keepEvery: Parsed number of samples per replayed sample, 1 if a rate is given.
+     * @param maxRate: Parsed maximum rate in samples per second, 0 if a number of samples is given.
+     * @return True if the input could be parsed, false otherwise.
+     */
+    static bool parseDecimation(const std::string& input, uint64_t& keepEvery, double& maxRate);
 };
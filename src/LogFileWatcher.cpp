@@ -0,0 +1,57 @@
+#include "LogFileWatcher.hpp"
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <thread>
+#include <unistd.h>
+
+LogFileWatcher::LogFileWatcher()
+    : fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+{
+}
+
+LogFileWatcher::~LogFileWatcher()
+{
+    // closing the descriptor removes all watches
+    if(fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+bool LogFileWatcher::watch(const std::vector<std::string>& fileNames)
+{
+    for(const std::string& fileName : fileNames)
+    {
+        if(fd < 0 || inotify_add_watch(fd, fileName.c_str(), IN_MODIFY | IN_CLOSE_WRITE) < 0)
+        {
+            watchingAll = false;
+        }
+    }
+
+    return watchingAll && fd >= 0;
+}
+
+bool LogFileWatcher::waitForChanges(std::chrono::milliseconds timeout)
+{
+    // unwatched files can only be polled, so every timeout may hide a change
+    if(fd < 0 || !watchingAll)
+    {
+        std::this_thread::sleep_for(timeout);
+        return true;
+    }
+
+    pollfd pollFd = {fd, POLLIN, 0};
+    if(poll(&pollFd, 1, timeout.count()) <= 0)
+    {
+        return false;
+    }
+
+    // the events only signal a change, the logfiles are checked by their size
+    alignas(inotify_event) char events[4096];
+    while(read(fd, events, sizeof(events)) > 0)
+    {
+    }
+
+    return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Helper class to wait for logfiles that are being written. Uses inotify, so waiting does not poll the files.
+ * If inotify is not available, waiting falls back to the given timeout and reports a possible change.
+ *
+ */
+class LogFileWatcher
+{
+public:
+    /**
+     * @brief Constructor.
+     *
+     */
+    LogFileWatcher();
+
+    /**
+     * @brief Destructor. Stops watching all files.
+     *
+     */
+    ~LogFileWatcher();
+
+    LogFileWatcher(const LogFileWatcher&) = delete;
+    LogFileWatcher& operator=(const LogFileWatcher&) = delete;
+
+    /**
+     * @brief Watches the given files for written data, in addition to the files watched before.
+     *
+     * @param fileNames: Names of the files to watch.
+     * @return bool True if all files are watched, false if a file does not exist or inotify is not available.
+     */
+    bool watch(const std::vector<std::string>& fileNames);
+
+    /**
+     * @brief Waits until data was written to a watched file. Pending notifications are consumed.
+     *
+     * @param timeout: Maximum time to wait.
+     * @return bool True if a watched file changed or a change cannot be excluded, false if the timeout elapsed without a change.
+     */
+    bool waitForChanges(std::chrono::milliseconds timeout);
+
+private:
+    /**
+     * @brief Inotify file descriptor, or -1 if inotify is not available.
+     *
+     */
+    int fd;
+
+    /**
+     * @brief Indicates whether all files passed to watch are watched.
+     *
+     */
+    bool watchingAll = true;
+};
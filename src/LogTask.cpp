@@ -1,19 +1,47 @@
 #include "LogTask.hpp"
 
+#include "CompressedLogFile.hpp"
 #include "LogFileHelper.hpp"
 
+#include <algorithm>
 #include <base-logging/Logging.hpp>
 #include <rtt/TaskContext.hpp>
+#include <rtt/base/ChannelElementBase.hpp>
 #include <rtt/base/OutputPortInterface.hpp>
+#include <rtt/internal/ConnectionManager.hpp>
 #include <rtt/transports/corba/CorbaDispatcher.hpp>
 #include <rtt/transports/corba/TaskContextServer.hpp>
 #include <rtt/typelib/TypelibMarshallerBase.hpp>
 #include <rtt/types/Types.hpp>
+#include <cmath>
 #include <string>
+#include <thread>
+
+LogTask::PreparedSample::PreparedSample()
+    : task(nullptr)
+    , portHandle(nullptr)
+    , streamIndex(0)
+    , indexInStream(0)
+    , transport(nullptr)
+    , transportHandle(nullptr)
+    , unmarshaled(false)
+{
+}
+
+LogTask::PreparedSample::~PreparedSample()
+{
+    sample.reset();
+    if(transportHandle)
+    {
+        transport->deleteHandle(transportHandle);
+    }
+}
 
 LogTask::LogTask(const std::string& taskName, const std::string& prefix, const std::string& renaming)
     : prefixedName(prefix + taskName)
     , originalName(taskName)
+    , lockstep(false)
+    , lockstepWindow(1)
 {
     try
     {
@@ -43,16 +71,42 @@ LogTask::~LogTask()
 
 void LogTask::activateLoggingForPort(const std::string& portName, bool activate)
 {
-    for(const auto& idx2Port : streamIdx2Port)
+    auto name2Port = portName2Port.find(portName);
+    if(name2Port != portName2Port.end())
     {
-        if(idx2Port.second->name == portName)
-        {
-            idx2Port.second->active = activate;
-        }
+        name2Port->second->active = activate;
     }
 }
 
-bool LogTask::addStream(pocolog_cpp::InputDataStream& stream)
+uint64_t LogTask::setDecimationForPort(const std::string& portName, uint64_t keepEvery, double maxRate)
+{
+    auto name2Port = portName2Port.find(portName);
+    if(name2Port == portName2Port.end())
+    {
+        return 0;
+    }
+
+    uint64_t decimation = std::max<uint64_t>(keepEvery, 1);
+    const pocolog_cpp::InputDataStream& stream = *name2Port->second->inputDataStream;
+    const double duration = (stream.getLastSampleTime() - stream.getFirstSampleTime()).toSeconds();
+    if(maxRate > 0 && stream.getSize() > 1 && duration > 0)
+    {
+        // the rate is rounded up to the next decimation, with a tolerance for streams at exactly a multiple of the cap
+        const double rate = (stream.getSize() - 1) / duration;
+        decimation = std::max(decimation, static_cast<uint64_t>(std::ceil(rate / maxRate - 1e-3)));
+    }
+
+    name2Port->second->decimation = decimation;
+    return decimation;
+}
+
+uint64_t LogTask::getDecimationForPort(const std::string& portName)
+{
+    auto name2Port = portName2Port.find(portName);
+    return name2Port != portName2Port.end() ? name2Port->second->decimation.load() : 0;
+}
+
+bool LogTask::addStream(pocolog_cpp::InputDataStream& stream, CompressedLogFile* compressedLog)
 {
     if(isStreamForThisTask(stream))
     {
@@ -61,7 +115,9 @@ bool LogTask::addStream(pocolog_cpp::InputDataStream& stream)
         auto portHandle = createPortHandle(portName, stream);
         if(portHandle && task && !task->getPort(portName))
         {
+            portHandle->compressedLog = compressedLog;
             task->ports()->addPort(portHandle->port->getName(), *portHandle->port);
+            portName2Port.emplace(portName, portHandle.get());
             streamIdx2Port.emplace(stream.getIndex(), std::move(portHandle));
             return true;
         }
@@ -105,33 +161,156 @@ std::unique_ptr<LogTask::PortHandle> LogTask::createPortHandle(const std::string
 
 bool LogTask::replaySample(uint64_t streamIndex, uint64_t indexInStream)
 {
-    auto& portHandle = streamIdx2Port.at(streamIndex);
+    return replaySample(*streamIdx2Port.at(streamIndex), indexInStream);
+}
 
+bool LogTask::replaySample(PortHandle& portHandle, uint64_t indexInStream)
+{
     bool canPortBeSkippedResult;
     if(canPortBeSkipped(canPortBeSkippedResult, portHandle))
     {
         return canPortBeSkippedResult;
     }
 
-    bool sampleCanBeUnmarshaled = unmarshalSample(portHandle, indexInStream);
+    LatencyHistogram::Timer timer;
+    size_t sampleSize;
+    bool sampleCanBeUnmarshaled = unmarshalSample(portHandle, indexInStream, sampleSize, timer);
     if(sampleCanBeUnmarshaled)
     {
-        checkTaskStateChange(portHandle);
-        portHandle->port->write(portHandle->sample);
+        checkTaskStateChange(portHandle, portHandle.sample);
+        writeToPort(portHandle, portHandle.sample);
+        timer.lap(portHandle.writeLatency);
+        portHandle.replayedSamples++;
+        portHandle.replayedBytes += sampleSize;
     }
 
     return sampleCanBeUnmarshaled;
 }
 
-bool LogTask::canPortBeSkipped(bool& result, std::unique_ptr<PortHandle>& portHandle)
+bool LogTask::readSample(PreparedSample& prepared, uint64_t streamIndex, uint64_t indexInStream)
+{
+    return readSample(prepared, *streamIdx2Port.at(streamIndex), indexInStream);
+}
+
+bool LogTask::readSample(PreparedSample& prepared, PortHandle& portHandle, uint64_t indexInStream)
+{
+    prepared.task = this;
+    prepared.portHandle = &portHandle;
+    prepared.streamIndex = portHandle.inputDataStream->getIndex();
+    prepared.indexInStream = indexInStream;
+    prepared.unmarshaled = false;
+    prepared.data.clear();
+
+    bool canPortBeSkippedResult;
+    if(canPortBeSkipped(canPortBeSkippedResult, portHandle))
+    {
+        return false;
+    }
+
+    LatencyHistogram::Timer timer;
+    if(!readSampleData(portHandle, indexInStream, prepared.data))
+    {
+        LOG_WARN_S << "Warning, could not replay sample: " << portHandle.inputDataStream->getName() << " " << indexInStream;
+        prepared.data.clear();
+        return false;
+    }
+
+    timer.lap(portHandle.readLatency);
+    return true;
+}
+
+LogTask::PortHandle* LogTask::getPortHandle(uint64_t streamIndex)
+{
+    auto idx2Port = streamIdx2Port.find(streamIndex);
+    if(idx2Port == streamIdx2Port.end())
+    {
+        return nullptr;
+    }
+
+    return idx2Port->second.get();
+}
+
+bool LogTask::readSampleData(PortHandle& portHandle, uint64_t indexInStream, std::vector<uint8_t>& data)
 {
-    if(!portHandle->active || !portHandle->port)
+    if(portHandle.compressedLog)
+    {
+        return portHandle.compressedLog->getSampleData(portHandle.inputDataStream->getIndex(), indexInStream, data);
+    }
+
+    return portHandle.inputDataStream->getSampleData(data, indexInStream);
+}
+
+bool LogTask::unmarshalSample(PreparedSample& prepared)
+{
+    if(prepared.data.empty())
+    {
+        return false;
+    }
+
+    auto* transport = prepared.portHandle->transport;
+    if(prepared.transport != transport)
+    {
+        if(prepared.transportHandle)
+        {
+            prepared.transport->deleteHandle(prepared.transportHandle);
+        }
+
+        prepared.transport = transport;
+        prepared.transportHandle = transport->createSample();
+        prepared.sample = transport->getDataSource(prepared.transportHandle);
+    }
+
+    LatencyHistogram::Timer timer;
+    try
+    {
+        transport->unmarshal(prepared.data, prepared.transportHandle);
+    }
+    catch(...)
+    {
+        LOG_ERROR_S << "caught marshall error...";
+        return false;
+    }
+
+    // the decoder threads of the pipeline unmarshal samples of the same port concurrently
+    timer.lapShared(prepared.portHandle->unmarshalLatency);
+    prepared.unmarshaled = true;
+    return true;
+}
+
+bool LogTask::writeSample(PreparedSample& prepared)
+{
+    auto& portHandle = *prepared.portHandle;
+
+    bool canPortBeSkippedResult;
+    if(canPortBeSkipped(canPortBeSkippedResult, portHandle))
+    {
+        return canPortBeSkippedResult;
+    }
+
+    if(!prepared.unmarshaled)
+    {
+        return false;
+    }
+
+    LatencyHistogram::Timer timer;
+    checkTaskStateChange(portHandle, prepared.sample);
+    writeToPort(portHandle, prepared.sample);
+    timer.lap(portHandle.writeLatency);
+    portHandle.replayedSamples++;
+    portHandle.replayedBytes += prepared.data.size();
+
+    return true;
+}
+
+bool LogTask::canPortBeSkipped(bool& result, PortHandle& portHandle)
+{
+    if(!portHandle.active || !portHandle.port)
     {
         result = false;
         return true;
     }
 
-    if(!portHandle->port->connected())
+    if(!portHandle.port->connected())
     {
         result = true;
         return true;
@@ -140,18 +319,20 @@ bool LogTask::canPortBeSkipped(bool& result, std::unique_ptr<PortHandle>& portHa
     return false;
 }
 
-bool LogTask::unmarshalSample(std::unique_ptr<PortHandle>& portHandle, uint64_t indexInStream)
+bool LogTask::unmarshalSample(PortHandle& portHandle, uint64_t indexInStream, size_t& sampleSize, LatencyHistogram::Timer& timer)
 {
-    std::vector<uint8_t> data;
-    if(!portHandle->inputDataStream.getSampleData(data, indexInStream))
+    if(!readSampleData(portHandle, indexInStream, portHandle.buffer))
     {
-        LOG_WARN_S << "Warning, could not replay sample: " << portHandle->inputDataStream.getName() << " " << indexInStream;
+        LOG_WARN_S << "Warning, could not replay sample: " << portHandle.inputDataStream->getName() << " " << indexInStream;
         return false;
     }
 
+    timer.lap(portHandle.readLatency);
+    sampleSize = portHandle.buffer.size();
+
     try
     {
-        portHandle->transport->unmarshal(data, portHandle->transportHandle);
+        portHandle.transport->unmarshal(portHandle.buffer, portHandle.transportHandle);
     }
     catch(...)
     {
@@ -159,14 +340,75 @@ bool LogTask::unmarshalSample(std::unique_ptr<PortHandle>& portHandle, uint64_t
         return false;
     }
 
+    timer.lap(portHandle.unmarshalLatency);
     return true;
 }
 
-void LogTask::checkTaskStateChange(std::unique_ptr<PortHandle>& portHandle)
+void LogTask::writeToPort(PortHandle& portHandle, RTT::base::DataSourceBase::shared_ptr sample)
 {
-    if(portHandle->name == "state")
+    if(!lockstep)
     {
-        switch(std::stoi(portHandle->sample.get()->toString()))
+        portHandle.port->write(sample);
+        return;
+    }
+
+    constexpr std::chrono::microseconds maxBackoff(1000);
+    std::chrono::microseconds backoff(10);
+    const auto blockStart = std::chrono::steady_clock::now();
+    bool blocked = false;
+
+    // the sample is written once when all connections can take it, so that no consumer receives it twice
+    while(lockstep && !hasFreeWindow(portHandle))
+    {
+        blocked = true;
+        std::this_thread::sleep_for(backoff);
+        backoff = std::min(backoff * 2, maxBackoff);
+    }
+    portHandle.port->write(sample);
+
+    if(blocked)
+    {
+        portHandle.blockedNanoseconds +=
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - blockStart).count();
+    }
+}
+
+bool LogTask::hasFreeWindow(PortHandle& portHandle)
+{
+    const size_t window = lockstepWindow;
+    for(const auto& connection : portHandle.port->getManager()->getConnections())
+    {
+        // the buffer of a local or pull connection is found on the writing side of its channel
+        RTT::base::ChannelBufferElementBase* buffer = nullptr;
+        for(RTT::base::ChannelElementBase::shared_ptr channel = connection.get<1>(); channel && !buffer; channel = channel->getOutput())
+        {
+            buffer = dynamic_cast<RTT::base::ChannelBufferElementBase*>(channel.get());
+        }
+
+        if(!buffer)
+        {
+            if(!portHandle.withoutBackpressure.exchange(true))
+            {
+                LOG_ERROR_S << "lockstep cannot wait for a consumer of port " << portHandle.name
+                            << ", only buffered local or pull connections report unread samples, the consumer may miss samples";
+            }
+            continue;
+        }
+
+        if(buffer->getBufferFillSize() >= std::min(window, buffer->getBufferSize()))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void LogTask::checkTaskStateChange(PortHandle& portHandle, RTT::base::DataSourceBase::shared_ptr sample)
+{
+    if(portHandle.name == "state")
+    {
+        switch(std::stoi(sample.get()->toString()))
         {
         case 0: // INIT
             task->configure();
@@ -197,18 +439,55 @@ bool LogTask::isStreamForThisTask(const pocolog_cpp::InputDataStream& inputStrea
     return prefixedName.find(taskName) != std::string::npos || originalName.find(taskName) != std::string::npos;
 }
 
+void LogTask::setLockstep(bool lockstep, size_t window)
+{
+    lockstepWindow = std::max<size_t>(window, 1);
+    this->lockstep = lockstep;
+}
+
 LogTask::PortCollection LogTask::getPortCollection()
 {
     PortCollection collection;
     for(const auto& portHandlePair : streamIdx2Port)
     {
         const auto& portHandle = portHandlePair.second;
-        collection.emplace_back(portHandle->name, portHandle->inputDataStream.getCXXType());
+        collection.emplace_back(portHandle->name, portHandle->inputDataStream->getCXXType());
     }
 
     return collection;
 }
 
+LogTask::ReplayStatisticsCollection LogTask::getReplayStatistics()
+{
+    ReplayStatisticsCollection statistics;
+    for(const auto& portHandlePair : streamIdx2Port)
+    {
+        const auto& portHandle = portHandlePair.second;
+        statistics.emplace(
+            portHandle->name,
+            ReplayStatistics{
+                portHandle->replayedSamples, portHandle->replayedBytes, std::chrono::nanoseconds(portHandle->blockedNanoseconds),
+                portHandle->withoutBackpressure,
+                portHandle->readLatency.getSummary(), portHandle->unmarshalLatency.getSummary(), portHandle->writeLatency.getSummary()});
+    }
+
+    return statistics;
+}
+
+void LogTask::resetReplayStatistics()
+{
+    for(const auto& portHandlePair : streamIdx2Port)
+    {
+        portHandlePair.second->replayedSamples = 0;
+        portHandlePair.second->replayedBytes = 0;
+        portHandlePair.second->blockedNanoseconds = 0;
+        portHandlePair.second->withoutBackpressure = false;
+        portHandlePair.second->readLatency.reset();
+        portHandlePair.second->unmarshalLatency.reset();
+        portHandlePair.second->writeLatency.reset();
+    }
+}
+
 std::string LogTask::getName()
 {
     return prefixedName;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "LatencyHistogram.hpp"
+
 #include <orocos_cpp/orocos_cpp.hpp>
 #include <pocolog_cpp/InputDataStream.hpp>
 #include <rtt/TaskContext.hpp>
@@ -8,7 +10,13 @@
 #include <rtt/transports/corba/TaskContextServer.hpp>
 #include <rtt/typelib/TypelibMarshallerBase.hpp>
 #include <rtt/types/Types.hpp>
+#include <atomic>
+#include <chrono>
+#include <map>
 #include <string>
+#include <unordered_map>
+
+class CompressedLogFile;
 
 /**
  * @brief Class that represents a LogTask instance. It contains a pointer to a Orocos task
@@ -17,6 +25,7 @@
  */
 class LogTask
 {
+public:
     /**
      * @brief Struct that contains all port-related orocos data types.
      *
@@ -44,10 +53,26 @@ class LogTask
             , transportHandle(transportHandle)
             , port(port)
             , active(active)
-            , inputDataStream(inputDataStream)
+            , inputDataStream(&inputDataStream)
+            , decimation(1)
+            , replayedSamples(0)
+            , replayedBytes(0)
+            , blockedNanoseconds(0)
+            , withoutBackpressure(false)
         {
         }
 
+        /**
+         * @brief Returns whether a sample is skipped by the decimation of the port.
+         *
+         * @param indexInStream: Sample position in the stream of the port.
+         * @return bool True if the sample is skipped, false if it is replayed.
+         */
+        bool isDecimated(uint64_t indexInStream) const
+        {
+            return indexInStream % decimation.load(std::memory_order_relaxed) != 0;
+        };
+
         /**
          * @brief Name of port.
          *
@@ -85,13 +110,207 @@ class LogTask
         bool active;
 
         /**
-         * @brief Related InputDataStream from Logfile.
+         * @brief Related InputDataStream from Logfile. Is replaced if a growing logfile is reopened.
+         *
+         */
+        pocolog_cpp::InputDataStream* inputDataStream;
+
+        /**
+         * @brief Compressed logfile holding the marshaled samples, nullptr if they are read from the InputDataStream.
+         *
+         */
+        CompressedLogFile* compressedLog = nullptr;
+
+        /**
+         * @brief Buffer for the marshaled data of the replayed sample. It keeps its capacity,
+         * so that no memory is allocated once the largest sample of the port was read.
+         *
+         */
+        std::vector<uint8_t> buffer;
+
+        /**
+         * @brief Number of samples per replayed sample. Only the samples whose position in the stream is a multiple
+         * are replayed, so that the decision needs neither the sample nor the previously replayed ones.
+         *
+         */
+        std::atomic<uint64_t> decimation;
+
+        /**
+         * @brief Number of samples written to the port.
+         *
+         */
+        std::atomic<uint64_t> replayedSamples;
+
+        /**
+         * @brief Number of marshaled bytes written to the port.
+         *
+         */
+        std::atomic<uint64_t> replayedBytes;
+
+        /**
+         * @brief Time in nanoseconds the replay was blocked by consumers of the port in lockstep mode.
+         *
+         */
+        std::atomic<uint64_t> blockedNanoseconds;
+
+        /**
+         * @brief Indicates whether a connection of the port could not hold back the replay in lockstep mode.
          *
          */
-        pocolog_cpp::InputDataStream& inputDataStream;
+        std::atomic<bool> withoutBackpressure;
+
+        /**
+         * @brief Durations of reading marshaled samples from the logfile.
+         *
+         */
+        LatencyHistogram readLatency;
+
+        /**
+         * @brief Durations of unmarshaling samples.
+         *
+         */
+        LatencyHistogram unmarshalLatency;
+
+        /**
+         * @brief Durations of writing samples to the port, including the time blocked in lockstep mode.
+         *
+         */
+        LatencyHistogram writeLatency;
     };
 
-public:
+    /**
+     * @brief Sample that is read and unmarshaled ahead of its replay. It owns its own
+     * typelib sample, so that several samples of the same port can be prepared at once.
+     *
+     */
+    struct PreparedSample
+    {
+        /**
+         * @brief Constructor.
+         *
+         */
+        PreparedSample();
+
+        /**
+         * @brief Destructor. Deletes the owned typelib sample.
+         *
+         */
+        ~PreparedSample();
+
+        PreparedSample(const PreparedSample&) = delete;
+        PreparedSample& operator=(const PreparedSample&) = delete;
+
+        /**
+         * @brief LogTask the sample belongs to.
+         *
+         */
+        LogTask* task;
+
+        /**
+         * @brief Port the sample belongs to.
+         *
+         */
+        PortHandle* portHandle;
+
+        /**
+         * @brief Global stream index from logfile.
+         *
+         */
+        uint64_t streamIndex;
+
+        /**
+         * @brief Sample position in that stream.
+         *
+         */
+        uint64_t indexInStream;
+
+        /**
+         * @brief Marshaled sample data as read from the logfile.
+         *
+         */
+        std::vector<uint8_t> data;
+
+        /**
+         * @brief Orogen transport that created the owned typelib sample.
+         *
+         */
+        orogen_transports::TypelibMarshallerBase* transport;
+
+        /**
+         * @brief Owned orogen transport handle.
+         *
+         */
+        orogen_transports::TypelibMarshallerBase::Handle* transportHandle;
+
+        /**
+         * @brief Sample containing the unmarshaled data.
+         *
+         */
+        RTT::base::DataSourceBase::shared_ptr sample;
+
+        /**
+         * @brief Indicates whether the sample was unmarshaled and can be written.
+         *
+         */
+        bool unmarshaled;
+    };
+
+    /**
+     * @brief Amount of data written to a port.
+     *
+     */
+    struct ReplayStatistics
+    {
+        /**
+         * @brief Number of written samples.
+         *
+         */
+        uint64_t samples;
+
+        /**
+         * @brief Number of written bytes, measured as marshaled size.
+         *
+         */
+        uint64_t bytes;
+
+        /**
+         * @brief Time the replay was blocked by consumers of the port in lockstep mode.
+         *
+         */
+        std::chrono::nanoseconds blockedTime;
+
+        /**
+         * @brief Indicates whether a connection of the port could not hold back the replay in lockstep mode, so that its
+         * consumer may have missed samples.
+         *
+         */
+        bool withoutBackpressure;
+
+        /**
+         * @brief Durations of reading the written samples from the logfile. Empty if the replay is built without latency histograms.
+         *
+         */
+        LatencyHistogram::Summary readLatency;
+
+        /**
+         * @brief Durations of unmarshaling the written samples.
+         *
+         */
+        LatencyHistogram::Summary unmarshalLatency;
+
+        /**
+         * @brief Durations of writing the samples to the port.
+         *
+         */
+        LatencyHistogram::Summary writeLatency;
+    };
+
+    /**
+     * @brief Alias for map of port names to their ReplayStatistics.
+     *
+     */
+    using ReplayStatisticsCollection = std::map<std::string, ReplayStatistics>;
+
     /**
      * @brief Alias for pair of port name and port type.
      *
@@ -125,9 +344,10 @@ public:
      * stream, or the stream does not contain data for the task model (name-based check).
      *
      * @param stream: InputDataStream from logfile containing port samples.
+     * @param compressedLog: Compressed logfile holding the marshaled samples of the stream, nullptr if the stream holds them.
      * @return bool True if stream was added, false otherwise.
      */
-    bool addStream(pocolog_cpp::InputDataStream& stream);
+    bool addStream(pocolog_cpp::InputDataStream& stream, CompressedLogFile* compressedLog = nullptr);
 
     /**
      * @brief Replays a given sample by global stream index and position in that stream.
@@ -137,6 +357,62 @@ public:
      */
     bool replaySample(uint64_t streamIndex, uint64_t indexInStream);
 
+    /**
+     * @brief Replays a given sample of a port without looking up the port by stream index.
+     *
+     * @param portHandle: PortHandle of the task, as returned by getPortHandle.
+     * @param indexInStream: Sample position in the stream of the port.
+     * @return bool True if the sample was replayed successfully, false otherwise.
+     */
+    bool replaySample(PortHandle& portHandle, uint64_t indexInStream);
+
+    /**
+     * @brief Returns the PortHandle for a stream index. Lookups can be done once and the
+     * handle used for all samples of the stream, as handles are valid during the task's lifetime.
+     *
+     * @param streamIndex: Global stream index from logfile.
+     * @return PortHandle* PortHandle of the stream, or nullptr if the stream was not added to the task.
+     */
+    PortHandle* getPortHandle(uint64_t streamIndex);
+
+    /**
+     * @brief Reads the marshaled data of a sample without replaying it. First stage of a pipelined replay.
+     * Reading is skipped if the port is disabled, invalid or not connected.
+     *
+     * @param prepared: Sample to read the data into.
+     * @param streamIndex: Global stream index from logfile.
+     * @param indexInStream: Sample position in that stream.
+     * @return bool True if the data was read, false otherwise.
+     */
+    bool readSample(PreparedSample& prepared, uint64_t streamIndex, uint64_t indexInStream);
+
+    /**
+     * @brief Reads the marshaled data of a sample of a port without looking up the port by stream index.
+     *
+     * @param prepared: Sample to read the data into.
+     * @param portHandle: PortHandle of the task, as returned by getPortHandle.
+     * @param indexInStream: Sample position in the stream of the port.
+     * @return bool True if the data was read, false otherwise.
+     */
+    bool readSample(PreparedSample& prepared, PortHandle& portHandle, uint64_t indexInStream);
+
+    /**
+     * @brief Unmarshals the data of a read sample into its own typelib sample. Second stage of a pipelined replay.
+     * Can be called concurrently for different prepared samples.
+     *
+     * @param prepared: Sample to unmarshal.
+     * @return bool True if the sample was unmarshaled, false otherwise.
+     */
+    bool unmarshalSample(PreparedSample& prepared);
+
+    /**
+     * @brief Writes an unmarshaled sample to its port. Last stage of a pipelined replay.
+     *
+     * @param prepared: Sample to write.
+     * @return bool Same result as for replaySample.
+     */
+    bool writeSample(PreparedSample& prepared);
+
     /**
      * @brief Activates logging for that port.
      * If disabled, replaying does nothing for the port.
@@ -146,6 +422,39 @@ public:
      */
     void activateLoggingForPort(const std::string& portName, bool activate = true);
 
+    /**
+     * @brief Sets the decimation of a port, so that only every keepEvery-th sample is replayed and the replay rate in log time
+     * stays below maxRate. A rate cap is converted into a decimation with the average sample rate of the port's stream,
+     * which matches periodic streams like IMUs or cameras.
+     *
+     * @param portName: Name of the port.
+     * @param keepEvery: Number of samples per replayed sample, 1 replays every sample.
+     * @param maxRate: Maximum replay rate in samples per second of log time, 0 for no rate cap.
+     * @return uint64_t Resulting number of samples per replayed sample, 0 if the port is unknown.
+     */
+    uint64_t setDecimationForPort(const std::string& portName, uint64_t keepEvery, double maxRate = 0);
+
+    /**
+     * @brief Returns the decimation of a port.
+     *
+     * @param portName: Name of the port.
+     * @return uint64_t Number of samples per replayed sample, 0 if the port is unknown.
+     */
+    uint64_t getDecimationForPort(const std::string& portName);
+
+    /**
+     * @brief Enables or disables the lockstep mode. In lockstep mode, a sample is written once every connection of
+     * the port holds less than the window of unread samples, i.e. with a window of 1 once the consumers read the
+     * previous sample. Thus, replay runs as fast as the slowest consumer without dropping samples. The unread samples
+     * are counted in the connection buffers on the writing side, so only buffered local or pull connections can hold
+     * back the replay. Other connections, e.g. data connections or remote push connections, are reported as error and
+     * marked in the ReplayStatistics. Disabling the mode aborts pending writes.
+     *
+     * @param lockstep: True if lockstep mode should be enabled, false otherwise.
+     * @param window: Maximum number of unread samples per connection, limited by the connection's buffer size.
+     */
+    void setLockstep(bool lockstep, size_t window = 1);
+
     /**
      * @brief Returns the PortCollection of all ports this task owns.
      *
@@ -153,6 +462,19 @@ public:
      */
     PortCollection getPortCollection();
 
+    /**
+     * @brief Returns the amount of data written to each port and the durations of its replay stages since the last reset.
+     *
+     * @return ReplayStatisticsCollection Map of port names to their ReplayStatistics.
+     */
+    ReplayStatisticsCollection getReplayStatistics();
+
+    /**
+     * @brief Resets the ReplayStatistics of all ports.
+     *
+     */
+    void resetReplayStatistics();
+
     /**
      * @brief Returns the task's name.
      *
@@ -184,24 +506,55 @@ private:
      * @param portHandle: Handle to check.
      * @return bool True if port can be skipped because there is no need to replay, false otherwise.
      */
-    bool canPortBeSkipped(bool& result, std::unique_ptr<PortHandle>& portHandle);
+    bool canPortBeSkipped(bool& result, PortHandle& portHandle);
+
+    /**
+     * @brief Reads a marshaled sample, either from the InputDataStream or from the compressed logfile of the port.
+     *
+     * @param portHandle: Port to read the sample for.
+     * @param indexInStream: Position of the sample in the InputDataStream.
+     * @param data: Read sample.
+     * @return bool True if the sample was read, false otherwise.
+     */
+    bool readSampleData(PortHandle& portHandle, uint64_t indexInStream, std::vector<uint8_t>& data);
+
     /**
      * @brief Unmarshals a given sample from the corresponding InputDataStream.
      * An unmarshaled sample is then hold in the handle's sample pointer.
      *
      * @param portHandle: Port to use for unmarshaling.
      * @param indexInStream: Position of sample to unmarshal in InputDataStream.
+     * @param sampleSize: Marshaled size of the sample.
+     * @param timer: Timer of the sample's replay, records the read and unmarshal stages.
      * @return bool True if unmarshaling was performed successfully, false otherwise.
      */
+    bool unmarshalSample(PortHandle& portHandle, uint64_t indexInStream, size_t& sampleSize, LatencyHistogram::Timer& timer);
 
-    bool unmarshalSample(std::unique_ptr<PortHandle>& portHandle, uint64_t indexInStream);
+    /**
+     * @brief Writes a sample to the port of the given PortHandle. In lockstep mode,
+     * writing waits until every connection of the port has a free window.
+     *
+     * @param portHandle: PortHandle to write to.
+     * @param sample: Unmarshaled sample to write.
+     */
+    void writeToPort(PortHandle& portHandle, RTT::base::DataSourceBase::shared_ptr sample);
+
+    /**
+     * @brief Checks whether every connection of a port holds less unread samples than the lockstep window.
+     * Connections without a buffer on the writing side are reported once and ignored.
+     *
+     * @param portHandle: PortHandle whose connections are checked.
+     * @return bool True if a sample can be written without exceeding the window, false otherwise.
+     */
+    bool hasFreeWindow(PortHandle& portHandle);
 
     /**
      * @brief Checks whether the given PortHandle is a state port and applies a task state change.
      *
      * @param portHandle: PortHandle to check.
+     * @param sample: Unmarshaled sample that is written to the port.
      */
-    void checkTaskStateChange(std::unique_ptr<PortHandle>& portHandle);
+    void checkTaskStateChange(PortHandle& portHandle, RTT::base::DataSourceBase::shared_ptr sample);
 
     /**
      * @brief Checks is the given stream is suitable for the task model.
@@ -230,10 +583,28 @@ private:
      */
     std::unique_ptr<RTT::TaskContext> task;
 
+    /**
+     * @brief Indicator if the lockstep mode is enabled.
+     *
+     */
+    std::atomic<bool> lockstep;
+
+    /**
+     * @brief Maximum number of unread samples per connection in lockstep mode.
+     *
+     */
+    std::atomic<size_t> lockstepWindow;
+
     /**
      * @brief Map of global stream indices to corresponding port handles.
      * Is deleted automatically on LogTask destructor call.
      *
      */
     std::map<uint64_t, std::unique_ptr<PortHandle>> streamIdx2Port;
+
+    /**
+     * @brief Map of port names to corresponding port handles, owned by streamIdx2Port.
+     *
+     */
+    std::unordered_map<std::string, PortHandle*> portName2Port;
 };
@@ -1,9 +1,23 @@
 #include "LogTaskManager.hpp"
 
+#include "IndexCache.hpp"
 #include "LogFileHelper.hpp"
+#include "PocologWriter.hpp"
+#include "WorkerPool.hpp"
 
+#include <algorithm>
 #include <base-logging/Logging.hpp>
+#include <boost/filesystem.hpp>
 #include <orocos_cpp/orocos_cpp.hpp>
+#include <set>
+#include <sys/stat.h>
+
+/**
+ * @brief Number of samples the sample index reserves for following growing logfiles.
+ * It costs address space only, until samples are appended.
+ *
+ */
+static const size_t followReserve = size_t(1) << 28;
 
 LogTaskManager::LogTaskManager()
 {
@@ -11,96 +25,773 @@ LogTaskManager::LogTaskManager()
     orocos.initialize(config);
 }
 
-void LogTaskManager::init(
+bool LogTaskManager::init(
     const std::vector<std::string>& fileNames, const std::string& prefix, const std::vector<std::string>& whiteList,
-    const std::map<std::string, std::string>& renamings)
+    const std::map<std::string, std::string>& renamings, const ProgressCallback& progress, const TimeWindow& window)
 {
+    clear();
+    initCancelled = false;
     this->prefix = prefix;
     this->renamings = renamings;
-    
-    streamName2LogTask.clear();
-    multiFileIndex = pocolog_cpp::MultiFileIndex(false);
-    multiFileIndex.registerStreamCheck([&](pocolog_cpp::Stream* st) {
-        LOG_INFO_S << "Checking " << st->getName();
 
-        if(LogFileHelper::isWhiteListed(st->getName(), whiteList))
+    // opening and ordering the files are reported as halves of the progress
+    const auto fileTimeRanges = openLogFiles(fileNames, whiteList, [&](size_t openedFiles) {
+        if(progress)
+        {
+            progress(0.5 * openedFiles / fileNames.size());
+        }
+    });
+
+    base::Time windowStart;
+    base::Time windowEnd;
+    applyTimeWindow(window, fileTimeRanges, windowStart, windowEnd);
+    auto isOutsideWindow = [&](pocolog_cpp::InputDataStream& inputStream) {
+        if(windowStart.isNull() && windowEnd.isNull())
+        {
+            return false;
+        }
+
+        const auto range = SampleIndex::getStreamRange(inputStream, windowStart, windowEnd);
+        return range.first == range.second;
+    };
+
+    // typekits are loaded once per model while the streams are added, so that tasks show up one after another
+    for(size_t fileIdx = 0; fileIdx < logFiles.size(); fileIdx++)
+    {
+        fileStreams.emplace_back();
+        fileMutexes.emplace_back(new std::mutex());
+        for(pocolog_cpp::Stream* stream : logFiles[fileIdx]->getStreams())
+        {
+            if(initCancelled)
+            {
+                return false;
+            }
+
+            LOG_INFO_S << "Checking " << stream->getName();
+
+            pocolog_cpp::InputDataStream* inputStream = dynamic_cast<pocolog_cpp::InputDataStream*>(stream);
+            if(!LogFileHelper::isWhiteListed(stream->getName(), whiteList))
+            {
+                LOG_INFO_S << "Skipping non-whitelisted stream " << stream->getName();
+            }
+            else if(inputStream && isOutsideWindow(*inputStream))
+            {
+                LOG_INFO_S << "Skipping stream without samples in the time window " << stream->getName();
+            }
+            else if(inputStream && (indexOnly || loadTypekitsAndAddStreamToLogTask(*inputStream, compressedLogs[fileIdx].get())))
+            {
+                fileStreams.back().push_back(inputStream);
+            }
+        }
+    }
+
+    // the stream table is complete before the first sample is published, so that the prefix can be replayed during indexing
+    buildStreamTable(fileStreams);
+    return loadOrBuildSampleIndex(fileNames, fileStreams, progress, windowStart, windowEnd);
+}
+
+void LogTaskManager::applyTimeWindow(
+    const TimeWindow& window, const std::vector<std::pair<base::Time, base::Time>>& fileTimeRanges, base::Time& windowStart,
+    base::Time& windowEnd)
+{
+    windowStart = base::Time();
+    windowEnd = base::Time();
+    if(window.start.empty() && window.end.empty())
+    {
+        return;
+    }
+
+    base::Time logStart;
+    for(const auto& fileTimeRange : fileTimeRanges)
+    {
+        if(!fileTimeRange.first.isNull() && (logStart.isNull() || fileTimeRange.first < logStart))
+        {
+            logStart = fileTimeRange.first;
+        }
+    }
+
+    if(!window.start.empty() && !LogFileHelper::parseTime(window.start, logStart, windowStart))
+    {
+        LOG_WARN_S << "invalid start time " << window.start << ", loading from the log start";
+    }
+
+    if(!window.end.empty() && !LogFileHelper::parseTime(window.end, logStart, windowEnd))
+    {
+        LOG_WARN_S << "invalid end time " << window.end << ", loading until the log end";
+    }
+
+    // the logfiles are closed before their streams are added, so that neither their typekits nor their samples are loaded
+    for(size_t fileIdx = fileTimeRanges.size(); fileIdx-- > 0;)
+    {
+        const auto& fileTimeRange = fileTimeRanges[fileIdx];
+        if(fileTimeRange.first.isNull() || (!windowEnd.isNull() && fileTimeRange.first > windowEnd) ||
+           (!windowStart.isNull() && fileTimeRange.second < windowStart))
         {
-            pocolog_cpp::InputDataStream* inputSt = dynamic_cast<pocolog_cpp::InputDataStream*>(st);
-            return loadTypekitsAndAddStreamToLogTask(*inputSt);
+            LOG_INFO_S << "Skipping logfile outside of the time window " << logFiles[fileIdx]->getFileName();
+            logFiles.erase(logFiles.begin() + fileIdx);
+            fileSizes.erase(fileSizes.begin() + fileIdx);
+            compressedLogs.erase(compressedLogs.begin() + fileIdx);
+        }
+    }
+}
+
+void LogTaskManager::clear()
+{
+    // the published samples are withdrawn first, log tasks and indices refer to the streams of the logfiles
+    sampleIndex.clear();
+    {
+        std::lock_guard<std::mutex> lock(selectionMutex);
+        replayEntry = nullptr;
+    }
+    streamTable.clear();
+    {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        taskName2LogTask.clear();
+    }
+    fileStreams.clear();
+    logFiles.clear();
+    fileSizes.clear();
+    compressedLogs.clear();
+    fileMutexes.clear();
+}
+
+void LogTaskManager::setFollowing(bool following)
+{
+    this->following = following;
+    sampleIndex.setReserve(following ? followReserve : 0);
+}
+
+void LogTaskManager::setIndexOnly(bool indexOnly)
+{
+    this->indexOnly = indexOnly;
+}
+
+void LogTaskManager::setDecimations(const std::vector<std::pair<std::string, Decimation>>& decimations)
+{
+    this->decimations.clear();
+    for(const auto& decimation : decimations)
+    {
+        this->decimations.emplace_back(std::regex(decimation.first), decimation.second);
+    }
+}
+
+size_t LogTaskManager::appendNewSamples()
+{
+    // pocolog streams cannot grow, so a grown logfile is opened again and its streams replace the indexed ones. Scanning only the
+    // appended blocks would need a sample reader besides pocolog_cpp::Index, whose entries cannot be added to, as the samples,
+    // their sizes and the typekits of their streams are all read through it
+    std::vector<std::unique_ptr<pocolog_cpp::LogFile>> reopenedFiles(logFiles.size());
+    std::vector<std::vector<pocolog_cpp::InputDataStream*>> extendedStreams = fileStreams;
+    bool reopened = false;
+    for(size_t fileIdx = 0; fileIdx < logFiles.size(); fileIdx++)
+    {
+        const std::string fileName = logFiles[fileIdx]->getFileName();
+        struct stat fileStat;
+        // compressed logfiles are complete, the size of their header log is not comparable either
+        if(fileStreams[fileIdx].empty() || compressedLogs[fileIdx] || stat(fileName.c_str(), &fileStat) ||
+           fileStat.st_size <= fileSizes[fileIdx])
+        {
+            continue;
+        }
+
+        try
+        {
+            reopenedFiles[fileIdx].reset(new pocolog_cpp::LogFile(fileName, false));
+        }
+        catch(const std::exception& e)
+        {
+            // e.g. a sample that is only partially written, the logfile is opened again on its next change
+            LOG_WARN_S << "cannot reopen logfile " << fileName << ": " << e.what();
+            continue;
+        }
+
+        // the streams keep their index in the logfile when it grows
+        const std::vector<pocolog_cpp::Stream*>& reopenedStreams = reopenedFiles[fileIdx]->getStreams();
+        for(pocolog_cpp::InputDataStream*& stream : extendedStreams[fileIdx])
+        {
+            auto reopenedStream = std::find_if(reopenedStreams.begin(), reopenedStreams.end(), [&](pocolog_cpp::Stream* reopenedStream) {
+                return reopenedStream->getIndex() == stream->getIndex();
+            });
+            stream = reopenedStream != reopenedStreams.end() ? dynamic_cast<pocolog_cpp::InputDataStream*>(*reopenedStream) : nullptr;
+        }
+
+        if(std::find(extendedStreams[fileIdx].begin(), extendedStreams[fileIdx].end(), nullptr) != extendedStreams[fileIdx].end())
+        {
+            LOG_WARN_S << "streams of logfile " << fileName << " changed, it is not followed";
+            extendedStreams[fileIdx] = fileStreams[fileIdx];
+            reopenedFiles[fileIdx].reset();
         }
         else
         {
-            LOG_INFO_S << "Skipping non-whitelisted stream " << st->getName();
+            fileSizes[fileIdx] = fileStat.st_size;
+            reopened = true;
+        }
+    }
+
+    if(!reopened)
+    {
+        return 0;
+    }
+
+    {
+        // the streams are replaced while no sample is selected, read or listed
+        std::lock_guard<std::mutex> selectionLock(selectionMutex);
+        std::lock_guard<std::mutex> taskLock(taskMutex);
+        size_t streamIdx = 0;
+        for(size_t fileIdx = 0; fileIdx < logFiles.size(); fileIdx++)
+        {
+            std::lock_guard<std::mutex> fileLock(*fileMutexes[fileIdx]);
+            for(pocolog_cpp::InputDataStream* stream : extendedStreams[fileIdx])
+            {
+                StreamEntry& entry = streamTable.at(streamIdx++);
+                entry.stream = stream;
+                if(entry.portHandle)
+                {
+                    entry.portHandle->inputDataStream = stream;
+                }
+            }
+
+            // the replaced logfile is closed after the sample index stopped referring to its streams
+            if(reopenedFiles[fileIdx])
+            {
+                logFiles[fileIdx].swap(reopenedFiles[fileIdx]);
+            }
+        }
+    }
+
+    fileStreams = extendedStreams;
+    std::vector<std::mutex*> mutexes;
+    for(const auto& fileMutex : fileMutexes)
+    {
+        mutexes.push_back(fileMutex.get());
+    }
+
+    return sampleIndex.extend(fileStreams, mutexes);
+}
+
+bool LogTaskManager::canAppendSamples()
+{
+    for(size_t fileIdx = 0; fileIdx < logFiles.size(); fileIdx++)
+    {
+        if(!fileStreams[fileIdx].empty() && !compressedLogs[fileIdx])
+        {
+            return sampleIndex.isExtensible();
+        }
+    }
+
+    return false;
+}
+
+void LogTaskManager::cancelInit()
+{
+    initCancelled = true;
+    sampleIndex.cancel();
+}
+
+bool LogTaskManager::loadOrBuildSampleIndex(
+    const std::vector<std::string>& fileNames, const std::vector<std::vector<pocolog_cpp::InputDataStream*>>& fileStreams,
+    const ProgressCallback& progress, const base::Time& windowStart, const base::Time& windowEnd)
+{
+    const std::string cacheKey = IndexCache::getSessionKey(fileNames, fileStreams, windowStart, windowEnd);
+    const std::string cacheFileName = fileStreams.empty() || following ? "" : IndexCache::getCacheFileName(cacheKey);
+    if(!cacheFileName.empty() && sampleIndex.load(cacheFileName, cacheKey, fileStreams, windowStart, windowEnd))
+    {
+        LOG_INFO_S << "Loaded sample index from " << cacheFileName;
+        IndexCache::touch(cacheFileName);
+        if(progress)
+        {
+            progress(1.);
         }
+        return true;
+    }
+
+    std::vector<std::mutex*> mutexes;
+    for(const auto& fileMutex : fileMutexes)
+    {
+        mutexes.push_back(fileMutex.get());
+    }
+
+    const bool complete = sampleIndex.build(
+        fileStreams, mutexes,
+        [&](double indexedShare) {
+            if(progress)
+            {
+                progress(0.5 + 0.5 * indexedShare);
+            }
+        },
+        windowStart, windowEnd);
 
+    // streams beyond the limits of the sample index are not indexed at all, rather than replaying a part of them
+    if(!complete && sampleIndex.getStreams().empty() && !streamTable.empty())
+    {
+        LOG_ERROR_S << "cannot replay the logfiles, their samples are not indexed";
         return false;
-    });
+    }
+
+    if(complete && !cacheFileName.empty())
+    {
+        if(sampleIndex.save(cacheFileName, cacheKey))
+        {
+            IndexCache::evict(cacheFileName);
+        }
+        else
+        {
+            LOG_WARN_S << "cannot write sample index cache " << cacheFileName;
+        }
+    }
+
+    return complete;
+}
+
+void LogTaskManager::buildStreamTable(const std::vector<std::vector<pocolog_cpp::InputDataStream*>>& fileStreams)
+{
+    std::lock_guard<std::mutex> lock(taskMutex);
+    streamTable.clear();
+
+    for(size_t fileIdx = 0; fileIdx < fileStreams.size(); fileIdx++)
+    {
+        for(pocolog_cpp::InputDataStream* stream : fileStreams[fileIdx])
+        {
+            streamTable.push_back(createStreamEntry(*stream, *fileMutexes.at(fileIdx)));
+        }
+    }
+}
+
+LogTaskManager::StreamEntry LogTaskManager::createStreamEntry(pocolog_cpp::InputDataStream& stream, std::mutex& fileMutex)
+{
+    StreamEntry entry = {&stream, &fileMutex, nullptr, nullptr};
+
+    auto taskNameTaskPair = taskName2LogTask.find(LogFileHelper::splitStreamName(stream.getName()).first);
+    if(taskNameTaskPair != taskName2LogTask.end())
+    {
+        // a handle with the same stream index may belong to a stream of another file
+        LogTask::PortHandle* portHandle = taskNameTaskPair->second->getPortHandle(stream.getIndex());
+        if(portHandle && portHandle->inputDataStream == entry.stream)
+        {
+            entry.task = taskNameTaskPair->second.get();
+            entry.portHandle = portHandle;
+        }
+    }
+
+    return entry;
+}
 
-    multiFileIndex.createIndex(fileNames);
+LogTaskManager::StreamEntry& LogTaskManager::getStreamEntry(size_t index)
+{
+    return streamTable.at(sampleIndex.getStreamIdx(index));
+}
+
+size_t LogTaskManager::getIndexForTime(const base::Time& time)
+{
+    return sampleIndex.getIndexForTime(time);
+}
+
+base::Time LogTaskManager::getSampleTime(size_t index)
+{
+    if(index >= sampleIndex.getSize())
+    {
+        return base::Time();
+    }
+
+    return sampleIndex.getSampleTime(index);
 }
 
 LogTaskManager::SampleMetadata LogTaskManager::setIndex(size_t index)
 {
+    std::lock_guard<std::mutex> lock(selectionMutex);
+    replayEntry = nullptr;
+
     try
     {
-        pocolog_cpp::InputDataStream* inputStream = dynamic_cast<pocolog_cpp::InputDataStream*>(multiFileIndex.getSampleStream(index));
-        replayCallback = [=]() {
-            return streamName2LogTask.at(inputStream->getName())->replaySample(inputStream->getIndex(), multiFileIndex.getPosInStream(index));
-        };
+        // the selected sample is stored as plain members, as a capturing callback would allocate for every sample
+        StreamEntry& entry = getStreamEntry(index);
+        replayPosInStream = sampleIndex.getPosInStream(index);
+        replayEntry = &entry;
 
-        return {inputStream->getName(), inputStream->getFileIndex().getSampleTime(multiFileIndex.getPosInStream(index)), true};
+        const bool decimated = entry.portHandle && entry.portHandle->isDecimated(replayPosInStream);
+        return {entry.stream->getName(), sampleIndex.getSampleTime(index), true, sampleIndex.getStreamIdx(index), decimated};
     }
     catch(...)
     {
     }
 
-    return {"", base::Time(), false};
+    return {"", base::Time(), false, 0, false};
+}
+
+size_t LogTaskManager::primeStreams(size_t index)
+{
+    struct PrimingSample
+    {
+        int64_t time;
+        StreamEntry* entry;
+        size_t indexInStream;
+    };
+
+    if(index >= sampleIndex.getSize())
+    {
+        return 0;
+    }
+
+    const base::Time targetTime = sampleIndex.getSampleTime(index);
+
+    std::vector<PrimingSample> primingSamples;
+    for(auto& entry : streamTable)
+    {
+        if(!entry.portHandle)
+        {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(*entry.fileMutex);
+
+        // binary search for the first sample of the stream that is not before the target
+        pocolog_cpp::Index& streamIndex = entry.stream->getFileIndex();
+        size_t first = 0;
+        size_t count = entry.stream->getSize();
+        while(count > 0)
+        {
+            const size_t step = count / 2;
+            if(streamIndex.getSampleTime(first + step) < targetTime)
+            {
+                first += step + 1;
+                count -= step + 1;
+            }
+            else
+            {
+                count = step;
+            }
+        }
+
+        if(first > 0)
+        {
+            const int64_t time = streamIndex.getSampleTime(first - 1).toMicroseconds();
+            primingSamples.push_back({time, &entry, first - 1});
+        }
+    }
+
+    std::stable_sort(primingSamples.begin(), primingSamples.end(), [](const PrimingSample& a, const PrimingSample& b) { return a.time < b.time; });
+
+    size_t primedSamples = 0;
+    for(const auto& primingSample : primingSamples)
+    {
+        try
+        {
+            std::lock_guard<std::mutex> lock(*primingSample.entry->fileMutex);
+            primedSamples += primingSample.entry->task->replaySample(*primingSample.entry->portHandle, primingSample.indexInStream);
+        }
+        catch(...)
+        {
+        }
+    }
+
+    return primedSamples;
 }
 
 bool LogTaskManager::replaySample()
 {
+    std::lock_guard<std::mutex> lock(selectionMutex);
+
+    if(!replayEntry || !replayEntry->portHandle || replayEntry->portHandle->isDecimated(replayPosInStream))
+    {
+        return false;
+    }
+
+    try
+    {
+        std::lock_guard<std::mutex> fileLock(*replayEntry->fileMutex);
+        // TODO: give replay feedback and reset und stop. Maybe differentiate between deactivated ports and ports with no handles.
+        return replayEntry->task->replaySample(*replayEntry->portHandle, replayPosInStream);
+    }
+    catch(...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+bool LogTaskManager::prepareSample(size_t index, LogTask::PreparedSample& prepared)
+{
+    prepared.task = nullptr;
+
+    try
+    {
+        StreamEntry& entry = getStreamEntry(index);
+        std::lock_guard<std::mutex> lock(*entry.fileMutex);
+        const size_t posInStream = sampleIndex.getPosInStream(index);
+        return entry.portHandle && !entry.portHandle->isDecimated(posInStream) && entry.task->readSample(prepared, *entry.portHandle, posInStream);
+    }
+    catch(...)
+    {
+    }
+
+    return false;
+}
+
+bool LogTaskManager::replayPreparedSample(LogTask::PreparedSample& prepared)
+{
+    if(!prepared.task)
+    {
+        return false;
+    }
+
     try
     {
-        return replayCallback(); // TODO: give replay feedback and reset und stop. Maybe differentiate between deactivated ports and ports with no
-                                 // handles.
+        if(!prepared.unmarshaled)
+        {
+            // only happens if the port got connected after preparing, so the stream is searched
+            auto entry = std::find_if(
+                streamTable.begin(), streamTable.end(), [&](const StreamEntry& entry) { return entry.portHandle == prepared.portHandle; });
+            if(entry == streamTable.end())
+            {
+                return false;
+            }
+
+            std::lock_guard<std::mutex> lock(*entry->fileMutex);
+            if(prepared.task->readSample(prepared, *prepared.portHandle, prepared.indexInStream))
+            {
+                prepared.task->unmarshalSample(prepared);
+            }
+        }
+
+        return prepared.task->writeSample(prepared);
     }
     catch(...)
     {
         return false;
     }
+}
+
+bool LogTaskManager::exportSpan(size_t first, size_t last, const std::string& directory)
+{
+    last = std::min(last, sampleIndex.getSize() - 1);
+    if(!sampleIndex.getSize() || first > last)
+    {
+        LOG_WARN_S << "no samples to export";
+        return false;
+    }
+
+    boost::system::error_code error;
+    boost::filesystem::create_directories(directory, error);
+    if(error)
+    {
+        LOG_WARN_S << "cannot create export directory " << directory;
+        return false;
+    }
+
+    auto getSourceFileName = [this](size_t fileIdx)
+    {
+        return compressedLogs[fileIdx] ? compressedLogs[fileIdx]->getFileName() : logFiles[fileIdx]->getFileName();
+    };
 
+    // a compressed logfile is exported uncompressed, its streams are declared in its header log
+    auto getExportName = [&](size_t fileIdx)
+    {
+        boost::filesystem::path fileName = boost::filesystem::path(getSourceFileName(fileIdx)).filename();
+        if(compressedLogs[fileIdx])
+        {
+            fileName.replace_extension();
+        }
+        return fileName;
+    };
+
+    // logfiles of the same name from different folders, e.g. of two runs, are exported to subdirectories named after their folders
+    std::map<boost::filesystem::path, size_t> exportNameCounts;
+    for(size_t fileIdx = 0; fileIdx < logFiles.size(); fileIdx++)
+    {
+        exportNameCounts[getExportName(fileIdx)]++;
+    }
+
+    // each logfile with exported streams is written to a new logfile of the same name, the streams are selected once
+    std::set<boost::filesystem::path> exportFileNames;
+    std::vector<std::unique_ptr<PocologWriter>> writers(logFiles.size());
+    std::vector<size_t> streamFiles;
+    std::vector<bool> exportedStreams;
+    for(size_t fileIdx = 0; fileIdx < logFiles.size(); fileIdx++)
+    {
+        std::vector<size_t> streamIdxs;
+        for(pocolog_cpp::InputDataStream* stream : fileStreams[fileIdx])
+        {
+            // streams that are not replayed, e.g. if only the index is loaded, are exported as well
+            const StreamEntry& entry = streamTable.at(streamFiles.size());
+            const bool exported = !entry.portHandle || entry.portHandle->active;
+            streamFiles.push_back(fileIdx);
+            exportedStreams.push_back(exported);
+            if(exported)
+            {
+                streamIdxs.push_back(stream->getIndex());
+            }
+        }
+
+        if(streamIdxs.empty())
+        {
+            continue;
+        }
+
+        const std::string sourceFileName = getSourceFileName(fileIdx);
+        boost::filesystem::path fileName = boost::filesystem::path(directory);
+        if(exportNameCounts[getExportName(fileIdx)] > 1)
+        {
+            fileName /= boost::filesystem::absolute(sourceFileName).parent_path().filename();
+        }
+        fileName /= getExportName(fileIdx);
+
+        // the writers of two logfiles must not share a target, as they would write into the same file
+        if(!exportFileNames.insert(fileName).second)
+        {
+            LOG_WARN_S << "cannot export " << sourceFileName << ", another logfile is exported to " << fileName.string();
+            return false;
+        }
+
+        if(boost::filesystem::equivalent(fileName, sourceFileName, error))
+        {
+            LOG_WARN_S << "cannot export " << sourceFileName << " to itself";
+            return false;
+        }
+
+        boost::filesystem::create_directories(fileName.parent_path(), error);
+
+        try
+        {
+            writers[fileIdx].reset(new PocologWriter(logFiles[fileIdx]->getFileName(), fileName.string()));
+        }
+        catch(const std::exception& e)
+        {
+            LOG_WARN_S << "cannot export " << sourceFileName << ": " << e.what();
+            return false;
+        }
+
+        if(!writers[fileIdx]->declareStreams(streamIdxs))
+        {
+            LOG_WARN_S << "cannot find the stream declarations of " << sourceFileName;
+            return false;
+        }
+    }
+
+    // the marshaled samples are copied in replay order, without unmarshaling them
+    std::vector<uint8_t> sampleData;
+    for(size_t index = first; index <= last; index++)
+    {
+        const size_t streamIdx = sampleIndex.getStreamIdx(index);
+        if(!exportedStreams.at(streamIdx))
+        {
+            continue;
+        }
+
+        const StreamEntry& entry = streamTable[streamIdx];
+        const size_t fileIdx = streamFiles[streamIdx];
+        const size_t posInStream = sampleIndex.getPosInStream(index);
+        CompressedLogFile* compressedLog = compressedLogs[fileIdx].get();
+        std::lock_guard<std::mutex> lock(*entry.fileMutex);
+        if((compressedLog && !compressedLog->getSampleData(entry.stream->getIndex(), posInStream, sampleData)) ||
+           !writers[fileIdx]->copySample(
+               entry.stream->getIndex(), entry.stream->getFileIndex().getSamplePos(posInStream), compressedLog ? &sampleData : nullptr))
+        {
+            LOG_WARN_S << "cannot export sample " << posInStream << " of stream " << entry.stream->getName();
+            return false;
+        }
+    }
+
+    size_t numSamples = 0;
+    for(const auto& writer : writers)
+    {
+        if(writer && !writer->close())
+        {
+            LOG_WARN_S << "cannot write exported logfiles to " << directory;
+            return false;
+        }
+        numSamples += writer ? writer->getNumSamples() : 0;
+    }
+
+    LOG_INFO_S << "exported " << numSamples << " samples to " << directory;
     return true;
 }
 
+std::vector<StreamStatistics> LogTaskManager::getStreamStatistics()
+{
+    // the streams are processed concurrently, only reading their timestamps is serialized per logfile
+    std::vector<StreamStatistics> statistics(streamTable.size());
+    WorkerPool::forEach(streamTable.size(), [&](size_t streamIdx) {
+        const StreamEntry& entry = streamTable[streamIdx];
+        std::vector<int64_t> times;
+        try
+        {
+            std::lock_guard<std::mutex> lock(*entry.fileMutex);
+            const auto range = SampleIndex::getStreamRange(*entry.stream, sampleIndex.getWindowStart(), sampleIndex.getWindowEnd());
+            pocolog_cpp::Index& streamIndex = entry.stream->getFileIndex();
+            times.reserve(range.second - range.first);
+            for(size_t pos = range.first; pos < range.second; pos++)
+            {
+                times.push_back(streamIndex.getSampleTime(pos).toMicroseconds());
+            }
+        }
+        catch(const std::exception& e)
+        {
+            LOG_WARN_S << "cannot read the timestamps of stream " << entry.stream->getName() << ": " << e.what();
+        }
+
+        statistics[streamIdx] = StreamStatistics::compute(entry.stream->getName(), times);
+    });
+
+    return statistics;
+}
+
+void LogTaskManager::setLockstep(bool lockstep, size_t window)
+{
+    std::lock_guard<std::mutex> lock(taskMutex);
+    for(const auto& taskNameTaskPair : taskName2LogTask)
+    {
+        taskNameTaskPair.second->setLockstep(lockstep, window);
+    }
+}
+
 LogTaskManager::TaskCollection LogTaskManager::getTaskCollection()
 {
+    std::lock_guard<std::mutex> lock(taskMutex);
     TaskCollection taskNames2PortInfos;
-    for(const auto& streamNameTaskPair : streamName2LogTask)
+    for(const auto& taskNameTaskPair : taskName2LogTask)
     {
-        const auto& task = streamNameTaskPair.second;
+        const auto& task = taskNameTaskPair.second;
         taskNames2PortInfos.emplace(task->getName(), task->getPortCollection());
     }
 
     return taskNames2PortInfos;
 }
 
+LogTask::ReplayStatisticsCollection LogTaskManager::getReplayStatistics()
+{
+    std::lock_guard<std::mutex> lock(taskMutex);
+    LogTask::ReplayStatisticsCollection streamNames2Statistics;
+    for(const auto& taskNameTaskPair : taskName2LogTask)
+    {
+        const auto& task = taskNameTaskPair.second;
+        for(const auto& portName2Statistics : task->getReplayStatistics())
+        {
+            streamNames2Statistics.emplace(task->getName() + "." + portName2Statistics.first, portName2Statistics.second);
+        }
+    }
+
+    return streamNames2Statistics;
+}
+
+void LogTaskManager::resetReplayStatistics()
+{
+    std::lock_guard<std::mutex> lock(taskMutex);
+    for(const auto& taskNameTaskPair : taskName2LogTask)
+    {
+        taskNameTaskPair.second->resetReplayStatistics();
+    }
+}
+
 size_t LogTaskManager::getNumSamples()
 {
-    return multiFileIndex.getSize();
+    return sampleIndex.getSize();
 }
 
 LogTask& LogTaskManager::findOrCreateLogTask(const std::string& streamName)
 {
-    std::shared_ptr<LogTask> logTask;
     const auto taskNameAndPort = LogFileHelper::splitStreamName(streamName);
-
-    for(const auto& name2LogTask : streamName2LogTask)
-    {
-        if(LogFileHelper::splitStreamName(name2LogTask.first).first == taskNameAndPort.first)
-        {
-            logTask = name2LogTask.second;
-        }
-    }
+    std::shared_ptr<LogTask>& logTask = taskName2LogTask[taskNameAndPort.first];
 
     if(!logTask)
     {
@@ -113,18 +804,126 @@ LogTask& LogTaskManager::findOrCreateLogTask(const std::string& streamName)
         logTask = std::make_shared<LogTask>(taskNameAndPort.first, prefix, renaming);
     }
 
-    streamName2LogTask.emplace(streamName, logTask);
-
     return *logTask;
 }
 
-bool LogTaskManager::loadTypekitsAndAddStreamToLogTask(pocolog_cpp::InputDataStream& inputStream)
+bool LogTaskManager::loadTypekitsAndAddStreamToLogTask(pocolog_cpp::InputDataStream& inputStream, CompressedLogFile* compressedLog)
 {
-    std::string modelName = LogFileHelper::splitStreamName(inputStream.getName()).first;
+    auto streamName2Model = streamName2ModelName.find(inputStream.getName());
+    const std::string modelName = streamName2Model != streamName2ModelName.end() ? streamName2Model->second : discoverModelName(inputStream);
 
     try
     {
-        modelName = inputStream.getTaskModel();
+        if(loadTypekitsForModel(modelName))
+        {
+            std::lock_guard<std::mutex> lock(taskMutex);
+            LogTask& logTask = findOrCreateLogTask(inputStream.getName());
+            if(!logTask.addStream(inputStream, compressedLog))
+            {
+                return false;
+            }
+
+            applyDecimation(logTask, inputStream.getName());
+            return true;
+        }
+    }
+    catch(...)
+    {
+    }
+
+    LOG_WARN_S << "cannot load typekits for stream " << inputStream.getName();
+    return false;
+}
+
+std::vector<std::pair<base::Time, base::Time>> LogTaskManager::openLogFiles(
+    const std::vector<std::string>& fileNames, const std::vector<std::string>& whiteList, const std::function<void(size_t)>& progress)
+{
+    std::vector<std::unique_ptr<pocolog_cpp::LogFile>> openedFiles(fileNames.size());
+    std::vector<std::unique_ptr<CompressedLogFile>> openedCompressedLogs(fileNames.size());
+    std::vector<std::vector<std::pair<std::string, std::string>>> streamModels(fileNames.size());
+    std::vector<std::pair<base::Time, base::Time>> timeRanges(fileNames.size());
+    std::vector<off_t> sizes(fileNames.size(), 0);
+
+    auto openFile = [&](size_t fileIdx) {
+        try
+        {
+            // the size is taken first, so that samples written while opening count as new samples
+            struct stat fileStat;
+            sizes[fileIdx] = stat(fileNames[fileIdx].c_str(), &fileStat) ? 0 : fileStat.st_size;
+            if(CompressedLogFile::isCompressedLog(fileNames[fileIdx]))
+            {
+                // pocolog opens the header log, the marshaled samples are read from the compressed frames
+                openedCompressedLogs[fileIdx].reset(new CompressedLogFile(fileNames[fileIdx]));
+                openedFiles[fileIdx].reset(new pocolog_cpp::LogFile(openedCompressedLogs[fileIdx]->getHeaderLogFileName(), false));
+            }
+            else
+            {
+                openedFiles[fileIdx].reset(new pocolog_cpp::LogFile(fileNames[fileIdx], false));
+            }
+
+            for(pocolog_cpp::Stream* stream : openedFiles[fileIdx]->getStreams())
+            {
+                auto inputStream = dynamic_cast<pocolog_cpp::InputDataStream*>(stream);
+                if(inputStream && LogFileHelper::isWhiteListed(inputStream->getName(), whiteList))
+                {
+                    streamModels[fileIdx].emplace_back(inputStream->getName(), discoverModelName(*inputStream));
+                    addToTimeRange(*inputStream, timeRanges[fileIdx]);
+                }
+            }
+        }
+        catch(const std::exception& e)
+        {
+            LOG_WARN_S << "cannot open logfile " << fileNames[fileIdx] << ": " << e.what();
+            openedFiles[fileIdx].reset();
+            openedCompressedLogs[fileIdx].reset();
+        }
+    };
+
+    WorkerPool::forEach(fileNames.size(), openFile, progress);
+
+    std::vector<std::pair<base::Time, base::Time>> fileTimeRanges;
+    streamName2ModelName.clear();
+    for(size_t fileIdx = 0; fileIdx < fileNames.size(); fileIdx++)
+    {
+        if(openedFiles[fileIdx])
+        {
+            logFiles.push_back(std::move(openedFiles[fileIdx]));
+            fileSizes.push_back(sizes[fileIdx]);
+            compressedLogs.push_back(std::move(openedCompressedLogs[fileIdx]));
+            fileTimeRanges.push_back(timeRanges[fileIdx]);
+            streamName2ModelName.insert(streamModels[fileIdx].begin(), streamModels[fileIdx].end());
+        }
+    }
+
+    return fileTimeRanges;
+}
+
+void LogTaskManager::addToTimeRange(pocolog_cpp::InputDataStream& inputStream, std::pair<base::Time, base::Time>& timeRange)
+{
+    if(!inputStream.getSize())
+    {
+        return;
+    }
+
+    try
+    {
+        pocolog_cpp::Index& streamIndex = inputStream.getFileIndex();
+        const base::Time first = streamIndex.getSampleTime(0);
+        const base::Time last = streamIndex.getSampleTime(inputStream.getSize() - 1);
+        timeRange.first = timeRange.first.isNull() ? first : std::min(timeRange.first, first);
+        timeRange.second = timeRange.second.isNull() ? last : std::max(timeRange.second, last);
+    }
+    catch(...)
+    {
+        LOG_WARN_S << "cannot read the time range of stream " << inputStream.getName();
+    }
+}
+
+std::string LogTaskManager::discoverModelName(const pocolog_cpp::InputDataStream& inputStream)
+{
+    try
+    {
+        return inputStream.getTaskModel();
     }
     catch(...)
     {
@@ -132,21 +931,32 @@ bool LogTaskManager::loadTypekitsAndAddStreamToLogTask(pocolog_cpp::InputDataStr
                    << " does not contain necessary metadata for its task model. Trying to load typekit via stream name";
     }
 
+    return LogFileHelper::splitStreamName(inputStream.getName()).first;
+}
+
+bool LogTaskManager::loadTypekitsForModel(const std::string& modelName)
+{
+    auto modelName2Loaded = modelName2TypekitsLoaded.find(modelName);
+    if(modelName2Loaded != modelName2TypekitsLoaded.end())
+    {
+        return modelName2Loaded->second;
+    }
+
+    bool loaded = true;
     try
     {
         orocos.loadAllTypekitsForModel(modelName);
-        LogTask& logTask = findOrCreateLogTask(inputStream.getName());
-        return logTask.addStream(inputStream);
     }
     catch(...)
     {
-        LOG_WARN_S << "cannot load typekits for stream " << inputStream.getName();
+        loaded = false;
     }
 
-    return false;
+    modelName2TypekitsLoaded.emplace(modelName, loaded);
+    return loaded;
 }
 
-void LogTaskManager::activateReplayForPort(const std::string& taskName, const std::string& portName, bool on)
+LogTask* LogTaskManager::findLogTask(const std::string& taskName)
 {
     std::string taskNameWithPossiblePrefix = taskName;
     std::string::size_type index = taskNameWithPossiblePrefix.find(prefix);
@@ -156,6 +966,51 @@ void LogTaskManager::activateReplayForPort(const std::string& taskName, const st
         taskNameWithPossiblePrefix.erase(index, prefix.length());
     }
 
-    LogTask& logTask = findOrCreateLogTask(taskNameWithPossiblePrefix);
-    logTask.activateLoggingForPort(portName, on);
+    // renamed tasks are displayed with their new name, but registered with the name from the logfile
+    for(const auto& renaming : renamings)
+    {
+        if(renaming.second == taskNameWithPossiblePrefix)
+        {
+            taskNameWithPossiblePrefix = renaming.first;
+        }
+    }
+
+    auto taskNameTaskPair = taskName2LogTask.find(taskNameWithPossiblePrefix);
+    return taskNameTaskPair != taskName2LogTask.end() ? taskNameTaskPair->second.get() : nullptr;
+}
+
+void LogTaskManager::activateReplayForPort(const std::string& taskName, const std::string& portName, bool on)
+{
+    std::lock_guard<std::mutex> lock(taskMutex);
+    LogTask* logTask = findLogTask(taskName);
+    if(logTask)
+    {
+        logTask->activateLoggingForPort(portName, on);
+    }
+}
+
+uint64_t LogTaskManager::setDecimationForPort(const std::string& taskName, const std::string& portName, const Decimation& decimation)
+{
+    std::lock_guard<std::mutex> lock(taskMutex);
+    LogTask* logTask = findLogTask(taskName);
+    return logTask ? logTask->setDecimationForPort(portName, decimation.keepEvery, decimation.maxRate) : 0;
+}
+
+uint64_t LogTaskManager::getDecimationForPort(const std::string& taskName, const std::string& portName)
+{
+    std::lock_guard<std::mutex> lock(taskMutex);
+    LogTask* logTask = findLogTask(taskName);
+    return logTask ? logTask->getDecimationForPort(portName) : 0;
+}
+
+void LogTaskManager::applyDecimation(LogTask& logTask, const std::string& streamName)
+{
+    for(const auto& decimation : decimations)
+    {
+        if(std::regex_match(streamName, decimation.first))
+        {
+            logTask.setDecimationForPort(LogFileHelper::splitStreamName(streamName).second, decimation.second.keepEvery, decimation.second.maxRate);
+            return;
+        }
+    }
 }
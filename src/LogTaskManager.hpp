@@ -1,22 +1,62 @@
 #pragma once
 
+#include "CompressedLogFile.hpp"
 #include "LogTask.hpp"
+#include "SampleIndex.hpp"
+#include "StreamStatistics.hpp"
 
+#include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <orocos_cpp/orocos_cpp.hpp>
-#include <pocolog_cpp/MultiFileIndex.hpp>
+#include <pocolog_cpp/LogFile.hpp>
+#include <regex>
 #include <string>
+#include <sys/types.h>
+#include <unordered_map>
 #include <vector>
 
 /**
  * @brief Class that handles the instantiation of LogTasks and their ports.
- * It takes ownership of all instantiated LogTasks and MultiFileIndex streams and
- * offers a convenient interface, abstracting the MultiFileIndex structure.
+ * It takes ownership of all instantiated LogTasks and logfiles and
+ * offers a convenient interface, abstracting the SampleIndex structure.
  *
  */
 class LogTaskManager
 {
+    /**
+     * @brief Replay target of a stream, resolved once after indexing.
+     *
+     */
+    struct StreamEntry
+    {
+        /**
+         * @brief Stream in the SampleIndex.
+         *
+         */
+        pocolog_cpp::InputDataStream* stream;
+
+        /**
+         * @brief Mutex serializing accesses to the stream's logfile.
+         *
+         */
+        std::mutex* fileMutex;
+
+        /**
+         * @brief LogTask the stream was added to, or nullptr if the stream is not replayed.
+         *
+         */
+        LogTask* task;
+
+        /**
+         * @brief PortHandle of the stream, or nullptr if the stream is not replayed.
+         *
+         */
+        LogTask::PortHandle* portHandle;
+    };
+
 public:
     /**
      * @brief Structure for currently loaded sample metadata.
@@ -34,10 +74,36 @@ public:
         base::Time timeStamp;
 
         /**
-         * @brief Indicates whether loading from MultiFileIndex stream was valid.
+         * @brief Indicates whether loading from SampleIndex stream was valid.
          * Does not indicate if unmarshaling can be performed.
          */
         bool valid;
+
+        /**
+         * @brief Index of the sample's stream in the sample index.
+         */
+        size_t streamIdx;
+
+        /**
+         * @brief Indicates whether the sample is skipped by the decimation of its port.
+         */
+        bool decimated;
+    };
+
+    /**
+     * @brief Decimation of a port, see LogTask::setDecimationForPort.
+     */
+    struct Decimation
+    {
+        /**
+         * @brief Number of samples per replayed sample, 1 replays every sample.
+         */
+        uint64_t keepEvery;
+
+        /**
+         * @brief Maximum replay rate in samples per second of log time, 0 for no rate cap.
+         */
+        double maxRate;
     };
 
     /**
@@ -55,6 +121,27 @@ public:
      */
     using TaskCollection = std::map<std::string, LogTask::PortCollection>;
 
+    /**
+     * @brief Callback that receives the loading progress as a fraction between 0 and 1.
+     */
+    using ProgressCallback = std::function<void(double)>;
+
+    /**
+     * @brief Log time window to restrict loading to, in the formats of LogFileHelper::parseTime.
+     */
+    struct TimeWindow
+    {
+        /**
+         * @brief Log time of the first sample to load, relative times refer to the log start. Empty to load from the log start.
+         */
+        std::string start;
+
+        /**
+         * @brief Log time of the last sample to load, relative times refer to the log start. Empty to load until the log end.
+         */
+        std::string end;
+    };
+
     /**
      * @brief Constructor.
      */
@@ -67,15 +154,80 @@ public:
 
     /**
      * @brief Initializes the LogTaskManager with new LogTasks and a optionally with a prefix.
+     * Can run in a separate thread: tasks are added one after another, and samples can be accessed and
+     * replayed as soon as getNumSamples reports them, while indexing continues.
      *
      * @param fileNames: List of filenames to load. Filenames must be absolute.
      * @param prefix: Prefix to add for all LogTasks.
      * @param whiteList: List of regular expressions to filter whitelisted streams.
      * @param renamings: Map of task renamings.
+     * @param progress: Optional callback for the loading progress, called from the calling thread.
+     * @param window: Optional time window. Logfiles without samples in the window are closed, streams without samples in the window
+     * are skipped, and only the samples within the window are indexed. Invalid times leave the window open.
+     * @return bool True if all samples were indexed. False if init was cancelled or timestamps could not be read, in which case
+     * the indexed samples are replayed, or if the streams exceed the limits of the sample index, in which case an error is logged
+     * and no samples are replayed.
      */
-    void init(
+    bool init(
         const std::vector<std::string>& fileNames, const std::string& prefix, const std::vector<std::string>& whiteList = {},
-        const std::map<std::string, std::string>& renamings = {});
+        const std::map<std::string, std::string>& renamings = {}, const ProgressCallback& progress = {}, const TimeWindow& window = {});
+
+    /**
+     * @brief Deletes all LogTasks and closes all logfiles. Must not be called during init.
+     *
+     */
+    void clear();
+
+    /**
+     * @brief Prepares the next init for logfiles that are still being written. The sample index reserves room for samples
+     * appended by appendNewSamples, and is neither loaded from nor saved to the index cache.
+     *
+     * @param following: True to follow the logfiles, false otherwise.
+     */
+    void setFollowing(bool following);
+
+    /**
+     * @brief Prepares the next init for index access only. The whitelisted streams are indexed without loading typekits
+     * or creating tasks, so that their samples can be exported or analyzed but not replayed.
+     *
+     * @param indexOnly: True to skip the typekits, false otherwise.
+     */
+    void setIndexOnly(bool indexOnly);
+
+    /**
+     * @brief Prepares the next init with decimations of ports. Each rule applies to the streams whose name matches its
+     * regular expression, the first matching rule wins. Streams without matching rule replay every sample.
+     *
+     * @param decimations: List of regular expressions matching stream names and their decimation.
+     */
+    void setDecimations(const std::vector<std::pair<std::string, Decimation>>& decimations);
+
+    /**
+     * @brief Reopens the logfiles that grew since they were opened and appends their new samples to the sample index,
+     * without rebuilding it. Streams that were added to a logfile after init are not replayed.
+     * pocolog streams cannot grow, so opening a grown logfile indexes it anew, in time linear to its size rather than to its new samples.
+     * Callers should therefore append less often as the logfiles grow. Logfiles that did not grow are not reopened.
+     * Must be called from the thread that ran init, after init returned.
+     *
+     * @return size_t Number of appended samples.
+     */
+    size_t appendNewSamples();
+
+    /**
+     * @brief Returns whether appendNewSamples can still append samples, i.e. whether following the logfiles is useful.
+     * It cannot once a logfile was written past the end of the time window, or if all logfiles are compressed.
+     * Must be called from the thread that ran init, after init returned.
+     *
+     * @return bool True if samples can be appended, false otherwise.
+     */
+    bool canAppendSamples();
+
+    /**
+     * @brief Cancels a running init. The manager keeps the tasks and samples loaded so far.
+     * Can be called from any thread, a cancel before init resets its flag is lost.
+     *
+     */
+    void cancelInit();
 
     /**
      * @brief Sets the replay pointer to the given index. The sample
@@ -86,6 +238,32 @@ public:
      */
     SampleMetadata setIndex(size_t index);
 
+    /**
+     * @brief Returns the index of the first sample whose timestamp is not before the given time.
+     * Performs a binary search on the time table.
+     *
+     * @param time: Log time to search for.
+     * @return size_t Index of the found sample, or the number of samples if all samples are before the given time.
+     */
+    size_t getIndexForTime(const base::Time& time);
+
+    /**
+     * @brief Returns the timestamp of the sample at the given index.
+     *
+     * @param index: Index of the sample.
+     * @return base::Time Timestamp of the sample, or a null time if the index is invalid.
+     */
+    base::Time getSampleTime(size_t index);
+
+    /**
+     * @brief Replays the latest sample of every stream that precedes the sample at the given index, in timestamp order.
+     * Primes consumers of low-rate streams after a seek. Each stream is searched by a binary search on its own index.
+     *
+     * @param index: Index of the sample replay continues with.
+     * @return size_t Number of replayed samples.
+     */
+    size_t primeStreams(size_t index);
+
     /**
      * @brief Replays the currently set sample.
      *
@@ -94,14 +272,85 @@ public:
     bool replaySample();
 
     /**
-     * @brief Enables or disabled replaying for a given port of a task.
+     * @brief Reads the sample at the given index ahead of its replay. The index pointer is not changed.
+     * Can be called from a separate thread.
      *
-     * @param taskName: Name of task.
+     * @param index: Index of the sample to read.
+     * @param prepared: Sample to read the data into.
+     * @return bool True if the sample data was read, false if the port does not need the sample or reading failed.
+     */
+    bool prepareSample(size_t index, LogTask::PreparedSample& prepared);
+
+    /**
+     * @brief Replays a sample that was prepared by prepareSample. If the sample was not
+     * unmarshaled beforehand, e.g. because its port got connected meanwhile, it is read and
+     * unmarshaled synchronously.
+     *
+     * @param prepared: Sample to replay.
+     * @return bool True if the sample was replayed successfully, false otherwise (e.g. on marshal error).
+     */
+    bool replayPreparedSample(LogTask::PreparedSample& prepared);
+
+    /**
+     * @brief Enables or disabled replaying for a given port of a task. Unknown tasks are ignored.
+     *
+     * @param taskName: Name of task, either as in the logfile or as in the task collection (prefixed and renamed).
      * @param portName: Name of port.
      * @param on: True if replaying should be enabled, false otherwise.
      */
     void activateReplayForPort(const std::string& taskName, const std::string& portName, bool on);
 
+    /**
+     * @brief Sets the decimation of a port of a task. Skipped samples are neither read nor unmarshaled. Unknown tasks are ignored.
+     *
+     * @param taskName: Name of task, either as in the logfile or as in the task collection (prefixed and renamed).
+     * @param portName: Name of port.
+     * @param decimation: Decimation of the port.
+     * @return uint64_t Resulting number of samples per replayed sample, 0 if the port is unknown.
+     */
+    uint64_t setDecimationForPort(const std::string& taskName, const std::string& portName, const Decimation& decimation);
+
+    /**
+     * @brief Returns the decimation of a port of a task.
+     *
+     * @param taskName: Name of task, either as in the logfile or as in the task collection (prefixed and renamed).
+     * @param portName: Name of port.
+     * @return uint64_t Number of samples per replayed sample, 0 if the port is unknown.
+     */
+    uint64_t getDecimationForPort(const std::string& taskName, const std::string& portName);
+
+    /**
+     * @brief Exports the samples of a span to new logfiles in the given directory, one for each logfile with active ports.
+     * The marshaled samples are copied without unmarshaling them, together with their timestamps and the declarations
+     * and metadata of their streams. Replayed streams are only exported if their port is active, compressed logfiles are exported
+     * uncompressed.
+     * Logfiles of the same name from different folders are exported to subdirectories named after their folders.
+     * Existing logfiles of the same name are replaced, unless they are the logfiles being exported.
+     * Can be called during replay, but not concurrently with init or appendNewSamples.
+     *
+     * @param first: Index of the first exported sample.
+     * @param last: Index of the last exported sample.
+     * @param directory: Directory to write the logfiles to, it is created if necessary.
+     * @return bool True if the span was exported, false otherwise.
+     */
+    bool exportSpan(size_t first, size_t last, const std::string& directory);
+
+    /**
+     * @brief Computes the timing statistics of all indexed streams within the time window, using only the timestamps of their index.
+     * The streams are processed concurrently. Must not be called concurrently with init or appendNewSamples.
+     *
+     * @return std::vector<StreamStatistics> Statistics of each stream, in the order of their global stream index.
+     */
+    std::vector<StreamStatistics> getStreamStatistics();
+
+    /**
+     * @brief Enables or disables the lockstep mode for all LogTasks, see LogTask::setLockstep.
+     *
+     * @param lockstep: True if writing should wait for the consumers, false otherwise.
+     * @param window: Maximum number of unread samples per connection.
+     */
+    void setLockstep(bool lockstep, size_t window = 1);
+
     /**
      * @brief Returns a map of task names to a list of their ports with types.
      *
@@ -110,7 +359,20 @@ public:
     TaskCollection getTaskCollection();
 
     /**
-     * @brief Returns the number of samples found in the logfiles.
+     * @brief Returns the amount of data written to each port since the last reset.
+     *
+     * @return LogTask::ReplayStatisticsCollection Map of stream names (as trajectory_follower.motion_command) to their statistics.
+     */
+    LogTask::ReplayStatisticsCollection getReplayStatistics();
+
+    /**
+     * @brief Resets the replay statistics of all ports.
+     *
+     */
+    void resetReplayStatistics();
+
+    /**
+     * @brief Returns the number of samples found in the logfiles. Grows while indexing.
      *
      * @return size_t Number of samples.
      */
@@ -119,13 +381,29 @@ public:
 private:
     /**
      * @brief Searches for a LogTask given the stream name. If no LogTask
-     * was instantiated for the stream, a new one is created and inserted.
+     * was instantiated for the stream's task, a new one is created and inserted.
      *
-     * @param streamName: Name of the stream as defined in the MultiFileIndex.
+     * @param streamName: Name of the stream as defined in the logfile.
      * @return LogTask& Reference to the corresponding LogTask for the stream.
      */
     LogTask& findOrCreateLogTask(const std::string& streamName);
 
+    /**
+     * @brief Searches for the LogTask of a task name as shown in the task collection. Must be called with the task mutex locked.
+     *
+     * @param taskName: Name of task, either as in the logfile or as in the task collection (prefixed and renamed).
+     * @return LogTask* Corresponding LogTask, or nullptr if the task is unknown.
+     */
+    LogTask* findLogTask(const std::string& taskName);
+
+    /**
+     * @brief Applies the first matching decimation rule to a newly added stream.
+     *
+     * @param logTask: LogTask the stream was added to.
+     * @param streamName: Name of the stream as defined in the logfile.
+     */
+    void applyDecimation(LogTask& logTask, const std::string& streamName);
+
     /**
      * @brief Loads the typekit for the given stream.
      * If the stream does not contain a model name in its metadata, a loading
@@ -133,9 +411,100 @@ private:
      * Finally, the stream is added to its corresponding log task.
      *
      * @param inputStram: InputDataStream to load typekits for and to add to a log task.
+     * @param compressedLog: Compressed logfile holding the marshaled samples of the stream, nullptr if the stream holds them.
      * @return True if the stream was added to the log task.
      */
-    bool loadTypekitsAndAddStreamToLogTask(pocolog_cpp::InputDataStream& inputStream);
+    bool loadTypekitsAndAddStreamToLogTask(pocolog_cpp::InputDataStream& inputStream, CompressedLogFile* compressedLog);
+
+    /**
+     * @brief Opens the given logfiles concurrently and discovers the task models and the time range of their whitelisted streams.
+     * Opened logfiles are appended to logFiles in the given order and their sizes to fileSizes, logfiles that cannot be opened are skipped.
+     * Compressed logfiles are opened through their header log and appended to compressedLogs, which holds nullptr for other logfiles.
+     *
+     * @param fileNames: List of filenames to open.
+     * @param whiteList: List of regular expressions to filter whitelisted streams.
+     * @param progress: Callback for the number of processed logfiles.
+     * @return std::vector<std::pair<base::Time, base::Time>> Times of the first and the last sample of each opened logfile,
+     * null times if the logfile has no whitelisted samples.
+     */
+    std::vector<std::pair<base::Time, base::Time>> openLogFiles(
+        const std::vector<std::string>& fileNames, const std::vector<std::string>& whiteList, const std::function<void(size_t)>& progress);
+
+    /**
+     * @brief Resolves a time window relative to the start of the opened logfiles and closes the logfiles outside of the window.
+     *
+     * @param window: Time window to resolve.
+     * @param fileTimeRanges: Times of the first and the last sample of each opened logfile.
+     * @param windowStart: Resolved start of the window, a null time if the window is open.
+     * @param windowEnd: Resolved end of the window, a null time if the window is open.
+     */
+    void applyTimeWindow(
+        const TimeWindow& window, const std::vector<std::pair<base::Time, base::Time>>& fileTimeRanges, base::Time& windowStart,
+        base::Time& windowEnd);
+
+    /**
+     * @brief Extends a time range by the times of the first and the last sample of a stream.
+     *
+     * @param inputStream: InputDataStream to add.
+     * @param timeRange: Times of the first and the last sample, null times if the range is empty.
+     */
+    static void addToTimeRange(pocolog_cpp::InputDataStream& inputStream, std::pair<base::Time, base::Time>& timeRange);
+
+    /**
+     * @brief Returns the task model of a stream. If the stream does not contain
+     * a model name in its metadata, the task name of the stream is returned.
+     *
+     * @param inputStream: InputDataStream to get the model for.
+     * @return std::string Model name.
+     */
+    static std::string discoverModelName(const pocolog_cpp::InputDataStream& inputStream);
+
+    /**
+     * @brief Loads all typekits for a task model. Each model is only loaded once, later calls return the cached result.
+     *
+     * @param modelName: Name of the task model.
+     * @return bool True if the typekits were loaded, false otherwise.
+     */
+    bool loadTypekitsForModel(const std::string& modelName);
+
+    /**
+     * @brief Loads the sample index of the given streams from the session cache. If the session is not cached
+     * or its logfiles changed, the index is built and saved to the cache.
+     *
+     * @param fileNames: Names of the loaded logfiles.
+     * @param fileStreams: Streams to index, grouped by their logfile.
+     * @param progress: Optional callback for the loading progress.
+     * @param windowStart: Start of the indexed time window, a null time leaves the window open.
+     * @param windowEnd: End of the indexed time window, a null time leaves the window open.
+     * @return bool True if all samples were indexed, false otherwise.
+     */
+    bool loadOrBuildSampleIndex(
+        const std::vector<std::string>& fileNames, const std::vector<std::vector<pocolog_cpp::InputDataStream*>>& fileStreams,
+        const ProgressCallback& progress, const base::Time& windowStart, const base::Time& windowEnd);
+
+    /**
+     * @brief Fills the stream table with the replay targets of the given streams, in the order of their global stream index.
+     *
+     * @param fileStreams: Streams to index, grouped by their logfile.
+     */
+    void buildStreamTable(const std::vector<std::vector<pocolog_cpp::InputDataStream*>>& fileStreams);
+
+    /**
+     * @brief Resolves the replay target of a stream.
+     *
+     * @param stream: Stream to resolve.
+     * @param fileMutex: Mutex of the stream's logfile.
+     * @return StreamEntry Entry of the stream.
+     */
+    StreamEntry createStreamEntry(pocolog_cpp::InputDataStream& stream, std::mutex& fileMutex);
+
+    /**
+     * @brief Returns the stream table entry of the sample at the given index.
+     *
+     * @param index: Index of the sample.
+     * @return StreamEntry& Entry of the sample's stream.
+     */
+    StreamEntry& getStreamEntry(size_t index);
 
     /**
      * @brief Prefix for all LogTasks.
@@ -144,12 +513,78 @@ private:
     std::string prefix;
 
     /**
-     * @brief MultiFileIndex containing all datastreams from logfiles.
-     * This class has the ownership. If the MultiFileIndex is cleared, all
-     * LogTasks must be deleted beforehand as they become invalid.
+     * @brief Opened logfiles, owning all datastreams.
+     * If the logfiles are closed, all LogTasks must be deleted beforehand as they become invalid.
      *
      */
-    pocolog_cpp::MultiFileIndex multiFileIndex;
+    std::vector<std::unique_ptr<pocolog_cpp::LogFile>> logFiles;
+
+    /**
+     * @brief Size of each logfile in bytes, taken before it was opened. A larger size indicates samples that were written since.
+     *
+     */
+    std::vector<off_t> fileSizes;
+
+    /**
+     * @brief Compressed logfile of each logfile, holding its marshaled samples. Nullptr if the logfile is not compressed.
+     *
+     */
+    std::vector<std::unique_ptr<CompressedLogFile>> compressedLogs;
+
+    /**
+     * @brief Indexed streams, grouped by their logfile.
+     *
+     */
+    std::vector<std::vector<pocolog_cpp::InputDataStream*>> fileStreams;
+
+    /**
+     * @brief Indicates whether the logfiles are followed while they are being written.
+     *
+     */
+    bool following = false;
+
+    /**
+     * @brief Indicates whether streams are indexed without loading typekits, see setIndexOnly.
+     *
+     */
+    bool indexOnly = false;
+
+    /**
+     * @brief Decimation rules for the added streams, see setDecimations.
+     *
+     */
+    std::vector<std::pair<std::regex, Decimation>> decimations;
+
+    /**
+     * @brief Index of all replayed samples of the logfiles, ordered by time.
+     *
+     */
+    SampleIndex sampleIndex;
+
+    /**
+     * @brief Mutexes serializing accesses to each logfile, as pocolog streams are not thread-safe.
+     * Streams of different logfiles can be accessed concurrently.
+     *
+     */
+    std::vector<std::unique_ptr<std::mutex>> fileMutexes;
+
+    /**
+     * @brief Mutex guarding the selected sample.
+     *
+     */
+    std::mutex selectionMutex;
+
+    /**
+     * @brief Mutex guarding the LogTasks while they are added during init.
+     *
+     */
+    std::mutex taskMutex;
+
+    /**
+     * @brief Indicates whether a running init should stop.
+     *
+     */
+    std::atomic<bool> initCancelled{false};
 
     /**
      * @brief Orocos api object. Gets forwarded to LogTasks to instantiate the Orocos tasks.
@@ -158,17 +593,45 @@ private:
     orocos_cpp::OrocosCpp orocos;
 
     /**
-     * @brief Function to call when the previously selected sample should be replayed.
+     * @brief Replay targets of all streams, addressed by their global stream index in the SampleIndex.
+     * Is complete before indexing starts and not changed until the next init.
+     * Avoids name and stream index lookups for every replayed sample.
+     *
+     */
+    std::vector<StreamEntry> streamTable;
+
+    /**
+     * @brief Stream entry of the previously selected sample, or nullptr if no valid sample is selected.
      * Used to decouple setting of index (and thus getting metadata information) and actual replay.
      *
      */
-    std::function<bool()> replayCallback;
+    StreamEntry* replayEntry = nullptr;
+
+    /**
+     * @brief Position of the previously selected sample in its stream.
+     *
+     */
+    size_t replayPosInStream = 0;
+
+    /**
+     * @brief Container that maps task names as found in the stream names (e.g. trajectory_follower) to their correspoding LogTask instances.
+     * Prefixes and renamings are not part of the key.
+     *
+     */
+    std::unordered_map<std::string, std::shared_ptr<LogTask>> taskName2LogTask;
+
+    /**
+     * @brief Map of stream names to their task models, discovered before indexing.
+     *
+     */
+    std::unordered_map<std::string, std::string> streamName2ModelName;
 
     /**
-     * @brief Container that maps stream names (as trajectory_follower.motion_command) to their correspoding LogTask instances.
+     * @brief Map of task models to whether their typekits could be loaded.
+     * Is kept across inits, as loaded typekits stay registered.
      *
      */
-    std::map<std::string, std::shared_ptr<LogTask>> streamName2LogTask;
+    std::unordered_map<std::string, bool> modelName2TypekitsLoaded;
 
     /**
      * @brief Map of renamings for tasks.
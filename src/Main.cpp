@@ -1,27 +1,267 @@
 #include "ArgParser.hpp"
+#include "IndexCache.hpp"
+#include "LogFileHelper.hpp"
 #include "ReplayGui.h"
 
 #include <csignal>
+#include <fstream>
 
 ReplayHandler replayHandler;
 
+void printThroughput(const std::string& name, const ReplayHandler::Throughput& throughput)
+{
+    std::cout << "  " << name << ": " << throughput.samples << " samples, " << throughput.samplesPerSecond << " samples/s, "
+              << throughput.megabytesPerSecond << " MB/s" << std::endl;
+}
+
+void printLatency(const std::string& stage, const LatencyHistogram::Summary& latency)
+{
+    auto toMicroseconds = [](std::chrono::nanoseconds duration) { return std::chrono::duration<double, std::micro>(duration).count(); };
+    std::cout << "    " << stage << ": p50 " << toMicroseconds(latency.p50) << " us, p99 " << toMicroseconds(latency.p99) << " us, max "
+              << toMicroseconds(latency.max) << " us" << std::endl;
+}
+
+bool getTimeWindow(const ArgParser& argParser, LogTaskManager::TimeWindow& window)
+{
+    // the formats are checked before loading, the times are resolved against the log start while loading
+    base::Time time;
+    if(!argParser.startTime.empty() && !LogFileHelper::parseTime(argParser.startTime, base::Time(), time))
+    {
+        std::cerr << "invalid start time " << argParser.startTime << std::endl;
+        return false;
+    }
+
+    if(!argParser.endTime.empty() && !LogFileHelper::parseTime(argParser.endTime, base::Time(), time))
+    {
+        std::cerr << "invalid end time " << argParser.endTime << std::endl;
+        return false;
+    }
+
+    window = {argParser.startTime, argParser.endTime};
+    return true;
+}
+
+ReplayHandler::CatchUpPolicy getCatchUpPolicy(const ArgParser& argParser)
+{
+    if(argParser.catchUp == "drop")
+    {
+        return ReplayHandler::CatchUpPolicy::Drop;
+    }
+    else if(argParser.catchUp == "stretch")
+    {
+        return ReplayHandler::CatchUpPolicy::Stretch;
+    }
+
+    return ReplayHandler::CatchUpPolicy::Burst;
+}
+
+std::vector<std::pair<std::string, LogTaskManager::Decimation>> getDecimations(const ArgParser& argParser)
+{
+    // the specifications were validated while parsing the arguments
+    std::vector<std::pair<std::string, LogTaskManager::Decimation>> decimations;
+    for(const auto& regex2Decimation : argParser.decimations)
+    {
+        LogTaskManager::Decimation decimation;
+        LogFileHelper::parseDecimation(regex2Decimation.second, decimation.keepEvery, decimation.maxRate);
+        decimations.emplace_back(regex2Decimation.first, decimation);
+    }
+
+    return decimations;
+}
+
+void printStatistics(const ArgParser& argParser, const std::vector<StreamStatistics>& statistics)
+{
+    // JSON written to stdout replaces the table, so that it can be piped
+    if(argParser.statsJsonFile == "-")
+    {
+        StreamStatistics::writeJson(std::cout, statistics);
+        return;
+    }
+
+    StreamStatistics::writeTable(std::cout, statistics);
+    if(!argParser.statsJsonFile.empty())
+    {
+        std::ofstream file(argParser.statsJsonFile);
+        StreamStatistics::writeJson(file, statistics);
+        if(!file)
+        {
+            std::cerr << "cannot write " << argParser.statsJsonFile << std::endl;
+        }
+    }
+}
+
 void startHeadless(const ArgParser& argParser)
 {
     static bool no_exit = argParser.no_exit;
     std::signal(SIGINT, [](int sig) { replayHandler.stop(); no_exit = false; });
-    replayHandler.init(argParser.fileNames, argParser.prefix, argParser.whiteListTokens, argParser.renamings);
+
+    LogTaskManager::TimeWindow window;
+    if(!getTimeWindow(argParser, window))
+    {
+        return;
+    }
+
+    const bool indexOnly = !argParser.exportDirectory.empty() || argParser.stats;
+    replayHandler.setFollowing(argParser.follow && !indexOnly);
+    replayHandler.setIndexOnly(indexOnly);
+    replayHandler.setDecimations(getDecimations(argParser));
+    replayHandler.initInBackground(argParser.fileNames, argParser.prefix, argParser.whiteListTokens, argParser.renamings, window);
+    replayHandler.setPipelined(argParser.pipeline);
+    replayHandler.setUnthrottled(argParser.maxSpeed);
+    replayHandler.setLockstep(argParser.lockstep, argParser.lockstepWindow);
+    replayHandler.setPrimeOnSeek(argParser.primeOnSeek);
+    replayHandler.setCatchUpPolicy(getCatchUpPolicy(argParser));
+    replayHandler.setDroppablePorts(argParser.droppablePorts);
+    if(argParser.autoSpeedLag > 0)
+    {
+        replayHandler.setAutoSpeed(
+            true, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double, std::milli>(argParser.autoSpeedLag)));
+    }
+
+    // exports and statistics cover all loaded samples, so they wait until indexing finished
+    if(indexOnly)
+    {
+        while(replayHandler.isIndexing())
+        {
+            if(!argParser.quiet)
+            {
+                std::cerr << "indexing " << static_cast<int>(replayHandler.getIndexingProgress() * 100) << "%\r" << std::flush;
+            }
+            usleep(100000);
+        }
+
+        if(argParser.stats)
+        {
+            printStatistics(argParser, replayHandler.getStreamStatistics());
+        }
+
+        if(!argParser.exportDirectory.empty())
+        {
+            const bool exported = replayHandler.exportSpan(argParser.exportDirectory);
+            std::cout << (exported ? "exported samples to " : "cannot export samples to ") << argParser.exportDirectory << std::endl;
+        }
+
+        replayHandler.stop();
+        return;
+    }
+
+    // replay starts as soon as samples are indexed, only the samples in the time window are loaded.
+    // A followed log starts at its newest sample, which is only known once indexing finished.
+    const bool startAtNewest = argParser.follow && argParser.startTime.empty();
+    while(replayHandler.isIndexing() && (startAtNewest || !replayHandler.getMaxIndex()))
+    {
+        if(!argParser.quiet)
+        {
+            std::cerr << "indexing " << static_cast<int>(replayHandler.getIndexingProgress() * 100) << "%\r" << std::flush;
+        }
+        usleep(100000);
+    }
+
+    // starting within the log counts as a seek, so that the streams get primed
+    if(startAtNewest)
+    {
+        replayHandler.setSampleIndex(replayHandler.getMaxIndex());
+    }
+    else if(!argParser.startTime.empty())
+    {
+        replayHandler.setSampleIndex(0);
+    }
+
     replayHandler.play();
 
+    // progress goes to stderr, so that it does not mix with piped output
     while(replayHandler.isPlaying())
     {
         if(!argParser.quiet){
-            std::cout << "replaying [" << replayHandler.getCurIndex() << "/" << replayHandler.getMaxIndex()
-                      << "]: " << replayHandler.getCurSamplePortName() << "\r";
+            std::cerr << "replaying [" << replayHandler.getCurIndex() << "/" << replayHandler.getMaxIndex() << "]";
+            if(replayHandler.isIndexing())
+            {
+                std::cerr << " (indexing " << static_cast<int>(replayHandler.getIndexingProgress() * 100) << "%)";
+            }
+            else if(replayHandler.isFollowing())
+            {
+                std::cerr << " (following)";
+            }
+            if(replayHandler.isAutoSpeed())
+            {
+                std::cerr << " at " << replayHandler.getReplayFactor() << "x";
+            }
+            std::cerr << ": " << replayHandler.getCurSamplePortName() << "\r";
         }
         usleep(5000);
     }
 
-    std::cout << std::endl;
+    std::cerr << std::endl;
+
+    const auto scheduling = replayHandler.getSchedulingStatistics();
+    std::cout << "scheduling error over " << scheduling.samples << " samples: mean "
+              << std::chrono::duration_cast<std::chrono::microseconds>(scheduling.meanError).count() << " us, max "
+              << std::chrono::duration_cast<std::chrono::microseconds>(scheduling.maxError).count() << " us" << std::endl;
+
+    if(replayHandler.isAutoSpeed())
+    {
+        std::cout << "automatic speed: " << replayHandler.getReplayFactor() << "x at a lag bound of " << argParser.autoSpeedLag << " ms"
+                  << std::endl;
+    }
+
+    const auto catchUp = replayHandler.getCatchUpStatistics();
+    std::cout << "catch-up (" << argParser.catchUp << "): " << catchUp.bursted << " bursted, " << catchUp.dropped << " dropped, "
+              << catchUp.stretched << " stretched by " << std::chrono::duration<double, std::milli>(catchUp.stretchTime).count() << " ms"
+              << std::endl;
+    std::cout << "decimation: " << replayHandler.getDecimatedSamples() << " samples skipped" << std::endl;
+
+    const auto throughput = replayHandler.getThroughputReport();
+    std::cout << "throughput over " << throughput.seconds << " s:" << std::endl;
+    for(const auto& streamName2Throughput : throughput.streams)
+    {
+        printThroughput(streamName2Throughput.first, streamName2Throughput.second);
+    }
+    printThroughput("total", throughput.total);
+
+    if(argParser.lockstep)
+    {
+        std::cout << "bottlenecks:" << std::endl;
+        for(const auto& bottleneck : replayHandler.getBottleneckReport())
+        {
+            std::cout << "  " << bottleneck.streamName << ": blocked " << std::chrono::duration<double>(bottleneck.blockedTime).count() << " s ("
+                      << bottleneck.share * 100 << "%)" << (bottleneck.withoutBackpressure ? ", connections without backpressure" : "")
+                      << std::endl;
+        }
+    }
+
+    const auto latencies = replayHandler.getLatencyReport();
+    if(!latencies.empty())
+    {
+        std::cout << "latencies:" << std::endl;
+        for(const auto& streamName2Latencies : latencies)
+        {
+            std::cout << "  " << streamName2Latencies.first << ":" << std::endl;
+            printLatency("read", streamName2Latencies.second.read);
+            printLatency("unmarshal", streamName2Latencies.second.unmarshal);
+            printLatency("write", streamName2Latencies.second.write);
+        }
+    }
+
+    const auto timing = replayHandler.getTimingReport();
+    if(timing.total.count)
+    {
+        std::cout << "lateness:" << std::endl;
+        for(const auto& streamName2Lateness : timing.streams)
+        {
+            printLatency(streamName2Lateness.first, streamName2Lateness.second);
+        }
+        printLatency("total", timing.total);
+    }
+
+    if(!argParser.timingCsvFile.empty())
+    {
+        std::ofstream file(argParser.timingCsvFile);
+        TimingFidelity::writeCsv(file, timing);
+        if(!file)
+        {
+            std::cerr << "cannot write " << argParser.timingCsvFile << std::endl;
+        }
+    }
 
     replayHandler.stop();
     std::cout << "replay handler stopped" << std::endl;
@@ -34,7 +274,14 @@ int startGui(int argc, char* argv[], const ArgParser& argParser)
     QApplication a(argc, argv);
     ReplayGui gui;
 
-    gui.initReplayHandler(argParser.fileNames, argParser.prefix, argParser.whiteListTokens, argParser.renamings);
+    LogTaskManager::TimeWindow window;
+    if(!getTimeWindow(argParser, window))
+    {
+        return 1;
+    }
+
+    gui.replayHandler.setDecimations(getDecimations(argParser));
+    gui.initReplayHandler(argParser.fileNames, argParser.prefix, argParser.whiteListTokens, argParser.renamings, window);
     gui.updateTaskView();
 
     gui.show();
@@ -46,6 +293,7 @@ int main(int argc, char* argv[])
     ArgParser argParser;
     if(argParser.parseArguments(argc, argv))
     {
+        IndexCache::setMaxSize(argParser.cacheSize << 20);
         if(argParser.headless)
         {
             startHeadless(argParser);
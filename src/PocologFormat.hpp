@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Binary layout of pocolog logfiles, as written by the Rock logger.
+ * A logfile starts with a prologue, followed by blocks. Each block has a header and a payload of the given size.
+ * Stream blocks declare a stream, data blocks hold a sample header and the marshalled sample of a stream.
+ * Multi-byte values are little endian, unless the prologue's big endian flag is set.
+ *
+ */
+struct PocologFormat
+{
+    /**
+     * @brief Types of blocks.
+     *
+     */
+    enum BlockType : uint8_t
+    {
+        UnknownBlock = 0,
+        StreamBlock = 1,
+        DataBlock = 2,
+        ControlBlock = 3
+    };
+
+    /**
+     * @brief Flag of the prologue marking big endian values.
+     *
+     */
+    static constexpr uint32_t bigEndianFlag = 1;
+
+    /**
+     * @brief Start of every logfile.
+     *
+     */
+    struct Prologue
+    {
+        /**
+         * @brief Magic "POCOSIM", without terminating null character.
+         *
+         */
+        char magic[7];
+
+        /**
+         * @brief Unused.
+         *
+         */
+        uint8_t padding;
+
+        /**
+         * @brief Format version.
+         *
+         */
+        uint32_t version;
+
+        /**
+         * @brief Flags, e.g. bigEndianFlag.
+         *
+         */
+        uint32_t flags;
+    } __attribute__((packed));
+
+    /**
+     * @brief Header of every block.
+     *
+     */
+    struct BlockHeader
+    {
+        /**
+         * @brief Type of the block, a BlockType.
+         *
+         */
+        uint8_t type;
+
+        /**
+         * @brief Unused.
+         *
+         */
+        uint8_t padding;
+
+        /**
+         * @brief Index of the stream the block belongs to.
+         *
+         */
+        uint16_t streamIdx;
+
+        /**
+         * @brief Size of the block's payload in bytes.
+         *
+         */
+        uint32_t dataSize;
+    } __attribute__((packed));
+
+    /**
+     * @brief Timestamp of a sample.
+     *
+     */
+    struct Time
+    {
+        /**
+         * @brief Seconds since the epoch.
+         *
+         */
+        uint32_t seconds;
+
+        /**
+         * @brief Microseconds within the second.
+         *
+         */
+        uint32_t microseconds;
+    } __attribute__((packed));
+
+    /**
+     * @brief Start of the payload of a data block, followed by the marshalled sample.
+     *
+     */
+    struct SampleHeader
+    {
+        /**
+         * @brief Time the sample was logged.
+         *
+         */
+        Time realTime;
+
+        /**
+         * @brief Timestamp of the sample, used for replay.
+         *
+         */
+        Time timeStamp;
+
+        /**
+         * @brief Size of the marshalled sample in bytes.
+         *
+         */
+        uint32_t dataSize;
+
+        /**
+         * @brief Indicates whether the marshalled sample is compressed.
+         *
+         */
+        uint8_t compressed;
+    } __attribute__((packed));
+};
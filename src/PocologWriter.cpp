@@ -0,0 +1,152 @@
+#include "PocologWriter.hpp"
+
+#include "PocologFormat.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <unistd.h>
+
+PocologWriter::PocologWriter(const std::string& sourceFileName, const std::string& fileName)
+    : source(sourceFileName, std::ios::binary)
+    , fileName(fileName)
+    , tmpFileName(fileName + "." + std::to_string(getpid()) + ".tmp")
+{
+    PocologFormat::Prologue prologue;
+    if(!source.read(reinterpret_cast<char*>(&prologue), sizeof(prologue)) || std::memcmp(prologue.magic, "POCOSIM", sizeof(prologue.magic)) ||
+       (prologue.flags & PocologFormat::bigEndianFlag))
+    {
+        throw std::runtime_error("not a little endian pocolog logfile: " + sourceFileName);
+    }
+
+    output.open(tmpFileName, std::ios::binary | std::ios::trunc);
+    if(!output.write(reinterpret_cast<const char*>(&prologue), sizeof(prologue)))
+    {
+        throw std::runtime_error("cannot write logfile " + fileName);
+    }
+}
+
+PocologWriter::~PocologWriter()
+{
+    if(!closed)
+    {
+        output.close();
+        std::remove(tmpFileName.c_str());
+    }
+}
+
+bool PocologWriter::declareStreams(const std::vector<size_t>& streamIdxs)
+{
+    if(this->streamIdxs.size() + streamIdxs.size() > std::numeric_limits<uint16_t>::max())
+    {
+        return false;
+    }
+
+    // the declarations are collected first, so that they are written in the requested order
+    std::map<size_t, std::vector<char>> declarations;
+    for(size_t streamIdx : streamIdxs)
+    {
+        declarations[streamIdx];
+    }
+
+    size_t numFound = 0;
+    PocologFormat::BlockHeader blockHeader;
+    source.clear();
+    source.seekg(sizeof(PocologFormat::Prologue));
+    while(numFound < declarations.size() && source.read(reinterpret_cast<char*>(&blockHeader), sizeof(blockHeader)))
+    {
+        auto declaration = declarations.find(blockHeader.streamIdx);
+        if(blockHeader.type != PocologFormat::StreamBlock || declaration == declarations.end() || !declaration->second.empty())
+        {
+            source.seekg(blockHeader.dataSize, std::ios::cur);
+            continue;
+        }
+
+        declaration->second.resize(sizeof(blockHeader) + blockHeader.dataSize);
+        if(!source.read(declaration->second.data() + sizeof(blockHeader), blockHeader.dataSize))
+        {
+            return false;
+        }
+        numFound++;
+    }
+
+    if(numFound < declarations.size())
+    {
+        return false;
+    }
+
+    for(size_t streamIdx : streamIdxs)
+    {
+        std::vector<char>& declaration = declarations[streamIdx];
+        const uint16_t newStreamIdx = this->streamIdxs.size();
+        blockHeader.type = PocologFormat::StreamBlock;
+        blockHeader.padding = 0;
+        blockHeader.streamIdx = newStreamIdx;
+        blockHeader.dataSize = declaration.size() - sizeof(blockHeader);
+        std::memcpy(declaration.data(), &blockHeader, sizeof(blockHeader));
+        output.write(declaration.data(), declaration.size());
+        this->streamIdxs.emplace(streamIdx, newStreamIdx);
+    }
+
+    return static_cast<bool>(output);
+}
+
+bool PocologWriter::copySample(size_t streamIdx, uint64_t position, const std::vector<uint8_t>* sampleData)
+{
+    auto newStreamIdx = streamIdxs.find(streamIdx);
+    if(newStreamIdx == streamIdxs.end())
+    {
+        return false;
+    }
+
+    PocologFormat::BlockHeader blockHeader;
+    source.clear();
+    source.seekg(position);
+    if(!source.read(reinterpret_cast<char*>(&blockHeader), sizeof(blockHeader)) || blockHeader.type != PocologFormat::DataBlock ||
+       blockHeader.streamIdx != streamIdx || blockHeader.dataSize < sizeof(PocologFormat::SampleHeader))
+    {
+        return false;
+    }
+
+    // the sample header keeps the timestamps, only the marshaled sample may be replaced
+    const size_t payloadSize = sampleData ? sizeof(PocologFormat::SampleHeader) + sampleData->size() : blockHeader.dataSize;
+    block.resize(sizeof(blockHeader) + std::max<size_t>(payloadSize, blockHeader.dataSize));
+    if(!source.read(block.data() + sizeof(blockHeader), sampleData ? sizeof(PocologFormat::SampleHeader) : blockHeader.dataSize))
+    {
+        return false;
+    }
+
+    if(sampleData)
+    {
+        PocologFormat::SampleHeader sampleHeader;
+        std::memcpy(&sampleHeader, block.data() + sizeof(blockHeader), sizeof(sampleHeader));
+        sampleHeader.dataSize = sampleData->size();
+        std::memcpy(block.data() + sizeof(blockHeader), &sampleHeader, sizeof(sampleHeader));
+        std::copy(sampleData->begin(), sampleData->end(), block.begin() + sizeof(blockHeader) + sizeof(sampleHeader));
+    }
+
+    blockHeader.streamIdx = newStreamIdx->second;
+    blockHeader.dataSize = payloadSize;
+    std::memcpy(block.data(), &blockHeader, sizeof(blockHeader));
+    if(!output.write(block.data(), sizeof(blockHeader) + payloadSize))
+    {
+        return false;
+    }
+
+    numSamples++;
+    return true;
+}
+
+bool PocologWriter::close()
+{
+    output.close();
+    if(!output || std::rename(tmpFileName.c_str(), fileName.c_str()))
+    {
+        return false;
+    }
+
+    closed = true;
+    return true;
+}
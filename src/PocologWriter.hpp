@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Writes a pocolog logfile by copying blocks of an existing logfile, without unmarshaling the samples.
+ * Stream declarations are copied byte by byte, so the type descriptions and metadata are kept. The copied streams
+ * are numbered in the order of their declaration in the new logfile.
+ * The logfile is written to a temporary file first and renamed when it is closed.
+ *
+ */
+class PocologWriter
+{
+public:
+    /**
+     * @brief Opens the source logfile and starts the new logfile with the source's prologue.
+     * Throws std::runtime_error if the source is not a little endian pocolog logfile or the new logfile cannot be written.
+     *
+     * @param sourceFileName: Name of the logfile to copy from.
+     * @param fileName: Name of the new logfile.
+     */
+    PocologWriter(const std::string& sourceFileName, const std::string& fileName);
+
+    /**
+     * @brief Destructor. Removes the new logfile unless it was closed.
+     *
+     */
+    ~PocologWriter();
+
+    PocologWriter(const PocologWriter&) = delete;
+    PocologWriter& operator=(const PocologWriter&) = delete;
+
+    /**
+     * @brief Copies the declarations of the given streams. The source is searched from its start
+     * until all declarations are found, which are usually at the start of the logfile.
+     *
+     * @param streamIdxs: Indices of the streams in the source logfile, in the order of their new indices.
+     * @return bool True if all streams were declared, false otherwise.
+     */
+    bool declareStreams(const std::vector<size_t>& streamIdxs);
+
+    /**
+     * @brief Copies a sample of a declared stream, including its timestamps.
+     *
+     * @param streamIdx: Index of the sample's stream in the source logfile.
+     * @param position: Position of the sample's block in the source logfile, as stored in the pocolog index.
+     * @param sampleData: Marshaled sample replacing the one in the source logfile, e.g. if the source is the header log of a compressed
+     * logfile. Nullptr to copy the marshaled sample of the source.
+     * @return bool True if the sample was copied, false if the stream is not declared or the block is no sample of the stream.
+     */
+    bool copySample(size_t streamIdx, uint64_t position, const std::vector<uint8_t>* sampleData = nullptr);
+
+    /**
+     * @brief Finishes the new logfile and renames it to its final name.
+     *
+     * @return bool True if the logfile was written, false otherwise.
+     */
+    bool close();
+
+    /**
+     * @brief Returns the number of copied samples.
+     *
+     * @return size_t Number of samples.
+     */
+    size_t getNumSamples() const
+    {
+        return numSamples;
+    };
+
+private:
+    /**
+     * @brief Source logfile.
+     *
+     */
+    std::ifstream source;
+
+    /**
+     * @brief Name of the new logfile.
+     *
+     */
+    std::string fileName;
+
+    /**
+     * @brief Name of the temporary file the new logfile is written to.
+     *
+     */
+    std::string tmpFileName;
+
+    /**
+     * @brief New logfile.
+     *
+     */
+    std::ofstream output;
+
+    /**
+     * @brief New index of each declared stream, addressed by its index in the source logfile.
+     *
+     */
+    std::map<size_t, uint16_t> streamIdxs;
+
+    /**
+     * @brief Buffer for the copied block.
+     *
+     */
+    std::vector<char> block;
+
+    /**
+     * @brief Number of copied samples.
+     *
+     */
+    size_t numSamples = 0;
+
+    /**
+     * @brief Indicates whether the new logfile was closed.
+     *
+     */
+    bool closed = false;
+};
@@ -2,9 +2,16 @@
 
 #include "LogFileHelper.hpp"
 
+#include <QApplication>
 #include <QFileDialog>
 #include <QMessageBox>
 
+/**
+ * @brief Tooltip of the decimation column.
+ *
+ */
+static const QString decimationHelp = "number of samples per replayed sample (10) or maximum rate (5Hz), empty to replay all samples";
+
 ReplayGui::ReplayGui(QMainWindow* parent)
     : QMainWindow(parent)
 {
@@ -15,8 +22,8 @@ ReplayGui::ReplayGui(QMainWindow* parent)
     ui.taskNameList->setModel(tasksModel);
     ui.taskNameList->setAlternatingRowColors(true);
 
-    tasksModel->setColumnCount(2);
-    tasksModel->setHorizontalHeaderLabels(QStringList({"Taskname", "Type"}));
+    tasksModel->setColumnCount(4);
+    tasksModel->setHorizontalHeaderLabels(QStringList({"Taskname", "Decimation", "Type", "Latency p99 read/unmarshal/write [us]"}));
     ui.taskNameList->setColumnWidth(0, 300);
 
     if(this->palette().color(QPalette::Window).black() > 150) // dark theme used, background must be dark as well
@@ -29,6 +36,10 @@ ReplayGui::ReplayGui(QMainWindow* parent)
     statusUpdateTimer->setInterval(10);
     checkFinishedTimer = new QTimer();
     checkFinishedTimer->setInterval(10);
+    indexingTimer = new QTimer();
+    indexingTimer->setInterval(100);
+    latencyUpdateTimer = new QTimer();
+    latencyUpdateTimer->setInterval(1000);
 
     QPalette palette;
     palette.setColor(QPalette::Window, Qt::red);
@@ -49,10 +60,15 @@ ReplayGui::ReplayGui(QMainWindow* parent)
     QObject::connect(ui.intervalBButton, SIGNAL(clicked()), this, SLOT(setIntervalB()));
     QObject::connect(statusUpdateTimer, SIGNAL(timeout()), this, SLOT(statusUpdate()));
     QObject::connect(ui.speedBox, SIGNAL(valueChanged(double)), this, SLOT(setSpeedBox()));
+    QObject::connect(ui.autoSpeedButton, SIGNAL(toggled(bool)), this, SLOT(setAutoSpeed(bool)));
     QObject::connect(ui.progressSlider, SIGNAL(sliderReleased()), this, SLOT(progressSliderUpdate()));
+    QObject::connect(ui.seekTimeEdit, SIGNAL(returnPressed()), this, SLOT(seekTimeUpdate()));
     QObject::connect(checkFinishedTimer, SIGNAL(timeout()), this, SLOT(handleRestart()));
+    QObject::connect(indexingTimer, SIGNAL(timeout()), this, SLOT(indexingUpdate()));
+    QObject::connect(latencyUpdateTimer, SIGNAL(timeout()), this, SLOT(latencyUpdate()));
     QObject::connect(ui.infoAbout, SIGNAL(triggered()), this, SLOT(showInfoAbout()));
     QObject::connect(ui.actionOpenLogfile, SIGNAL(triggered()), this, SLOT(showOpenFile()));
+    QObject::connect(ui.actionExportSpan, SIGNAL(triggered()), this, SLOT(showExportSpan()));
     QObject::connect(tasksModel, SIGNAL(itemChanged(QStandardItem*)), this, SLOT(handleItemChanged(QStandardItem*)));
 }
 
@@ -63,9 +79,10 @@ ReplayGui::~ReplayGui()
 
 void ReplayGui::initReplayHandler(
     const std::vector<std::string>& fileNames, const std::string& prefix, const std::vector<std::string>& whiteList,
-    const std::map<std::string, std::string>& renamings)
+    const std::map<std::string, std::string>& renamings, const LogTaskManager::TimeWindow& window)
 {
-    replayHandler.init(fileNames, prefix, whiteList, renamings);
+    replayHandler.initInBackground(fileNames, prefix, whiteList, renamings, window);
+    indexingTimer->start();
 
     QString title;
     // window title
@@ -130,6 +147,7 @@ void ReplayGui::togglePlay()
     if(replayHandler.getMaxIndex() && !replayHandler.isPlaying())
     {
         checkFinishedTimer->start();
+        replayHandler.setPrimeOnSeek(ui.primeButton->isChecked());
         replayHandler.play();
         setGuiPlaying();
     }
@@ -141,6 +159,25 @@ void ReplayGui::togglePlay()
     }
 }
 
+void ReplayGui::indexingUpdate()
+{
+    const bool indexing = replayHandler.isIndexing();
+    updateTaskView();
+
+    // the first indexed sample replaces the placeholder of the empty index
+    if(!ui.progressSlider->maximum() && replayHandler.getMaxIndex() && !replayHandler.isPlaying())
+    {
+        replayHandler.setSampleIndex(replayHandler.getCurIndex());
+    }
+    ui.progressSlider->setMaximum(replayHandler.getMaxIndex());
+
+    if(!indexing)
+    {
+        indexingTimer->stop();
+    }
+    statusUpdate();
+}
+
 void ReplayGui::handleRestart()
 {
     if(replayHandler.hasFinished())
@@ -156,15 +193,46 @@ void ReplayGui::handleRestart()
     }
 }
 
+void ReplayGui::latencyUpdate()
+{
+    const auto latencies = replayHandler.getLatencyReport();
+    auto toMicroseconds = [](std::chrono::nanoseconds duration) { return QString::number(duration.count() / 1000.); };
+    for(int taskRow = 0; taskRow < tasksModel->rowCount(); taskRow++)
+    {
+        QStandardItem* task = tasksModel->item(taskRow);
+        for(int portRow = 0; portRow < task->rowCount(); portRow++)
+        {
+            QStandardItem* latency = task->child(portRow, 3);
+            if(!latency)
+            {
+                continue;
+            }
+
+            auto streamName2Latencies = latencies.find(task->text().toStdString() + "." + task->child(portRow)->text().toStdString());
+            if(streamName2Latencies == latencies.end())
+            {
+                latency->setText("");
+                continue;
+            }
+
+            const auto& stages = streamName2Latencies->second;
+            latency->setText(
+                toMicroseconds(stages.read.p99) + " / " + toMicroseconds(stages.unmarshal.p99) + " / " + toMicroseconds(stages.write.p99));
+        }
+    }
+}
+
 void ReplayGui::setGuiPlaying()
 {
     ui.playButton->setChecked(true);
     ui.playButton->setIcon(pauseIcon);
     statusUpdateTimer->start();
     checkFinishedTimer->start();
+    latencyUpdateTimer->start();
     ui.forwardButton->setEnabled(false);
     ui.backwardButton->setEnabled(false);
     ui.progressSlider->setEnabled(false);
+    ui.seekTimeEdit->setEnabled(false);
     ui.intervalAButton->setEnabled(false);
     ui.intervalBButton->setEnabled(false);
     statusUpdate();
@@ -176,9 +244,12 @@ void ReplayGui::setGuiPaused()
     ui.playButton->setChecked(false);
     statusUpdateTimer->stop();
     checkFinishedTimer->stop();
+    latencyUpdateTimer->stop();
+    latencyUpdate();
     ui.forwardButton->setEnabled(true);
     ui.backwardButton->setEnabled(true);
     ui.progressSlider->setEnabled(true);
+    ui.seekTimeEdit->setEnabled(true);
     ui.intervalAButton->setEnabled(true);
     ui.intervalBButton->setEnabled(true);
     statusUpdate();
@@ -187,12 +258,28 @@ void ReplayGui::setGuiPaused()
 void ReplayGui::statusUpdate()
 {
     QString interval = "    [" + QString::number(replayHandler.getMinSpan()) + "/" + QString::number(replayHandler.getMaxSpan()) + "]";
+    if(replayHandler.isIndexing())
+    {
+        interval += "    indexing " + QString::number(static_cast<int>(replayHandler.getIndexingProgress() * 100)) + "%";
+    }
     ui.curSampleNum->setText(QString::number(replayHandler.getCurIndex()) + "/" + QString::number(replayHandler.getMaxIndex()) + interval);
     ui.curTimestamp->setText(replayHandler.getCurTimeStamp().c_str());
     ui.curPortName->setText(replayHandler.getCurSamplePortName().c_str());
     ui.curPortName->setAutoFillBackground(!replayHandler.canSampleBeReplayed());
     ui.progressSlider->setSliderPosition(replayHandler.getCurIndex());
     ui.speedBar->setValue(replayHandler.getCurrentSpeed() * 100);
+
+    // the speed box follows the automatic speed without setting it again
+    if(replayHandler.isAutoSpeed())
+    {
+        ui.speedBox->blockSignals(true);
+        ui.speedBox->setValue(replayHandler.getReplayFactor());
+        ui.speedBox->blockSignals(false);
+    }
+
+    const auto lag = replayHandler.getLag();
+    auto toMilliseconds = [](std::chrono::nanoseconds duration) { return QString::number(duration.count() / 1e6, 'f', 1); };
+    ui.lagLabel->setText(lag.count ? "Lag: " + toMilliseconds(lag.p50) + " / " + toMilliseconds(lag.p99) + " ms" : "Lag: -");
 }
 
 void ReplayGui::stopPlay()
@@ -208,6 +295,16 @@ void ReplayGui::setSpeedBox()
     replayHandler.setReplaySpeed(speed);
 }
 
+void ReplayGui::setAutoSpeed(bool autoSpeed)
+{
+    replayHandler.setAutoSpeed(autoSpeed);
+    ui.speedBox->setEnabled(!autoSpeed);
+    if(!autoSpeed)
+    {
+        setSpeedBox();
+    }
+}
+
 void ReplayGui::backward()
 {
     replayHandler.previous();
@@ -226,9 +323,25 @@ void ReplayGui::progressSliderUpdate()
     statusUpdate();
 }
 
+void ReplayGui::seekTimeUpdate()
+{
+    base::Time time;
+    if(LogFileHelper::parseTime(ui.seekTimeEdit->text().toStdString(), replayHandler.getStartTime(), time))
+    {
+        replayHandler.seekToTime(time);
+        ui.seekTimeEdit->clear();
+    }
+    else
+    {
+        ui.seekTimeEdit->selectAll();
+    }
+
+    statusUpdate();
+}
+
 void ReplayGui::showOpenFile()
 {
-    QStringList fileNames = QFileDialog::getOpenFileNames(this, "Select logfile(s)", "", "Logfiles: *.log");
+    QStringList fileNames = QFileDialog::getOpenFileNames(this, "Select logfile(s)", "", "Logfiles: *.log *.log.zst");
     QStringList fileNamesCopy = fileNames; // doc says so
 
     std::vector<std::string> stdStrings;
@@ -239,11 +352,31 @@ void ReplayGui::showOpenFile()
 
     stopPlay();
     replayHandler.deinit();
+    clearTaskView();
     initReplayHandler(stdStrings, "");
     updateTaskView();
     statusUpdate();
 }
 
+void ReplayGui::showExportSpan()
+{
+    QString directory = QFileDialog::getExistingDirectory(this, "Select export directory");
+    if(directory.isEmpty())
+    {
+        return;
+    }
+
+    // the samples are copied without unmarshaling, so the export runs at disk speed
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const bool exported = replayHandler.exportSpan(directory.toStdString());
+    QApplication::restoreOverrideCursor();
+
+    if(!exported)
+    {
+        QMessageBox::warning(this, "Export Span", "Cannot export the span to " + directory, QMessageBox::Ok, 0);
+    }
+}
+
 void ReplayGui::showInfoAbout()
 {
     QMessageBox::information(this, "Credits", QString("PICOL iconset: http://www.picol.org\n"), QMessageBox::Ok, 0);
@@ -251,6 +384,16 @@ void ReplayGui::showInfoAbout()
 
 void ReplayGui::handleItemChanged(QStandardItem* item)
 {
+    if(item->column() == 1)
+    {
+        handleDecimationChanged(item);
+        return;
+    }
+    else if(item->column() != 0)
+    {
+        return;
+    }
+
     const QModelIndex index = tasksModel->indexFromItem(item);
     QItemSelectionModel* selModel = ui.taskNameList->selectionModel();
     const std::string portName = item->text().toStdString();
@@ -258,7 +401,31 @@ void ReplayGui::handleItemChanged(QStandardItem* item)
     selModel->select(QItemSelection(index, index), item->checkState() == Qt::Checked ? QItemSelectionModel::Select : QItemSelectionModel::Deselect);
 }
 
-void ReplayGui::updateTaskView()
+void ReplayGui::handleDecimationChanged(QStandardItem* item)
+{
+    // the last applied text is kept in the user role, changes of the other roles and reverts compare equal to it
+    const QString applied = item->data(Qt::UserRole).toString();
+    if(item->text() == applied)
+    {
+        return;
+    }
+
+    uint64_t keepEvery;
+    double maxRate;
+    const QStandardItem* port = item->parent()->child(item->row());
+    if(!LogFileHelper::parseDecimation(item->text().toStdString(), keepEvery, maxRate))
+    {
+        item->setText(applied);
+        return;
+    }
+
+    const uint64_t decimation = replayHandler.setDecimationForPort(
+        item->parent()->text().toStdString(), port->text().toStdString(), LogTaskManager::Decimation{keepEvery, maxRate});
+    item->setData(item->text(), Qt::UserRole);
+    item->setToolTip(decimation > 1 ? QString("replays 1 of %1 samples").arg(decimation) : decimationHelp);
+}
+
+void ReplayGui::clearTaskView()
 {
     while(tasksModel->rowCount() > 0)
     {
@@ -266,24 +433,49 @@ void ReplayGui::updateTaskView()
         for(QStandardItem* item : rows)
             delete item;
     }
+}
 
+void ReplayGui::updateTaskView()
+{
     for(const auto& taskName2Ports : replayHandler.getTaskNamesWithPorts())
     {
-        auto* task = new QStandardItem(taskName2Ports.first.c_str());
-        task->setCheckable(false);
+        QStandardItem* task;
+        const QList<QStandardItem*> taskItems = tasksModel->findItems(taskName2Ports.first.c_str());
+        if(taskItems.empty())
+        {
+            task = new QStandardItem(taskName2Ports.first.c_str());
+            task->setCheckable(false);
+            tasksModel->appendRow(task);
+        }
+        else
+        {
+            task = taskItems.front();
+        }
 
-        QList<QStandardItem*> portTypes;
         for(const auto& portName : taskName2Ports.second)
         {
-            QStandardItem* port = new QStandardItem(portName.first.c_str());
-            port->setCheckable(true);
-            port->setData(Qt::Checked, Qt::CheckStateRole);
-            task->appendRow(port);
-            portTypes.push_back(new QStandardItem(portName.second.c_str()));
+            bool shown = false;
+            for(int row = 0; row < task->rowCount(); row++)
+            {
+                shown |= task->child(row)->text().toStdString() == portName.first;
+            }
+
+            if(!shown)
+            {
+                QStandardItem* port = new QStandardItem(portName.first.c_str());
+                port->setCheckable(true);
+                port->setData(Qt::Checked, Qt::CheckStateRole);
+                const uint64_t keepEvery = replayHandler.getDecimationForPort(task->text().toStdString(), portName.first);
+                const QString decimationText = keepEvery > 1 ? QString::number(keepEvery) : QString();
+                QStandardItem* decimation = new QStandardItem(decimationText);
+                decimation->setData(decimationText, Qt::UserRole);
+                decimation->setToolTip(keepEvery > 1 ? QString("replays 1 of %1 samples").arg(keepEvery) : decimationHelp);
+                QStandardItem* type = new QStandardItem(portName.second.c_str());
+                type->setEditable(false);
+                QStandardItem* latency = new QStandardItem();
+                latency->setEditable(false);
+                task->appendRow(QList<QStandardItem*>({port, decimation, type, latency}));
+            }
         }
-
-        task->appendColumn(portTypes);
-
-        tasksModel->appendRow(task);
     }
 }
@@ -30,22 +30,31 @@ public:
     ~ReplayGui();
 
     /**
-     * @brief Updates the task view when the model changed.
+     * @brief Updates the task view when the model changed. Tasks and ports are only appended,
+     * so that the check states of shown ports are kept.
      *
      */
     void updateTaskView();
 
+    /**
+     * @brief Removes all tasks from the task view.
+     *
+     */
+    void clearTaskView();
+
     /**
      * @brief Inits the underlying replay handler with file names to load and a optional log task prefix.
+     * The logfiles are indexed in the background, the view is updated as tasks and samples are added.
      *
      * @param fileNames: List of file names to load.
      * @param prefix: Optional prefix to set for all log tasks.
      * @param whiteList: List of regular expressions to filter whitelisted streams.
      * @param renamings: Map of renamings.
+     * @param window: Optional time window, only the samples within the window are loaded.
      */
     void initReplayHandler(
         const std::vector<std::string>& fileNames, const std::string& prefix, const std::vector<std::string>& whiteList = {},
-        const std::map<std::string, std::string>& renamings = {});
+        const std::map<std::string, std::string>& renamings = {}, const LogTaskManager::TimeWindow& window = {});
 
 protected:
     /**
@@ -91,6 +100,18 @@ private:
      */
     QTimer* checkFinishedTimer;
 
+    /**
+     * @brief Timer to update the view periodically while indexing.
+     *
+     */
+    QTimer* indexingTimer;
+
+    /**
+     * @brief Timer to update the latency column periodically while playing.
+     *
+     */
+    QTimer* latencyUpdateTimer;
+
     /**
      * @brief Sets the gui in a paused mode, inverting icons and enabling certain interactions.
      *
@@ -103,6 +124,13 @@ private:
      */
     void setGuiPlaying();
 
+    /**
+     * @brief Applies an edited decimation of a port, reverting the item to the last applied decimation if it cannot be parsed.
+     *
+     * @param item: Item of the decimation column.
+     */
+    void handleDecimationChanged(QStandardItem* item);
+
 public slots:
 
     /**
@@ -135,6 +163,13 @@ public slots:
      */
     void setSpeedBox();
 
+    /**
+     * @brief Enables or disables the automatic speed. The speed box shows the automatic speed while it is enabled.
+     *
+     * @param autoSpeed: True if the speed should be adjusted automatically, false otherwise.
+     */
+    void setAutoSpeed(bool autoSpeed);
+
     /**
      * @brief Sets the replay index pointer one step further.
      *
@@ -153,6 +188,12 @@ public slots:
      */
     void progressSliderUpdate();
 
+    /**
+     * @brief Forwards the log time entered in the seek field to the replay handler.
+     *
+     */
+    void seekTimeUpdate();
+
     /**
      * @brief Shows the about info and credits.
      *
@@ -165,12 +206,30 @@ public slots:
      */
     void showOpenFile();
 
+    /**
+     * @brief Opens a dialog to export the samples between the span markers of the active ports to new log files.
+     *
+     */
+    void showExportSpan();
+
     /**
      * @brief Handles a restart of replaying when repeat option is enabled.
      *
      */
     void handleRestart();
 
+    /**
+     * @brief Adds newly indexed tasks and samples to the view. Stops the indexing timer after indexing has finished.
+     *
+     */
+    void indexingUpdate();
+
+    /**
+     * @brief Shows the 99th percentiles of the replay stages of each port in the latency column of the task view.
+     *
+     */
+    void latencyUpdate();
+
     /**
      * @brief Sets the minimum span.
      *
@@ -3,7 +3,28 @@
 #include "LogFileHelper.hpp"
 
 #include <algorithm>
+#include <base-logging/Logging.hpp>
 #include <boost/algorithm/clamp.hpp>
+#include <limits>
+
+/**
+ * @brief Minimum time between appending the samples written to followed logfiles. Bounds the replay lag behind the writer.
+ *
+ */
+static const std::chrono::milliseconds followInterval(200);
+
+/**
+ * @brief Factor by which the time between appends exceeds the duration of the last append. pocolog indexes a reopened logfile anew,
+ * in time linear to its size, so the interval grows with the followed logfiles and appending takes at most a fifth of the index thread.
+ *
+ */
+static const int followBackoff = 5;
+
+/**
+ * @brief Time by which a sample may miss its deadline before the catch-up policy applies. Covers the wake up latency of the replay thread.
+ *
+ */
+static const std::chrono::milliseconds catchUpTolerance(1);
 
 ReplayHandler::~ReplayHandler()
 {
@@ -12,10 +33,93 @@ ReplayHandler::~ReplayHandler()
 
 void ReplayHandler::init(
     const std::vector<std::string>& fileNames, const std::string& prefix, const std::vector<std::string>& whiteList,
-    const std::map<std::string, std::string>& renamings)
+    const std::map<std::string, std::string>& renamings, const LogTaskManager::ProgressCallback& progress,
+    const LogTaskManager::TimeWindow& window)
+{
+    deinit();
+    manager.setFollowing(follow);
+    manager.setIndexOnly(indexOnly);
+    manager.init(fileNames, prefix, whiteList, renamings, progress, window);
+    indexingProgress = 1.;
+
+    if(follow)
+    {
+        following = true;
+        indexThread = std::thread([=]() { followLogFiles(fileNames); });
+    }
+
+    startReplay();
+}
+
+void ReplayHandler::initInBackground(
+    const std::vector<std::string>& fileNames, const std::string& prefix, const std::vector<std::string>& whiteList,
+    const std::map<std::string, std::string>& renamings, const LogTaskManager::TimeWindow& window)
+{
+    deinit();
+
+    // the previous session is closed before replay starts, so that only the indexing thread changes the manager
+    manager.clear();
+    manager.setFollowing(follow);
+    manager.setIndexOnly(indexOnly);
+    indexing = true;
+    following = follow;
+    indexingProgress = 0.;
+    indexThread = std::thread([=]() {
+        manager.init(fileNames, prefix, whiteList, renamings, [this](double progress) { indexingProgress = progress; }, window);
+        indexing = false;
+        followLogFiles(fileNames);
+    });
+
+    startReplay();
+}
+
+void ReplayHandler::followLogFiles(const std::vector<std::string>& fileNames)
+{
+    LogFileWatcher watcher;
+    if(following && !watcher.watch(fileNames))
+    {
+        LOG_WARN_S << "cannot watch all logfiles, checking them every " << followInterval.count() << " ms";
+    }
+
+    // samples written before the watches were added are appended first
+    auto nextAppend = std::chrono::steady_clock::now();
+    bool changed = true;
+    while(following)
+    {
+        if(changed)
+        {
+            // a logger writes continuously, so the logfiles are reopened at most once per interval. Waiting in steps of the
+            // follow interval bounds the delay of deinit
+            for(auto now = std::chrono::steady_clock::now(); following && now < nextAppend; now = std::chrono::steady_clock::now())
+            {
+                std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(nextAppend - now, followInterval));
+            }
+
+            if(!following)
+            {
+                break;
+            }
+
+            const auto appendStart = std::chrono::steady_clock::now();
+            manager.appendNewSamples();
+            const auto appendDuration = std::chrono::steady_clock::now() - appendStart;
+            nextAppend = appendStart + std::max<std::chrono::steady_clock::duration>(followInterval, followBackoff * appendDuration);
+
+            // e.g. the logger wrote past the end time, so replay finishes after the indexed samples
+            if(!manager.canAppendSamples())
+            {
+                LOG_INFO_S << "stopped following the logfiles, no more samples can be appended";
+                following = false;
+                break;
+            }
+        }
+
+        changed = watcher.waitForChanges(followInterval);
+    }
+}
+
+void ReplayHandler::startReplay()
 {
-    manager.init(fileNames, prefix, whiteList, renamings);
-    gotSamplesToPlay = manager.getNumSamples();
     targetSpeed = 1.;
     currentSpeed = 0;
     curIndex = 0;
@@ -23,27 +127,53 @@ void ReplayHandler::init(
     playing = false;
     running = true;
     replayWasValid = true;
-    maxIdx = gotSamplesToPlay ? manager.getNumSamples() - 1 : 0;
     minSpan = 0;
-    maxSpan = maxIdx;
+    maxSpan = std::numeric_limits<uint64_t>::max();
     setSampleIndex(curIndex);
+    scheduler.anchor(curMetadata.timeStamp, targetSpeed);
+    scheduler.resetStatistics();
+    timingFidelity.reset();
+    resetCatchUpStatistics();
+    droppableStreams.clear();
+    playDuration = std::chrono::nanoseconds::zero();
+
+    replayThread = std::thread(std::bind(&ReplayHandler::replaySamples, this));
+}
+
+void ReplayHandler::waitForIndex()
+{
+    // while the logfiles are followed, the index thread keeps running after indexing
+    while(indexing && following)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
 
-    if(gotSamplesToPlay)
+    if(!following && indexThread.joinable())
     {
-        replayThread = std::thread(std::bind(&ReplayHandler::replaySamples, this));
+        indexThread.join();
     }
 }
 
 void ReplayHandler::deinit()
 {
+    // a cancel is lost if it precedes the start of init, so it is repeated until indexing stopped
+    following = false;
+    while(indexing)
+    {
+        manager.cancelInit();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    waitForIndex();
+
     {
         std::lock_guard<std::mutex> lock(playMutex);
         playing = false;
         running = false;
     }
     playCondition.notify_one();
+    manager.setLockstep(false);
 
-    if(gotSamplesToPlay && replayThread.joinable())
+    if(replayThread.joinable())
     {
         replayThread.join();
     }
@@ -60,55 +190,206 @@ void ReplayHandler::replaySamples()
     {
         setTimeStampBaselines();
 
+        uint64_t pipelineEnd = getMaxSpan();
+        if(pipelined && playing)
+        {
+            pipeline.start(curIndex, pipelineEnd);
+        }
+
         while(playing)
         {
-            replayWasValid = manager.replaySample();
-            if(curIndex < maxSpan)
+            // decimated samples are skipped without waiting for their deadline
+            std::chrono::nanoseconds overdue;
+            if(curMetadata.decimated)
+            {
+                if(pipelined)
+                {
+                    pipeline.skipSample(curIndex);
+                }
+                decimated++;
+            }
+            else if(!waitForDeadline(overdue))
+            {
+                continue;
+            }
+            else if(overdue > catchUpTolerance && catchUpPolicy == CatchUpPolicy::Drop && isDroppable(curMetadata.streamIdx, curMetadata.portName))
+            {
+                // in sequential replay, dropped samples are neither read nor unmarshaled, the pipeline has prepared them already
+                if(pipelined)
+                {
+                    pipeline.skipSample(curIndex);
+                }
+                dropped++;
+            }
+            else
+            {
+                publishSample(overdue);
+            }
+
+            if(curIndex >= getMaxSpan())
+            {
+                waitForSamples();
+            }
+
+            if(curIndex < getMaxSpan())
             {
+                // the pipeline follows the span while indexing publishes more samples
+                if(pipelined && getMaxSpan() > pipelineEnd)
+                {
+                    pipelineEnd = getMaxSpan();
+                    pipeline.extend(pipelineEnd);
+                }
+
                 calculateRelativeSpeed();
                 next();
-                calculateTimeToSleep();
-
-                std::unique_lock<std::mutex> lock(playMutex);
-                playCondition.wait_for(lock, std::chrono::milliseconds(timeToSleep), [this] { return !playing || !running; });
             }
-            else
+            else if(!canSpanGrow())
             {
                 finished = true;
                 playing = false;
             }
         }
+
+        pipeline.stop();
+
+        std::lock_guard<std::mutex> lock(playMutex);
+        playDuration += ReplayScheduler::Clock::now() - playStart;
     }
 }
 
-void ReplayHandler::calculateTimeToSleep()
+bool ReplayHandler::waitForDeadline(std::chrono::nanoseconds& overdue)
 {
-    timeToSleep = (curMetadata.timeStamp - previousSampleTime).toMilliseconds() / targetSpeed;
-    timeBeforeSleep = base::Time::now();
+    overdue = std::chrono::nanoseconds::zero();
+    if(unthrottled)
+    {
+        return playing && running;
+    }
+
+    std::unique_lock<std::mutex> lock(playMutex);
+
+    // the deadline is recalculated after each wake up, as a speed change re-anchors the schedule
+    while(playing && running)
+    {
+        const auto deadline = scheduler.getDeadline(curMetadata.timeStamp);
+        if(playCondition.wait_until(lock, deadline) == std::cv_status::timeout)
+        {
+            overdue = ReplayScheduler::Clock::now() - deadline;
+            return true;
+        }
+    }
+
+    return false;
 }
 
-void ReplayHandler::calculateRelativeSpeed()
+void ReplayHandler::publishSample(std::chrono::nanoseconds overdue)
 {
-    int64_t diff = (base::Time::now() - timeBeforeSleep).toMilliseconds();
-    if(diff && timeToSleep)
+    replayWasValid = pipelined ? pipeline.replaySample(curIndex) : manager.replaySample();
+    if(unthrottled)
     {
-        currentSpeed = static_cast<double>(timeToSleep) / diff;
+        return;
     }
-    else
+
+    // the anchor is read and changed under the play mutex, as the speed is set from other threads
+    const auto publishTime = ReplayScheduler::Clock::now();
+    std::chrono::nanoseconds lateness;
+    {
+        std::lock_guard<std::mutex> lock(playMutex);
+        lateness = scheduler.recordPublish(curMetadata.timeStamp, publishTime);
+
+        // re-anchoring at the current sample keeps the lag of an overloaded period out of the next one
+        if(autoSpeed && speedController.record(lateness, publishTime))
+        {
+            targetSpeed = speedController.getSpeed();
+            scheduler.anchor(curMetadata.timeStamp, targetSpeed, publishTime);
+        }
+
+        // the schedule is re-anchored at the late sample, so that the following samples keep their distances
+        if(catchUpPolicy == CatchUpPolicy::Stretch && lateness > catchUpTolerance)
+        {
+            scheduler.anchor(curMetadata.timeStamp, scheduler.getSpeed(), publishTime);
+            stretched++;
+            stretchTime += lateness.count();
+        }
+    }
+    timingFidelity.record(curMetadata.streamIdx, curMetadata.portName, curMetadata.timeStamp, lateness, publishTime);
+
+    // the drop policy writes the overdue samples of non-droppable ports back-to-back as well, only stretching re-anchors instead
+    if(catchUpPolicy != CatchUpPolicy::Stretch && overdue > catchUpTolerance)
     {
-        currentSpeed = 1;
+        bursted++;
     }
 }
 
-void ReplayHandler::setTimeStampBaselines()
+bool ReplayHandler::isDroppable(size_t streamIdx, const std::string& streamName)
+{
+    // the droppable ports can be set during replay
+    std::lock_guard<std::mutex> lock(playMutex);
+    if(streamIdx >= droppableStreams.size())
+    {
+        droppableStreams.resize(streamIdx + 1, 0);
+    }
+
+    uint8_t& droppable = droppableStreams[streamIdx];
+    if(!droppable)
+    {
+        const bool matched = std::any_of(
+            droppablePorts.begin(), droppablePorts.end(), [&](const std::regex& port) { return std::regex_match(streamName, port); });
+        droppable = matched ? 1 : 2;
+    }
+
+    return droppable == 1;
+}
+
+void ReplayHandler::resetCatchUpStatistics()
 {
-    timeBeforeSleep = base::Time::now();
-    timeToSleep = 0;
+    decimated = 0;
+    bursted = 0;
+    dropped = 0;
+    stretched = 0;
+    stretchTime = 0;
+}
+
+void ReplayHandler::waitForSamples()
+{
+    std::unique_lock<std::mutex> lock(playMutex);
+    while(canSpanGrow() && playing && running && curIndex >= getMaxSpan())
+    {
+        playCondition.wait_for(lock, std::chrono::milliseconds(10));
+    }
+}
+
+bool ReplayHandler::canSpanGrow()
+{
+    // a span limited by the user ends at its maximum even if the index grows beyond it
+    return (indexing || following) && getMaxIndex() < maxSpan;
+}
+
+void ReplayHandler::calculateRelativeSpeed()
+{
+    std::lock_guard<std::mutex> lock(playMutex);
+    currentSpeed = scheduler.getRelativeSpeed(curMetadata.timeStamp);
+}
 
+void ReplayHandler::setTimeStampBaselines()
+{
     {
         std::unique_lock<std::mutex> lock(playMutex);
         playCondition.wait(lock, [this] { return playing || !running; });
     }
+
+    // priming is done before anchoring, so that it does not delay the schedule
+    if(playing && primeOnSeek && seeked)
+    {
+        manager.primeStreams(curIndex);
+    }
+    seeked = false;
+
+    std::lock_guard<std::mutex> lock(playMutex);
+    // in unthrottled mode, the reached speed is measured against real time
+    scheduler.anchor(curMetadata.timeStamp, unthrottled ? 1. : targetSpeed);
+    manager.setLockstep(lockstep && playing, lockstepWindow);
+    playStart = ReplayScheduler::Clock::now();
+    speedController.reset(targetSpeed, playStart);
 }
 
 void ReplayHandler::stop()
@@ -116,25 +397,41 @@ void ReplayHandler::stop()
     curIndex = minSpan;
     finished = false;
 
+    manager.setLockstep(false);
+
     std::lock_guard<std::mutex> lock(playMutex);
     playing = false;
     currentSpeed = 0;
     setSampleIndex(curIndex);
+    scheduler.resetStatistics();
+    timingFidelity.reset();
+    resetCatchUpStatistics();
+    manager.resetReplayStatistics();
+    playDuration = std::chrono::nanoseconds::zero();
     playCondition.notify_one();
 }
 
 void ReplayHandler::setReplaySpeed(float speed)
 {
     constexpr float minimumSpeed = 0.01;
-    targetSpeed = std::max(speed, minimumSpeed);
+
+    {
+        std::lock_guard<std::mutex> lock(playMutex);
+        targetSpeed = std::max(speed, minimumSpeed);
+        if(!unthrottled)
+        {
+            scheduler.setSpeed(targetSpeed);
+        }
+        speedController.reset(targetSpeed);
+    }
+    playCondition.notify_one();
 }
 
 void ReplayHandler::next()
 {
-    if(curIndex < maxSpan)
+    if(curIndex < getMaxSpan())
     {
-        previousSampleTime = curMetadata.timeStamp;
-        setSampleIndex(++curIndex);
+        loadSampleIndex(++curIndex);
     }
 }
 
@@ -142,16 +439,23 @@ void ReplayHandler::previous()
 {
     if(curIndex)
     {
-        setSampleIndex(--curIndex);
+        loadSampleIndex(--curIndex);
     }
 }
 
 void ReplayHandler::setSampleIndex(uint64_t index)
 {
-    if(gotSamplesToPlay)
+    loadSampleIndex(index);
+    seeked = true;
+}
+
+void ReplayHandler::loadSampleIndex(uint64_t index)
+{
+    sampleLoaded = manager.getNumSamples();
+    if(sampleLoaded)
     {
-        curIndex = boost::algorithm::clamp(index, minSpan, maxSpan);
-        curMetadata = manager.setIndex(index);
+        curIndex = boost::algorithm::clamp(index, minSpan, getMaxSpan());
+        curMetadata = manager.setIndex(curIndex);
     }
     else
     {
@@ -160,6 +464,164 @@ void ReplayHandler::setSampleIndex(uint64_t index)
     }
 }
 
+void ReplayHandler::seekToTime(const base::Time& time)
+{
+    if(manager.getNumSamples())
+    {
+        setSampleIndex(boost::algorithm::clamp<uint64_t>(manager.getIndexForTime(time), minSpan, getMaxSpan()));
+    }
+}
+
+void ReplayHandler::setTimeSpan(const base::Time& start, const base::Time& end)
+{
+    if(!manager.getNumSamples())
+    {
+        return;
+    }
+
+    minSpan = std::min<uint64_t>(manager.getIndexForTime(start), getMaxIndex());
+
+    // the last sample at or before the end precedes the first sample after it
+    const uint64_t afterEndIndex = manager.getIndexForTime(end + base::Time::fromMicroseconds(1));
+    maxSpan = boost::algorithm::clamp<uint64_t>(afterEndIndex ? afterEndIndex - 1 : 0, minSpan, getMaxIndex());
+}
+
+void ReplayHandler::setPrimeOnSeek(bool primeOnSeek)
+{
+    this->primeOnSeek = primeOnSeek;
+}
+
+void ReplayHandler::setAutoSpeed(bool autoSpeed, std::chrono::nanoseconds lagBound)
+{
+    std::lock_guard<std::mutex> lock(playMutex);
+    this->autoSpeed = autoSpeed;
+    speedController.setLagBound(lagBound);
+    speedController.reset(targetSpeed);
+}
+
+void ReplayHandler::setCatchUpPolicy(CatchUpPolicy policy)
+{
+    catchUpPolicy = policy;
+}
+
+void ReplayHandler::setDroppablePorts(const std::vector<std::string>& droppablePorts)
+{
+    std::vector<std::regex> droppableRegexes(droppablePorts.begin(), droppablePorts.end());
+    std::lock_guard<std::mutex> lock(playMutex);
+    this->droppablePorts.swap(droppableRegexes);
+    droppableStreams.clear();
+}
+
+void ReplayHandler::setFollowing(bool follow)
+{
+    this->follow = follow;
+}
+
+void ReplayHandler::setIndexOnly(bool indexOnly)
+{
+    this->indexOnly = indexOnly;
+}
+
+void ReplayHandler::setPipelined(bool pipelined)
+{
+    this->pipelined = pipelined;
+}
+
+void ReplayHandler::setUnthrottled(bool unthrottled)
+{
+    {
+        std::lock_guard<std::mutex> lock(playMutex);
+        this->unthrottled = unthrottled;
+        scheduler.setSpeed(unthrottled ? 1. : targetSpeed);
+    }
+    playCondition.notify_one();
+}
+
+ReplayHandler::ThroughputReport ReplayHandler::getThroughputReport()
+{
+    const double seconds = getPlaySeconds();
+    auto toThroughput = [seconds](uint64_t samples, uint64_t bytes) -> Throughput {
+        if(seconds <= 0)
+        {
+            return {samples, bytes, 0., 0.};
+        }
+        return {samples, bytes, samples / seconds, bytes / seconds / 1e6};
+    };
+
+    ThroughputReport report;
+    report.seconds = seconds;
+    uint64_t totalSamples = 0;
+    uint64_t totalBytes = 0;
+    for(const auto& streamName2Statistics : manager.getReplayStatistics())
+    {
+        const auto& statistics = streamName2Statistics.second;
+        report.streams.emplace(streamName2Statistics.first, toThroughput(statistics.samples, statistics.bytes));
+        totalSamples += statistics.samples;
+        totalBytes += statistics.bytes;
+    }
+    report.total = toThroughput(totalSamples, totalBytes);
+
+    return report;
+}
+
+void ReplayHandler::setLockstep(bool lockstep, size_t window)
+{
+    this->lockstep = lockstep;
+    lockstepWindow = window;
+    if(playing)
+    {
+        manager.setLockstep(lockstep, window);
+    }
+}
+
+std::vector<ReplayHandler::Bottleneck> ReplayHandler::getBottleneckReport()
+{
+    const double seconds = getPlaySeconds();
+
+    std::vector<Bottleneck> bottlenecks;
+    for(const auto& streamName2Statistics : manager.getReplayStatistics())
+    {
+        const auto blockedTime = streamName2Statistics.second.blockedTime;
+        const bool withoutBackpressure = streamName2Statistics.second.withoutBackpressure;
+        if(blockedTime.count() || withoutBackpressure)
+        {
+            const double share = seconds > 0 ? std::chrono::duration<double>(blockedTime).count() / seconds : 0.;
+            bottlenecks.push_back({streamName2Statistics.first, blockedTime, share, withoutBackpressure});
+        }
+    }
+
+    std::sort(bottlenecks.begin(), bottlenecks.end(), [](const Bottleneck& a, const Bottleneck& b) { return a.blockedTime > b.blockedTime; });
+    return bottlenecks;
+}
+
+std::map<std::string, ReplayHandler::StageLatencies> ReplayHandler::getLatencyReport()
+{
+    std::map<std::string, StageLatencies> latencies;
+    for(const auto& streamName2Statistics : manager.getReplayStatistics())
+    {
+        const auto& statistics = streamName2Statistics.second;
+        if(statistics.readLatency.count || statistics.unmarshalLatency.count || statistics.writeLatency.count)
+        {
+            latencies.emplace(
+                streamName2Statistics.first, StageLatencies{statistics.readLatency, statistics.unmarshalLatency, statistics.writeLatency});
+        }
+    }
+
+    return latencies;
+}
+
+double ReplayHandler::getPlaySeconds()
+{
+    std::lock_guard<std::mutex> lock(playMutex);
+    auto duration = playDuration;
+    if(playing)
+    {
+        duration += ReplayScheduler::Clock::now() - playStart;
+    }
+
+    return std::chrono::duration<double>(duration).count();
+}
+
 void ReplayHandler::setMinSpan(uint64_t minIdx)
 {
     minSpan = minIdx;
@@ -167,11 +629,30 @@ void ReplayHandler::setMinSpan(uint64_t minIdx)
 
 void ReplayHandler::setMaxSpan(uint64_t maxIdx)
 {
-    maxSpan = maxIdx;
+    // a span reaching the last sample follows the index while it grows
+    maxSpan = maxIdx >= getMaxIndex() ? std::numeric_limits<uint64_t>::max() : maxIdx;
+}
+
+bool ReplayHandler::exportSpan(const std::string& directory)
+{
+    // the streams of followed logfiles are replaced while samples are appended
+    if(following)
+    {
+        LOG_WARN_S << "cannot export while following the logfiles";
+        return false;
+    }
+
+    return manager.exportSpan(getMinSpan(), getMaxSpan(), directory);
 }
 
 void ReplayHandler::play()
 {
+    // samples may have been published after the current index was set
+    if(!sampleLoaded)
+    {
+        loadSampleIndex(curIndex);
+    }
+
     {
         std::lock_guard<std::mutex> lock(playMutex);
         playing = true;
@@ -185,10 +666,26 @@ void ReplayHandler::pause()
         std::lock_guard<std::mutex> lock(playMutex);
         playing = false;
     }
+    manager.setLockstep(false);
     currentSpeed = 0;
 }
 
 // GCOVR_EXCL_START
+void ReplayHandler::setDecimations(const std::vector<std::pair<std::string, LogTaskManager::Decimation>>& decimations)
+{
+    manager.setDecimations(decimations);
+}
+
+uint64_t ReplayHandler::setDecimationForPort(const std::string& taskName, const std::string& portName, const LogTaskManager::Decimation& decimation)
+{
+    return manager.setDecimationForPort(taskName, portName, decimation);
+}
+
+uint64_t ReplayHandler::getDecimationForPort(const std::string& taskName, const std::string& portName)
+{
+    return manager.getDecimationForPort(taskName, portName);
+}
+
 void ReplayHandler::activateReplayForPort(const std::string& taskName, const std::string& portName, bool on)
 {
     manager.activateReplayForPort(taskName, portName, on);
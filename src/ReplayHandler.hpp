@@ -1,7 +1,15 @@
 #pragma once
 
+#include "LogFileWatcher.hpp"
 #include "LogTaskManager.hpp"
+#include "ReplayPipeline.hpp"
+#include "ReplayScheduler.hpp"
+#include "SpeedController.hpp"
+#include "TimingFidelity.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <regex>
 #include <base/Time.hpp>
 #include <future>
 #include <memory>
@@ -15,6 +23,175 @@ class ReplayHandler
 {
 
 public:
+    /**
+     * @brief Throughput of replayed samples.
+     *
+     */
+    struct Throughput
+    {
+        /**
+         * @brief Number of written samples.
+         *
+         */
+        uint64_t samples;
+
+        /**
+         * @brief Number of written bytes, measured as marshaled size.
+         *
+         */
+        uint64_t bytes;
+
+        /**
+         * @brief Written samples per second.
+         *
+         */
+        double samplesPerSecond;
+
+        /**
+         * @brief Written megabytes per second.
+         *
+         */
+        double megabytesPerSecond;
+    };
+
+    /**
+     * @brief Throughput of all streams since the last start of replay.
+     *
+     */
+    struct ThroughputReport
+    {
+        /**
+         * @brief Map of stream names to their throughput.
+         *
+         */
+        std::map<std::string, Throughput> streams;
+
+        /**
+         * @brief Throughput of all streams.
+         *
+         */
+        Throughput total;
+
+        /**
+         * @brief Wall time spent in playing mode in seconds.
+         *
+         */
+        double seconds;
+    };
+
+    /**
+     * @brief Port that blocked the replay in lockstep mode.
+     *
+     */
+    struct Bottleneck
+    {
+        /**
+         * @brief Name of the stream.
+         *
+         */
+        std::string streamName;
+
+        /**
+         * @brief Time the replay was blocked by consumers of the port.
+         *
+         */
+        std::chrono::nanoseconds blockedTime;
+
+        /**
+         * @brief Share of the wall time spent in playing mode, in [0, 1].
+         *
+         */
+        double share;
+
+        /**
+         * @brief Indicates whether a connection of the port could not hold back the replay, so that its consumer may have missed samples.
+         *
+         */
+        bool withoutBackpressure;
+    };
+
+    /**
+     * @brief Policy for samples whose deadline has already passed when they are due, i.e. when replay lags behind the schedule.
+     *
+     */
+    enum class CatchUpPolicy
+    {
+        /**
+         * @brief Overdue samples are written back-to-back until replay is on schedule again.
+         *
+         */
+        Burst,
+
+        /**
+         * @brief Overdue samples of droppable ports are not written, the others are written back-to-back. In sequential replay,
+         * dropped samples are not read either, while pipelined replay has read and unmarshaled them ahead of time.
+         *
+         */
+        Drop,
+
+        /**
+         * @brief The schedule of the following samples is delayed by the lateness of a late sample, so that the lag is not made up.
+         *
+         */
+        Stretch
+    };
+
+    /**
+     * @brief Number of samples handled by the catch-up policy.
+     *
+     */
+    struct CatchUpStatistics
+    {
+        /**
+         * @brief Number of overdue samples written back-to-back by the burst policy, or by the drop policy for non-droppable ports.
+         *
+         */
+        uint64_t bursted;
+
+        /**
+         * @brief Number of overdue samples skipped.
+         *
+         */
+        uint64_t dropped;
+
+        /**
+         * @brief Number of late samples that delayed the schedule.
+         *
+         */
+        uint64_t stretched;
+
+        /**
+         * @brief Total delay of the schedule.
+         *
+         */
+        std::chrono::nanoseconds stretchTime;
+    };
+
+    /**
+     * @brief Durations of the replay stages of a port.
+     *
+     */
+    struct StageLatencies
+    {
+        /**
+         * @brief Durations of reading samples from the logfile.
+         *
+         */
+        LatencyHistogram::Summary read;
+
+        /**
+         * @brief Durations of unmarshaling samples.
+         *
+         */
+        LatencyHistogram::Summary unmarshal;
+
+        /**
+         * @brief Durations of writing samples to the port.
+         *
+         */
+        LatencyHistogram::Summary write;
+    };
+
     /**
      * @brief Constructor.
      *
@@ -65,12 +242,110 @@ public:
     void setSampleIndex(uint64_t index);
 
     /**
-     * @brief Sets the replay speed relatively.
+     * @brief Moves the current index to the first sample at or after the given log time.
+     * The index is clamped to the min/max span. Can only be used if the handler is paused/stopped.
+     *
+     * @param time: Log time to seek to.
+     */
+    void seekToTime(const base::Time& time);
+
+    /**
+     * @brief Sets the min and max span to the samples within the given log time interval.
+     *
+     * @param start: Log time of the first sample to replay.
+     * @param end: Log time of the last sample to replay.
+     */
+    void setTimeSpan(const base::Time& start, const base::Time& end);
+
+    /**
+     * @brief Sets the replay speed relatively. If replay is active, the schedule is
+     * re-anchored at the current log time.
      *
      * @param speed: Speed to set. 1.00 means 100%.
      */
     void setReplaySpeed(float speed);
 
+    /**
+     * @brief Enables or disables the pipelined replay. If enabled, samples are read and unmarshaled
+     * ahead of their replay by separate threads, so that the replay thread only writes the samples.
+     * Can only be used when handler is paused/stopped.
+     *
+     * @param pipelined: True if replay should be pipelined, false otherwise.
+     */
+    void setPipelined(bool pipelined);
+
+    /**
+     * @brief Enables or disables the unthrottled replay. If enabled, samples are replayed
+     * as fast as possible without sleeping between them, i.e. the replay speed is ignored.
+     *
+     * @param unthrottled: True if replay should be unthrottled, false otherwise.
+     */
+    void setUnthrottled(bool unthrottled);
+
+    /**
+     * @brief Enables or disables the lockstep replay. If enabled, a sample is written once the connected
+     * consumers hold less than the window of unread samples, so that no samples are dropped, see LogTask::setLockstep.
+     * Pausing or stopping aborts a pending write.
+     *
+     * @param lockstep: True if replay should wait for the consumers, false otherwise.
+     * @param window: Maximum number of unread samples per connection, 1 to wait until the previous sample was read.
+     */
+    void setLockstep(bool lockstep, size_t window = 1);
+
+    /**
+     * @brief Enables or disables the automatic speed. If enabled, the replay speed is continuously adjusted to the highest
+     * speed that keeps the lateness of the published samples below the given bound, see SpeedController. Consumers that
+     * block the replay in lockstep mode slow it down as well. Has no effect in unthrottled mode.
+     *
+     * @param autoSpeed: True if the speed should be adjusted automatically, false to keep the set speed.
+     * @param lagBound: Largest tolerated lateness of the published samples.
+     */
+    void setAutoSpeed(bool autoSpeed, std::chrono::nanoseconds lagBound = std::chrono::milliseconds(10));
+
+    /**
+     * @brief Sets the policy for samples that are due more than a millisecond after their deadline.
+     * Has no effect in unthrottled mode.
+     *
+     * @param policy: Catch-up policy.
+     */
+    void setCatchUpPolicy(CatchUpPolicy policy);
+
+    /**
+     * @brief Sets the ports whose overdue samples are skipped by the drop policy, e.g. high-rate camera streams.
+     * Can be called during replay.
+     *
+     * @param droppablePorts: List of regular expressions matching the stream names of droppable ports.
+     */
+    void setDroppablePorts(const std::vector<std::string>& droppablePorts);
+
+    /**
+     * @brief Enables or disables priming on seek. If enabled, the latest sample of every stream
+     * before the current index is replayed when playing starts after a seek, so that consumers
+     * of low-rate streams get their inputs without waiting for the next sample.
+     *
+     * @param primeOnSeek: True if streams should be primed after a seek, false otherwise.
+     */
+    void setPrimeOnSeek(bool primeOnSeek);
+
+    /**
+     * @brief Enables or disables following logfiles that are still being written. If enabled, samples written after indexing
+     * are appended to the index as the logfiles change, and replay waits for them instead of finishing. Replay lags behind
+     * the writer by about the follow interval, which grows with the size of the logfiles, see LogTaskManager::appendNewSamples.
+     * Following stops once no more samples can be appended, e.g. when the logfiles were written past the end of the time window,
+     * and replay finishes at the end of a span limited by setMaxSpan. Takes effect on the next init.
+     *
+     * @param follow: True if the logfiles should be followed, false otherwise.
+     */
+    void setFollowing(bool follow);
+
+    /**
+     * @brief Sets whether the logfiles are only loaded for exporting or analyzing them, without loading typekits.
+     * Takes effect on the next init.
+     *
+     * @param indexOnly: True to skip the typekits, false otherwise.
+     */
+    void setIndexOnly(bool indexOnly);
+
     /**
      * @brief Sets the minimum span. If replay has finished or is stopped, the current
      * index is reset to the minimum span value.
@@ -81,11 +356,32 @@ public:
 
     /**
      * @brief Sets the maximum span. Repaly finishes after the maximum span is reached.
+     * A span reaching the maximum index follows the index while it grows during background indexing.
      *
      * @param maxIdx: Maximum index.
      */
     void setMaxSpan(uint64_t maxIdx);
 
+    /**
+     * @brief Exports the samples between the minimum and the maximum span of the active ports to new logfiles,
+     * copying the marshaled samples without loading typekits. Not possible while following the logfiles.
+     *
+     * @param directory: Directory to write the logfiles to, it is created if necessary.
+     * @return bool True if the span was exported, false otherwise.
+     */
+    bool exportSpan(const std::string& directory);
+
+    /**
+     * @brief Computes the timing statistics of all loaded streams from the timestamps of their index, see LogTaskManager::getStreamStatistics.
+     * Should be called after indexing finished.
+     *
+     * @return std::vector<StreamStatistics> Statistics of each stream.
+     */
+    std::vector<StreamStatistics> getStreamStatistics()
+    {
+        return manager.getStreamStatistics();
+    };
+
     /**
      * @brief Activates/Deactivates replay for given port of task.
      *
@@ -95,6 +391,33 @@ public:
      */
     void activateReplayForPort(const std::string& taskName, const std::string& portName, bool on);
 
+    /**
+     * @brief Sets the decimation of a port of a task, see LogTaskManager::setDecimationForPort.
+     * Skipped samples are neither read nor unmarshaled, and replay does not wait for their deadlines.
+     *
+     * @param taskName: Name of task.
+     * @param portName: Name of port.
+     * @param decimation: Decimation of the port.
+     * @return uint64_t Resulting number of samples per replayed sample, 0 if the port is unknown.
+     */
+    uint64_t setDecimationForPort(const std::string& taskName, const std::string& portName, const LogTaskManager::Decimation& decimation);
+
+    /**
+     * @brief Returns the decimation of a port of a task.
+     *
+     * @param taskName: Name of task.
+     * @param portName: Name of port.
+     * @return uint64_t Number of samples per replayed sample, 0 if the port is unknown.
+     */
+    uint64_t getDecimationForPort(const std::string& taskName, const std::string& portName);
+
+    /**
+     * @brief Sets decimation rules for the streams of the next init, see LogTaskManager::setDecimations.
+     *
+     * @param decimations: List of regular expressions matching stream names and their decimation.
+     */
+    void setDecimations(const std::vector<std::pair<std::string, LogTaskManager::Decimation>>& decimations);
+
     /**
      * @brief Inits the replay handler for given logfiles.
      * All replay parameters are updated and the current index is set to 0.
@@ -103,13 +426,37 @@ public:
      * @param prefix: Prefix for all tasks.
      * @param whiteList: List of regular expressions to filter whitelisted streams.
      * @param renamings: Map of task renamings.
+     * @param progress: Optional callback for the loading progress between 0 and 1, called from the calling thread.
+     * @param window: Optional time window, only the samples within the window are loaded.
      */
     void init(
         const std::vector<std::string>& fileNames, const std::string& prefix, const std::vector<std::string>& whiteList = {},
-        const std::map<std::string, std::string>& renamings = {});
+        const std::map<std::string, std::string>& renamings = {}, const LogTaskManager::ProgressCallback& progress = {},
+        const LogTaskManager::TimeWindow& window = {});
+
+    /**
+     * @brief Inits the replay handler for given logfiles and returns immediately, while the logfiles are indexed in a separate thread.
+     * Tasks show up in the task collection as their streams are added, and the already indexed samples can be replayed.
+     * The maximum index grows until indexing has finished, or while the logfiles are followed.
+     *
+     * @param fileNames: List of file names.
+     * @param prefix: Prefix for all tasks.
+     * @param whiteList: List of regular expressions to filter whitelisted streams.
+     * @param renamings: Map of task renamings.
+     * @param window: Optional time window, only the samples within the window are loaded.
+     */
+    void initInBackground(
+        const std::vector<std::string>& fileNames, const std::string& prefix, const std::vector<std::string>& whiteList = {},
+        const std::map<std::string, std::string>& renamings = {}, const LogTaskManager::TimeWindow& window = {});
+
+    /**
+     * @brief Waits until background indexing has finished. Samples written to followed logfiles are appended afterwards.
+     *
+     */
+    void waitForIndex();
 
     /**
-     * @brief Deinits the replay handler. Closes all log tasks and allows
+     * @brief Deinits the replay handler. Cancels background indexing, closes all log tasks and allows
      * new initing.
      */
     void deinit();
@@ -130,6 +477,26 @@ public:
         return curMetadata.timeStamp.toString();
     };
 
+    /**
+     * @brief Returns the timestamp of the first sample.
+     *
+     * @return base::Time Log start time, or a null time if no samples are loaded.
+     */
+    base::Time getStartTime()
+    {
+        return manager.getSampleTime(0);
+    };
+
+    /**
+     * @brief Returns the timestamp of the last sample.
+     *
+     * @return base::Time Log end time, or a null time if no samples are loaded.
+     */
+    base::Time getEndTime()
+    {
+        return manager.getSampleTime(getMaxIndex());
+    };
+
     /**
      * @brief Returns the current sample port name.
      *
@@ -151,13 +518,44 @@ public:
     };
 
     /**
-     * @brief Returns the maximum possible index.
+     * @brief Returns the maximum possible index. Grows during background indexing.
      *
      * @return size_t Maximum index.
      */
     size_t getMaxIndex()
     {
-        return maxIdx;
+        const size_t numSamples = manager.getNumSamples();
+        return numSamples ? numSamples - 1 : 0;
+    };
+
+    /**
+     * @brief Returns whether the logfiles are still indexed in the background.
+     *
+     * @return bool True if indexing is running, false otherwise.
+     */
+    bool isIndexing()
+    {
+        return indexing;
+    };
+
+    /**
+     * @brief Returns whether samples written to the logfiles are appended to the index.
+     *
+     * @return bool True if the logfiles are followed, false otherwise.
+     */
+    bool isFollowing()
+    {
+        return following;
+    };
+
+    /**
+     * @brief Returns the progress of indexing.
+     *
+     * @return double Fraction of the indexing work done, between 0 and 1.
+     */
+    double getIndexingProgress()
+    {
+        return indexingProgress;
     };
 
     /**
@@ -177,7 +575,7 @@ public:
      */
     uint64_t getMaxSpan()
     {
-        return maxSpan;
+        return std::min<uint64_t>(maxSpan, getMaxIndex());
     };
 
     /**
@@ -192,6 +590,7 @@ public:
 
     /**
      * @brief Returns the reached speed taking in account the target speed.
+     * In unthrottled mode, the reached speed relative to the log time is returned.
      *
      * @return double Current speed.
      */
@@ -200,6 +599,140 @@ public:
         return currentSpeed;
     };
 
+    /**
+     * @brief Returns the scheduling errors of the published samples, i.e. how late
+     * the samples were written compared to their wall clock deadlines.
+     *
+     * @return ReplayScheduler::Statistics Scheduling errors since the last start of replay.
+     */
+    ReplayScheduler::Statistics getSchedulingStatistics()
+    {
+        return scheduler.getStatistics();
+    };
+
+    /**
+     * @brief Returns the lateness of the published samples in total, per port and over time.
+     *
+     * @return TimingFidelity::Report Lateness since the last start of replay.
+     */
+    TimingFidelity::Report getTimingReport()
+    {
+        return timingFidelity.getReport();
+    };
+
+    /**
+     * @brief Returns the lateness of the published samples of all ports, without taking the locks of the per-port statistics.
+     *
+     * @return LatencyHistogram::Summary Lateness since the last start of replay.
+     */
+    LatencyHistogram::Summary getLag()
+    {
+        return timingFidelity.getTotal();
+    };
+
+    /**
+     * @brief Returns whether the unthrottled replay is enabled.
+     *
+     * @return bool True if replay is unthrottled, false otherwise.
+     */
+    bool isUnthrottled()
+    {
+        return unthrottled;
+    };
+
+    /**
+     * @brief Returns the throughput of all streams since the last start of replay.
+     *
+     * @return ThroughputReport Throughput per stream and in total.
+     */
+    ThroughputReport getThroughputReport();
+
+    /**
+     * @brief Returns whether the lockstep replay is enabled.
+     *
+     * @return bool True if replay waits for the consumers, false otherwise.
+     */
+    bool isLockstep()
+    {
+        return lockstep;
+    };
+
+    /**
+     * @brief Returns the ports that blocked the replay in lockstep mode since the last start of replay,
+     * and the ports with connections that could not block it.
+     *
+     * @return std::vector<Bottleneck> Blocking ports, sorted descending by blocked time.
+     */
+    std::vector<Bottleneck> getBottleneckReport();
+
+    /**
+     * @brief Returns whether the automatic speed is enabled.
+     *
+     * @return bool True if the speed is adjusted automatically, false otherwise.
+     */
+    bool isAutoSpeed()
+    {
+        return autoSpeed;
+    };
+
+    /**
+     * @brief Returns the catch-up policy.
+     *
+     * @return CatchUpPolicy Policy for overdue samples.
+     */
+    CatchUpPolicy getCatchUpPolicy()
+    {
+        return catchUpPolicy;
+    };
+
+    /**
+     * @brief Returns the number of samples handled by the catch-up policy since the last start of replay.
+     *
+     * @return CatchUpStatistics Bursted, dropped and stretched samples.
+     */
+    CatchUpStatistics getCatchUpStatistics()
+    {
+        return {bursted, dropped, stretched, std::chrono::nanoseconds(stretchTime)};
+    };
+
+    /**
+     * @brief Returns the number of samples skipped by the decimation of their ports since the last start of replay.
+     *
+     * @return uint64_t Number of decimated samples.
+     */
+    uint64_t getDecimatedSamples()
+    {
+        return decimated;
+    };
+
+    /**
+     * @brief Returns the durations of reading, unmarshaling and writing the samples of each replayed port since the last start of replay.
+     * The report is empty if the replay is built without latency histograms, see LatencyHistogram::enabled.
+     *
+     * @return std::map<std::string, StageLatencies> Map of stream names to their stage latencies, for ports with replayed samples.
+     */
+    std::map<std::string, StageLatencies> getLatencyReport();
+
+    /**
+     * @brief Returns whether priming on seek is enabled.
+     *
+     * @return bool True if streams are primed after a seek, false otherwise.
+     */
+    bool isPrimingOnSeek()
+    {
+        return primeOnSeek;
+    };
+
+    /**
+     * @brief Returns whether the pipelined replay is enabled.
+     *
+     * @return bool True if replay is pipelined, false otherwise.
+     */
+    bool isPipelined()
+    {
+        return pipelined;
+    };
+
     /**
      * @brief Returns whether the current displayed port can be replayed,
      * i.e. if a typelib entry can unmarshal the data.
@@ -239,10 +772,70 @@ private:
     void replaySamples();
 
     /**
-     * @brief Calculates the time to sleep by using the timestamp of the next sample.
+     * @brief Returns the wall time spent in playing mode since the last start of replay.
+     *
+     * @return double Wall time in seconds.
+     */
+    double getPlaySeconds();
+
+    /**
+     * @brief Resets the replay parameters to the first sample and starts the replay thread.
+     *
+     */
+    void startReplay();
+
+    /**
+     * @brief Appends the samples written to the logfiles until following is disabled. Runs in the index thread after init.
+     * The time between appends is at least the follow interval and backs off to a multiple of the last append's duration.
+     *
+     * @param fileNames: Names of the followed logfiles.
+     */
+    void followLogFiles(const std::vector<std::string>& fileNames);
+
+    /**
+     * @brief Waits until background indexing or following published samples after the current index, the span cannot grow anymore,
+     * or replay was paused.
+     *
+     */
+    void waitForSamples();
+
+    /**
+     * @brief Returns whether samples can still be appended to the span, because indexing or following grows the index
+     * and the span is not limited to the indexed samples.
+     *
+     * @return bool True if the span can grow, false otherwise.
+     */
+    bool canSpanGrow();
+
+    /**
+     * @brief Waits until the deadline of the current sample is reached.
+     *
+     * @param overdue: Time by which the deadline had already passed, 0 in unthrottled mode.
+     * @return bool True if the sample is due, false if replay was paused or stopped meanwhile.
+     */
+    bool waitForDeadline(std::chrono::nanoseconds& overdue);
+
+    /**
+     * @brief Writes the current sample and records its lateness. Applies the catch-up policy to late samples.
+     *
+     * @param overdue: Time by which the deadline of the sample had already passed when it was due.
+     */
+    void publishSample(std::chrono::nanoseconds overdue);
+
+    /**
+     * @brief Returns whether the samples of a stream may be skipped by the drop policy.
+     *
+     * @param streamIdx: Index of the stream.
+     * @param streamName: Name of the stream, matched against the droppable ports once per stream.
+     * @return bool True if the stream is droppable, false otherwise.
+     */
+    bool isDroppable(size_t streamIdx, const std::string& streamName);
+
+    /**
+     * @brief Resets the catch-up and decimation counters.
      *
      */
-    void calculateTimeToSleep();
+    void resetCatchUpStatistics();
 
     /**
      * @brief Calculates the reached speed taking into account the target speed.
@@ -251,10 +844,18 @@ private:
     void calculateRelativeSpeed();
 
     /**
-     * @brief Sets the timestamps at the beginning of a playing-step.
+     * @brief Waits until replay is started, primes the streams if a seek happened and
+     * anchors the schedule at the current sample.
      */
     void setTimeStampBaselines();
 
+    /**
+     * @brief Loads the metadata of the given index without marking it as seek.
+     *
+     * @param index: Index to set.
+     */
+    void loadSampleIndex(uint64_t index);
+
     /**
      * @brief Target speed.
      *
@@ -286,17 +887,11 @@ private:
     uint64_t minSpan;
 
     /**
-     * @brief Maximum span index.
+     * @brief Maximum span index. The maximum value lets the span follow the index while it grows.
      *
      */
     uint64_t maxSpan;
 
-    /**
-     * @brief Maximum possible index.
-     *
-     */
-    uint64_t maxIdx;
-
     /**
      * @brief Indicator if replaying is finished.
      *
@@ -316,11 +911,47 @@ private:
     bool playing;
 
     /**
-     * @brief Indicator if the multi file index contains samples to play.
-     * This cannot be the case, e.g. when no suitable typekits are available
-     * or the streams are emtpy.
+     * @brief Indicator if the current metadata was loaded from a sample.
+     * This cannot be the case, e.g. when no suitable typekits are available,
+     * the streams are emtpy or no samples were indexed yet.
+     */
+    bool sampleLoaded = false;
+
+    /**
+     * @brief Indicator if the logfiles are indexed in the background.
+     *
      */
-    bool gotSamplesToPlay;
+    std::atomic<bool> indexing{false};
+
+    /**
+     * @brief Indicator if the logfiles are followed on the next init.
+     *
+     */
+    bool follow = false;
+
+    /**
+     * @brief Indicates whether the next init skips the typekits.
+     *
+     */
+    bool indexOnly = false;
+
+    /**
+     * @brief Indicator if samples written to the logfiles are appended in the index thread.
+     *
+     */
+    std::atomic<bool> following{false};
+
+    /**
+     * @brief Progress of indexing between 0 and 1.
+     *
+     */
+    std::atomic<double> indexingProgress{0.};
+
+    /**
+     * @brief Thread running the background indexing.
+     *
+     */
+    std::thread indexThread;
 
     /**
      * @brief Mutex to lock replay variables related to replay.
@@ -341,31 +972,141 @@ private:
     std::thread replayThread;
 
     /**
-     * @brief Timestamp of previous sample.
+     * @brief Scheduler mapping sample timestamps to wall clock deadlines.
+     * Is guarded by the play mutex, as the speed can be changed during replay.
+     *
+     */
+    ReplayScheduler scheduler;
+
+    /**
+     * @brief Lateness of the published samples. Is recorded by the replay thread only while replay is throttled.
+     *
+     */
+    TimingFidelity timingFidelity;
+
+    /**
+     * @brief Indicates whether the current sample could be replayed.
+     */
+    bool replayWasValid;
+
+    /**
+     * @brief Indicator if the pipelined replay is enabled.
      *
      */
-    base::Time previousSampleTime;
+    bool pipelined = false;
 
     /**
-     * @brief Tracks the system time before going to sleep; used to calculate reached speed.
+     * @brief Indicator if the unthrottled replay is enabled.
      *
      */
-    base::Time timeBeforeSleep;
+    bool unthrottled = false;
 
     /**
-     * @brief Time to sleep before replaying next sample.
+     * @brief Indicator if the lockstep replay is enabled.
      *
      */
-    int64_t timeToSleep;
+    bool lockstep = false;
 
     /**
-     * @brief Indicates whether the current sample could be replayed.
+     * @brief Maximum number of unread samples per connection in lockstep replay.
+     *
      */
-    bool replayWasValid;
+    size_t lockstepWindow = 1;
+
+    /**
+     * @brief Indicator if streams should be primed after a seek. Is set from the GUI thread during replay.
+     *
+     */
+    std::atomic<bool> primeOnSeek{false};
+
+    /**
+     * @brief Indicator if the speed is adjusted automatically.
+     *
+     */
+    std::atomic<bool> autoSpeed{false};
+
+    /**
+     * @brief Controller of the automatic speed. Is guarded by the play mutex like the scheduler.
+     *
+     */
+    SpeedController speedController;
+
+    /**
+     * @brief Policy for overdue samples.
+     *
+     */
+    std::atomic<CatchUpPolicy> catchUpPolicy{CatchUpPolicy::Burst};
+
+    /**
+     * @brief Regular expressions matching the stream names of droppable ports. Is guarded by the play mutex.
+     *
+     */
+    std::vector<std::regex> droppablePorts;
+
+    /**
+     * @brief Cached matches of the droppable ports per stream index: 0 if not matched yet, 1 if droppable, 2 otherwise.
+     * Is guarded by the play mutex.
+     *
+     */
+    std::vector<uint8_t> droppableStreams;
+
+    /**
+     * @brief Number of samples skipped by decimation since the last start of replay.
+     *
+     */
+    std::atomic<uint64_t> decimated{0};
+
+    /**
+     * @brief Number of overdue samples written back-to-back since the last start of replay.
+     *
+     */
+    std::atomic<uint64_t> bursted{0};
+
+    /**
+     * @brief Number of overdue samples skipped since the last start of replay.
+     *
+     */
+    std::atomic<uint64_t> dropped{0};
+
+    /**
+     * @brief Number of late samples that delayed the schedule since the last start of replay.
+     *
+     */
+    std::atomic<uint64_t> stretched{0};
+
+    /**
+     * @brief Total delay of the schedule in nanoseconds since the last start of replay.
+     *
+     */
+    std::atomic<int64_t> stretchTime{0};
+
+    /**
+     * @brief Indicator if the current index was set by a seek since replay was paused.
+     *
+     */
+    bool seeked = false;
+
+    /**
+     * @brief Wall time at which playing mode was entered the last time.
+     *
+     */
+    ReplayScheduler::Clock::time_point playStart;
+
+    /**
+     * @brief Accumulated wall time spent in playing mode, excluding the current run.
+     *
+     */
+    std::chrono::nanoseconds playDuration;
 
     /**
      * @brief Log task manager.
      *
      */
     LogTaskManager manager;
+
+    /**
+     * @brief Pipeline preparing samples ahead of their replay. Is only used if pipelined replay is enabled.
+     *
+     */
+    ReplayPipeline pipeline{manager};
 };
@@ -0,0 +1,188 @@
+#include "ReplayPipeline.hpp"
+
+#include <algorithm>
+
+ReplayPipeline::ReplayPipeline(LogTaskManager& manager, size_t capacity, size_t numDecoders)
+    : manager(manager)
+    , numDecoders(std::max<size_t>(numDecoders, 1))
+    , nextReadIndex(0)
+    , lastIndex(0)
+    , nextReplayIndex(0)
+    , running(false)
+{
+    for(size_t i = 0; i < std::max<size_t>(capacity, 1); i++)
+    {
+        slots.emplace_back(new Slot());
+    }
+}
+
+ReplayPipeline::~ReplayPipeline()
+{
+    stop();
+}
+
+void ReplayPipeline::start(uint64_t firstIndex, uint64_t lastIndex)
+{
+    stop();
+
+    for(auto& slot : slots)
+    {
+        slot->state = SlotState::Free;
+    }
+
+    readQueue.clear();
+    nextReadIndex = firstIndex;
+    nextReplayIndex = firstIndex;
+    this->lastIndex = lastIndex;
+    running = true;
+
+    readerThread = std::thread(std::bind(&ReplayPipeline::readSamples, this));
+    for(size_t i = 0; i < numDecoders; i++)
+    {
+        decoderThreads.emplace_back(std::bind(&ReplayPipeline::decodeSamples, this));
+    }
+}
+
+void ReplayPipeline::extend(uint64_t lastIndex)
+{
+    {
+        std::lock_guard<std::mutex> lock(pipelineMutex);
+        this->lastIndex = std::max(this->lastIndex, lastIndex);
+    }
+    slotFreed.notify_all();
+}
+
+void ReplayPipeline::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(pipelineMutex);
+        running = false;
+    }
+    slotFreed.notify_all();
+    sampleRead.notify_all();
+    sampleDecoded.notify_all();
+
+    if(readerThread.joinable())
+    {
+        readerThread.join();
+    }
+
+    for(auto& decoderThread : decoderThreads)
+    {
+        decoderThread.join();
+    }
+    decoderThreads.clear();
+}
+
+bool ReplayPipeline::replaySample(uint64_t index)
+{
+    return takeSample(index, true);
+}
+
+void ReplayPipeline::skipSample(uint64_t index)
+{
+    takeSample(index, false);
+}
+
+bool ReplayPipeline::takeSample(uint64_t index, bool write)
+{
+    if(!running || index != nextReplayIndex || index > lastIndex)
+    {
+        start(index, std::max(index, lastIndex));
+    }
+
+    Slot& slot = getSlot(index);
+    {
+        std::unique_lock<std::mutex> lock(pipelineMutex);
+        sampleDecoded.wait(lock, [&] { return !running || (slot.state == SlotState::Decoded && slot.index == index); });
+        if(!running)
+        {
+            return false;
+        }
+    }
+
+    bool result = write && manager.replayPreparedSample(slot.sample);
+
+    {
+        std::lock_guard<std::mutex> lock(pipelineMutex);
+        slot.state = SlotState::Free;
+        nextReplayIndex++;
+    }
+    slotFreed.notify_one();
+
+    return result;
+}
+
+void ReplayPipeline::readSamples()
+{
+    while(true)
+    {
+        uint64_t index;
+        {
+            std::unique_lock<std::mutex> lock(pipelineMutex);
+            slotFreed.wait(lock, [this] { return !running || (nextReadIndex <= lastIndex && getSlot(nextReadIndex).state == SlotState::Free); });
+            if(!running)
+            {
+                return;
+            }
+
+            index = nextReadIndex++;
+        }
+
+        // a free slot is only accessed by the reader, so reading can be done without lock
+        Slot& slot = getSlot(index);
+        bool wasRead = manager.prepareSample(index, slot.sample);
+
+        {
+            std::lock_guard<std::mutex> lock(pipelineMutex);
+            slot.index = index;
+            if(wasRead)
+            {
+                slot.state = SlotState::Read;
+                readQueue.push_back(index);
+            }
+            else
+            {
+                slot.state = SlotState::Decoded;
+            }
+        }
+
+        if(wasRead)
+        {
+            sampleRead.notify_one();
+        }
+        else
+        {
+            sampleDecoded.notify_one();
+        }
+    }
+}
+
+void ReplayPipeline::decodeSamples()
+{
+    while(true)
+    {
+        uint64_t index;
+        {
+            std::unique_lock<std::mutex> lock(pipelineMutex);
+            sampleRead.wait(lock, [this] { return !running || !readQueue.empty(); });
+            if(!running)
+            {
+                return;
+            }
+
+            index = readQueue.front();
+            readQueue.pop_front();
+            getSlot(index).state = SlotState::Decoding;
+        }
+
+        Slot& slot = getSlot(index);
+        slot.sample.task->unmarshalSample(slot.sample);
+
+        {
+            std::lock_guard<std::mutex> lock(pipelineMutex);
+            slot.state = SlotState::Decoded;
+        }
+        sampleDecoded.notify_one();
+    }
+}
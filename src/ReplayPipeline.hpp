@@ -0,0 +1,239 @@
+#pragma once
+
+#include "LogTaskManager.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Class that prepares samples ahead of their replay in separate stages.
+ * A reader thread reads the marshaled data of the upcoming samples into a bounded
+ * ring buffer, decoder threads unmarshal them and the replay thread only writes
+ * the decoded samples in index order. Writing in index order preserves the order per port.
+ *
+ */
+class ReplayPipeline
+{
+    /**
+     * @brief States of a ring buffer slot.
+     *
+     */
+    enum class SlotState
+    {
+        Free,
+        Read,
+        Decoding,
+        Decoded
+    };
+
+    /**
+     * @brief Ring buffer slot holding a single prepared sample.
+     *
+     */
+    struct Slot
+    {
+        /**
+         * @brief Index of the held sample.
+         *
+         */
+        uint64_t index;
+
+        /**
+         * @brief State of the slot.
+         *
+         */
+        SlotState state;
+
+        /**
+         * @brief Prepared sample.
+         *
+         */
+        LogTask::PreparedSample sample;
+    };
+
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param manager: LogTaskManager to read, unmarshal and replay samples with.
+     * @param capacity: Number of samples that can be prepared ahead.
+     * @param numDecoders: Number of decoder threads.
+     */
+    ReplayPipeline(LogTaskManager& manager, size_t capacity = 64, size_t numDecoders = 2);
+
+    /**
+     * @brief Destructor. Stops all pipeline threads.
+     *
+     */
+    ~ReplayPipeline();
+
+    /**
+     * @brief Starts preparing samples. A running pipeline is stopped and its prepared samples are discarded.
+     *
+     * @param firstIndex: Index of the first sample to prepare.
+     * @param lastIndex: Index of the last sample to prepare.
+     */
+    void start(uint64_t firstIndex, uint64_t lastIndex);
+
+    /**
+     * @brief Extends the range of samples to prepare without discarding the prepared samples,
+     * e.g. when indexing published more samples.
+     *
+     * @param lastIndex: Index of the last sample to prepare. Is ignored if it is before the current last index.
+     */
+    void extend(uint64_t lastIndex);
+
+    /**
+     * @brief Stops all pipeline threads and discards the prepared samples.
+     *
+     */
+    void stop();
+
+    /**
+     * @brief Replays the sample at the given index. Blocks until the sample is prepared.
+     * Samples must be replayed in index order, beginning with the first index.
+     *
+     * @param index: Index of the sample to replay.
+     * @return bool True if the sample was replayed successfully, false otherwise.
+     */
+    bool replaySample(uint64_t index);
+
+    /**
+     * @brief Discards the sample at the given index without writing it, keeping the prepared samples that follow.
+     * Blocks until the sample is prepared, like replaySample.
+     *
+     * @param index: Index of the sample to discard.
+     */
+    void skipSample(uint64_t index);
+
+    /**
+     * @brief Returns whether the pipeline threads are running.
+     *
+     * @return bool True if the pipeline is running, false otherwise.
+     */
+    bool isRunning()
+    {
+        return running;
+    };
+
+private:
+    /**
+     * @brief Takes the prepared sample at the given index from its slot and frees the slot.
+     *
+     * @param index: Index of the sample.
+     * @param write: True to write the sample to its port, false to discard it.
+     * @return bool True if the sample was written successfully, false otherwise.
+     */
+    bool takeSample(uint64_t index, bool write);
+
+    /**
+     * @brief Reader stage. Reads the marshaled data of the upcoming samples into free slots.
+     *
+     */
+    void readSamples();
+
+    /**
+     * @brief Decoder stage. Unmarshals read samples.
+     *
+     */
+    void decodeSamples();
+
+    /**
+     * @brief Returns the slot for a given index.
+     *
+     * @param index: Sample index.
+     * @return Slot& Slot holding the index.
+     */
+    Slot& getSlot(uint64_t index)
+    {
+        return *slots[index % slots.size()];
+    };
+
+    /**
+     * @brief LogTaskManager to read, unmarshal and replay samples with.
+     *
+     */
+    LogTaskManager& manager;
+
+    /**
+     * @brief Ring buffer of prepared samples.
+     *
+     */
+    std::vector<std::unique_ptr<Slot>> slots;
+
+    /**
+     * @brief Number of decoder threads.
+     *
+     */
+    size_t numDecoders;
+
+    /**
+     * @brief Index of the next sample to read.
+     *
+     */
+    uint64_t nextReadIndex;
+
+    /**
+     * @brief Index of the last sample to read.
+     *
+     */
+    uint64_t lastIndex;
+
+    /**
+     * @brief Index of the next sample to replay.
+     *
+     */
+    uint64_t nextReplayIndex;
+
+    /**
+     * @brief Indices of read samples that wait for unmarshaling.
+     *
+     */
+    std::deque<uint64_t> readQueue;
+
+    /**
+     * @brief Indicator if pipeline threads should run.
+     *
+     */
+    bool running;
+
+    /**
+     * @brief Mutex to lock the slot states and indices.
+     *
+     */
+    std::mutex pipelineMutex;
+
+    /**
+     * @brief Condition to wake up the reader when a slot was freed.
+     *
+     */
+    std::condition_variable slotFreed;
+
+    /**
+     * @brief Condition to wake up the decoders when a sample was read.
+     *
+     */
+    std::condition_variable sampleRead;
+
+    /**
+     * @brief Condition to wake up the replay thread when a sample was decoded.
+     *
+     */
+    std::condition_variable sampleDecoded;
+
+    /**
+     * @brief Reader thread.
+     *
+     */
+    std::thread readerThread;
+
+    /**
+     * @brief Decoder threads.
+     *
+     */
+    std::vector<std::thread> decoderThreads;
+};
@@ -0,0 +1,75 @@
+#include "ReplayScheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+ReplayScheduler::ReplayScheduler()
+    : speed(1.)
+{
+    resetStatistics();
+}
+
+void ReplayScheduler::anchor(const base::Time& logTime, double speed, Clock::time_point wallTime)
+{
+    logAnchor = logTime;
+    wallAnchor = wallTime;
+    this->speed = speed;
+}
+
+void ReplayScheduler::setSpeed(double speed, Clock::time_point wallTime)
+{
+    anchor(getLogTime(wallTime), speed, wallTime);
+}
+
+ReplayScheduler::Clock::time_point ReplayScheduler::getDeadline(const base::Time& logTime) const
+{
+    const double logOffsetNs = static_cast<double>((logTime - logAnchor).toMicroseconds()) * 1000.;
+    return wallAnchor + std::chrono::nanoseconds(std::llround(logOffsetNs / speed));
+}
+
+base::Time ReplayScheduler::getLogTime(Clock::time_point wallTime) const
+{
+    const double wallOffsetNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(wallTime - wallAnchor).count());
+    return logAnchor + base::Time::fromMicroseconds(std::llround(wallOffsetNs * speed / 1000.));
+}
+
+double ReplayScheduler::getRelativeSpeed(const base::Time& logTime, Clock::time_point wallTime) const
+{
+    const auto idealElapsed = getDeadline(logTime) - wallAnchor;
+    const auto actualElapsed = wallTime - wallAnchor;
+    if(idealElapsed.count() <= 0 || actualElapsed.count() <= 0)
+    {
+        return 1.;
+    }
+
+    return static_cast<double>(idealElapsed.count()) / actualElapsed.count();
+}
+
+std::chrono::nanoseconds ReplayScheduler::recordPublish(const base::Time& logTime, Clock::time_point publishTime)
+{
+    const auto error = std::chrono::duration_cast<std::chrono::nanoseconds>(publishTime - getDeadline(logTime));
+
+    std::lock_guard<std::mutex> lock(statisticsMutex);
+    recordedSamples++;
+    errorSum += error;
+    lastError = error;
+    maxError = recordedSamples == 1 ? error : std::max(maxError, error);
+
+    return error;
+}
+
+ReplayScheduler::Statistics ReplayScheduler::getStatistics()
+{
+    std::lock_guard<std::mutex> lock(statisticsMutex);
+    const auto meanError = recordedSamples ? errorSum / static_cast<int64_t>(recordedSamples) : std::chrono::nanoseconds::zero();
+    return {recordedSamples, lastError, meanError, maxError};
+}
+
+void ReplayScheduler::resetStatistics()
+{
+    std::lock_guard<std::mutex> lock(statisticsMutex);
+    recordedSamples = 0;
+    errorSum = std::chrono::nanoseconds::zero();
+    lastError = std::chrono::nanoseconds::zero();
+    maxError = std::chrono::nanoseconds::zero();
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <base/Time.hpp>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+/**
+ * @brief Class that maps log timestamps to absolute wall clock deadlines.
+ * The mapping is anchored to a fixed pair of log time t0 and wall time w0, so that
+ * the deadline of every sample is computed from the anchor instead of accumulating
+ * per-sample sleeps. Rounding errors therefore do not add up over long logs.
+ *
+ */
+class ReplayScheduler
+{
+public:
+    /**
+     * @brief Monotonic clock used for all wall clock deadlines.
+     *
+     */
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Aggregated scheduling errors, i.e. actual publish time minus deadline.
+     *
+     */
+    struct Statistics
+    {
+        /**
+         * @brief Number of recorded samples.
+         *
+         */
+        uint64_t samples;
+
+        /**
+         * @brief Scheduling error of the last recorded sample.
+         *
+         */
+        std::chrono::nanoseconds lastError;
+
+        /**
+         * @brief Mean scheduling error of all recorded samples.
+         *
+         */
+        std::chrono::nanoseconds meanError;
+
+        /**
+         * @brief Largest scheduling error of all recorded samples.
+         *
+         */
+        std::chrono::nanoseconds maxError;
+    };
+
+    /**
+     * @brief Constructor.
+     *
+     */
+    ReplayScheduler();
+
+    /**
+     * @brief Anchors the given log time to the given wall time.
+     *
+     * @param logTime: Log time t0.
+     * @param speed: Relative replay speed. 1.00 means 100%.
+     * @param wallTime: Wall time w0.
+     */
+    void anchor(const base::Time& logTime, double speed, Clock::time_point wallTime = Clock::now());
+
+    /**
+     * @brief Changes the replay speed without a jump in log time. The scheduler is
+     * re-anchored to the log time that corresponds to the given wall time.
+     *
+     * @param speed: Relative replay speed. 1.00 means 100%.
+     * @param wallTime: Wall time of the speed change.
+     */
+    void setSpeed(double speed, Clock::time_point wallTime = Clock::now());
+
+    /**
+     * @brief Returns the absolute wall time at which a sample with the given log time is due.
+     *
+     * @param logTime: Log time of the sample.
+     * @return Clock::time_point Deadline of the sample.
+     */
+    Clock::time_point getDeadline(const base::Time& logTime) const;
+
+    /**
+     * @brief Returns the log time that is due at the given wall time.
+     *
+     * @param wallTime: Wall time to convert.
+     * @return base::Time Corresponding log time.
+     */
+    base::Time getLogTime(Clock::time_point wallTime = Clock::now()) const;
+
+    /**
+     * @brief Returns the reached speed relative to the set speed since the last anchoring.
+     * A value of 1 means that replay is exactly on schedule.
+     *
+     * @param logTime: Log time of the latest published sample.
+     * @param wallTime: Wall time at which the sample was published.
+     * @return double Reached relative speed.
+     */
+    double getRelativeSpeed(const base::Time& logTime, Clock::time_point wallTime = Clock::now()) const;
+
+    /**
+     * @brief Records the scheduling error of a published sample.
+     *
+     * @param logTime: Log time of the published sample.
+     * @param publishTime: Wall time at which the sample was published.
+     * @return std::chrono::nanoseconds Scheduling error of the sample. Positive values mean the sample was late.
+     */
+    std::chrono::nanoseconds recordPublish(const base::Time& logTime, Clock::time_point publishTime = Clock::now());
+
+    /**
+     * @brief Returns the aggregated scheduling errors.
+     *
+     * @return Statistics Scheduling errors since the last reset.
+     */
+    Statistics getStatistics();
+
+    /**
+     * @brief Resets the aggregated scheduling errors.
+     *
+     */
+    void resetStatistics();
+
+    /**
+     * @brief Returns the set replay speed.
+     *
+     * @return double Relative replay speed.
+     */
+    double getSpeed() const
+    {
+        return speed;
+    };
+
+private:
+    /**
+     * @brief Log time t0 of the anchor.
+     *
+     */
+    base::Time logAnchor;
+
+    /**
+     * @brief Wall time w0 of the anchor.
+     *
+     */
+    Clock::time_point wallAnchor;
+
+    /**
+     * @brief Relative replay speed.
+     *
+     */
+    double speed;
+
+    /**
+     * @brief Mutex to lock the statistics, which are read from other threads.
+     *
+     */
+    std::mutex statisticsMutex;
+
+    /**
+     * @brief Number of recorded samples.
+     *
+     */
+    uint64_t recordedSamples;
+
+    /**
+     * @brief Sum of all recorded scheduling errors.
+     *
+     */
+    std::chrono::nanoseconds errorSum;
+
+    /**
+     * @brief Scheduling error of the last recorded sample.
+     *
+     */
+    std::chrono::nanoseconds lastError;
+
+    /**
+     * @brief Largest recorded scheduling error.
+     *
+     */
+    std::chrono::nanoseconds maxError;
+};
@@ -0,0 +1,487 @@
+#include "SampleIndex.hpp"
+
+#include <algorithm>
+#include <base-logging/Logging.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <limits>
+#include <queue>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
+
+/**
+ * @brief Header of a sample index cache file. It is followed by the key, padded to 8 bytes, and the written SampleTable.
+ *
+ */
+struct CacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t blockSize;
+    uint64_t keySize;
+    uint64_t numEntries;
+    uint64_t numStreams;
+};
+
+static const char cacheMagic[8] = {'R', 'R', 'I', 'N', 'D', 'E', 'X', '\0'};
+static const uint32_t cacheVersion = 2;
+
+// each reader reads the timestamps of a stream in blocks and runs at most two blocks ahead of the merge, about 16 KB per stream
+static const size_t readBlockSize = 1024;
+static const size_t readAheadSize = 2 * readBlockSize;
+
+static size_t getTableOffset(uint64_t keySize)
+{
+    return sizeof(CacheHeader) + (keySize + 7) / 8 * 8;
+}
+
+std::pair<size_t, size_t> SampleIndex::getStreamRange(
+    pocolog_cpp::InputDataStream& stream, const base::Time& windowStart, const base::Time& windowEnd)
+{
+    pocolog_cpp::Index& streamIndex = stream.getFileIndex();
+
+    // binary search for the first sample of the stream that is not before the given time, or after it
+    auto findFirst = [&](const base::Time& time, bool after) {
+        size_t first = 0;
+        size_t count = stream.getSize();
+        while(count > 0)
+        {
+            const size_t step = count / 2;
+            const base::Time sampleTime = streamIndex.getSampleTime(first + step);
+            if(after ? sampleTime <= time : sampleTime < time)
+            {
+                first += step + 1;
+                count -= step + 1;
+            }
+            else
+            {
+                count = step;
+            }
+        }
+        return first;
+    };
+
+    const size_t begin = windowStart.isNull() ? 0 : findFirst(windowStart, false);
+    const size_t end = windowEnd.isNull() ? stream.getSize() : findFirst(windowEnd, true);
+    return {begin, std::max(begin, end)};
+}
+
+bool SampleIndex::build(
+    const std::vector<std::vector<pocolog_cpp::InputDataStream*>>& fileStreams, const std::vector<std::mutex*>& fileMutexes,
+    const ProgressCallback& progress, const base::Time& windowStart, const base::Time& windowEnd)
+{
+    clear();
+    this->windowStart = windowStart;
+    this->windowEnd = windowEnd;
+    const std::vector<size_t> streamSizes = assignStreams(fileStreams, windowStart, windowEnd);
+
+    const auto largestStream = std::max_element(streamSizes.begin(), streamSizes.end());
+    if(streams.size() > SampleTable::maxStreams)
+    {
+        LOG_ERROR_S << "cannot index " << streams.size() << " streams, the sample index is limited to " << SampleTable::maxStreams;
+        clear();
+        return false;
+    }
+
+    if(largestStream != streamSizes.end() && *largestStream > SampleTable::maxStreamSize)
+    {
+        LOG_ERROR_S << "cannot index stream " << streams[largestStream - streamSizes.begin()]->getName() << " with " << *largestStream
+                    << " samples, the sample index is limited to " << SampleTable::maxStreamSize << " samples per stream";
+        clear();
+        return false;
+    }
+
+    std::vector<std::unique_ptr<StreamTimes>> streamTimes;
+    size_t numSamples = 0;
+    for(size_t streamSize : streamSizes)
+    {
+        streamTimes.emplace_back(new StreamTimes());
+        streamTimes.back()->times.resize(std::min(streamSize, readAheadSize));
+        streamTimes.back()->size = streamSize;
+        streamTimes.back()->complete = streamSize == 0;
+        numSamples += streamSize;
+    }
+
+    table.reset(numSamples + reserve, streams.size());
+
+    // pocolog streams of different files can be read concurrently, streams of the same file share the file. Each file has its own reader,
+    // as a reader waits for the merge to free its buffers, which may in turn wait for the timestamps of any other file
+    std::vector<std::thread> readers;
+    for(size_t fileIdx = 0; fileIdx < fileStreams.size(); fileIdx++)
+    {
+        readers.emplace_back([&, fileIdx]() { readFileTimes(fileIdx, *fileMutexes.at(fileIdx), streamTimes); });
+    }
+
+    // heap of (time, stream index), the stream index breaks ties in favour of earlier streams and files
+    using Head = std::pair<int64_t, uint32_t>;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    std::vector<size_t> positions(streams.size(), 0);
+    for(uint32_t streamIdx = 0; streamIdx < streams.size(); streamIdx++)
+    {
+        if(waitForTime(*streamTimes[streamIdx], 0))
+        {
+            heads.emplace(streamTimes[streamIdx]->getTime(0), streamIdx);
+            markMerged(*streamTimes[streamIdx]);
+        }
+    }
+
+    constexpr size_t publishInterval = 1 << 16;
+    size_t numOrdered = 0;
+    auto publish = [&]() {
+        numEntries.store(numOrdered, std::memory_order_release);
+        if(progress && numSamples)
+        {
+            progress(static_cast<double>(numOrdered) / numSamples);
+        }
+    };
+
+    while(!heads.empty() && !cancelled)
+    {
+        const uint32_t streamIdx = heads.top().second;
+        table.append(heads.top().first, streamIdx);
+        heads.pop();
+
+        const size_t pos = positions[streamIdx]++;
+        numOrdered++;
+
+        // the merge may have to wait for the readers, so the ordered samples are published before
+        StreamTimes& times = *streamTimes[streamIdx];
+        if(numOrdered % publishInterval == 0 || pos + 1 >= times.numRead.load(std::memory_order_acquire))
+        {
+            publish();
+        }
+
+        if(waitForTime(times, pos + 1))
+        {
+            heads.emplace(times.getTime(pos + 1), streamIdx);
+            markMerged(times);
+        }
+    }
+
+    publish();
+    for(std::thread& reader : readers)
+    {
+        reader.join();
+    }
+
+    if(numOrdered != numSamples)
+    {
+        return false;
+    }
+
+    for(size_t streamIdx = 0; streamIdx < streams.size(); streamIdx++)
+    {
+        streamEnds.push_back(streamBegins[streamIdx] + streamSizes[streamIdx]);
+    }
+
+    return true;
+}
+
+size_t SampleIndex::extend(
+    const std::vector<std::vector<pocolog_cpp::InputDataStream*>>& fileStreams, const std::vector<std::mutex*>& fileMutexes)
+{
+    std::vector<pocolog_cpp::InputDataStream*> extendedStreams;
+    for(const auto& streamsOfFile : fileStreams)
+    {
+        extendedStreams.insert(extendedStreams.end(), streamsOfFile.begin(), streamsOfFile.end());
+    }
+
+    if(streamEnds.size() != streams.size() || extendedStreams.size() != streams.size())
+    {
+        return 0;
+    }
+    streams = extendedStreams;
+
+    // (time, stream index, position in stream) of the new samples, the times of each stream are clamped to be monotonic
+    using NewSample = std::tuple<int64_t, uint32_t, size_t>;
+    std::vector<NewSample> newSamples;
+    for(uint32_t streamIdx = 0; streamIdx < streams.size(); streamIdx++)
+    {
+        std::lock_guard<std::mutex> lock(*fileMutexes.at(streamFiles[streamIdx]));
+        int64_t lastTime = std::numeric_limits<int64_t>::min();
+        try
+        {
+            pocolog_cpp::Index& streamIndex = streams[streamIdx]->getFileIndex();
+            for(size_t pos = streamEnds[streamIdx]; pos < streams[streamIdx]->getSize(); pos++)
+            {
+                const base::Time time = streamIndex.getSampleTime(pos);
+                if(!windowEnd.isNull() && time > windowEnd)
+                {
+                    windowEndReached = true;
+                    break;
+                }
+
+                // a stream without samples in the window yet starts with its first sample in the window
+                if(!windowStart.isNull() && time < windowStart && streamBegins[streamIdx] == streamEnds[streamIdx])
+                {
+                    streamBegins[streamIdx] = streamEnds[streamIdx] = pos + 1;
+                    continue;
+                }
+
+                lastTime = std::max(lastTime, time.toMicroseconds());
+                newSamples.emplace_back(lastTime, streamIdx, pos);
+            }
+        }
+        catch(const std::exception&)
+        {
+            // samples from a broken index entry on are read again by the next extension
+        }
+    }
+
+    std::stable_sort(newSamples.begin(), newSamples.end(), [](const NewSample& a, const NewSample& b) {
+        return std::tie(std::get<0>(a), std::get<1>(a)) < std::tie(std::get<0>(b), std::get<1>(b));
+    });
+
+    // published samples are never moved, so the table clamps a sample before the last indexed one to its timestamp
+    const int64_t lastIndexedTime = table.getSize() ? table.getTime(table.getSize() - 1) : std::numeric_limits<int64_t>::min();
+    const size_t numAppended = std::min(newSamples.size(), table.getCapacity() - table.getSize());
+    size_t numLate = 0;
+    for(size_t i = 0; i < numAppended; i++)
+    {
+        const uint32_t streamIdx = std::get<1>(newSamples[i]);
+        numLate += std::get<0>(newSamples[i]) < lastIndexedTime;
+        table.append(std::get<0>(newSamples[i]), streamIdx);
+        streamEnds[streamIdx] = std::get<2>(newSamples[i]) + 1;
+    }
+
+    if(numLate)
+    {
+        LOG_WARN_S << numLate << " appended samples are older than the last indexed sample, they are replayed at its timestamp";
+        numLateSamples += numLate;
+    }
+
+    numEntries.store(table.getSize(), std::memory_order_release);
+    return numAppended;
+}
+
+bool SampleIndex::isExtensible() const
+{
+    return !streamEnds.empty() && streamEnds.size() == streams.size() && table.getSize() < table.getCapacity() && !windowEndReached;
+}
+
+void SampleIndex::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(readMutex);
+        cancelled = true;
+    }
+    timesRead.notify_all();
+    timesMerged.notify_all();
+}
+
+void SampleIndex::readFileTimes(size_t fileIdx, std::mutex& fileMutex, std::vector<std::unique_ptr<StreamTimes>>& streamTimes)
+{
+    while(true)
+    {
+        StreamTimes* next = nullptr;
+        size_t nextIdx = 0;
+        {
+            // the merge frees the buffers of the streams it waits for, so a waiting reader always gets a stream to read
+            std::unique_lock<std::mutex> lock(readMutex);
+            bool pending = false;
+            timesMerged.wait(lock, [&] {
+                next = nullptr;
+                pending = false;
+                for(size_t streamIdx = 0; streamIdx < streams.size(); streamIdx++)
+                {
+                    StreamTimes& times = *streamTimes[streamIdx];
+                    if(streamFiles[streamIdx] != fileIdx || times.complete)
+                    {
+                        continue;
+                    }
+
+                    pending = true;
+                    if(times.getFreeSize() >= std::min(readBlockSize, times.size - times.numRead) &&
+                       (!next || times.lastReadTime < next->lastReadTime))
+                    {
+                        next = &times;
+                        nextIdx = streamIdx;
+                    }
+                }
+                return next || !pending || cancelled;
+            });
+
+            if(!next || cancelled)
+            {
+                return;
+            }
+        }
+
+        const size_t begin = next->numRead;
+        size_t end = std::min(begin + readBlockSize, next->size);
+        bool failed = false;
+        try
+        {
+            std::lock_guard<std::mutex> lock(fileMutex);
+            pocolog_cpp::Index& streamIndex = streams[nextIdx]->getFileIndex();
+            for(size_t pos = begin; pos < end; pos++)
+            {
+                next->lastReadTime = streamIndex.getSampleTime(streamBegins[nextIdx] + pos).toMicroseconds();
+                next->times[pos % next->times.size()] = next->lastReadTime;
+            }
+        }
+        catch(const std::exception&)
+        {
+            // samples from a broken index entry on are not replayed
+            end = begin;
+            failed = true;
+        }
+
+        {
+            // publishing under the lock ensures that a waiting merge does not miss the notification
+            std::lock_guard<std::mutex> lock(readMutex);
+            next->numRead = end;
+            next->complete = failed || end == next->size;
+        }
+        timesRead.notify_all();
+    }
+}
+
+bool SampleIndex::waitForTime(const StreamTimes& times, size_t pos)
+{
+    if(pos < times.numRead.load(std::memory_order_acquire))
+    {
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(readMutex);
+    timesMerged.notify_all();
+    timesRead.wait(lock, [&] { return pos < times.numRead || times.complete || cancelled; });
+
+    return pos < times.numRead && !cancelled;
+}
+
+void SampleIndex::markMerged(StreamTimes& times)
+{
+    // a reader waits until a whole block is free, so it is only woken up once per block. The counters are sequentially consistent,
+    // so that either the merge sees the last read block or the reader sees the merged timestamp before waiting
+    const size_t numMerged = ++times.numMerged;
+    if(times.times.size() - (times.numRead - numMerged) == readBlockSize)
+    {
+        std::lock_guard<std::mutex> lock(readMutex);
+        timesMerged.notify_all();
+    }
+}
+
+bool SampleIndex::save(const std::string& fileName, const std::string& key) const
+{
+    CacheHeader header;
+    std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = cacheVersion;
+    header.blockSize = SampleTable::blockSize;
+    header.keySize = key.size();
+    header.numEntries = getSize();
+    header.numStreams = streams.size();
+
+    const std::string tmpFileName = fileName + "." + std::to_string(getpid()) + ".tmp";
+    std::ofstream file(tmpFileName, std::ios::binary | std::ios::trunc);
+    const std::string padding(getTableOffset(key.size()) - sizeof(CacheHeader) - key.size(), '\0');
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(key.data(), key.size());
+    file.write(padding.data(), padding.size());
+    table.write(file);
+    file.close();
+
+    if(!file || std::rename(tmpFileName.c_str(), fileName.c_str()))
+    {
+        std::remove(tmpFileName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool SampleIndex::load(
+    const std::string& fileName, const std::string& key, const std::vector<std::vector<pocolog_cpp::InputDataStream*>>& fileStreams,
+    const base::Time& windowStart, const base::Time& windowEnd)
+{
+    clear();
+    this->windowStart = windowStart;
+    this->windowEnd = windowEnd;
+
+    const int fd = open(fileName.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        return false;
+    }
+
+    struct stat fileStat;
+    const bool validSize = !fstat(fd, &fileStat) && static_cast<size_t>(fileStat.st_size) >= getTableOffset(key.size());
+    void* memory = validSize ? mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+
+    if(memory == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const size_t fileSize = fileStat.st_size;
+    std::shared_ptr<const void> fileMapping(memory, [fileSize](const void* memory) { munmap(const_cast<void*>(memory), fileSize); });
+
+    const auto& header = *static_cast<const CacheHeader*>(memory);
+    const char* storedKey = static_cast<const char*>(memory) + sizeof(CacheHeader);
+    const size_t tableOffset = getTableOffset(key.size());
+    if(std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) || header.version != cacheVersion ||
+       header.blockSize != SampleTable::blockSize || header.keySize != key.size() || key.compare(0, key.size(), storedKey, key.size()))
+    {
+        return false;
+    }
+
+    assignStreams(fileStreams, windowStart, windowEnd);
+    if(header.numStreams != streams.size() ||
+       !table.map(static_cast<const char*>(memory) + tableOffset, fileSize - tableOffset, header.numEntries, header.numStreams))
+    {
+        clear();
+        return false;
+    }
+
+    mapping = fileMapping;
+    numEntries.store(header.numEntries, std::memory_order_release);
+
+    return true;
+}
+
+void SampleIndex::clear()
+{
+    numEntries = 0;
+    cancelled = false;
+    streams.clear();
+    streamFiles.clear();
+    streamBegins.clear();
+    streamEnds.clear();
+    windowStart = base::Time();
+    windowEnd = base::Time();
+    windowEndReached = false;
+    numLateSamples = 0;
+    table.reset(0, 0);
+    mapping.reset();
+}
+
+size_t SampleIndex::getIndexForTime(const base::Time& time) const
+{
+    return table.getIndexForTime(time.toMicroseconds(), getSize());
+}
+
+std::vector<size_t> SampleIndex::assignStreams(
+    const std::vector<std::vector<pocolog_cpp::InputDataStream*>>& fileStreams, const base::Time& windowStart, const base::Time& windowEnd)
+{
+    std::vector<size_t> streamSizes;
+    for(uint32_t fileIdx = 0; fileIdx < fileStreams.size(); fileIdx++)
+    {
+        streams.insert(streams.end(), fileStreams[fileIdx].begin(), fileStreams[fileIdx].end());
+        streamFiles.insert(streamFiles.end(), fileStreams[fileIdx].size(), fileIdx);
+        for(pocolog_cpp::InputDataStream* stream : fileStreams[fileIdx])
+        {
+            const auto range = getStreamRange(*stream, windowStart, windowEnd);
+            streamBegins.push_back(range.first);
+            streamSizes.push_back(range.second - range.first);
+        }
+    }
+
+    return streamSizes;
+}
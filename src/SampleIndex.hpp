@@ -0,0 +1,457 @@
+#pragma once
+
+#include "SampleTable.hpp"
+
+#include <atomic>
+#include <base/Time.hpp>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <pocolog_cpp/InputDataStream.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Class that orders the samples of several logfiles by time.
+ * The timestamps of each file are read concurrently, while a k-way merge over all streams orders them.
+ * The readers only run a few blocks ahead of the merge, so building needs little memory besides the SampleTable.
+ * Replaces the pocolog_cpp::MultiFileIndex, which processes the files one at a time.
+ * The ordered samples are published progressively, so the indexed prefix can be accessed while building continues.
+ * The ordered samples are kept in a compact SampleTable, using about 8 bytes per sample.
+ * The index can be restricted to a time window, so that only the samples within the window are read and stored.
+ * Samples added to the streams after building, e.g. by a logger that is still writing, are appended without rebuilding.
+ * The ordered samples can be saved to a cache file, which is memory mapped when loaded again.
+ *
+ */
+class SampleIndex
+{
+    /**
+     * @brief Timestamps of a stream read during building. The reader runs at most two read blocks ahead of the merge,
+     * so that building needs a bounded buffer per stream instead of the timestamps of all samples.
+     *
+     */
+    struct StreamTimes
+    {
+        /**
+         * @brief Timestamps in microseconds that were read but not merged yet, addressed by the position in the stream
+         * modulo its size. Is sized to the number of samples in the stream, at most to two read blocks.
+         *
+         */
+        std::vector<int64_t> times;
+
+        /**
+         * @brief Number of samples of the stream within the time window.
+         *
+         */
+        size_t size = 0;
+
+        /**
+         * @brief Timestamp of the last read sample. Is only accessed by the reader of the stream's logfile.
+         *
+         */
+        int64_t lastReadTime = std::numeric_limits<int64_t>::min();
+
+        /**
+         * @brief Number of timestamps read so far.
+         *
+         */
+        std::atomic<size_t> numRead{0};
+
+        /**
+         * @brief Number of timestamps taken by the merge, their slots in times can be read again.
+         *
+         */
+        std::atomic<size_t> numMerged{0};
+
+        /**
+         * @brief Indicates whether reading finished. If reading failed, numRead stays below the stream size.
+         *
+         */
+        std::atomic<bool> complete{false};
+
+        /**
+         * @brief Returns the timestamp of a read sample that was not merged yet.
+         *
+         * @param pos: Position of the sample in the stream.
+         * @return int64_t Timestamp in microseconds.
+         */
+        int64_t getTime(size_t pos) const
+        {
+            return times[pos % times.size()];
+        };
+
+        /**
+         * @brief Returns the number of timestamps that can be read without overwriting timestamps that were not merged yet.
+         *
+         * @return size_t Number of free slots.
+         */
+        size_t getFreeSize() const
+        {
+            return times.size() - (numRead - numMerged);
+        };
+    };
+
+public:
+    /**
+     * @brief Function receiving the fraction of indexed samples.
+     *
+     */
+    using ProgressCallback = std::function<void(double)>;
+
+    /**
+     * @brief Returns the range of a stream's samples within a time window. Performs a binary search on the stream's index.
+     *
+     * @param stream: Stream to search.
+     * @param windowStart: Start of the time window, a null time leaves the window open.
+     * @param windowEnd: End of the time window, inclusive. A null time leaves the window open.
+     * @return std::pair<size_t, size_t> Position of the first sample in the window and position after the last sample in the window.
+     */
+    static std::pair<size_t, size_t> getStreamRange(
+        pocolog_cpp::InputDataStream& stream, const base::Time& windowStart, const base::Time& windowEnd);
+
+    /**
+     * @brief Builds the index. The global stream indices are assigned in the order of the given streams.
+     * Ordered samples are published in blocks, getSize returns the number of samples that can be accessed.
+     *
+     * @param fileStreams: Streams to index, grouped by their logfile.
+     * @param fileMutexes: Mutexes serializing accesses to each logfile, as pocolog streams are not thread-safe. Are locked while reading timestamps.
+     * @param progress: Optional function receiving the fraction of indexed samples. Is called from the calling thread.
+     * @param windowStart: Start of the indexed time window, a null time leaves the window open.
+     * @param windowEnd: End of the indexed time window, inclusive. A null time leaves the window open.
+     * @return bool True if all samples were indexed, false if building was cancelled, timestamps could not be read
+     * or the streams exceed the limits of the SampleTable. In the latter case, an error is logged and no streams are indexed.
+     */
+    bool build(
+        const std::vector<std::vector<pocolog_cpp::InputDataStream*>>& fileStreams, const std::vector<std::mutex*>& fileMutexes,
+        const ProgressCallback& progress = {}, const base::Time& windowStart = base::Time(), const base::Time& windowEnd = base::Time());
+
+    /**
+     * @brief Appends the samples that were added to the indexed streams after building. The new samples are ordered by time among each other.
+     * A new sample before the last indexed sample is clamped to its timestamp, so that it follows the indexed samples, as published
+     * samples are never moved. Such late samples are counted and reported with a warning.
+     * Must not be called during building.
+     *
+     * @param fileStreams: Streams to extend, replacing the indexed streams, e.g. if a growing logfile was reopened.
+     * Must be given in the same order as for building.
+     * @param fileMutexes: Mutexes serializing accesses to each logfile. Are locked while reading timestamps.
+     * @return size_t Number of appended samples. Is 0 if the index was loaded, building did not complete or the reserve is used up.
+     */
+    size_t extend(const std::vector<std::vector<pocolog_cpp::InputDataStream*>>& fileStreams, const std::vector<std::mutex*>& fileMutexes);
+
+    /**
+     * @brief Returns the number of samples that extend appended with the timestamp of an earlier indexed sample,
+     * because they were written after samples of a later time.
+     *
+     * @return size_t Number of late samples.
+     */
+    size_t getNumLateSamples() const
+    {
+        return numLateSamples;
+    };
+
+    /**
+     * @brief Returns whether extend can append more samples. It cannot if the index was loaded, building did not complete,
+     * the reserve is used up, or a stream reached the end of the time window: the logfiles are written in time order,
+     * so all samples in the window were read by the extension that found a sample after it.
+     *
+     * @return bool True if the index can be extended, false otherwise.
+     */
+    bool isExtensible() const;
+
+    /**
+     * @brief Sets the number of samples that building reserves for extending the index. The reserve only costs address space
+     * until samples are appended to it.
+     *
+     * @param reserve: Number of samples.
+     */
+    void setReserve(size_t reserve)
+    {
+        this->reserve = reserve;
+    };
+
+    /**
+     * @brief Cancels a running build. Can be called from any thread.
+     *
+     */
+    void cancel();
+
+    /**
+     * @brief Saves the ordered samples to a cache file. The file is written to a temporary file first
+     * and renamed afterwards, so concurrent readers never see a partial file.
+     *
+     * @param fileName: Name of the cache file.
+     * @param key: Key identifying the indexed streams, is stored in the file.
+     * @return bool True if the file was written, false otherwise.
+     */
+    bool save(const std::string& fileName, const std::string& key) const;
+
+    /**
+     * @brief Loads the ordered samples from a cache file by memory mapping it, so loading does not depend on the number of samples.
+     * The global stream indices are assigned in the order of the given streams, as in build.
+     *
+     * @param fileName: Name of the cache file.
+     * @param key: Key identifying the indexed streams. The file is only loaded if it was saved with the same key.
+     * @param fileStreams: Streams the cache file was saved for, grouped by their logfile.
+     * @param windowStart: Start of the time window the cache file was saved for, a null time leaves the window open.
+     * @param windowEnd: End of the time window the cache file was saved for, a null time leaves the window open.
+     * @return bool True if the file was loaded, false if it is missing, invalid or saved with a different key.
+     */
+    bool load(
+        const std::string& fileName, const std::string& key, const std::vector<std::vector<pocolog_cpp::InputDataStream*>>& fileStreams,
+        const base::Time& windowStart = base::Time(), const base::Time& windowEnd = base::Time());
+
+    /**
+     * @brief Removes all streams and samples. Must not be called during building.
+     *
+     */
+    void clear();
+
+    /**
+     * @brief Returns the number of indexed samples. Grows during building.
+     *
+     * @return size_t Number of samples.
+     */
+    size_t getSize() const
+    {
+        return numEntries.load(std::memory_order_acquire);
+    };
+
+    /**
+     * @brief Returns the indexed streams, addressed by their global stream index.
+     *
+     * @return const std::vector<pocolog_cpp::InputDataStream*>& Indexed streams.
+     */
+    const std::vector<pocolog_cpp::InputDataStream*>& getStreams() const
+    {
+        return streams;
+    };
+
+    /**
+     * @brief Returns the global stream index of the sample at the given index.
+     *
+     * @param index: Index of the sample. Throws std::out_of_range if invalid.
+     * @return size_t Global stream index.
+     */
+    size_t getStreamIdx(size_t index) const
+    {
+        return table.getStreamIdx(checkIndex(index));
+    };
+
+    /**
+     * @brief Returns the position in its stream of the sample at the given index.
+     *
+     * @param index: Index of the sample. Throws std::out_of_range if invalid.
+     * @return size_t Position in stream.
+     */
+    size_t getPosInStream(size_t index) const
+    {
+        return streamBegins[table.getStreamIdx(checkIndex(index))] + table.getPosInStream(index);
+    };
+
+    /**
+     * @brief Returns the timestamp of the sample at the given index.
+     *
+     * @param index: Index of the sample. Throws std::out_of_range if invalid.
+     * @return base::Time Timestamp of the sample.
+     */
+    base::Time getSampleTime(size_t index) const
+    {
+        return base::Time::fromMicroseconds(table.getTime(checkIndex(index)));
+    };
+
+    /**
+     * @brief Returns the index of the first sample whose timestamp is not before the given time.
+     * Performs a binary search on the indexed samples.
+     *
+     * @param time: Time to search for.
+     * @return size_t Index of the found sample, or the number of samples if all samples are before the given time.
+     */
+    size_t getIndexForTime(const base::Time& time) const;
+
+    /**
+     * @brief Returns the start of the indexed time window.
+     *
+     * @return const base::Time& Start of the window, a null time if the window is open.
+     */
+    const base::Time& getWindowStart() const
+    {
+        return windowStart;
+    };
+
+    /**
+     * @brief Returns the end of the indexed time window.
+     *
+     * @return const base::Time& End of the window, a null time if the window is open.
+     */
+    const base::Time& getWindowEnd() const
+    {
+        return windowEnd;
+    };
+
+    /**
+     * @brief Returns the memory used by the ordered samples, excluding a mapped cache file.
+     *
+     * @return size_t Used memory in bytes.
+     */
+    size_t getMemoryUsage() const
+    {
+        return table.getMemoryUsage();
+    };
+
+private:
+    /**
+     * @brief Checks that a sample was published.
+     *
+     * @param index: Index of the sample. Throws std::out_of_range if invalid.
+     * @return size_t The given index.
+     */
+    size_t checkIndex(size_t index) const
+    {
+        if(index >= getSize())
+        {
+            throw std::out_of_range("SampleIndex: invalid sample index " + std::to_string(index));
+        }
+
+        return index;
+    };
+
+    /**
+     * @brief Assigns the global stream indices in the order of the given streams and determines their samples within the time window.
+     *
+     * @param fileStreams: Streams to index, grouped by their logfile.
+     * @param windowStart: Start of the time window, a null time leaves the window open.
+     * @param windowEnd: End of the time window, a null time leaves the window open.
+     * @return std::vector<size_t> Number of samples of each stream within the time window, addressed by their global stream index.
+     */
+    std::vector<size_t> assignStreams(
+        const std::vector<std::vector<pocolog_cpp::InputDataStream*>>& fileStreams, const base::Time& windowStart, const base::Time& windowEnd);
+
+    /**
+     * @brief Reads the timestamps of the streams of a logfile in blocks. The stream whose read timestamps
+     * end earliest is continued first, so that all streams of the file advance in time together.
+     * A stream is only read if the merge freed a block in its buffer, the reader waits if no stream of the file can be read.
+     *
+     * @param fileIdx: Index of the logfile.
+     * @param fileMutex: Mutex serializing accesses to the logfile.
+     * @param streamTimes: Timestamps of all streams, addressed by their global stream index.
+     */
+    void readFileTimes(size_t fileIdx, std::mutex& fileMutex, std::vector<std::unique_ptr<StreamTimes>>& streamTimes);
+
+    /**
+     * @brief Waits until the timestamp of a sample was read.
+     *
+     * @param times: Timestamps of the sample's stream.
+     * @param pos: Position of the sample in its stream.
+     * @return bool True if the timestamp is available, false if the stream has no such sample or building was cancelled.
+     */
+    bool waitForTime(const StreamTimes& times, size_t pos);
+
+    /**
+     * @brief Marks the next read timestamp of a stream as merged. Wakes up the readers once a block is free in the stream's buffer.
+     *
+     * @param times: Timestamps of the stream.
+     */
+    void markMerged(StreamTimes& times);
+
+    /**
+     * @brief Indexed streams, addressed by their global stream index.
+     *
+     */
+    std::vector<pocolog_cpp::InputDataStream*> streams;
+
+    /**
+     * @brief Logfile of each stream, addressed by their global stream index.
+     *
+     */
+    std::vector<uint32_t> streamFiles;
+
+    /**
+     * @brief Position of the first indexed sample of each stream, addressed by their global stream index.
+     * Is 0 unless the index is restricted to a time window.
+     *
+     */
+    std::vector<size_t> streamBegins;
+
+    /**
+     * @brief Position after the last indexed sample of each stream, addressed by their global stream index.
+     * Is only set if building completed, so that the index can be extended.
+     *
+     */
+    std::vector<size_t> streamEnds;
+
+    /**
+     * @brief Start of the indexed time window, a null time if the window is open.
+     *
+     */
+    base::Time windowStart;
+
+    /**
+     * @brief End of the indexed time window, a null time if the window is open.
+     *
+     */
+    base::Time windowEnd;
+
+    /**
+     * @brief Indicator if an extension found a sample after the end of the time window.
+     *
+     */
+    bool windowEndReached = false;
+
+    /**
+     * @brief Number of samples appended by extend before the last indexed sample.
+     *
+     */
+    size_t numLateSamples = 0;
+
+    /**
+     * @brief Number of samples reserved for extending the index.
+     *
+     */
+    size_t reserve = 0;
+
+    /**
+     * @brief Samples of all streams, ordered by time. Is sized to the number of samples and the reserve before building,
+     * so published samples are never moved.
+     *
+     */
+    SampleTable table;
+
+    /**
+     * @brief Memory mapped cache file, if the index was loaded. Is unmapped on release.
+     *
+     */
+    std::shared_ptr<const void> mapping;
+
+    /**
+     * @brief Number of ordered samples that are published.
+     *
+     */
+    std::atomic<size_t> numEntries{0};
+
+    /**
+     * @brief Indicates whether building should stop.
+     *
+     */
+    std::atomic<bool> cancelled{false};
+
+    /**
+     * @brief Mutex for waiting on read and merged timestamps.
+     *
+     */
+    std::mutex readMutex;
+
+    /**
+     * @brief Condition to wake up the merge if timestamps were read or building was cancelled.
+     *
+     */
+    std::condition_variable timesRead;
+
+    /**
+     * @brief Condition to wake up the readers if the merge freed a block of timestamps, is waiting or building was cancelled.
+     *
+     */
+    std::condition_variable timesMerged;
+};
@@ -0,0 +1,179 @@
+#include "SampleTable.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+
+constexpr size_t SampleTable::blockSize;
+constexpr size_t SampleTable::maxStreams;
+constexpr size_t SampleTable::maxStreamSize;
+constexpr uint32_t SampleTable::overflowOffset;
+
+static size_t getNumBlocks(size_t numSamples)
+{
+    return (numSamples + SampleTable::blockSize - 1) / SampleTable::blockSize;
+}
+
+static size_t getPaddedSize(size_t size)
+{
+    return (size + 7) / 8 * 8;
+}
+
+void SampleTable::reset(size_t capacity, size_t numStreams)
+{
+    {
+        std::lock_guard<std::mutex> lock(overflowMutex);
+        overflows.clear();
+    }
+
+    storage.reset();
+    this->numStreams = numStreams;
+    this->capacity = 0;
+    numSamples = 0;
+    lastTime = std::numeric_limits<int64_t>::min();
+    streamPositions.assign(numStreams, 0);
+    blockTimes = nullptr;
+    blockPositions = nullptr;
+    entries = nullptr;
+
+    // anonymous memory is only committed when it is written, so the reserve for appended samples costs address space only
+    const size_t numBlocks = getNumBlocks(capacity);
+    const size_t storageSize = numBlocks * sizeof(int64_t) + capacity * sizeof(Entry) + numBlocks * numStreams * sizeof(uint32_t);
+    if(storageSize)
+    {
+        void* memory = mmap(nullptr, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(memory == MAP_FAILED)
+        {
+            throw std::bad_alloc();
+        }
+
+        storage.reset(memory, [storageSize](void* memory) { munmap(memory, storageSize); });
+        this->capacity = capacity;
+        blockTimes = static_cast<int64_t*>(memory);
+        entries = reinterpret_cast<Entry*>(blockTimes + numBlocks);
+        blockPositions = reinterpret_cast<uint32_t*>(entries + capacity);
+    }
+
+    blockTimeData = blockTimes;
+    blockPositionData = blockPositions;
+    entryData = entries;
+}
+
+void SampleTable::append(int64_t time, uint32_t streamIdx)
+{
+    lastTime = std::max(lastTime, time);
+
+    const size_t block = numSamples / blockSize;
+    if(numSamples % blockSize == 0)
+    {
+        blockTimes[block] = lastTime;
+        std::copy(streamPositions.begin(), streamPositions.end(), blockPositions + block * numStreams);
+    }
+
+    Entry& entry = entries[numSamples];
+    const uint64_t timeOffset = lastTime - blockTimes[block];
+    entry.streamIdx = streamIdx;
+    entry.rank = streamPositions[streamIdx]++ - blockPositions[block * numStreams + streamIdx];
+    if(timeOffset < overflowOffset)
+    {
+        entry.timeOffset = timeOffset;
+    }
+    else
+    {
+        entry.timeOffset = overflowOffset;
+        std::lock_guard<std::mutex> lock(overflowMutex);
+        overflows.push_back({numSamples, lastTime});
+    }
+
+    numSamples++;
+}
+
+void SampleTable::write(std::ostream& stream) const
+{
+    const size_t numBlocks = getNumBlocks(numSamples);
+    const size_t positionsSize = numBlocks * numStreams * sizeof(uint32_t);
+    const std::string padding(getPaddedSize(positionsSize) - positionsSize, '\0');
+
+    std::lock_guard<std::mutex> lock(overflowMutex);
+    const uint64_t numOverflows = overflows.size();
+    stream.write(reinterpret_cast<const char*>(blockTimeData), numBlocks * sizeof(int64_t));
+    stream.write(reinterpret_cast<const char*>(entryData), numSamples * sizeof(Entry));
+    stream.write(reinterpret_cast<const char*>(blockPositionData), positionsSize);
+    stream.write(padding.data(), padding.size());
+    stream.write(reinterpret_cast<const char*>(&numOverflows), sizeof(numOverflows));
+    stream.write(reinterpret_cast<const char*>(overflows.data()), numOverflows * sizeof(Overflow));
+}
+
+bool SampleTable::map(const char* memory, size_t size, size_t numSamples, size_t numStreams)
+{
+    reset(0, 0);
+
+    const size_t numBlocks = getNumBlocks(numSamples);
+    const size_t entriesOffset = numBlocks * sizeof(int64_t);
+    const size_t positionsOffset = entriesOffset + numSamples * sizeof(Entry);
+    const size_t overflowsOffset = positionsOffset + getPaddedSize(numBlocks * numStreams * sizeof(uint32_t));
+    if(numStreams > maxStreams || size < overflowsOffset + sizeof(uint64_t))
+    {
+        return false;
+    }
+
+    uint64_t numOverflows;
+    std::memcpy(&numOverflows, memory + overflowsOffset, sizeof(numOverflows));
+    if(numOverflows > numSamples || size != overflowsOffset + sizeof(uint64_t) + numOverflows * sizeof(Overflow))
+    {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(overflowMutex);
+        const Overflow* mappedOverflows = reinterpret_cast<const Overflow*>(memory + overflowsOffset + sizeof(uint64_t));
+        overflows.assign(mappedOverflows, mappedOverflows + numOverflows);
+    }
+
+    this->numStreams = numStreams;
+    this->numSamples = numSamples;
+    blockTimeData = reinterpret_cast<const int64_t*>(memory);
+    entryData = reinterpret_cast<const Entry*>(memory + entriesOffset);
+    blockPositionData = reinterpret_cast<const uint32_t*>(memory + positionsOffset);
+
+    return true;
+}
+
+size_t SampleTable::getIndexForTime(int64_t time, size_t size) const
+{
+    size_t begin = 0;
+    while(size)
+    {
+        const size_t half = size / 2;
+        if(getTime(begin + half) < time)
+        {
+            begin += half + 1;
+            size -= half + 1;
+        }
+        else
+        {
+            size = half;
+        }
+    }
+
+    return begin;
+}
+
+size_t SampleTable::getMemoryUsage() const
+{
+    const size_t numBlocks = storage ? getNumBlocks(numSamples) : 0;
+    const size_t numEntries = storage ? numSamples : 0;
+
+    std::lock_guard<std::mutex> lock(overflowMutex);
+    return streamPositions.capacity() * sizeof(uint32_t) + numBlocks * (sizeof(int64_t) + numStreams * sizeof(uint32_t)) +
+           numEntries * sizeof(Entry) + overflows.capacity() * sizeof(Overflow);
+}
+
+int64_t SampleTable::getOverflowTime(size_t index) const
+{
+    std::lock_guard<std::mutex> lock(overflowMutex);
+    auto overflow = std::lower_bound(
+        overflows.begin(), overflows.end(), index, [](const Overflow& overflow, size_t index) { return overflow.index < index; });
+    return overflow->time;
+}
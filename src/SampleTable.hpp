@@ -0,0 +1,291 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+/**
+ * @brief Compact storage of time ordered samples, referencing each sample by its stream and its position in the stream.
+ * Samples are grouped in blocks of fixed size. A block stores the timestamp of its first sample and the position of every stream
+ * at its start, so each sample only needs a 32 bit time offset, a 16 bit stream index and a 16 bit rank within the block.
+ * Time offsets that do not fit into 32 bits are kept in an overflow table. Samples are accessed in constant time,
+ * except for overflowing time offsets, which are searched in the overflow table.
+ *
+ * The storage is reserved for a maximum number of samples and committed by the system as samples are appended,
+ * so appended samples never move. A single writer appends samples, readers may access the samples that were appended
+ * before, if the writer published their number with release semantics.
+ *
+ */
+class SampleTable
+{
+    /**
+     * @brief Sample within a block.
+     *
+     */
+    struct Entry
+    {
+        /**
+         * @brief Timestamp relative to the block's first sample in microseconds, or overflowOffset if stored in the overflow table.
+         *
+         */
+        uint32_t timeOffset;
+
+        /**
+         * @brief Global index of the sample's stream.
+         *
+         */
+        uint16_t streamIdx;
+
+        /**
+         * @brief Number of samples of the same stream before the sample in its block.
+         *
+         */
+        uint16_t rank;
+    };
+
+    /**
+     * @brief Timestamp of a sample whose time offset does not fit into an entry.
+     *
+     */
+    struct Overflow
+    {
+        /**
+         * @brief Index of the sample.
+         *
+         */
+        uint64_t index;
+
+        /**
+         * @brief Timestamp of the sample in microseconds.
+         *
+         */
+        int64_t time;
+    };
+
+public:
+    /**
+     * @brief Number of samples per block.
+     *
+     */
+    static constexpr size_t blockSize = 4096;
+
+    /**
+     * @brief Maximum number of streams, limited by the 16 bit stream index.
+     *
+     */
+    static constexpr size_t maxStreams = std::numeric_limits<uint16_t>::max() + 1;
+
+    /**
+     * @brief Maximum number of samples per stream, limited by the 32 bit stream positions of the blocks.
+     *
+     */
+    static constexpr size_t maxStreamSize = std::numeric_limits<uint32_t>::max();
+
+    /**
+     * @brief Removes all samples and reserves the storage for the given number of samples. Throws std::bad_alloc if it cannot be reserved.
+     *
+     * @param capacity: Maximum number of samples that can be appended.
+     * @param numStreams: Number of streams, must not exceed maxStreams.
+     */
+    void reset(size_t capacity, size_t numStreams);
+
+    /**
+     * @brief Appends a sample. Its position in the stream follows the stream's previous sample. Must not exceed the capacity.
+     * The timestamp is clamped to the previous sample, so that the timestamps are monotonic even if a stream's clock jumped back.
+     *
+     * @param time: Timestamp of the sample in microseconds.
+     * @param streamIdx: Global index of the sample's stream.
+     */
+    void append(int64_t time, uint32_t streamIdx);
+
+    /**
+     * @brief Writes the samples to a stream, in the layout expected by map.
+     *
+     * @param stream: Stream to write to.
+     */
+    void write(std::ostream& stream) const;
+
+    /**
+     * @brief Accesses samples written by write in place. The memory has to stay valid until the table is reset or destroyed.
+     *
+     * @param memory: Written samples, aligned to 8 bytes.
+     * @param size: Size of the memory in bytes.
+     * @param numSamples: Number of written samples.
+     * @param numStreams: Number of streams of the written samples.
+     * @return bool True if the memory matches the given numbers of samples and streams, false otherwise.
+     */
+    bool map(const char* memory, size_t size, size_t numSamples, size_t numStreams);
+
+    /**
+     * @brief Returns the number of appended or mapped samples.
+     *
+     * @return size_t Number of samples. Must only be called by the writer.
+     */
+    size_t getSize() const
+    {
+        return numSamples;
+    };
+
+    /**
+     * @brief Returns the maximum number of samples that can be appended.
+     *
+     * @return size_t Number of samples.
+     */
+    size_t getCapacity() const
+    {
+        return capacity;
+    };
+
+    /**
+     * @brief Returns the global stream index of the sample at the given index.
+     *
+     * @param index: Index of an appended sample.
+     * @return size_t Global stream index.
+     */
+    size_t getStreamIdx(size_t index) const
+    {
+        return entryData[index].streamIdx;
+    };
+
+    /**
+     * @brief Returns the position in its stream of the sample at the given index.
+     *
+     * @param index: Index of an appended sample.
+     * @return size_t Position in stream.
+     */
+    size_t getPosInStream(size_t index) const
+    {
+        const Entry& entry = entryData[index];
+        return blockPositionData[index / blockSize * numStreams + entry.streamIdx] + entry.rank;
+    };
+
+    /**
+     * @brief Returns the timestamp of the sample at the given index.
+     *
+     * @param index: Index of an appended sample.
+     * @return int64_t Timestamp in microseconds.
+     */
+    int64_t getTime(size_t index) const
+    {
+        const uint32_t timeOffset = entryData[index].timeOffset;
+        return timeOffset != overflowOffset ? blockTimeData[index / blockSize] + timeOffset : getOverflowTime(index);
+    };
+
+    /**
+     * @brief Returns the index of the first sample whose timestamp is not before the given time. Performs a binary search.
+     *
+     * @param time: Time to search for in microseconds.
+     * @param size: Number of samples to search.
+     * @return size_t Index of the found sample, or size if all samples are before the given time.
+     */
+    size_t getIndexForTime(int64_t time, size_t size) const;
+
+    /**
+     * @brief Returns the memory used by the appended samples. Reserved storage is only committed once samples are appended to it.
+     *
+     * @return size_t Used memory in bytes.
+     */
+    size_t getMemoryUsage() const;
+
+private:
+    /**
+     * @brief Time offset marking a timestamp in the overflow table.
+     *
+     */
+    static constexpr uint32_t overflowOffset = std::numeric_limits<uint32_t>::max();
+
+    /**
+     * @brief Returns the timestamp of a sample from the overflow table.
+     *
+     * @param index: Index of the sample.
+     * @return int64_t Timestamp in microseconds.
+     */
+    int64_t getOverflowTime(size_t index) const;
+
+    /**
+     * @brief Number of streams, determines the number of stream positions per block.
+     *
+     */
+    size_t numStreams = 0;
+
+    /**
+     * @brief Number of appended or mapped samples.
+     *
+     */
+    size_t numSamples = 0;
+
+    /**
+     * @brief Maximum number of samples that can be appended.
+     *
+     */
+    size_t capacity = 0;
+
+    /**
+     * @brief Timestamp of the last appended sample in microseconds.
+     *
+     */
+    int64_t lastTime = std::numeric_limits<int64_t>::min();
+
+    /**
+     * @brief Position of the next sample of each stream, while appending.
+     *
+     */
+    std::vector<uint32_t> streamPositions;
+
+    /**
+     * @brief Reserved storage of the block timestamps, block stream positions and samples, if samples are appended. Is unmapped on release.
+     *
+     */
+    std::shared_ptr<void> storage;
+
+    /**
+     * @brief Timestamp of the first sample of each block in microseconds, pointing into the storage.
+     *
+     */
+    int64_t* blockTimes = nullptr;
+
+    /**
+     * @brief Position of each stream at the start of each block, pointing into the storage.
+     *
+     */
+    uint32_t* blockPositions = nullptr;
+
+    /**
+     * @brief Samples, pointing into the storage.
+     *
+     */
+    Entry* entries = nullptr;
+
+    /**
+     * @brief Timestamps whose offset does not fit into an entry, ordered by sample index. Is copied if samples are mapped.
+     *
+     */
+    std::vector<Overflow> overflows;
+
+    /**
+     * @brief Mutex for accessing the overflow table, as it grows while readers access it.
+     *
+     */
+    mutable std::mutex overflowMutex;
+
+    /**
+     * @brief Block timestamps, pointing either into the appended samples or into the mapped memory.
+     *
+     */
+    const int64_t* blockTimeData = nullptr;
+
+    /**
+     * @brief Block stream positions, pointing either into the appended samples or into the mapped memory.
+     *
+     */
+    const uint32_t* blockPositionData = nullptr;
+
+    /**
+     * @brief Samples, pointing either into the appended samples or into the mapped memory.
+     *
+     */
+    const Entry* entryData = nullptr;
+};
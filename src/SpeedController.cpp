@@ -0,0 +1,76 @@
+#include "SpeedController.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief Factor by which the speed grows after a period without lag.
+ *
+ */
+static const double increaseFactor = 1.25;
+
+/**
+ * @brief Share of the estimated sustainable speed that is set after an overloaded period.
+ *
+ */
+static const double decreaseMargin = 0.95;
+
+/**
+ * @brief Factor by which the last overloaded speed is raised after a period without lag.
+ *
+ */
+static const double ceilingGrowth = 1.02;
+
+SpeedController::SpeedController(std::chrono::nanoseconds lagBound, std::chrono::nanoseconds period, double minSpeed, double maxSpeed)
+    : lagBound(lagBound)
+    , period(period)
+    , minSpeed(minSpeed)
+    , maxSpeed(std::max(minSpeed, maxSpeed))
+{
+    reset(1.);
+}
+
+void SpeedController::setLagBound(std::chrono::nanoseconds lagBound)
+{
+    this->lagBound = lagBound;
+}
+
+void SpeedController::reset(double speed, Clock::time_point now)
+{
+    this->speed = std::min(std::max(speed, minSpeed), maxSpeed);
+    ceiling = maxSpeed;
+    periodStart = now;
+    lateness.reset();
+}
+
+bool SpeedController::record(std::chrono::nanoseconds lateness, Clock::time_point publishTime)
+{
+    this->lateness.record(lateness.count());
+    if(publishTime - periodStart < period)
+    {
+        return false;
+    }
+
+    const double previousSpeed = speed;
+    update(this->lateness.getSummary().p99);
+    periodStart = publishTime;
+    this->lateness.reset();
+
+    return speed != previousSpeed;
+}
+
+void SpeedController::update(std::chrono::nanoseconds lag)
+{
+    if(lag > lagBound)
+    {
+        // the lag grows by the share of the period that the publishing falls behind, which estimates the sustainable speed
+        ceiling = speed;
+        speed *= decreaseMargin * std::max(0.5, 1. - static_cast<double>(lag.count()) / period.count());
+    }
+    else if(lag < lagBound / 2)
+    {
+        speed = ceiling > speed ? std::min(speed * increaseFactor, (speed + ceiling) / 2) : speed * increaseFactor;
+        ceiling = std::min(ceiling * ceilingGrowth, maxSpeed);
+    }
+
+    speed = std::min(std::max(speed, minSpeed), maxSpeed);
+}
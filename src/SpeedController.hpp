@@ -0,0 +1,137 @@
+#pragma once
+
+#include "LatencyHistogram.hpp"
+
+#include <chrono>
+
+/**
+ * @brief Feedback controller that searches the highest replay speed whose publish lag stays below a bound.
+ * The lateness of the published samples is collected over fixed periods of wall time. If the 99th percentile of the
+ * lateness of a period exceeded the bound, the speed is reduced to the estimated sustainable speed, as the lag grows by
+ * the share of the period that publishing falls behind. If it stayed below half of the bound, the speed is increased.
+ * Increases approach the last overloaded speed halfway, so that the speed settles below it, and that ceiling is raised
+ * slowly, so that a lighter load is probed again. The schedule should be re-anchored at the current sample when the
+ * speed changes, so that the lag of an overloaded period is not carried into the next one.
+ *
+ */
+class SpeedController
+{
+public:
+    /**
+     * @brief Monotonic clock of the publish times.
+     *
+     */
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param lagBound: Largest tolerated lateness of the published samples.
+     * @param period: Wall time between speed updates.
+     * @param minSpeed: Lowest relative replay speed.
+     * @param maxSpeed: Highest relative replay speed.
+     */
+    SpeedController(
+        std::chrono::nanoseconds lagBound = std::chrono::milliseconds(10), std::chrono::nanoseconds period = std::chrono::milliseconds(500),
+        double minSpeed = 0.01, double maxSpeed = 1000.);
+
+    /**
+     * @brief Sets the largest tolerated lateness of the published samples.
+     *
+     * @param lagBound: Lateness bound.
+     */
+    void setLagBound(std::chrono::nanoseconds lagBound);
+
+    /**
+     * @brief Returns the largest tolerated lateness of the published samples.
+     *
+     * @return std::chrono::nanoseconds Lateness bound.
+     */
+    std::chrono::nanoseconds getLagBound() const
+    {
+        return lagBound;
+    };
+
+    /**
+     * @brief Restarts the control at the given speed, forgetting the collected lateness and the last overloaded speed.
+     *
+     * @param speed: Relative replay speed to start at.
+     * @param now: Start of the first period.
+     */
+    void reset(double speed, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Records the lateness of a published sample and updates the speed if the current period is over.
+     *
+     * @param lateness: Publish time minus deadline of the sample.
+     * @param publishTime: Wall time at which the sample was published.
+     * @return bool True if the speed was changed, false otherwise.
+     */
+    bool record(std::chrono::nanoseconds lateness, Clock::time_point publishTime = Clock::now());
+
+    /**
+     * @brief Returns the controlled speed.
+     *
+     * @return double Relative replay speed.
+     */
+    double getSpeed() const
+    {
+        return speed;
+    };
+
+private:
+    /**
+     * @brief Updates the speed from the lateness of the finished period.
+     *
+     * @param lag: 99th percentile of the lateness of the period.
+     */
+    void update(std::chrono::nanoseconds lag);
+
+    /**
+     * @brief Lateness of the samples of the current period.
+     *
+     */
+    LatencyHistogram lateness;
+
+    /**
+     * @brief Largest tolerated lateness.
+     *
+     */
+    std::chrono::nanoseconds lagBound;
+
+    /**
+     * @brief Wall time between speed updates.
+     *
+     */
+    std::chrono::nanoseconds period;
+
+    /**
+     * @brief Lowest relative replay speed.
+     *
+     */
+    double minSpeed;
+
+    /**
+     * @brief Highest relative replay speed.
+     *
+     */
+    double maxSpeed;
+
+    /**
+     * @brief Controlled relative replay speed.
+     *
+     */
+    double speed;
+
+    /**
+     * @brief Last speed at which the lag exceeded the bound, raised slowly while the lag stays low.
+     *
+     */
+    double ceiling;
+
+    /**
+     * @brief Start of the current period.
+     *
+     */
+    Clock::time_point periodStart;
+};
@@ -0,0 +1,187 @@
+#include "StreamStatistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+
+/**
+ * @brief Returns the element at the given percentile of the not yet ordered part of the values, using the nearest rank.
+ * Percentiles must be requested in increasing order, as the values before the returned element are not ordered again.
+ *
+ * @param values: Values, partially ordered by previous calls.
+ * @param begin: Position of the first value that is not ordered yet, is moved behind the returned element.
+ * @param percentile: Percentile between 0 and 100.
+ * @return int64_t Value at the percentile.
+ */
+static int64_t getPercentile(std::vector<int64_t>& values, size_t& begin, double percentile)
+{
+    const size_t rank = std::max<size_t>(1, static_cast<size_t>(std::ceil(percentile / 100. * values.size())));
+    const size_t pos = std::max(begin, std::min(rank, values.size()) - 1);
+    std::nth_element(values.begin() + begin, values.begin() + pos, values.end());
+    begin = pos;
+    return values[pos];
+}
+
+/**
+ * @brief Writes a string as JSON string literal.
+ *
+ * @param stream: Stream to write to.
+ * @param value: String to write.
+ */
+static void writeJsonString(std::ostream& stream, const std::string& value)
+{
+    stream << '"';
+    for(const char c : value)
+    {
+        if(c == '"' || c == '\\')
+        {
+            stream << '\\' << c;
+        }
+        else if(static_cast<unsigned char>(c) < 0x20)
+        {
+            stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec << std::setfill(' ');
+        }
+        else
+        {
+            stream << c;
+        }
+    }
+    stream << '"';
+}
+
+StreamStatistics StreamStatistics::compute(const std::string& name, const std::vector<int64_t>& times, size_t numGaps)
+{
+    StreamStatistics statistics;
+    statistics.name = name;
+    statistics.numSamples = times.size();
+    if(times.empty())
+    {
+        return statistics;
+    }
+
+    statistics.firstTime = base::Time::fromMicroseconds(times.front());
+    statistics.lastTime = base::Time::fromMicroseconds(times.back());
+
+    std::vector<int64_t> periods;
+    periods.reserve(times.size() - 1);
+    for(size_t pos = 1; pos < times.size(); pos++)
+    {
+        const int64_t period = times[pos] - times[pos - 1];
+        if(period < 0)
+        {
+            statistics.numOutOfOrder++;
+            continue;
+        }
+
+        periods.push_back(period);
+
+        // the gaps are kept ordered, the smallest is replaced by a larger period
+        if(numGaps && (statistics.largestGaps.size() < numGaps || period > statistics.largestGaps.back().duration.toMicroseconds()))
+        {
+            const Gap gap = {base::Time::fromMicroseconds(times[pos - 1]), base::Time::fromMicroseconds(period)};
+            if(statistics.largestGaps.size() == numGaps)
+            {
+                statistics.largestGaps.pop_back();
+            }
+            statistics.largestGaps.insert(
+                std::upper_bound(
+                    statistics.largestGaps.begin(), statistics.largestGaps.end(), gap,
+                    [](const Gap& a, const Gap& b) { return a.duration > b.duration; }),
+                gap);
+        }
+    }
+
+    if(periods.empty())
+    {
+        return statistics;
+    }
+
+    int64_t sum = 0;
+    for(const int64_t period : periods)
+    {
+        sum += period;
+    }
+    statistics.meanPeriod = base::Time::fromMicroseconds(sum / static_cast<int64_t>(periods.size()));
+    statistics.minPeriod = base::Time::fromMicroseconds(*std::min_element(periods.begin(), periods.end()));
+    statistics.maxPeriod = base::Time::fromMicroseconds(*std::max_element(periods.begin(), periods.end()));
+
+    // the percentiles are selected in linear time instead of sorting
+    size_t begin = 0;
+    const int64_t medianPeriod = getPercentile(periods, begin, 50.);
+    statistics.medianPeriod = base::Time::fromMicroseconds(medianPeriod);
+
+    for(int64_t& period : periods)
+    {
+        period = std::llabs(period - medianPeriod);
+    }
+
+    begin = 0;
+    statistics.jitter50 = base::Time::fromMicroseconds(getPercentile(periods, begin, 50.));
+    statistics.jitter95 = base::Time::fromMicroseconds(getPercentile(periods, begin, 95.));
+    statistics.jitter99 = base::Time::fromMicroseconds(getPercentile(periods, begin, 99.));
+    return statistics;
+}
+
+void StreamStatistics::writeTable(std::ostream& stream, const std::vector<StreamStatistics>& statistics)
+{
+    const std::ios::fmtflags flags = stream.flags();
+    const std::streamsize precision = stream.precision();
+    size_t nameWidth = 6;
+    for(const StreamStatistics& streamStatistics : statistics)
+    {
+        nameWidth = std::max(nameWidth, streamStatistics.name.size());
+    }
+
+    const std::vector<std::string> columns = {"samples", "mean ms", "min ms", "median ms", "max ms", "jit50 ms", "jit95 ms", "jit99 ms",
+                                              "gap ms", "unordered"};
+    stream << std::left << std::setw(nameWidth) << "stream" << std::right;
+    for(const std::string& column : columns)
+    {
+        stream << std::setw(11) << column;
+    }
+    stream << std::endl;
+
+    auto toMilliseconds = [](const base::Time& time) { return time.toMicroseconds() / 1000.; };
+    for(const StreamStatistics& streamStatistics : statistics)
+    {
+        stream << std::left << std::setw(nameWidth) << streamStatistics.name << std::right << std::fixed << std::setprecision(3)
+               << std::setw(11) << streamStatistics.numSamples << std::setw(11) << toMilliseconds(streamStatistics.meanPeriod)
+               << std::setw(11) << toMilliseconds(streamStatistics.minPeriod) << std::setw(11)
+               << toMilliseconds(streamStatistics.medianPeriod) << std::setw(11) << toMilliseconds(streamStatistics.maxPeriod)
+               << std::setw(11) << toMilliseconds(streamStatistics.jitter50) << std::setw(11) << toMilliseconds(streamStatistics.jitter95)
+               << std::setw(11) << toMilliseconds(streamStatistics.jitter99) << std::setw(11)
+               << (streamStatistics.largestGaps.empty() ? 0. : toMilliseconds(streamStatistics.largestGaps.front().duration))
+               << std::setw(11) << streamStatistics.numOutOfOrder << std::endl;
+    }
+    stream.flags(flags);
+    stream.precision(precision);
+}
+
+void StreamStatistics::writeJson(std::ostream& stream, const std::vector<StreamStatistics>& statistics)
+{
+    stream << "[";
+    for(size_t streamIdx = 0; streamIdx < statistics.size(); streamIdx++)
+    {
+        const StreamStatistics& streamStatistics = statistics[streamIdx];
+        stream << (streamIdx ? ",\n " : "\n ") << "{\"name\": ";
+        writeJsonString(stream, streamStatistics.name);
+        stream << ", \"samples\": " << streamStatistics.numSamples << ", \"first_time_us\": " << streamStatistics.firstTime.toMicroseconds()
+               << ", \"last_time_us\": " << streamStatistics.lastTime.toMicroseconds()
+               << ", \"mean_period_us\": " << streamStatistics.meanPeriod.toMicroseconds()
+               << ", \"min_period_us\": " << streamStatistics.minPeriod.toMicroseconds()
+               << ", \"median_period_us\": " << streamStatistics.medianPeriod.toMicroseconds()
+               << ", \"max_period_us\": " << streamStatistics.maxPeriod.toMicroseconds()
+               << ", \"jitter_us\": {\"p50\": " << streamStatistics.jitter50.toMicroseconds()
+               << ", \"p95\": " << streamStatistics.jitter95.toMicroseconds() << ", \"p99\": " << streamStatistics.jitter99.toMicroseconds()
+               << "}, \"largest_gaps\": [";
+        for(size_t gapIdx = 0; gapIdx < streamStatistics.largestGaps.size(); gapIdx++)
+        {
+            const Gap& gap = streamStatistics.largestGaps[gapIdx];
+            stream << (gapIdx ? ", " : "") << "{\"start_us\": " << gap.start.toMicroseconds()
+                   << ", \"duration_us\": " << gap.duration.toMicroseconds() << "}";
+        }
+        stream << "], \"out_of_order\": " << streamStatistics.numOutOfOrder << "}";
+    }
+    stream << (statistics.empty() ? "]" : "\n]") << std::endl;
+}
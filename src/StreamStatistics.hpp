@@ -0,0 +1,140 @@
+#pragma once
+
+#include <base/Time.hpp>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Timing statistics of a stream, computed from the timestamps of its index without reading sample payloads.
+ * Periods are the differences between consecutive timestamps in logfile order. A timestamp before its predecessor
+ * is counted as out of order and its negative period is left out of the period statistics.
+ * Jitter is the absolute deviation of a period from the median period.
+ *
+ */
+struct StreamStatistics
+{
+    /**
+     * @brief Period between two consecutive samples.
+     *
+     */
+    struct Gap
+    {
+        /**
+         * @brief Timestamp of the sample before the gap.
+         *
+         */
+        base::Time start;
+
+        /**
+         * @brief Length of the gap.
+         *
+         */
+        base::Time duration;
+    };
+
+    /**
+     * @brief Name of the stream.
+     *
+     */
+    std::string name;
+
+    /**
+     * @brief Number of samples.
+     *
+     */
+    size_t numSamples = 0;
+
+    /**
+     * @brief Timestamp of the first sample in logfile order.
+     *
+     */
+    base::Time firstTime;
+
+    /**
+     * @brief Timestamp of the last sample in logfile order.
+     *
+     */
+    base::Time lastTime;
+
+    /**
+     * @brief Mean period.
+     *
+     */
+    base::Time meanPeriod;
+
+    /**
+     * @brief Smallest period, 0 for duplicate timestamps.
+     *
+     */
+    base::Time minPeriod;
+
+    /**
+     * @brief Median period.
+     *
+     */
+    base::Time medianPeriod;
+
+    /**
+     * @brief Largest period.
+     *
+     */
+    base::Time maxPeriod;
+
+    /**
+     * @brief Median jitter.
+     *
+     */
+    base::Time jitter50;
+
+    /**
+     * @brief 95th percentile of the jitter.
+     *
+     */
+    base::Time jitter95;
+
+    /**
+     * @brief 99th percentile of the jitter.
+     *
+     */
+    base::Time jitter99;
+
+    /**
+     * @brief Largest periods, the largest first.
+     *
+     */
+    std::vector<Gap> largestGaps;
+
+    /**
+     * @brief Number of timestamps before the timestamp of their preceding sample.
+     *
+     */
+    size_t numOutOfOrder = 0;
+
+    /**
+     * @brief Computes the statistics of a stream. Runs in linear time, so that large streams are processed in seconds.
+     *
+     * @param name: Name of the stream.
+     * @param times: Timestamps in microseconds, in logfile order.
+     * @param numGaps: Number of largest gaps to keep.
+     * @return StreamStatistics Statistics of the stream.
+     */
+    static StreamStatistics compute(const std::string& name, const std::vector<int64_t>& times, size_t numGaps = 3);
+
+    /**
+     * @brief Writes the statistics as a table, with periods and jitter in milliseconds.
+     *
+     * @param stream: Stream to write to.
+     * @param statistics: Statistics of all streams.
+     */
+    static void writeTable(std::ostream& stream, const std::vector<StreamStatistics>& statistics);
+
+    /**
+     * @brief Writes the statistics as JSON array of stream objects, with times and durations in microseconds.
+     *
+     * @param stream: Stream to write to.
+     * @param statistics: Statistics of all streams.
+     */
+    static void writeJson(std::ostream& stream, const std::vector<StreamStatistics>& statistics);
+};
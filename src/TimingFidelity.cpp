@@ -0,0 +1,151 @@
+#include "TimingFidelity.hpp"
+
+#include <algorithm>
+
+TimingFidelity::TimingFidelity(std::chrono::nanoseconds interval, size_t maxPoints)
+    : interval(interval)
+    , initialInterval(interval)
+    , maxPoints(std::max<size_t>(2, maxPoints))
+{
+    reset();
+}
+
+void TimingFidelity::record(
+    size_t streamIdx, const std::string& streamName, const base::Time& logTime, std::chrono::nanoseconds lateness,
+    Clock::time_point publishTime)
+{
+    total.record(lateness.count());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if(streamIdx >= streams.size())
+    {
+        streams.resize(streamIdx + 1);
+    }
+
+    auto& stream = streams[streamIdx];
+    if(!stream)
+    {
+        stream.reset(new StreamLateness());
+        stream->name = streamName;
+    }
+    stream->lateness.record(lateness.count());
+
+    if(timeSeries.empty() && !curPoint.samples)
+    {
+        firstPublishTime = publishTime;
+    }
+
+    // samples after a pause start a new point at the interval they fall into
+    const auto wallTime = std::chrono::duration_cast<std::chrono::nanoseconds>(publishTime - firstPublishTime);
+    if(wallTime >= curPoint.wallTime + interval)
+    {
+        finishPoint();
+        curPoint.wallTime = wallTime / interval * interval;
+
+        // after merging, the sample may fall into the interval of the last finished point, which is continued
+        if(!timeSeries.empty() && timeSeries.back().wallTime == curPoint.wallTime)
+        {
+            curPoint = timeSeries.back();
+            curLatenessSum = curPoint.meanLateness * static_cast<int64_t>(curPoint.samples);
+            timeSeries.pop_back();
+        }
+    }
+
+    const auto clampedLateness = std::max(lateness, std::chrono::nanoseconds::zero());
+    if(!curPoint.samples)
+    {
+        curPoint.logTime = logTime;
+    }
+    curPoint.samples++;
+    curLatenessSum += clampedLateness;
+    curPoint.maxLateness = std::max(curPoint.maxLateness, clampedLateness);
+}
+
+void TimingFidelity::finishPoint()
+{
+    if(curPoint.samples)
+    {
+        curPoint.meanLateness = curLatenessSum / static_cast<int64_t>(curPoint.samples);
+        timeSeries.push_back(curPoint);
+    }
+    curPoint = Point{base::Time(), curPoint.wallTime, 0, std::chrono::nanoseconds::zero(), std::chrono::nanoseconds::zero()};
+    curLatenessSum = std::chrono::nanoseconds::zero();
+
+    if(timeSeries.size() < maxPoints)
+    {
+        return;
+    }
+
+    // the points of each doubled interval are merged, weighting their means by their number of samples
+    interval *= 2;
+    std::vector<Point> merged;
+    for(const Point& point : timeSeries)
+    {
+        const auto start = point.wallTime / interval * interval;
+        if(merged.empty() || merged.back().wallTime != start)
+        {
+            merged.push_back(point);
+            merged.back().wallTime = start;
+            continue;
+        }
+
+        Point& mergedPoint = merged.back();
+        const uint64_t samples = mergedPoint.samples + point.samples;
+        mergedPoint.meanLateness =
+            (mergedPoint.meanLateness * static_cast<int64_t>(mergedPoint.samples) + point.meanLateness * static_cast<int64_t>(point.samples)) /
+            static_cast<int64_t>(samples);
+        mergedPoint.maxLateness = std::max(mergedPoint.maxLateness, point.maxLateness);
+        mergedPoint.samples = samples;
+    }
+    timeSeries.swap(merged);
+}
+
+TimingFidelity::Report TimingFidelity::getReport()
+{
+    Report report;
+    report.total = total.getSummary();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for(const auto& stream : streams)
+    {
+        if(stream)
+        {
+            report.streams.emplace(stream->name, stream->lateness.getSummary());
+        }
+    }
+
+    report.timeSeries = timeSeries;
+    if(curPoint.samples)
+    {
+        report.timeSeries.push_back(curPoint);
+        report.timeSeries.back().meanLateness = curLatenessSum / static_cast<int64_t>(curPoint.samples);
+    }
+    report.interval = interval;
+
+    return report;
+}
+
+void TimingFidelity::reset()
+{
+    total.reset();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    streams.clear();
+    timeSeries.clear();
+    curPoint = Point{base::Time(), std::chrono::nanoseconds::zero(), 0, std::chrono::nanoseconds::zero(), std::chrono::nanoseconds::zero()};
+    curLatenessSum = std::chrono::nanoseconds::zero();
+    interval = initialInterval;
+}
+
+void TimingFidelity::writeCsv(std::ostream& stream, const Report& report)
+{
+    auto toMilliseconds = [](std::chrono::nanoseconds duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+
+    stream << "wall_time_s,log_time_us,samples,mean_lateness_ms,max_lateness_ms\n";
+    for(const Point& point : report.timeSeries)
+    {
+        stream << std::chrono::duration<double>(point.wallTime).count() << "," << point.logTime.toMicroseconds() << "," << point.samples << ","
+               << toMilliseconds(point.meanLateness) << "," << toMilliseconds(point.maxLateness) << "\n";
+    }
+    stream.flush();
+}
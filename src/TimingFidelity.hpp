@@ -0,0 +1,235 @@
+#pragma once
+
+#include "LatencyHistogram.hpp"
+
+#include <base/Time.hpp>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Records the lateness of published samples, i.e. actual publish time minus the deadline derived from
+ * the log timestamp and the replay speed. Lateness is aggregated per stream and in total into histograms, and over
+ * wall time into a time series of fixed intervals. Early samples are counted with a lateness of 0.
+ * The time series is bounded: when it is full, neighbouring points are merged and the interval is doubled.
+ *
+ */
+class TimingFidelity
+{
+public:
+    /**
+     * @brief Monotonic clock of the publish times.
+     *
+     */
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Lateness of the samples published within an interval of wall time.
+     *
+     */
+    struct Point
+    {
+        /**
+         * @brief Log time of the first sample of the interval.
+         *
+         */
+        base::Time logTime;
+
+        /**
+         * @brief Wall time from the first recorded sample to the start of the interval.
+         *
+         */
+        std::chrono::nanoseconds wallTime;
+
+        /**
+         * @brief Number of samples published within the interval.
+         *
+         */
+        uint64_t samples;
+
+        /**
+         * @brief Mean lateness of the samples.
+         *
+         */
+        std::chrono::nanoseconds meanLateness;
+
+        /**
+         * @brief Largest lateness of the samples.
+         *
+         */
+        std::chrono::nanoseconds maxLateness;
+    };
+
+    /**
+     * @brief Lateness of all recorded samples.
+     *
+     */
+    struct Report
+    {
+        /**
+         * @brief Lateness of the samples of all streams.
+         *
+         */
+        LatencyHistogram::Summary total;
+
+        /**
+         * @brief Map of stream names to the lateness of their samples.
+         *
+         */
+        std::map<std::string, LatencyHistogram::Summary> streams;
+
+        /**
+         * @brief Lateness over wall time, in the order of the intervals. The last point may cover a partial interval.
+         *
+         */
+        std::vector<Point> timeSeries;
+
+        /**
+         * @brief Wall time covered by each point of the time series.
+         *
+         */
+        std::chrono::nanoseconds interval;
+    };
+
+    /**
+     * @brief Constructor.
+     *
+     * @param interval: Wall time covered by each point of the time series.
+     * @param maxPoints: Maximum number of points of the time series, at least 2.
+     */
+    TimingFidelity(std::chrono::nanoseconds interval = std::chrono::seconds(1), size_t maxPoints = 3600);
+
+    /**
+     * @brief Records the lateness of a published sample.
+     *
+     * @param streamIdx: Index of the sample's stream, used to look up the stream without comparing names.
+     * @param streamName: Name of the sample's stream, only copied when the stream is recorded for the first time.
+     * @param logTime: Log time of the sample.
+     * @param lateness: Publish time minus deadline of the sample.
+     * @param publishTime: Wall time at which the sample was published.
+     */
+    void record(
+        size_t streamIdx, const std::string& streamName, const base::Time& logTime, std::chrono::nanoseconds lateness,
+        Clock::time_point publishTime = Clock::now());
+
+    /**
+     * @brief Returns the lateness of all samples recorded since the last reset.
+     *
+     * @return Report Lateness in total, per stream and over time.
+     */
+    Report getReport();
+
+    /**
+     * @brief Returns the lateness of all samples recorded since the last reset, without per-stream statistics and time series.
+     *
+     * @return LatencyHistogram::Summary Lateness of the samples of all streams.
+     */
+    LatencyHistogram::Summary getTotal() const
+    {
+        return total.getSummary();
+    };
+
+    /**
+     * @brief Removes all recorded samples.
+     *
+     */
+    void reset();
+
+    /**
+     * @brief Writes the time series of a report as CSV, with one line per point and the lateness in milliseconds.
+     *
+     * @param stream: Stream to write to.
+     * @param report: Report to write.
+     */
+    static void writeCsv(std::ostream& stream, const Report& report);
+
+private:
+    /**
+     * @brief Lateness of the samples of a stream.
+     *
+     */
+    struct StreamLateness
+    {
+        /**
+         * @brief Name of the stream.
+         *
+         */
+        std::string name;
+
+        /**
+         * @brief Lateness of the stream's samples.
+         *
+         */
+        LatencyHistogram lateness;
+    };
+
+    /**
+     * @brief Finishes the current point of the time series and merges neighbouring points if the time series is full.
+     *
+     */
+    void finishPoint();
+
+    /**
+     * @brief Mutex to lock the streams and the time series, which are read from other threads.
+     *
+     */
+    std::mutex mutex;
+
+    /**
+     * @brief Lateness of the samples of all streams.
+     *
+     */
+    LatencyHistogram total;
+
+    /**
+     * @brief Lateness per stream, addressed by stream index. Streams without samples are nullptr.
+     *
+     */
+    std::vector<std::unique_ptr<StreamLateness>> streams;
+
+    /**
+     * @brief Finished points of the time series.
+     *
+     */
+    std::vector<Point> timeSeries;
+
+    /**
+     * @brief Current point of the time series.
+     *
+     */
+    Point curPoint;
+
+    /**
+     * @brief Sum of the lateness of the samples of the current point.
+     *
+     */
+    std::chrono::nanoseconds curLatenessSum;
+
+    /**
+     * @brief Publish time of the first recorded sample.
+     *
+     */
+    Clock::time_point firstPublishTime;
+
+    /**
+     * @brief Wall time covered by each point of the time series.
+     *
+     */
+    std::chrono::nanoseconds interval;
+
+    /**
+     * @brief Wall time covered by each point at construction, restored on reset.
+     *
+     */
+    std::chrono::nanoseconds initialInterval;
+
+    /**
+     * @brief Maximum number of points of the time series.
+     *
+     */
+    size_t maxPoints;
+};
@@ -0,0 +1,67 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+void WorkerPool::forEach(size_t numItems, const std::function<void(size_t)>& work, const std::function<void(size_t)>& progress, size_t numThreads)
+{
+    if(!numThreads)
+    {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    std::atomic<size_t> nextItem(0);
+    size_t finishedItems = 0;
+    std::mutex finishedMutex;
+    std::condition_variable itemFinished;
+
+    auto processItems = [&]() {
+        for(size_t item = nextItem++; item < numItems; item = nextItem++)
+        {
+            work(item);
+
+            {
+                std::lock_guard<std::mutex> lock(finishedMutex);
+                finishedItems++;
+            }
+            itemFinished.notify_one();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < std::min(numThreads, numItems); i++)
+    {
+        threads.emplace_back(processItems);
+    }
+
+    // progress is reported from this thread, so that callers can update a gui
+    std::unique_lock<std::mutex> lock(finishedMutex);
+    size_t reportedItems = 0;
+    while(finishedItems < numItems)
+    {
+        itemFinished.wait_for(lock, std::chrono::milliseconds(100));
+        if(progress && finishedItems != reportedItems)
+        {
+            reportedItems = finishedItems;
+            lock.unlock();
+            progress(reportedItems);
+            lock.lock();
+        }
+    }
+    lock.unlock();
+
+    for(auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    if(progress && reportedItems != numItems)
+    {
+        progress(numItems);
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * @brief Helper class to process independent work items on a bounded number of threads.
+ *
+ */
+class WorkerPool
+{
+public:
+    /**
+     * @brief Processes the given number of work items concurrently and waits until all are done.
+     * Exceptions must be handled within the work function.
+     *
+     * @param numItems: Number of work items.
+     * @param work: Function processing the work item with the given index. Is called from the worker threads.
+     * @param progress: Optional function receiving the number of finished items. Is called from the calling thread.
+     * @param numThreads: Maximum number of worker threads, 0 for the number of hardware threads.
+     */
+    static void forEach(
+        size_t numItems, const std::function<void(size_t)>& work, const std::function<void(size_t)>& progress = {}, size_t numThreads = 0);
+};
@@ -1,4 +1,5 @@
 #include "ArgParser.hpp"
+#include "IndexCache.hpp"
 
 #include <boost/test/unit_test.hpp>
 
@@ -53,3 +54,192 @@ BOOST_AUTO_TEST_CASE(TestRenaming)
     BOOST_TEST(argParser.renamings.size() == 1);
     BOOST_TEST(argParser.renamings.at("foo") == "bar");
 }
+
+BOOST_AUTO_TEST_CASE(TestMaxSpeed)
+{
+    ArgParser argParser;
+
+    const std::vector<std::string> args = {"test", "--headless", "--max-speed", "../logs/"};
+    char* argsResult[args.size() + 1];
+    createCommandLineArgs(argsResult, args);
+
+    bool result = argParser.parseArguments(args.size(), argsResult);
+
+    BOOST_TEST(result);
+    BOOST_TEST(argParser.headless);
+    BOOST_TEST(argParser.maxSpeed);
+}
+
+BOOST_AUTO_TEST_CASE(TestLockstep)
+{
+    ArgParser argParser;
+
+    const std::vector<std::string> args = {"test", "--headless", "--lockstep", "--lockstep-window", "4", "../logs/"};
+    char* argsResult[args.size() + 1];
+    createCommandLineArgs(argsResult, args);
+
+    bool result = argParser.parseArguments(args.size(), argsResult);
+
+    BOOST_TEST(result);
+    BOOST_TEST(argParser.lockstep);
+    BOOST_TEST(argParser.lockstepWindow == 4);
+    BOOST_TEST(!argParser.maxSpeed);
+}
+
+BOOST_AUTO_TEST_CASE(TestCacheSize)
+{
+    ArgParser argParser;
+    BOOST_TEST(argParser.cacheSize << 20 == IndexCache::defaultMaxSize);
+
+    const std::vector<std::string> args = {"test", "--cache-size", "512", "../logs/"};
+    char* argsResult[args.size() + 1];
+    createCommandLineArgs(argsResult, args);
+
+    bool result = argParser.parseArguments(args.size(), argsResult);
+
+    BOOST_TEST(result);
+    BOOST_TEST(argParser.cacheSize == 512);
+}
+
+BOOST_AUTO_TEST_CASE(TestTimeSpan)
+{
+    ArgParser argParser;
+
+    const std::vector<std::string> args = {"test", "--headless", "--prime-on-seek", "--start-time", "90.5", "--end-time", "14:32:05.120", "../logs/"};
+    char* argsResult[args.size() + 1];
+    createCommandLineArgs(argsResult, args);
+
+    bool result = argParser.parseArguments(args.size(), argsResult);
+
+    BOOST_TEST(result);
+    BOOST_TEST(argParser.primeOnSeek);
+    BOOST_TEST(argParser.startTime == "90.5");
+    BOOST_TEST(argParser.endTime == "14:32:05.120");
+}
+
+BOOST_AUTO_TEST_CASE(TestFollow)
+{
+    ArgParser argParser;
+
+    const std::vector<std::string> args = {"test", "--headless", "--follow", "../logs/"};
+    char* argsResult[args.size() + 1];
+    createCommandLineArgs(argsResult, args);
+
+    bool result = argParser.parseArguments(args.size(), argsResult);
+
+    BOOST_TEST(result);
+    BOOST_TEST(argParser.follow);
+    BOOST_TEST(argParser.startTime.empty());
+}
+
+BOOST_AUTO_TEST_CASE(TestExport)
+{
+    ArgParser argParser;
+
+    const std::vector<std::string> args = {"test", "--headless", "--export", "/tmp/span", "--start-time", "10", "../logs/"};
+    char* argsResult[args.size() + 1];
+    createCommandLineArgs(argsResult, args);
+
+    bool result = argParser.parseArguments(args.size(), argsResult);
+
+    BOOST_TEST(result);
+    BOOST_TEST(argParser.exportDirectory == "/tmp/span");
+    BOOST_TEST(argParser.startTime == "10");
+}
+
+BOOST_AUTO_TEST_CASE(TestStats)
+{
+    ArgParser argParser;
+
+    const std::vector<std::string> args = {"test", "--stats-json", "-", "../logs/"};
+    char* argsResult[args.size() + 1];
+    createCommandLineArgs(argsResult, args);
+
+    bool result = argParser.parseArguments(args.size(), argsResult);
+
+    BOOST_TEST(result);
+    BOOST_TEST(argParser.stats);
+    BOOST_TEST(argParser.statsJsonFile == "-");
+}
+
+BOOST_AUTO_TEST_CASE(TestTimingCsv)
+{
+    ArgParser argParser;
+
+    const std::vector<std::string> args = {"test", "--timing-csv", "timing.csv", "../logs/"};
+    char* argsResult[args.size() + 1];
+    createCommandLineArgs(argsResult, args);
+
+    bool result = argParser.parseArguments(args.size(), argsResult);
+
+    BOOST_TEST(result);
+    BOOST_TEST(argParser.timingCsvFile == "timing.csv");
+    BOOST_TEST(!argParser.stats);
+}
+
+BOOST_AUTO_TEST_CASE(TestCatchUp)
+{
+    ArgParser argParser;
+
+    const std::vector<std::string> args = {"test", "--catch-up", "drop", "--droppable", ".*camera.*,.*lidar", "../logs/"};
+    char* argsResult[args.size() + 1];
+    createCommandLineArgs(argsResult, args);
+
+    bool result = argParser.parseArguments(args.size(), argsResult);
+
+    BOOST_TEST(result);
+    BOOST_TEST(argParser.catchUp == "drop");
+    BOOST_TEST(argParser.droppablePorts.size() == 2);
+    BOOST_TEST(argParser.droppablePorts[1] == ".*lidar");
+}
+
+BOOST_AUTO_TEST_CASE(TestInvalidCatchUp)
+{
+    ArgParser argParser;
+
+    const std::vector<std::string> args = {"test", "--catch-up", "skip", "../logs/"};
+    char* argsResult[args.size() + 1];
+    createCommandLineArgs(argsResult, args);
+
+    BOOST_TEST(!argParser.parseArguments(args.size(), argsResult));
+}
+
+BOOST_AUTO_TEST_CASE(TestAutoSpeed)
+{
+    ArgParser argParser;
+
+    const std::vector<std::string> args = {"test", "--auto-speed", "2.5", "../logs/"};
+    char* argsResult[args.size() + 1];
+    createCommandLineArgs(argsResult, args);
+
+    bool result = argParser.parseArguments(args.size(), argsResult);
+
+    BOOST_TEST(result);
+    BOOST_TEST(argParser.autoSpeedLag == 2.5);
+}
+
+BOOST_AUTO_TEST_CASE(TestDecimate)
+{
+    ArgParser argParser;
+
+    const std::vector<std::string> args = {"test", "--decimate", ".*camera.*:10", "--decimate", "task:.*:5Hz", "../logs/"};
+    char* argsResult[args.size() + 1];
+    createCommandLineArgs(argsResult, args);
+
+    bool result = argParser.parseArguments(args.size(), argsResult);
+    const std::vector<std::pair<std::string, std::string>> decimations = {{".*camera.*", "10"}, {"task:.*", "5Hz"}};
+
+    BOOST_TEST(result);
+    BOOST_TEST((argParser.decimations == decimations));
+}
+
+BOOST_AUTO_TEST_CASE(TestInvalidDecimate)
+{
+    ArgParser argParser;
+
+    const std::vector<std::string> args = {"test", "--decimate", ".*camera.*", "../logs/"};
+    char* argsResult[args.size() + 1];
+    createCommandLineArgs(argsResult, args);
+
+    BOOST_TEST(!argParser.parseArguments(args.size(), argsResult));
+}
@@ -0,0 +1,133 @@
+#include "CompressedLogFile.hpp"
+
+#include "FileLocationHandler.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <pocolog_cpp/InputDataStream.hpp>
+#include <pocolog_cpp/LogFile.hpp>
+#include <sys/stat.h>
+#include <zstd.h>
+
+const std::string compressedTestLog = getLogFilePath() + "trajectory_follower_Logger.0.log";
+const boost::filesystem::path compressedTestFolder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+
+static std::vector<char> readFile(const std::string& fileName)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+BOOST_AUTO_TEST_CASE(TestCompressedLogSamples)
+{
+    boost::filesystem::create_directories(compressedTestFolder);
+    const std::string fileName = (compressedTestFolder / "trajectory_follower_Logger.0.log.zst").string();
+    BOOST_REQUIRE(CompressedLogFile::compress(compressedTestLog, fileName, 4096));
+    BOOST_TEST(CompressedLogFile::isCompressedLog(fileName));
+    BOOST_TEST(!CompressedLogFile::isCompressedLog(compressedTestLog));
+    BOOST_TEST(boost::filesystem::file_size(fileName) < boost::filesystem::file_size(compressedTestLog));
+
+    // a small cache forces frames to be decompressed again
+    CompressedLogFile compressedLog(fileName, 2);
+    pocolog_cpp::LogFile headerLog(compressedLog.getHeaderLogFileName(), false);
+    pocolog_cpp::LogFile logFile(compressedTestLog, false);
+    BOOST_REQUIRE(headerLog.getStreams().size() == logFile.getStreams().size());
+
+    size_t numSamples = 0;
+    std::vector<uint8_t> compressedData;
+    std::vector<uint8_t> data;
+    for(size_t streamIdx = 0; streamIdx < logFile.getStreams().size(); streamIdx++)
+    {
+        auto stream = dynamic_cast<pocolog_cpp::InputDataStream*>(logFile.getStreams()[streamIdx]);
+        auto headerStream = dynamic_cast<pocolog_cpp::InputDataStream*>(headerLog.getStreams()[streamIdx]);
+        BOOST_REQUIRE(stream);
+        BOOST_REQUIRE(headerStream);
+        BOOST_TEST(headerStream->getName() == stream->getName());
+        BOOST_TEST(headerStream->getCXXType() == stream->getCXXType());
+        BOOST_REQUIRE(headerStream->getSize() == stream->getSize());
+
+        for(size_t sampleNr = 0; sampleNr < stream->getSize(); sampleNr++)
+        {
+            BOOST_REQUIRE(stream->getSampleData(data, sampleNr));
+            BOOST_REQUIRE(compressedLog.getSampleData(stream->getIndex(), sampleNr, compressedData));
+            BOOST_TEST(compressedData == data);
+            numSamples++;
+        }
+
+        BOOST_TEST(!compressedLog.getSampleData(stream->getIndex(), stream->getSize(), compressedData));
+    }
+
+    BOOST_TEST(numSamples == 849);
+    BOOST_TEST(compressedLog.getNumDecompressedFrames() > 0);
+
+    // the header log is extracted once, reopening the logfile only marks it as used for the cache eviction
+    const std::string headerLogFileName = compressedLog.getHeaderLogFileName();
+    struct stat headerLogStat;
+    BOOST_REQUIRE(!stat(headerLogFileName.c_str(), &headerLogStat));
+    boost::filesystem::last_write_time(headerLogFileName, std::time(nullptr) - 100);
+    CompressedLogFile reopenedLog(fileName);
+    BOOST_TEST(reopenedLog.getHeaderLogFileName() == headerLogFileName);
+    struct stat reopenedStat;
+    BOOST_REQUIRE(!stat(headerLogFileName.c_str(), &reopenedStat));
+    BOOST_TEST(reopenedStat.st_ino == headerLogStat.st_ino);
+    BOOST_TEST(boost::filesystem::last_write_time(headerLogFileName) >= std::time(nullptr) - 10);
+}
+
+BOOST_AUTO_TEST_CASE(TestCompressedLogSeeksBack)
+{
+    const std::string fileName = (compressedTestFolder / "trajectory_follower_Logger.0.log.zst").string();
+    CompressedLogFile compressedLog(fileName, 2);
+    pocolog_cpp::LogFile logFile(compressedTestLog, false);
+    auto stream = dynamic_cast<pocolog_cpp::InputDataStream*>(logFile.getStreams().front());
+    BOOST_REQUIRE(stream);
+    BOOST_REQUIRE(stream->getSize() > 3);
+
+    // samples at the start, middle and end of the log lie in different frames, the middle one is read again after the end
+    const size_t last = stream->getSize() - 1;
+    std::vector<uint8_t> compressedData;
+    std::vector<uint8_t> data;
+    for(size_t sampleNr : {size_t(0), last / 2, last, last / 2, size_t(0)})
+    {
+        BOOST_REQUIRE(stream->getSampleData(data, sampleNr));
+        BOOST_REQUIRE(compressedLog.getSampleData(stream->getIndex(), sampleNr, compressedData));
+        BOOST_TEST(compressedData == data);
+    }
+
+    // walking the log backwards reads each frame again after the cache held later ones
+    for(size_t sampleNr = stream->getSize(); sampleNr-- > 0;)
+    {
+        BOOST_REQUIRE(stream->getSampleData(data, sampleNr));
+        BOOST_REQUIRE(compressedLog.getSampleData(stream->getIndex(), sampleNr, compressedData));
+        BOOST_TEST(compressedData == data);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TestCompressedLogDecompressesWithZstd)
+{
+    const std::string fileName = (compressedTestFolder / "trajectory_follower_Logger.0.log.zst").string();
+    const std::vector<char> original = readFile(compressedTestLog);
+    const std::vector<char> compressed = readFile(fileName);
+
+    // zstd skips the index and the seek table, so the original logfile is restored
+    std::vector<char> decompressed(original.size() + 1);
+    const size_t size = ZSTD_decompress(decompressed.data(), decompressed.size(), compressed.data(), compressed.size());
+    BOOST_REQUIRE(!ZSTD_isError(size));
+    decompressed.resize(size);
+    BOOST_TEST((decompressed == original));
+}
+
+BOOST_AUTO_TEST_CASE(TestInvalidCompressedLog)
+{
+    const std::string fileName = (compressedTestFolder / "invalid.log.zst").string();
+    std::ofstream(fileName) << "no compressed logfile";
+
+    BOOST_CHECK_THROW(CompressedLogFile compressedLog(fileName), std::runtime_error);
+    BOOST_CHECK_THROW(CompressedLogFile compressedLog((compressedTestFolder / "missing.log.zst").string()), std::runtime_error);
+    BOOST_TEST(!CompressedLogFile::compress(fileName, (compressedTestFolder / "other.log.zst").string()));
+    BOOST_TEST(!boost::filesystem::exists(compressedTestFolder / "other.log.zst"));
+
+    boost::filesystem::remove_all(compressedTestFolder);
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "PocologWriter.hpp"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <pocolog_cpp/InputDataStream.hpp>
+#include <pocolog_cpp/LogFile.hpp>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/**
+ * @brief Logfile that grows like the logfile of a running logger. A copy of a source logfile is written with the PocologWriter,
+ * and the growing logfile receives its blocks up to a number of samples, so that it is a valid logfile after each growth.
+ *
+ */
+class GrowingLogFile
+{
+public:
+    /**
+     * @brief Writes the copy of the source logfile next to the growing logfile and starts the growing logfile with the
+     * stream declarations and the first samples.
+     *
+     * @param sourceFileName: Name of the copied logfile.
+     * @param fileName: Name of the growing logfile.
+     * @param numSamples: Number of samples the growing logfile starts with.
+     * @param byStream: True to copy the samples stream after stream, like a logger that holds back all but the first stream,
+     * false to copy them in the order of the source logfile.
+     */
+    GrowingLogFile(const std::string& sourceFileName, const std::string& fileName, size_t numSamples, bool byStream = false)
+        : fileName(fileName)
+        , copyFileName(boost::filesystem::path(fileName).replace_extension(".copy.log").string())
+    {
+        // (position, stream index) of the source samples, copied in the order of the source logfile
+        std::vector<std::pair<uint64_t, size_t>> sourceSamples;
+        std::vector<size_t> streamIdxs;
+        {
+            pocolog_cpp::LogFile source(sourceFileName, false);
+            for(pocolog_cpp::Stream* stream : source.getStreams())
+            {
+                if(dynamic_cast<pocolog_cpp::InputDataStream*>(stream))
+                {
+                    streamIdxs.push_back(stream->getIndex());
+                    appendSamplePositions(*stream, sourceSamples);
+                }
+            }
+        }
+        std::sort(sourceSamples.begin(), sourceSamples.end(), [byStream](const std::pair<uint64_t, size_t>& a, const std::pair<uint64_t, size_t>& b) {
+            return byStream ? std::tie(a.second, a.first) < std::tie(b.second, b.first) : a < b;
+        });
+
+        PocologWriter writer(sourceFileName, copyFileName);
+        bool written = writer.declareStreams(streamIdxs);
+        for(const auto& sourceSample : sourceSamples)
+        {
+            written &= writer.copySample(sourceSample.second, sourceSample.first);
+        }
+
+        if(!written || !writer.close())
+        {
+            return;
+        }
+
+        std::vector<std::pair<uint64_t, size_t>> copiedSamples;
+        {
+            pocolog_cpp::LogFile copy(copyFileName, false);
+            for(pocolog_cpp::Stream* stream : copy.getStreams())
+            {
+                appendSamplePositions(*stream, copiedSamples);
+            }
+        }
+        std::sort(copiedSamples.begin(), copiedSamples.end());
+        for(const auto& copiedSample : copiedSamples)
+        {
+            blockPositions.push_back(copiedSample.first);
+        }
+        blockPositions.push_back(boost::filesystem::file_size(copyFileName));
+
+        std::ofstream(fileName, std::ios::binary | std::ios::trunc);
+        grow(numSamples);
+    }
+
+    /**
+     * @brief Destructor. Removes the copy, the growing logfile is kept.
+     *
+     */
+    ~GrowingLogFile()
+    {
+        boost::system::error_code error;
+        boost::filesystem::remove(copyFileName, error);
+    }
+
+    /**
+     * @brief Appends the next samples of the copy to the growing logfile.
+     *
+     * @param numSamples: Number of appended samples.
+     * @return bool True if the samples were appended, false if the copy has fewer samples left or cannot be read.
+     */
+    bool grow(size_t numSamples)
+    {
+        if(blockPositions.empty() || numWritten + numSamples >= blockPositions.size())
+        {
+            return false;
+        }
+
+        // the first growth includes the prologue and the stream declarations before the first sample
+        const uint64_t end = blockPositions[numWritten + numSamples];
+        std::ifstream copy(copyFileName, std::ios::binary);
+        std::vector<char> blocks(end - writtenSize);
+        if(!copy.seekg(writtenSize) || !copy.read(blocks.data(), blocks.size()))
+        {
+            return false;
+        }
+
+        std::ofstream file(fileName, std::ios::binary | std::ios::app);
+        if(!file.write(blocks.data(), blocks.size()).flush())
+        {
+            return false;
+        }
+
+        numWritten += numSamples;
+        writtenSize = end;
+        return true;
+    }
+
+    /**
+     * @brief Returns the name of the growing logfile.
+     *
+     * @return const std::string& Name of the logfile.
+     */
+    const std::string& getFileName() const
+    {
+        return fileName;
+    };
+
+private:
+    /**
+     * @brief Appends the positions of a stream's sample blocks.
+     *
+     * @param stream: Stream whose samples are listed.
+     * @param samples: List of (position, stream index) to append to.
+     */
+    static void appendSamplePositions(pocolog_cpp::Stream& stream, std::vector<std::pair<uint64_t, size_t>>& samples)
+    {
+        for(size_t pos = 0; pos < stream.getSize(); pos++)
+        {
+            samples.emplace_back(static_cast<std::streamoff>(stream.getFileIndex().getSamplePos(pos)), stream.getIndex());
+        }
+    }
+
+    /**
+     * @brief Name of the growing logfile.
+     *
+     */
+    std::string fileName;
+
+    /**
+     * @brief Name of the complete copy of the source logfile.
+     *
+     */
+    std::string copyFileName;
+
+    /**
+     * @brief Positions of the sample blocks in the copy in file order, followed by its size.
+     *
+     */
+    std::vector<uint64_t> blockPositions;
+
+    /**
+     * @brief Number of samples written to the growing logfile.
+     *
+     */
+    size_t numWritten = 0;
+
+    /**
+     * @brief Size of the growing logfile in bytes.
+     *
+     */
+    uint64_t writtenSize = 0;
+};
@@ -0,0 +1,90 @@
+#include "IndexCache.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <vector>
+
+const boost::filesystem::path cacheTestFolder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+
+BOOST_AUTO_TEST_CASE(TestFnvHash)
+{
+    BOOST_TEST(IndexCache::hash("") == 14695981039346656037ull);
+    BOOST_TEST(IndexCache::hash("a") == 0xaf63dc4c8601ec8cull);
+    BOOST_TEST(IndexCache::hash("session") != IndexCache::hash("sessioN"));
+}
+
+BOOST_AUTO_TEST_CASE(TestSessionKeyChangesWithFile)
+{
+    boost::filesystem::create_directories(cacheTestFolder);
+    const std::string fileName = (cacheTestFolder / "test.log").string();
+    std::ofstream(fileName) << "samples";
+
+    const std::string key = IndexCache::getSessionKey({fileName}, {});
+    BOOST_TEST(IndexCache::getSessionKey({fileName}, {}) == key);
+
+    std::ofstream(fileName, std::ios::app) << " appended";
+    BOOST_TEST(IndexCache::getSessionKey({fileName}, {}) != key);
+
+    boost::filesystem::remove(fileName);
+    BOOST_TEST(IndexCache::getSessionKey({fileName}, {}) != key);
+}
+
+BOOST_AUTO_TEST_CASE(TestCacheFileLocation)
+{
+    // the tests run with a temporary cache home, which is restored afterwards
+    const std::string cacheHome = std::getenv("XDG_CACHE_HOME");
+    setenv("XDG_CACHE_HOME", cacheTestFolder.c_str(), 1);
+
+    const std::string fileName = IndexCache::getCacheFileName("key");
+    BOOST_TEST(boost::filesystem::path(fileName).parent_path() == cacheTestFolder / "rock_replay");
+    BOOST_TEST(boost::filesystem::is_directory(cacheTestFolder / "rock_replay"));
+    BOOST_TEST(IndexCache::getCacheFileName("other key") != fileName);
+    BOOST_TEST(boost::filesystem::path(fileName).extension() == ".idx");
+    BOOST_TEST(IndexCache::getCacheFileName("key", ".log") == boost::filesystem::path(fileName).replace_extension(".log").string());
+
+    setenv("XDG_CACHE_HOME", cacheHome.c_str(), 1);
+    boost::filesystem::remove_all(cacheTestFolder);
+}
+
+BOOST_AUTO_TEST_CASE(TestCacheEviction)
+{
+    const std::string cacheHome = std::getenv("XDG_CACHE_HOME");
+    setenv("XDG_CACHE_HOME", cacheTestFolder.c_str(), 1);
+    const uint64_t maxSize = IndexCache::getMaxSize();
+    IndexCache::setMaxSize(2500);
+
+    // four cache files of 1000 bytes, used one after the other
+    const std::vector<std::string> fileNames = {IndexCache::getCacheFileName("oldest"), IndexCache::getCacheFileName("old", ".log"),
+                                                IndexCache::getCacheFileName("new"), IndexCache::getCacheFileName("newest")};
+    const std::time_t now = std::time(nullptr);
+    for(size_t i = 0; i < fileNames.size(); i++)
+    {
+        std::ofstream(fileNames[i]) << std::string(1000, 'x');
+        boost::filesystem::last_write_time(fileNames[i], now - 100 + i);
+    }
+    const std::string otherFileName = (cacheTestFolder / "rock_replay" / "other.idx").string();
+    std::ofstream(otherFileName) << std::string(1000, 'x');
+    boost::filesystem::last_write_time(otherFileName, now - 200);
+
+    // the oldest file was used again, so the header log is the least recently used one
+    IndexCache::touch(fileNames[0]);
+    IndexCache::evict(fileNames[3]);
+    BOOST_TEST(boost::filesystem::exists(fileNames[0]));
+    BOOST_TEST(!boost::filesystem::exists(fileNames[1]));
+    BOOST_TEST(!boost::filesystem::exists(fileNames[2]));
+    BOOST_TEST(boost::filesystem::exists(fileNames[3]));
+    BOOST_TEST(boost::filesystem::exists(otherFileName));
+
+    // the written file is kept even if it does not fit into the cache
+    IndexCache::setMaxSize(0);
+    IndexCache::evict(fileNames[3]);
+    BOOST_TEST(!boost::filesystem::exists(fileNames[0]));
+    BOOST_TEST(boost::filesystem::exists(fileNames[3]));
+
+    IndexCache::setMaxSize(maxSize);
+    setenv("XDG_CACHE_HOME", cacheHome.c_str(), 1);
+    boost::filesystem::remove_all(cacheTestFolder);
+}
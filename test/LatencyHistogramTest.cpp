@@ -0,0 +1,125 @@
+#include "LatencyHistogram.hpp"
+
+#include <atomic>
+#include <boost/test/unit_test.hpp>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE(TestLatencyHistogramBuckets)
+{
+    // small durations are exact, larger ones are resolved with 16 sub-buckets per power of two
+    for(uint64_t value = 0; value < 16; value++)
+    {
+        BOOST_TEST(LatencyHistogram::getBucket(value) == value);
+        BOOST_TEST(LatencyHistogram::getBucketUpperBound(value) == value);
+    }
+
+    size_t lastBucket = 0;
+    for(uint64_t value = 16; value < (uint64_t(1) << 36); value = value * 5 / 4 + 1)
+    {
+        const size_t bucket = LatencyHistogram::getBucket(value);
+        BOOST_TEST(bucket >= lastBucket);
+        BOOST_TEST(LatencyHistogram::getBucketUpperBound(bucket) >= value);
+        BOOST_TEST(LatencyHistogram::getBucketUpperBound(bucket) - value <= value / 16);
+        BOOST_TEST(LatencyHistogram::getBucket(LatencyHistogram::getBucketUpperBound(bucket)) == bucket);
+        lastBucket = bucket;
+    }
+
+    BOOST_TEST(LatencyHistogram::getBucket(uint64_t(1) << 40) == LatencyHistogram::getBucket(~uint64_t(0)));
+}
+
+BOOST_AUTO_TEST_CASE(TestLatencyHistogramSummary)
+{
+    LatencyHistogram histogram;
+    BOOST_TEST(histogram.getSummary().count == 0);
+    BOOST_TEST(histogram.getSummary().p99.count() == 0);
+
+    for(int64_t value = 1; value <= 1000; value++)
+    {
+        histogram.record(value * 1000);
+    }
+    histogram.record(-5);
+
+    const auto summary = histogram.getSummary();
+    BOOST_TEST(summary.count == 1001);
+    BOOST_TEST(summary.mean.count() == 500000);
+    BOOST_TEST(summary.max.count() == 1000000);
+    BOOST_TEST(summary.p50.count() >= 500000);
+    BOOST_TEST(summary.p50.count() <= 500000 * 17 / 16);
+    BOOST_TEST(summary.p90.count() >= 900000);
+    BOOST_TEST(summary.p90.count() <= 900000 * 17 / 16);
+    BOOST_TEST(summary.p99.count() >= 990000);
+    BOOST_TEST(summary.p99.count() <= 1000000);
+
+    histogram.reset();
+    BOOST_TEST(histogram.getSummary().count == 0);
+    BOOST_TEST(histogram.getSummary().max.count() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(TestLatencyHistogramConcurrentReading)
+{
+    LatencyHistogram histogram;
+    std::atomic<bool> recording{true};
+    bool countDecreased = false;
+    std::thread reader([&histogram, &recording, &countDecreased]() {
+        uint64_t lastCount = 0;
+        while(recording)
+        {
+            const uint64_t count = histogram.getSummary().count;
+            countDecreased |= count < lastCount;
+            lastCount = count;
+        }
+    });
+    for(int64_t value = 0; value < 100000; value++)
+    {
+        histogram.record(value);
+    }
+    recording = false;
+    reader.join();
+    BOOST_TEST(!countDecreased);
+
+    const auto summary = histogram.getSummary();
+    BOOST_TEST(summary.count == 100000);
+    BOOST_TEST(summary.max.count() == 99999);
+}
+
+BOOST_AUTO_TEST_CASE(TestLatencyHistogramConcurrentRecording)
+{
+    LatencyHistogram histogram;
+    std::vector<std::thread> threads;
+    for(int thread = 0; thread < 4; thread++)
+    {
+        threads.emplace_back([&histogram, thread]() {
+            for(int64_t value = 0; value < 10000; value++)
+            {
+                histogram.recordShared(value + thread);
+            }
+        });
+    }
+    for(auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    const auto summary = histogram.getSummary();
+    BOOST_TEST(summary.count == 40000);
+    BOOST_TEST(summary.max.count() == 10002);
+}
+
+BOOST_AUTO_TEST_CASE(TestLatencyHistogramTimer)
+{
+    LatencyHistogram first;
+    LatencyHistogram second;
+    LatencyHistogram::Timer timer;
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    timer.lap(first);
+    timer.lap(second);
+
+    BOOST_TEST(first.getSummary().count == (LatencyHistogram::enabled ? 1 : 0));
+    BOOST_TEST(second.getSummary().count == (LatencyHistogram::enabled ? 1 : 0));
+    if(LatencyHistogram::enabled)
+    {
+        BOOST_TEST(first.getSummary().max.count() >= 2000000);
+        BOOST_TEST(second.getSummary().max.count() < first.getSummary().max.count());
+    }
+}
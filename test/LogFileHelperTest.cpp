@@ -68,3 +68,49 @@ BOOST_AUTO_TEST_CASE(TestStreamNameEmpty)
 {
     testStreamSplit("", "", "");
 }
+
+BOOST_AUTO_TEST_CASE(TestParseTime)
+{
+    base::Time logStart;
+    BOOST_TEST(LogFileHelper::parseTime("20161118-12:08:20:786284", base::Time(), logStart));
+
+    base::Time time;
+    BOOST_TEST(LogFileHelper::parseTime("90.5", logStart, time));
+    BOOST_TEST((time - logStart).toMicroseconds() == 90500000);
+
+    BOOST_TEST(LogFileHelper::parseTime("12:08:21.5", logStart, time));
+    BOOST_TEST((time - logStart).toMicroseconds() == 713716);
+
+    BOOST_TEST(LogFileHelper::parseTime("20161118-12:08:20.786", logStart, time));
+    BOOST_TEST((logStart - time).toMicroseconds() == 284);
+}
+
+BOOST_AUTO_TEST_CASE(TestParseInvalidTime)
+{
+    base::Time time;
+    BOOST_TEST(!LogFileHelper::parseTime("12:08", base::Time(), time));
+    BOOST_TEST(!LogFileHelper::parseTime("yesterday", base::Time(), time));
+    BOOST_TEST(!LogFileHelper::parseTime("", base::Time(), time));
+}
+
+BOOST_AUTO_TEST_CASE(TestParseDecimation)
+{
+    uint64_t keepEvery;
+    double maxRate;
+    BOOST_TEST(LogFileHelper::parseDecimation("10", keepEvery, maxRate));
+    BOOST_TEST(keepEvery == 10);
+    BOOST_TEST(maxRate == 0);
+
+    BOOST_TEST(LogFileHelper::parseDecimation(" 2.5 Hz", keepEvery, maxRate));
+    BOOST_TEST(keepEvery == 1);
+    BOOST_TEST(maxRate == 2.5);
+
+    BOOST_TEST(LogFileHelper::parseDecimation("", keepEvery, maxRate));
+    BOOST_TEST(keepEvery == 1);
+    BOOST_TEST(maxRate == 0);
+
+    BOOST_TEST(!LogFileHelper::parseDecimation("0", keepEvery, maxRate));
+    BOOST_TEST(!LogFileHelper::parseDecimation("0Hz", keepEvery, maxRate));
+    BOOST_TEST(!LogFileHelper::parseDecimation("-3", keepEvery, maxRate));
+    BOOST_TEST(!LogFileHelper::parseDecimation("fast", keepEvery, maxRate));
+}
@@ -0,0 +1,34 @@
+#include "LogFileWatcher.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <fstream>
+
+BOOST_AUTO_TEST_CASE(TestLogFileWatcherNotifiesWrites)
+{
+    const std::string fileName = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+    std::ofstream file(fileName);
+
+    LogFileWatcher watcher;
+    BOOST_REQUIRE(watcher.watch({fileName}));
+    BOOST_TEST(!watcher.waitForChanges(std::chrono::milliseconds(10)));
+
+    file << "sample" << std::flush;
+    BOOST_TEST(watcher.waitForChanges(std::chrono::milliseconds(1000)));
+
+    // the notification was consumed
+    BOOST_TEST(!watcher.waitForChanges(std::chrono::milliseconds(10)));
+
+    file.close();
+    boost::filesystem::remove(fileName);
+}
+
+BOOST_AUTO_TEST_CASE(TestLogFileWatcherFallsBackToTimeout)
+{
+    LogFileWatcher watcher;
+    BOOST_TEST(!watcher.watch({"/nonexistent/file.log"}));
+
+    const auto start = std::chrono::steady_clock::now();
+    BOOST_TEST(watcher.waitForChanges(std::chrono::milliseconds(20)));
+    BOOST_TEST((std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20)));
+}
@@ -1,10 +1,14 @@
 #include "LogTaskManager.hpp"
 
 #include "FileLocationHandler.hpp"
+#include "GrowingLogFile.hpp"
 #include "LogFileHelper.hpp"
 
+#include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
+#include <iomanip>
 #include <set>
+#include <sstream>
 
 const std::string logFolder = getLogFilePath();
 const auto fileNames = LogFileHelper::parseFileNames({logFolder + "trajectory_follower_Logger.0.log"});
@@ -12,7 +16,7 @@ LogTaskManager manager;
 
 BOOST_AUTO_TEST_CASE(TestEmptyLoading)
 {
-    manager.init({}, "");
+    BOOST_TEST(manager.init({}, ""));
     BOOST_TEST(!manager.getNumSamples());
 }
 
@@ -21,7 +25,7 @@ BOOST_AUTO_TEST_CASE(TestSpawnTrajectoryFollower)
     const std::set<std::pair<std::string, std::string>> portsWithTypes = {
         {"follower_data", "/trajectory_follower/FollowerData"}, {"motion_command", "/base/commands/Motion2D"}, {"state", "int"}};
 
-    manager.init(fileNames, "");
+    BOOST_TEST(manager.init(fileNames, ""));
 
     auto tasks = manager.getTaskCollection();
     auto trajectoryFollowerTask = tasks.at("trajectory_follower");
@@ -41,6 +45,28 @@ BOOST_AUTO_TEST_CASE(TestTaskMetaData)
     BOOST_TEST(!metadata.timeStamp.isNull());
 }
 
+BOOST_AUTO_TEST_CASE(TestIndexForTime)
+{
+    const auto sampleTime = manager.setIndex(250).timeStamp;
+    const size_t index = manager.getIndexForTime(sampleTime);
+
+    BOOST_TEST(index <= 250);
+    BOOST_TEST(manager.getSampleTime(index) == sampleTime);
+    BOOST_TEST(manager.getIndexForTime(base::Time()) == 0);
+    BOOST_TEST(manager.getIndexForTime(manager.getSampleTime(848) + base::Time::fromMicroseconds(1)) == 849);
+    BOOST_TEST(manager.getSampleTime(849).isNull());
+}
+
+BOOST_AUTO_TEST_CASE(TestPrimeStreams)
+{
+    BOOST_TEST(manager.primeStreams(0) == 0);
+    BOOST_TEST(manager.primeStreams(849) == 0);
+
+    const size_t primedSamples = manager.primeStreams(848);
+    BOOST_TEST(primedSamples > 0);
+    BOOST_TEST(primedSamples <= 3);
+}
+
 BOOST_AUTO_TEST_CASE(TestInvalidTaskMetaData)
 {
     auto metadata = manager.setIndex(1000);
@@ -63,6 +89,55 @@ BOOST_AUTO_TEST_CASE(TestTaskActivateReplayForPort)
     BOOST_TEST(!replayedSampleDeactivated);
 }
 
+BOOST_AUTO_TEST_CASE(TestTaskDecimation)
+{
+    std::vector<size_t> keptIndexes;
+    std::vector<size_t> decimatedIndexes;
+    auto collectIndexes = [&]()
+    {
+        keptIndexes.clear();
+        decimatedIndexes.clear();
+        for(size_t index = 0; index < manager.getNumSamples(); index++)
+        {
+            const auto metadata = manager.setIndex(index);
+            if(metadata.portName == "trajectory_follower.motion_command")
+            {
+                (metadata.decimated ? decimatedIndexes : keptIndexes).push_back(index);
+            }
+        }
+    };
+
+    manager.activateReplayForPort("trajectory_follower", "motion_command", true);
+    BOOST_TEST(manager.setDecimationForPort("trajectory_follower", "motion_command", {3, 0}) == 3);
+    BOOST_TEST(manager.getDecimationForPort("trajectory_follower", "motion_command") == 3);
+    BOOST_TEST(manager.setDecimationForPort("trajectory_follower", "foo", {3, 0}) == 0);
+
+    collectIndexes();
+    const size_t samples = keptIndexes.size() + decimatedIndexes.size();
+    BOOST_TEST(samples > 3);
+    BOOST_TEST(keptIndexes.size() == (samples + 2) / 3);
+
+    manager.setIndex(keptIndexes.front());
+    BOOST_TEST(manager.replaySample());
+    manager.setIndex(decimatedIndexes.front());
+    BOOST_TEST(!manager.replaySample());
+
+    BOOST_TEST(manager.setDecimationForPort("trajectory_follower", "motion_command", {1, 0}) == 1);
+    collectIndexes();
+    BOOST_TEST(decimatedIndexes.empty());
+    BOOST_TEST(keptIndexes.size() == samples);
+}
+
+BOOST_AUTO_TEST_CASE(TestTaskDecimationRules)
+{
+    manager.setDecimations({{".*motion_command", {2, 0}}});
+    manager.init(fileNames, "");
+    manager.setDecimations({});
+
+    BOOST_TEST(manager.getDecimationForPort("trajectory_follower", "motion_command") == 2);
+    BOOST_TEST(manager.getDecimationForPort("trajectory_follower", "state") == 1);
+}
+
 BOOST_AUTO_TEST_CASE(TestTaskWhitelist)
 {
     manager.init(fileNames, "", {"foo"});
@@ -79,4 +154,185 @@ BOOST_AUTO_TEST_CASE(TestTaskRenaming)
 
     bool containsRenamedTask = taskCollection.find("foo") != taskCollection.end();
     BOOST_TEST(containsRenamedTask);
-}
\ No newline at end of file
+}
+
+BOOST_AUTO_TEST_CASE(TestRenamedTaskActivateReplayForPort)
+{
+    manager.activateReplayForPort("foo", "motion_command", false);
+    manager.setIndex(250);
+    bool replayedSampleDeactivated = manager.replaySample();
+
+    manager.activateReplayForPort("foo", "motion_command", true);
+    manager.setIndex(250);
+    bool replayedSampleActivated = manager.replaySample();
+
+    BOOST_TEST(!replayedSampleDeactivated);
+    BOOST_TEST(replayedSampleActivated);
+    BOOST_TEST(manager.getTaskCollection().size() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(TestMultiFileLoading)
+{
+    manager.init(LogFileHelper::parseFileNames({logFolder}), "");
+
+    auto tasks = manager.getTaskCollection();
+    BOOST_TEST(manager.getNumSamples() >= 849);
+    BOOST_TEST((tasks.find("trajectory_follower") != tasks.end()));
+
+    // loading again only hits the typekit cache
+    manager.init(fileNames, "");
+    BOOST_TEST(manager.getNumSamples() == 849);
+}
+
+BOOST_AUTO_TEST_CASE(TestTimeWindowLoading)
+{
+    manager.init(fileNames, "");
+    const base::Time logStart = manager.getSampleTime(0);
+    const base::Time windowStart = manager.getSampleTime(200);
+    const base::Time windowEnd = manager.getSampleTime(600);
+    const size_t numWindowSamples = manager.getIndexForTime(windowEnd + base::Time::fromMicroseconds(1)) - manager.getIndexForTime(windowStart);
+
+    std::ostringstream start;
+    std::ostringstream end;
+    start << std::fixed << std::setprecision(6) << (windowStart - logStart).toSeconds();
+    end << std::fixed << std::setprecision(6) << (windowEnd - logStart).toSeconds();
+    manager.init(fileNames, "", {}, {}, {}, {start.str(), end.str()});
+
+    BOOST_TEST(manager.getNumSamples() == numWindowSamples);
+    BOOST_TEST(manager.getSampleTime(0) == windowStart);
+    BOOST_TEST(manager.getSampleTime(numWindowSamples - 1) == windowEnd);
+    BOOST_TEST(manager.setIndex(numWindowSamples - 1).valid);
+    BOOST_TEST(manager.getTaskCollection().size() == 1);
+
+    // logfiles outside of the window are skipped
+    manager.init(LogFileHelper::parseFileNames({logFolder}), "", {}, {}, {}, {"20000101-00:00:00", "20000101-00:00:01"});
+    BOOST_TEST(!manager.getNumSamples());
+    BOOST_TEST(manager.getTaskCollection().empty());
+}
+
+BOOST_AUTO_TEST_CASE(TestCompressedLogLoading)
+{
+    const boost::filesystem::path folder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(folder);
+    const std::string compressedFileName = (folder / "trajectory_follower_Logger.0.log.zst").string();
+    BOOST_REQUIRE(CompressedLogFile::compress(fileNames.front(), compressedFileName, 4096));
+
+    manager.init(fileNames, "");
+    const base::Time sampleTime = manager.getSampleTime(250);
+
+    // the compressed logfile is found in its folder and replays the same samples
+    manager.init(LogFileHelper::parseFileNames({folder.string() + "/"}), "");
+    BOOST_TEST(manager.getNumSamples() == 849);
+    BOOST_TEST(manager.getSampleTime(250) == sampleTime);
+    BOOST_TEST(manager.getTaskCollection().size() == 1);
+
+    auto metadata = manager.setIndex(250);
+    BOOST_TEST(metadata.valid);
+    BOOST_TEST(metadata.portName == "trajectory_follower.motion_command");
+
+    manager.clear();
+    boost::filesystem::remove_all(folder);
+}
+
+BOOST_AUTO_TEST_CASE(TestAppendNewSamples)
+{
+    const boost::filesystem::path folder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(folder);
+    GrowingLogFile growingLog(fileNames.front(), (folder / "trajectory_follower_Logger.0.log").string(), 400);
+
+    manager.setFollowing(true);
+    BOOST_TEST(manager.init({growingLog.getFileName()}, ""));
+    manager.setFollowing(false);
+    BOOST_TEST(manager.getNumSamples() == 400);
+    BOOST_TEST(manager.appendNewSamples() == 0);
+
+    // the samples written after init are appended and replayed like the indexed ones
+    BOOST_REQUIRE(growingLog.grow(449));
+    BOOST_TEST(manager.appendNewSamples() == 449);
+    BOOST_TEST(manager.getNumSamples() == 849);
+    BOOST_TEST(manager.getSampleTime(848) >= manager.getSampleTime(400));
+    BOOST_TEST(manager.setIndex(848).valid);
+    BOOST_TEST(manager.replaySample());
+    BOOST_TEST(manager.appendNewSamples() == 0);
+
+    manager.clear();
+    boost::filesystem::remove_all(folder);
+}
+
+BOOST_AUTO_TEST_CASE(TestExportSpan)
+{
+    const boost::filesystem::path folder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    manager.init(fileNames, "");
+    const base::Time firstTime = manager.getSampleTime(100);
+    const base::Time lastTime = manager.getSampleTime(300);
+    BOOST_TEST(manager.exportSpan(100, 300, folder.string()));
+
+    // the exported logfile holds the span with its timestamps
+    manager.init(LogFileHelper::parseFileNames({folder.string() + "/"}), "");
+    BOOST_TEST(manager.getNumSamples() == 201);
+    BOOST_TEST(manager.getSampleTime(0) == firstTime);
+    BOOST_TEST(manager.getSampleTime(200) == lastTime);
+    BOOST_TEST(manager.getTaskCollection().size() == 1);
+    BOOST_TEST(manager.setIndex(200).valid);
+
+    // inactive ports are not exported, streams are declared without loading typekits if only the index is loaded
+    manager.activateReplayForPort("trajectory_follower", "follower_data", false);
+    BOOST_TEST(manager.exportSpan(0, 200, (folder / "active").string()));
+    manager.setIndexOnly(true);
+    manager.init(LogFileHelper::parseFileNames({(folder / "active").string() + "/"}), "");
+    manager.setIndexOnly(false);
+    BOOST_TEST(manager.getNumSamples() < 201);
+    BOOST_TEST(manager.getTaskCollection().empty());
+
+    BOOST_TEST(!manager.exportSpan(10, 5, (folder / "empty").string()));
+    manager.clear();
+    boost::filesystem::remove_all(folder);
+}
+
+BOOST_AUTO_TEST_CASE(TestExportSpanOfSameNamedLogfiles)
+{
+    // the logfiles of two runs have the same names, so they are exported to subdirectories named after their folders
+    const boost::filesystem::path folder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    std::vector<std::string> runFileNames;
+    for(const std::string run : {"run1", "run2"})
+    {
+        boost::filesystem::create_directories(folder / run);
+        runFileNames.push_back((folder / run / "trajectory_follower_Logger.0.log").string());
+        boost::filesystem::copy_file(fileNames.front(), runFileNames.back());
+    }
+
+    manager.init(runFileNames, "");
+    BOOST_TEST(manager.exportSpan(0, manager.getNumSamples() - 1, (folder / "export").string()));
+
+    for(const std::string run : {"run1", "run2"})
+    {
+        const boost::filesystem::path exportedFileName = folder / "export" / run / "trajectory_follower_Logger.0.log";
+        BOOST_REQUIRE(boost::filesystem::exists(exportedFileName));
+        manager.init({exportedFileName.string()}, "");
+        BOOST_TEST(manager.getNumSamples() == 849);
+    }
+
+    manager.clear();
+    boost::filesystem::remove_all(folder);
+}
+
+BOOST_AUTO_TEST_CASE(TestStreamStatistics)
+{
+    manager.setIndexOnly(true);
+    manager.init(fileNames, "");
+    manager.setIndexOnly(false);
+
+    const std::vector<StreamStatistics> statistics = manager.getStreamStatistics();
+    BOOST_TEST(!statistics.empty());
+
+    size_t numSamples = 0;
+    for(const StreamStatistics& streamStatistics : statistics)
+    {
+        numSamples += streamStatistics.numSamples;
+        BOOST_TEST(streamStatistics.numOutOfOrder == 0);
+        BOOST_TEST(streamStatistics.minPeriod <= streamStatistics.medianPeriod);
+        BOOST_TEST(streamStatistics.medianPeriod <= streamStatistics.maxPeriod);
+    }
+    BOOST_TEST(numSamples == manager.getNumSamples());
+    manager.clear();
+}
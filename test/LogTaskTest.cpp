@@ -8,6 +8,9 @@
 #include <pocolog_cpp/MultiFileIndex.hpp>
 #include <rtt/InputPort.hpp>
 #include <rtt/base/InputPortInterface.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <new>
 #include <thread>
 #include <trajectory_follower/TrajectoryFollowerTypes.hpp>
 
@@ -17,6 +20,30 @@ pocolog_cpp::MultiFileIndex multiFileIndex = pocolog_cpp::MultiFileIndex(false);
 orocos_cpp::OrocosCpp orocos;
 std::unique_ptr<LogTask> trajectoryFollowerTask;
 
+// counts the heap allocations of the test thread, other threads (e.g. corba) are not counted
+thread_local bool countAllocations = false;
+thread_local size_t allocationCount = 0;
+
+void* operator new(std::size_t size)
+{
+    if(countAllocations)
+    {
+        allocationCount++;
+    }
+
+    if(void* memory = std::malloc(size ? size : 1))
+    {
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
 void setup()
 {
     orocos_cpp::OrocosCppConfig config;
@@ -119,15 +146,18 @@ void replayAllSamplesOfTask(std::unique_ptr<LogTask>& logTask)
     }
 }
 
-template <typename PortType> RTT::InputPort<PortType>* createPortReader(const std::string& taskName, const std::string& portName)
+template <typename PortType>
+RTT::InputPort<PortType>* createPortReader(
+    const std::string& taskName, const std::string& portName, const RTT::ConnPolicy& policy = RTT::ConnPolicy(),
+    const std::string& readerSuffix = "_reader")
 {
     auto task = orocos.getTaskContext(taskName);
     auto port = task->getPort(portName);
     auto reader = dynamic_cast<RTT::InputPort<PortType>*>(port->antiClone());
 
-    reader->setName(portName + "_reader");
+    reader->setName(portName + readerSuffix);
     task->addPort(*reader);
-    reader->connectTo(port, RTT::ConnPolicy());
+    reader->connectTo(port, policy);
 
     return reader;
 }
@@ -140,6 +170,24 @@ BOOST_AUTO_TEST_CASE(TestPortReplay)
 
     auto sample = portReader->getDataSource();
     BOOST_TEST(portReader->read(sample) == RTT::FlowStatus::NewData);
+
+    auto statistics = trajectoryFollowerTask->getReplayStatistics();
+    BOOST_TEST(statistics.at("motion_command").samples > 0);
+    BOOST_TEST(statistics.at("motion_command").bytes > 0);
+    BOOST_TEST(statistics.at("follower_data").samples == 0);
+
+    // each replayed sample passes all stages, samples of unconnected ports are not timed
+    const auto& motionCommand = statistics.at("motion_command");
+    const uint64_t timedSamples = LatencyHistogram::enabled ? motionCommand.samples : 0;
+    BOOST_TEST(motionCommand.readLatency.count == timedSamples);
+    BOOST_TEST(motionCommand.unmarshalLatency.count == timedSamples);
+    BOOST_TEST(motionCommand.writeLatency.count == timedSamples);
+    BOOST_TEST(motionCommand.writeLatency.p50.count() <= motionCommand.writeLatency.p99.count());
+    BOOST_TEST(statistics.at("follower_data").readLatency.count == 0);
+
+    trajectoryFollowerTask->resetReplayStatistics();
+    BOOST_TEST(trajectoryFollowerTask->getReplayStatistics().at("motion_command").samples == 0);
+    BOOST_TEST(trajectoryFollowerTask->getReplayStatistics().at("motion_command").writeLatency.count == 0);
 }
 
 BOOST_AUTO_TEST_CASE(TestPortReplayDeactivated)
@@ -162,4 +210,106 @@ BOOST_AUTO_TEST_CASE(TestTaskStateChange)
 
     BOOST_TEST(portReader->connected());
     BOOST_TEST(initialState != orocos.getTaskContext("trajectory_follower")->getTaskState());
-}
\ No newline at end of file
+}
+
+BOOST_AUTO_TEST_CASE(TestLockstepReplay)
+{
+    orocos.getTaskContext("trajectory_follower")->getPort("motion_command")->disconnect();
+    auto fastReader = createPortReader<base::commands::Motion2D>("trajectory_follower", "motion_command", RTT::ConnPolicy::buffer(2), "_fast_reader");
+    auto slowReader = createPortReader<base::commands::Motion2D>("trajectory_follower", "motion_command", RTT::ConnPolicy::buffer(2), "_slow_reader");
+
+    // both consumers record the received samples, the slow one sleeps after each sample
+    std::atomic<bool> replayDone(false);
+    auto consume = [&](RTT::InputPort<base::commands::Motion2D>* reader, std::vector<double>& received, std::chrono::microseconds delay) {
+        base::commands::Motion2D motion;
+        while(!replayDone)
+        {
+            while(reader->read(motion, false) == RTT::NewData)
+            {
+                received.push_back(motion.translation);
+                std::this_thread::sleep_for(delay);
+            }
+        }
+
+        while(reader->read(motion, false) == RTT::NewData)
+        {
+            received.push_back(motion.translation);
+        }
+    };
+    std::vector<double> fastReceived;
+    std::vector<double> slowReceived;
+    std::thread fastConsumer(consume, fastReader, std::ref(fastReceived), std::chrono::microseconds(0));
+    std::thread slowConsumer(consume, slowReader, std::ref(slowReceived), std::chrono::microseconds(100));
+
+    trajectoryFollowerTask->resetReplayStatistics();
+    trajectoryFollowerTask->setLockstep(true);
+    replayAllSamplesOfTask(trajectoryFollowerTask);
+    trajectoryFollowerTask->setLockstep(false);
+
+    replayDone = true;
+    fastConsumer.join();
+    slowConsumer.join();
+
+    auto statistics = trajectoryFollowerTask->getReplayStatistics().at("motion_command");
+    BOOST_TEST(statistics.samples > 0);
+    BOOST_TEST(fastReceived.size() == statistics.samples);
+    BOOST_TEST(slowReceived.size() == statistics.samples);
+    BOOST_TEST((fastReceived == slowReceived));
+    BOOST_TEST(statistics.blockedTime.count() > 0);
+    BOOST_TEST(!statistics.withoutBackpressure);
+}
+
+BOOST_AUTO_TEST_CASE(TestLockstepWithoutBackpressure)
+{
+    orocos.getTaskContext("trajectory_follower")->getPort("motion_command")->disconnect();
+    createPortReader<base::commands::Motion2D>("trajectory_follower", "motion_command", RTT::ConnPolicy::data(), "_data_reader");
+
+    // data connections cannot report unread samples, so lockstep does not wait for them
+    trajectoryFollowerTask->resetReplayStatistics();
+    trajectoryFollowerTask->setLockstep(true, 4);
+    replayAllSamplesOfTask(trajectoryFollowerTask);
+    trajectoryFollowerTask->setLockstep(false);
+
+    auto statistics = trajectoryFollowerTask->getReplayStatistics().at("motion_command");
+    BOOST_TEST(statistics.samples > 0);
+    BOOST_TEST(statistics.withoutBackpressure);
+    BOOST_TEST(statistics.blockedTime.count() == 0);
+}
+
+size_t countReplayAllocations(const pocolog_cpp::InputDataStream& stream, size_t numSamples)
+{
+    allocationCount = 0;
+    countAllocations = true;
+    for(size_t i = 0; i < numSamples; i++)
+    {
+        trajectoryFollowerTask->replaySample(stream.getIndex(), i);
+    }
+    countAllocations = false;
+
+    return allocationCount;
+}
+
+BOOST_AUTO_TEST_CASE(TestReplayAllocationsStayFlat)
+{
+    orocos.getTaskContext("trajectory_follower")->getPort("motion_command")->disconnect();
+    createPortReader<base::commands::Motion2D>("trajectory_follower", "motion_command", RTT::ConnPolicy(), "_allocation_reader");
+
+    pocolog_cpp::InputDataStream* motionCommandStream = nullptr;
+    for(const auto& stream : multiFileIndex.getAllStreams())
+    {
+        if(stream->getName() == "trajectory_follower.motion_command")
+        {
+            motionCommandStream = dynamic_cast<pocolog_cpp::InputDataStream*>(stream);
+        }
+    }
+
+    BOOST_REQUIRE(motionCommandStream);
+    BOOST_REQUIRE(motionCommandStream->getSize() > 10);
+
+    // the first pass grows the port buffer to the largest sample
+    countReplayAllocations(*motionCommandStream, motionCommandStream->getSize());
+
+    const size_t fewSamplesAllocations = countReplayAllocations(*motionCommandStream, 10);
+    const size_t allSamplesAllocations = countReplayAllocations(*motionCommandStream, motionCommandStream->getSize());
+    BOOST_TEST(allSamplesAllocations == fewSamplesAllocations);
+}
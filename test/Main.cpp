@@ -2,4 +2,36 @@
 #define BOOST_TEST_MODULE "rock_replay"
 #define BOOST_AUTO_TEST_MAIN
 
+#include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
+#include <cstdlib>
+
+/**
+ * @brief Points the index cache of all tests to a temporary directory, so that the tests neither fill
+ * nor read the cache of the user.
+ *
+ */
+struct TemporaryCacheHome
+{
+    TemporaryCacheHome()
+        : cacheHome(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("rock_replay_test_cache_%%%%%%%%"))
+    {
+        boost::filesystem::create_directories(cacheHome);
+        setenv("XDG_CACHE_HOME", cacheHome.c_str(), 1);
+    }
+
+    ~TemporaryCacheHome()
+    {
+        unsetenv("XDG_CACHE_HOME");
+        boost::system::error_code error;
+        boost::filesystem::remove_all(cacheHome, error);
+    }
+
+    /**
+     * @brief Temporary cache directory.
+     *
+     */
+    boost::filesystem::path cacheHome;
+};
+
+BOOST_GLOBAL_FIXTURE(TemporaryCacheHome);
@@ -0,0 +1,117 @@
+#include "PocologWriter.hpp"
+
+#include "PocologFormat.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+const boost::filesystem::path writerTestFolder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+
+/**
+ * @brief Builds a little endian pocolog logfile in memory.
+ *
+ */
+struct TestLog
+{
+    TestLog()
+    {
+        PocologFormat::Prologue prologue = {{'P', 'O', 'C', 'O', 'S', 'I', 'M'}, 0, 2, 0};
+        append(&prologue, sizeof(prologue));
+    }
+
+    void declareStream(uint16_t streamIdx, const std::string& declaration)
+    {
+        PocologFormat::BlockHeader blockHeader = {PocologFormat::StreamBlock, 0, streamIdx, static_cast<uint32_t>(declaration.size())};
+        append(&blockHeader, sizeof(blockHeader));
+        data += declaration;
+    }
+
+    uint64_t addSample(uint16_t streamIdx, uint32_t microseconds, const std::string& sample)
+    {
+        const uint64_t position = data.size();
+        PocologFormat::BlockHeader blockHeader = {PocologFormat::DataBlock, 0, streamIdx,
+                                                  static_cast<uint32_t>(sizeof(PocologFormat::SampleHeader) + sample.size())};
+        PocologFormat::SampleHeader sampleHeader = {{1, microseconds + 1}, {1, microseconds}, static_cast<uint32_t>(sample.size()), 0};
+        append(&blockHeader, sizeof(blockHeader));
+        append(&sampleHeader, sizeof(sampleHeader));
+        data += sample;
+        return position;
+    }
+
+    void append(const void* value, size_t size)
+    {
+        data.append(static_cast<const char*>(value), size);
+    }
+
+    std::string data;
+};
+
+static std::string readLog(const std::string& fileName)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+BOOST_AUTO_TEST_CASE(TestCopyStreamsAndSamples)
+{
+    boost::filesystem::create_directories(writerTestFolder);
+    const std::string sourceFileName = (writerTestFolder / "source.log").string();
+    const std::string fileName = (writerTestFolder / "export.log").string();
+
+    TestLog source;
+    source.declareStream(0, "first stream");
+    source.declareStream(1, "second stream");
+    const uint64_t skipped = source.addSample(0, 10, "skipped");
+    source.declareStream(2, "late stream");
+    const uint64_t first = source.addSample(2, 20, "first");
+    const uint64_t second = source.addSample(0, 30, "second");
+    std::ofstream(sourceFileName, std::ios::binary) << source.data;
+
+    // the streams are renumbered in the order of their declaration
+    TestLog expected;
+    expected.declareStream(0, "late stream");
+    expected.declareStream(1, "first stream");
+    expected.addSample(0, 20, "first");
+    expected.addSample(1, 30, "replaced");
+
+    {
+        PocologWriter writer(sourceFileName, fileName);
+        BOOST_TEST(writer.declareStreams({2, 0}));
+        BOOST_TEST(writer.copySample(2, first));
+        BOOST_TEST(!writer.copySample(1, skipped));
+        BOOST_TEST(!writer.copySample(0, first));
+        BOOST_TEST(!writer.copySample(0, first + 1));
+
+        const std::string replaced = "replaced";
+        const std::vector<uint8_t> sampleData(replaced.begin(), replaced.end());
+        BOOST_TEST(writer.copySample(0, second, &sampleData));
+        BOOST_TEST(writer.getNumSamples() == 2);
+        BOOST_TEST(!boost::filesystem::exists(fileName));
+        BOOST_TEST(writer.close());
+    }
+
+    BOOST_TEST(readLog(fileName) == expected.data);
+}
+
+BOOST_AUTO_TEST_CASE(TestUnfinishedExport)
+{
+    const std::string sourceFileName = (writerTestFolder / "source.log").string();
+    const std::string fileName = (writerTestFolder / "unfinished.log").string();
+
+    {
+        PocologWriter writer(sourceFileName, fileName);
+        BOOST_TEST(!writer.declareStreams({5}));
+    }
+
+    // an export that was not closed leaves no files behind
+    BOOST_TEST(!boost::filesystem::exists(fileName));
+    BOOST_TEST(std::distance(boost::filesystem::directory_iterator(writerTestFolder), boost::filesystem::directory_iterator()) == 2);
+
+    std::ofstream((writerTestFolder / "invalid.log").string()) << "no logfile";
+    BOOST_CHECK_THROW(PocologWriter((writerTestFolder / "invalid.log").string(), fileName), std::runtime_error);
+
+    boost::filesystem::remove_all(writerTestFolder);
+}
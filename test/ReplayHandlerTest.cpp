@@ -2,7 +2,9 @@
 
 #include "LogFileHelper.hpp"
 #include "FileLocationHandler.hpp"
+#include "GrowingLogFile.hpp"
 
+#include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
 
 ReplayHandler replayHandler;
@@ -93,6 +95,36 @@ BOOST_AUTO_TEST_CASE(TestPrevious)
     }
 }
 
+BOOST_AUTO_TEST_CASE(TestSeekToTime)
+{
+    const auto start = replayHandler.getStartTime();
+    const auto end = replayHandler.getEndTime();
+
+    replayHandler.setSampleIndex(100);
+    replayHandler.seekToTime(start);
+    BOOST_TEST(replayHandler.getCurIndex() == 0);
+
+    replayHandler.seekToTime(end + base::Time::fromMilliseconds(1000));
+    BOOST_TEST(replayHandler.getCurIndex() == replayHandler.getMaxIndex());
+}
+
+BOOST_AUTO_TEST_CASE(TestTimeSpan)
+{
+    const auto start = replayHandler.getStartTime();
+    const auto end = replayHandler.getEndTime();
+
+    replayHandler.setTimeSpan(start + base::Time::fromMilliseconds(1000), end - base::Time::fromMilliseconds(1000));
+    BOOST_TEST(replayHandler.getMinSpan() > 0);
+    BOOST_TEST(replayHandler.getMaxSpan() < replayHandler.getMaxIndex());
+
+    replayHandler.seekToTime(start);
+    BOOST_TEST(replayHandler.getCurIndex() == replayHandler.getMinSpan());
+
+    replayHandler.setTimeSpan(start, end);
+    BOOST_TEST(replayHandler.getMinSpan() == 0);
+    BOOST_TEST(replayHandler.getMaxSpan() == replayHandler.getMaxIndex());
+}
+
 BOOST_AUTO_TEST_CASE(TestTaskCollection)
 {
     auto tasksWithPortNames = replayHandler.getTaskNamesWithPorts();
@@ -147,6 +179,228 @@ BOOST_AUTO_TEST_CASE(TestPlayThrough)
     BOOST_TEST(replayHandler.getCurIndex() == replayHandler.getMaxIndex());
     BOOST_TEST(replayHandler.hasFinished());
     BOOST_TEST(!replayHandler.isPlaying());
+
+    auto timing = replayHandler.getTimingReport();
+    BOOST_TEST(timing.total.count > 0);
+    BOOST_TEST(timing.streams.size() == 3);
+    BOOST_TEST(!timing.timeSeries.empty());
+    BOOST_TEST(replayHandler.getLag().count == timing.total.count);
+}
+
+BOOST_AUTO_TEST_CASE(TestPipelinedPlayThrough)
+{
+    replayHandler.stop();
+    replayHandler.setPipelined(true);
+    replayHandler.setSampleIndex(0);
+    replayHandler.setReplaySpeed(10.);
+    replayHandler.play();
+
+    std::this_thread::sleep_for(std::chrono::seconds(10));
+
+    BOOST_TEST(replayHandler.isPipelined());
+    BOOST_TEST(replayHandler.getCurIndex() == replayHandler.getMaxIndex());
+    BOOST_TEST(replayHandler.hasFinished());
+    BOOST_TEST(replayHandler.canSampleBeReplayed());
+
+    replayHandler.setPipelined(false);
+}
+
+BOOST_AUTO_TEST_CASE(TestDropCatchUp)
+{
+    // at this speed, replay lags behind the schedule, so that overdue samples are dropped instead of written
+    replayHandler.stop();
+    replayHandler.setCatchUpPolicy(ReplayHandler::CatchUpPolicy::Drop);
+    replayHandler.setDroppablePorts({".*"});
+    replayHandler.setSampleIndex(0);
+    replayHandler.setReplaySpeed(100000.);
+    replayHandler.play();
+
+    std::this_thread::sleep_for(std::chrono::seconds(5));
+
+    BOOST_TEST(replayHandler.hasFinished());
+    const auto catchUp = replayHandler.getCatchUpStatistics();
+    BOOST_TEST(catchUp.dropped > 0);
+    BOOST_TEST(catchUp.bursted == 0);
+    BOOST_TEST(catchUp.dropped + replayHandler.getTimingReport().total.count == replayHandler.getMaxIndex() + 1);
+
+    replayHandler.stop();
+    replayHandler.setCatchUpPolicy(ReplayHandler::CatchUpPolicy::Burst);
+    replayHandler.setDroppablePorts({});
+    replayHandler.setReplaySpeed(10.);
+}
+
+BOOST_AUTO_TEST_CASE(TestDropCatchUpWithoutDroppablePorts)
+{
+    // overdue samples of ports that cannot be dropped are written back-to-back and counted as under the burst policy
+    replayHandler.stop();
+    replayHandler.setCatchUpPolicy(ReplayHandler::CatchUpPolicy::Drop);
+    replayHandler.setDroppablePorts({"no_such_task.*"});
+    replayHandler.setSampleIndex(0);
+    replayHandler.setReplaySpeed(100000.);
+    replayHandler.play();
+
+    std::this_thread::sleep_for(std::chrono::seconds(5));
+
+    BOOST_TEST(replayHandler.hasFinished());
+    const auto catchUp = replayHandler.getCatchUpStatistics();
+    BOOST_TEST(catchUp.dropped == 0);
+    BOOST_TEST(catchUp.bursted > 0);
+
+    replayHandler.stop();
+    replayHandler.setCatchUpPolicy(ReplayHandler::CatchUpPolicy::Burst);
+    replayHandler.setDroppablePorts({});
+    replayHandler.setReplaySpeed(10.);
+}
+
+BOOST_AUTO_TEST_CASE(TestUnthrottledPlayThrough)
+{
+    replayHandler.stop();
+    replayHandler.setUnthrottled(true);
+    replayHandler.setSampleIndex(0);
+    replayHandler.play();
+
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    BOOST_TEST(replayHandler.isUnthrottled());
+    BOOST_TEST(replayHandler.getCurIndex() == replayHandler.getMaxIndex());
+    BOOST_TEST(replayHandler.hasFinished());
+
+    auto report = replayHandler.getThroughputReport();
+    BOOST_TEST(report.seconds > 0);
+    BOOST_TEST(report.streams.size() == 3);
+
+    replayHandler.setUnthrottled(false);
+}
+
+BOOST_AUTO_TEST_CASE(TestInitInBackground)
+{
+    replayHandler.initInBackground(fileNames, "");
+    replayHandler.play();
+    replayHandler.waitForIndex();
+
+    BOOST_TEST(!replayHandler.isIndexing());
+    BOOST_TEST(replayHandler.getIndexingProgress() == 1.);
+    BOOST_TEST(replayHandler.getMaxIndex() == 848);
+    BOOST_TEST(replayHandler.getMaxSpan() == 848);
+    BOOST_TEST(replayHandler.getTaskNamesWithPorts().at("trajectory_follower").size() == 3);
+
+    // deinit cancels a running indexing
+    replayHandler.initInBackground(fileNames, "");
+    replayHandler.deinit();
+    BOOST_TEST(!replayHandler.isIndexing());
+}
+
+BOOST_AUTO_TEST_CASE(TestFollow)
+{
+    const boost::filesystem::path folder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(folder);
+    GrowingLogFile growingLog(fileNames.front(), (folder / "trajectory_follower_Logger.0.log").string(), 400);
+
+    replayHandler.setFollowing(true);
+    replayHandler.initInBackground({growingLog.getFileName()}, "");
+    replayHandler.waitForIndex();
+    BOOST_TEST(replayHandler.isFollowing());
+    BOOST_TEST(replayHandler.getMaxIndex() == 399);
+
+    // a followed replay waits for new samples at the end instead of finishing
+    replayHandler.setUnthrottled(true);
+    replayHandler.setSampleIndex(replayHandler.getMaxIndex());
+    replayHandler.play();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    BOOST_TEST(replayHandler.isPlaying());
+    BOOST_TEST(!replayHandler.hasFinished());
+    BOOST_TEST(replayHandler.getMaxIndex() == 399);
+
+    // the samples written by the logger are appended and replayed
+    BOOST_REQUIRE(growingLog.grow(449));
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while(replayHandler.getCurIndex() < 848 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_TEST(replayHandler.getMaxIndex() == 848);
+    BOOST_TEST(replayHandler.getCurIndex() == 848);
+    BOOST_TEST(!replayHandler.hasFinished());
+
+    replayHandler.deinit();
+    BOOST_TEST(!replayHandler.isFollowing());
+    replayHandler.setFollowing(false);
+    replayHandler.setUnthrottled(false);
+    boost::filesystem::remove_all(folder);
+}
+
+BOOST_AUTO_TEST_CASE(TestFollowUntilEndTime)
+{
+    // the end time lies within the samples written after loading
+    base::Time endTime;
+    size_t lastIndex;
+    {
+        LogTaskManager manager;
+        manager.init(fileNames, "");
+        endTime = manager.getSampleTime(600);
+        lastIndex = manager.getIndexForTime(endTime + base::Time::fromMicroseconds(1)) - 1;
+    }
+
+    const boost::filesystem::path folder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(folder);
+    GrowingLogFile growingLog(fileNames.front(), (folder / "trajectory_follower_Logger.0.log").string(), 400);
+
+    replayHandler.setFollowing(true);
+    replayHandler.initInBackground({growingLog.getFileName()}, "", {}, {}, {"", endTime.toString()});
+    replayHandler.waitForIndex();
+    BOOST_TEST(replayHandler.isFollowing());
+    BOOST_TEST(replayHandler.getMaxIndex() == 399);
+
+    replayHandler.setUnthrottled(true);
+    replayHandler.setSampleIndex(replayHandler.getMaxIndex());
+    replayHandler.play();
+
+    // following stops once the logger wrote past the end time, so that the replay finishes at the last sample before it
+    BOOST_REQUIRE(growingLog.grow(449));
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while(!replayHandler.hasFinished() && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_TEST(replayHandler.hasFinished());
+    BOOST_TEST(!replayHandler.isFollowing());
+    BOOST_TEST(replayHandler.getMaxIndex() == lastIndex);
+    BOOST_TEST(replayHandler.getCurIndex() == lastIndex);
+
+    replayHandler.deinit();
+    replayHandler.setFollowing(false);
+    replayHandler.setUnthrottled(false);
+    boost::filesystem::remove_all(folder);
+}
+
+BOOST_AUTO_TEST_CASE(TestFollowUntilMaxSpan)
+{
+    const boost::filesystem::path folder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(folder);
+    GrowingLogFile growingLog(fileNames.front(), (folder / "trajectory_follower_Logger.0.log").string(), 400);
+
+    replayHandler.setFollowing(true);
+    replayHandler.initInBackground({growingLog.getFileName()}, "");
+    replayHandler.waitForIndex();
+
+    // a span limited by the user finishes at its end, even though the logfile is still followed
+    replayHandler.setMaxSpan(300);
+    replayHandler.setUnthrottled(true);
+    replayHandler.setSampleIndex(290);
+    replayHandler.play();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while(!replayHandler.hasFinished() && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_TEST(replayHandler.hasFinished());
+    BOOST_TEST(replayHandler.isFollowing());
+    BOOST_TEST(replayHandler.getCurIndex() == 300);
+
+    replayHandler.deinit();
+    replayHandler.setFollowing(false);
+    replayHandler.setUnthrottled(false);
+    boost::filesystem::remove_all(folder);
 }
 
 BOOST_AUTO_TEST_CASE(TestDeinit)
@@ -0,0 +1,91 @@
+#include "ReplayPipeline.hpp"
+
+#include "FileLocationHandler.hpp"
+#include "LogFileHelper.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+const std::string logFolder = getLogFilePath();
+const auto fileNames = LogFileHelper::parseFileNames({logFolder + "trajectory_follower_Logger.0.log"});
+LogTaskManager pipelineManager;
+
+BOOST_AUTO_TEST_CASE(TestPipelineReplaysAllSamples)
+{
+    pipelineManager.init(fileNames, "");
+    ReplayPipeline pipeline(pipelineManager, 8, 2);
+
+    const size_t lastIndex = pipelineManager.getNumSamples() - 1;
+    pipeline.start(0, lastIndex);
+    BOOST_TEST(pipeline.isRunning());
+
+    for(size_t i = 0; i <= lastIndex; i++)
+    {
+        pipelineManager.setIndex(i);
+        bool expectedResult = pipelineManager.replaySample();
+
+        BOOST_TEST(pipeline.replaySample(i) == expectedResult);
+    }
+
+    pipeline.stop();
+    BOOST_TEST(!pipeline.isRunning());
+}
+
+BOOST_AUTO_TEST_CASE(TestPipelineRestartsOnJump)
+{
+    ReplayPipeline pipeline(pipelineManager, 4, 1);
+    pipeline.start(0, 100);
+
+    BOOST_TEST(pipeline.replaySample(0));
+    BOOST_TEST(pipeline.replaySample(50));
+    BOOST_TEST(pipeline.replaySample(51));
+}
+
+BOOST_AUTO_TEST_CASE(TestPipelineExtendsRange)
+{
+    ReplayPipeline pipeline(pipelineManager, 4, 1);
+    pipeline.start(0, 10);
+    pipeline.extend(20);
+
+    for(size_t i = 0; i <= 20; i++)
+    {
+        pipelineManager.setIndex(i);
+        bool expectedResult = pipelineManager.replaySample();
+
+        BOOST_TEST(pipeline.replaySample(i) == expectedResult);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TestPipelineSkipsSamples)
+{
+    ReplayPipeline pipeline(pipelineManager, 4, 1);
+    pipeline.start(0, 20);
+
+    // skipping keeps the prepared samples, so that the following samples are replayed without a restart
+    for(size_t i = 0; i <= 20; i++)
+    {
+        if(i % 2)
+        {
+            pipeline.skipSample(i);
+            continue;
+        }
+
+        pipelineManager.setIndex(i);
+        bool expectedResult = pipelineManager.replaySample();
+
+        BOOST_TEST(pipeline.replaySample(i) == expectedResult);
+    }
+    BOOST_TEST(pipeline.isRunning());
+}
+
+BOOST_AUTO_TEST_CASE(TestPreparedSampleOfDeactivatedPort)
+{
+    LogTask::PreparedSample prepared;
+
+    pipelineManager.activateReplayForPort("trajectory_follower", "motion_command", false);
+    bool wasRead = pipelineManager.prepareSample(250, prepared);
+
+    BOOST_TEST(!wasRead);
+    BOOST_TEST(!pipelineManager.replayPreparedSample(prepared));
+
+    pipelineManager.activateReplayForPort("trajectory_follower", "motion_command", true);
+}
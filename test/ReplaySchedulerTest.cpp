@@ -0,0 +1,83 @@
+#include "ReplayScheduler.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace std::chrono;
+
+const base::Time logStart = base::Time::fromMicroseconds(1479467300000000);
+const ReplayScheduler::Clock::time_point wallStart = ReplayScheduler::Clock::time_point(seconds(1000));
+
+BOOST_AUTO_TEST_CASE(TestDeadlineAtAnchor)
+{
+    ReplayScheduler scheduler;
+    scheduler.anchor(logStart, 1., wallStart);
+
+    BOOST_TEST((scheduler.getDeadline(logStart) == wallStart));
+    BOOST_TEST(scheduler.getLogTime(wallStart) == logStart);
+}
+
+BOOST_AUTO_TEST_CASE(TestDeadlineDoesNotDrift)
+{
+    ReplayScheduler scheduler;
+    scheduler.anchor(logStart, 3., wallStart);
+
+    // 1 kHz stream over ten hours, each step is not a multiple of the speed
+    const int64_t numSamples = 36000000;
+    const auto lastSampleTime = logStart + base::Time::fromMicroseconds(numSamples * 1000);
+
+    BOOST_TEST((scheduler.getDeadline(lastSampleTime) - wallStart == nanoseconds(numSamples * 1000000 / 3)));
+}
+
+BOOST_AUTO_TEST_CASE(TestSubMillisecondResolution)
+{
+    ReplayScheduler scheduler;
+    scheduler.anchor(logStart, 1., wallStart);
+
+    BOOST_TEST((scheduler.getDeadline(logStart + base::Time::fromMicroseconds(250)) - wallStart == microseconds(250)));
+
+    scheduler.anchor(logStart, 4., wallStart);
+    BOOST_TEST((scheduler.getDeadline(logStart + base::Time::fromMicroseconds(1)) - wallStart == nanoseconds(250)));
+}
+
+BOOST_AUTO_TEST_CASE(TestSpeedChangeReanchors)
+{
+    ReplayScheduler scheduler;
+    scheduler.anchor(logStart, 1., wallStart);
+
+    const auto speedChange = wallStart + seconds(10);
+    scheduler.setSpeed(2., speedChange);
+
+    BOOST_TEST(scheduler.getSpeed() == 2.);
+    BOOST_TEST(scheduler.getLogTime(speedChange) == logStart + base::Time::fromMilliseconds(10000));
+    BOOST_TEST((scheduler.getDeadline(logStart + base::Time::fromMilliseconds(20000)) == speedChange + seconds(5)));
+}
+
+BOOST_AUTO_TEST_CASE(TestRecordPublish)
+{
+    ReplayScheduler scheduler;
+    scheduler.anchor(logStart, 1., wallStart);
+
+    const auto sampleTime = logStart + base::Time::fromMilliseconds(10);
+    BOOST_TEST((scheduler.recordPublish(sampleTime, wallStart + milliseconds(10) + microseconds(30)) == microseconds(30)));
+    BOOST_TEST((scheduler.recordPublish(sampleTime, wallStart + milliseconds(10) + microseconds(10)) == microseconds(10)));
+
+    auto statistics = scheduler.getStatistics();
+    BOOST_TEST(statistics.samples == 2);
+    BOOST_TEST((statistics.lastError == microseconds(10)));
+    BOOST_TEST((statistics.meanError == microseconds(20)));
+    BOOST_TEST((statistics.maxError == microseconds(30)));
+
+    scheduler.resetStatistics();
+    BOOST_TEST(scheduler.getStatistics().samples == 0);
+}
+
+BOOST_AUTO_TEST_CASE(TestRelativeSpeed)
+{
+    ReplayScheduler scheduler;
+    scheduler.anchor(logStart, 2., wallStart);
+
+    const auto sampleTime = logStart + base::Time::fromMilliseconds(4000);
+    BOOST_TEST(scheduler.getRelativeSpeed(sampleTime, wallStart + seconds(2)) == 1.);
+    BOOST_TEST(scheduler.getRelativeSpeed(sampleTime, wallStart + seconds(4)) == 0.5);
+    BOOST_TEST(scheduler.getRelativeSpeed(logStart, wallStart) == 1.);
+}
@@ -0,0 +1,348 @@
+#include "SampleIndex.hpp"
+
+#include "FileLocationHandler.hpp"
+#include "GrowingLogFile.hpp"
+#include "LogFileHelper.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <pocolog_cpp/LogFile.hpp>
+#include <thread>
+
+const std::string logFolder = getLogFilePath();
+std::mutex firstFileMutex;
+std::mutex secondFileMutex;
+
+std::vector<pocolog_cpp::InputDataStream*> getInputStreams(pocolog_cpp::LogFile& logFile)
+{
+    std::vector<pocolog_cpp::InputDataStream*> inputStreams;
+    for(pocolog_cpp::Stream* stream : logFile.getStreams())
+    {
+        if(auto inputStream = dynamic_cast<pocolog_cpp::InputDataStream*>(stream))
+        {
+            inputStreams.push_back(inputStream);
+        }
+    }
+
+    return inputStreams;
+}
+
+bool isOrderedByTime(const SampleIndex& index)
+{
+    for(size_t i = 1; i < index.getSize(); i++)
+    {
+        if(index.getSampleTime(i) < index.getSampleTime(i - 1))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(TestEmptySampleIndex)
+{
+    SampleIndex index;
+    index.build({}, {});
+
+    BOOST_TEST(index.getSize() == 0);
+    BOOST_TEST(index.getStreams().empty());
+    BOOST_TEST(index.getIndexForTime(base::Time::now()) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(TestSingleFileSampleIndex)
+{
+    pocolog_cpp::LogFile logFile(logFolder + "trajectory_follower_Logger.0.log", false);
+    const auto inputStreams = getInputStreams(logFile);
+
+    double reportedProgress = 0.;
+    SampleIndex index;
+    BOOST_TEST(index.build({inputStreams}, {&firstFileMutex}, [&](double progress) { reportedProgress = progress; }));
+
+    BOOST_TEST(index.getSize() == 849);
+    BOOST_TEST(reportedProgress == 1.);
+    BOOST_TEST(index.getStreams() == inputStreams);
+    BOOST_TEST(isOrderedByTime(index));
+
+    const size_t streamIdx = index.getStreamIdx(250);
+    const size_t posInStream = index.getPosInStream(250);
+    BOOST_TEST(index.getSampleTime(250) == inputStreams.at(streamIdx)->getFileIndex().getSampleTime(posInStream));
+    BOOST_TEST(index.getIndexForTime(index.getSampleTime(250)) <= 250);
+    BOOST_CHECK_THROW(index.getStreamIdx(849), std::out_of_range);
+
+    index.clear();
+    BOOST_TEST(index.getSize() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(TestMultiFileSampleIndex)
+{
+    std::vector<std::unique_ptr<pocolog_cpp::LogFile>> logFiles;
+    std::vector<std::unique_ptr<std::mutex>> fileMutexes;
+    std::vector<std::mutex*> mutexes;
+    std::vector<std::vector<pocolog_cpp::InputDataStream*>> fileStreams;
+    size_t numSamples = 0;
+    for(const auto& fileName : LogFileHelper::parseFileNames({logFolder}))
+    {
+        logFiles.emplace_back(new pocolog_cpp::LogFile(fileName, false));
+        fileMutexes.emplace_back(new std::mutex());
+        mutexes.push_back(fileMutexes.back().get());
+        fileStreams.push_back(getInputStreams(*logFiles.back()));
+        for(auto inputStream : fileStreams.back())
+        {
+            numSamples += inputStream->getSize();
+        }
+    }
+
+    SampleIndex index;
+    index.build(fileStreams, mutexes);
+
+    BOOST_TEST(logFiles.size() > 1);
+    BOOST_TEST(index.getSize() == numSamples);
+    BOOST_TEST(isOrderedByTime(index));
+
+    // the timestamps are read ahead in bounded buffers, each stream has to appear completely and in its own order
+    std::vector<size_t> nextPositions(index.getStreams().size(), 0);
+    bool matchesStreams = true;
+    for(size_t i = 0; i < index.getSize(); i++)
+    {
+        const size_t streamIdx = index.getStreamIdx(i);
+        pocolog_cpp::InputDataStream* stream = index.getStreams()[streamIdx];
+        matchesStreams &= index.getPosInStream(i) == nextPositions[streamIdx]++ &&
+                          index.getSampleTime(i) == stream->getFileIndex().getSampleTime(index.getPosInStream(i));
+    }
+
+    BOOST_TEST(matchesStreams);
+    for(size_t streamIdx = 0; streamIdx < nextPositions.size(); streamIdx++)
+    {
+        BOOST_TEST(nextPositions[streamIdx] == index.getStreams()[streamIdx]->getSize());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TestSampleIndexCache)
+{
+    pocolog_cpp::LogFile logFile(logFolder + "trajectory_follower_Logger.0.log", false);
+    const std::vector<std::vector<pocolog_cpp::InputDataStream*>> fileStreams = {getInputStreams(logFile)};
+    const std::string cacheFileName = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+
+    SampleIndex builtIndex;
+    builtIndex.build(fileStreams, {&firstFileMutex});
+    BOOST_REQUIRE(builtIndex.save(cacheFileName, "key"));
+
+    SampleIndex loadedIndex;
+    BOOST_TEST(!loadedIndex.load(cacheFileName, "other key", fileStreams));
+    BOOST_REQUIRE(loadedIndex.load(cacheFileName, "key", fileStreams));
+    BOOST_TEST(loadedIndex.getSize() == builtIndex.getSize());
+    BOOST_TEST(loadedIndex.getStreams() == builtIndex.getStreams());
+    for(size_t i = 0; i < builtIndex.getSize(); i++)
+    {
+        BOOST_TEST(loadedIndex.getStreamIdx(i) == builtIndex.getStreamIdx(i));
+        BOOST_TEST(loadedIndex.getPosInStream(i) == builtIndex.getPosInStream(i));
+        BOOST_TEST(loadedIndex.getSampleTime(i) == builtIndex.getSampleTime(i));
+    }
+
+    // truncated files are rejected
+    boost::filesystem::resize_file(cacheFileName, boost::filesystem::file_size(cacheFileName) - 1);
+    BOOST_TEST(!loadedIndex.load(cacheFileName, "key", fileStreams));
+    BOOST_TEST(loadedIndex.getSize() == 0);
+
+    boost::filesystem::remove(cacheFileName);
+    BOOST_TEST(!loadedIndex.load(cacheFileName, "key", fileStreams));
+}
+
+BOOST_AUTO_TEST_CASE(TestProgressiveSampleIndex)
+{
+    pocolog_cpp::LogFile firstLogFile(logFolder + "trajectory_follower_Logger.0.log", false);
+    pocolog_cpp::LogFile secondLogFile(logFolder + "slam3d_Logger.0.log", false);
+
+    SampleIndex index;
+    std::atomic<bool> built(false);
+    std::thread builder([&]() {
+        index.build({getInputStreams(firstLogFile), getInputStreams(secondLogFile)}, {&firstFileMutex, &secondFileMutex});
+        built = true;
+    });
+
+    // the published prefix only grows and stays ordered
+    size_t lastSize = 0;
+    bool grows = true;
+    while(!built)
+    {
+        const size_t size = index.getSize();
+        grows &= size >= lastSize;
+        for(size_t i = 1; i < size; i++)
+        {
+            grows &= index.getSampleTime(i - 1) <= index.getSampleTime(i);
+        }
+        lastSize = size;
+    }
+    builder.join();
+
+    BOOST_TEST(grows);
+    BOOST_TEST(index.getSize() >= lastSize);
+    BOOST_TEST(isOrderedByTime(index));
+}
+
+BOOST_AUTO_TEST_CASE(TestCancelSampleIndex)
+{
+    pocolog_cpp::LogFile logFile(logFolder + "trajectory_follower_Logger.0.log", false);
+
+    SampleIndex index;
+    index.cancel();
+    BOOST_TEST(index.build({getInputStreams(logFile)}, {&firstFileMutex}));
+
+    std::thread canceller([&]() { index.cancel(); });
+    const bool complete = index.build({getInputStreams(logFile)}, {&firstFileMutex});
+    canceller.join();
+
+    BOOST_TEST((complete ? index.getSize() == 849 : index.getSize() < 849));
+    BOOST_TEST(isOrderedByTime(index));
+}
+
+BOOST_AUTO_TEST_CASE(TestWindowedSampleIndex)
+{
+    pocolog_cpp::LogFile logFile(logFolder + "trajectory_follower_Logger.0.log", false);
+    const auto inputStreams = getInputStreams(logFile);
+
+    SampleIndex fullIndex;
+    fullIndex.build({inputStreams}, {&firstFileMutex});
+    const base::Time windowStart = fullIndex.getSampleTime(100);
+    const base::Time windowEnd = fullIndex.getSampleTime(700);
+    const size_t first = fullIndex.getIndexForTime(windowStart);
+    const size_t numWindowSamples = fullIndex.getIndexForTime(windowEnd + base::Time::fromMicroseconds(1)) - first;
+
+    SampleIndex windowedIndex;
+    BOOST_TEST(windowedIndex.build({inputStreams}, {&firstFileMutex}, {}, windowStart, windowEnd));
+
+    BOOST_TEST(windowedIndex.getSize() == numWindowSamples);
+    for(size_t i = 0; i < windowedIndex.getSize(); i++)
+    {
+        BOOST_TEST(windowedIndex.getStreamIdx(i) == fullIndex.getStreamIdx(first + i));
+        BOOST_TEST(windowedIndex.getPosInStream(i) == fullIndex.getPosInStream(first + i));
+        BOOST_TEST(windowedIndex.getSampleTime(i) == fullIndex.getSampleTime(first + i));
+    }
+
+    const auto range = SampleIndex::getStreamRange(*inputStreams.front(), windowEnd + base::Time::fromMilliseconds(1000), base::Time());
+    BOOST_TEST(range.first == range.second);
+}
+
+BOOST_AUTO_TEST_CASE(TestExtendSampleIndex)
+{
+    pocolog_cpp::LogFile logFile(logFolder + "trajectory_follower_Logger.0.log", false);
+    const std::vector<std::vector<pocolog_cpp::InputDataStream*>> fileStreams = {getInputStreams(logFile)};
+
+    SampleIndex index;
+    index.setReserve(1000);
+    BOOST_REQUIRE(index.build(fileStreams, {&firstFileMutex}));
+    const size_t numSamples = index.getSize();
+    const size_t lastPosInStream = index.getPosInStream(numSamples - 1);
+
+    // streams that did not grow append nothing, a reopened logfile provides the same samples
+    pocolog_cpp::LogFile reopenedFile(logFolder + "trajectory_follower_Logger.0.log", false);
+    const std::vector<std::vector<pocolog_cpp::InputDataStream*>> reopenedStreams = {getInputStreams(reopenedFile)};
+    BOOST_TEST(index.extend(reopenedStreams, {&firstFileMutex}) == 0);
+    BOOST_TEST(index.getSize() == numSamples);
+    BOOST_TEST(index.getStreams() == reopenedStreams.front());
+    BOOST_TEST(index.getPosInStream(numSamples - 1) == lastPosInStream);
+
+    // a mismatching set of streams is rejected
+    BOOST_TEST(index.extend({}, {}) == 0);
+    BOOST_TEST(index.getStreams() == reopenedStreams.front());
+}
+
+BOOST_AUTO_TEST_CASE(TestExtendGrownSampleIndex)
+{
+    const boost::filesystem::path folder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(folder);
+    GrowingLogFile growingLog(logFolder + "trajectory_follower_Logger.0.log", (folder / "growing.log").string(), 400);
+
+    SampleIndex index;
+    index.setReserve(1000);
+    std::unique_ptr<pocolog_cpp::LogFile> logFile(new pocolog_cpp::LogFile(growingLog.getFileName(), false));
+    BOOST_REQUIRE(index.build({getInputStreams(*logFile)}, {&firstFileMutex}));
+    BOOST_TEST(index.getSize() == 400);
+
+    // the samples written by the logger are appended once the grown logfile is reopened
+    for(size_t numAppended : {49, 400})
+    {
+        const size_t numSamples = index.getSize();
+        BOOST_REQUIRE(growingLog.grow(numAppended));
+        std::unique_ptr<pocolog_cpp::LogFile> grownFile(new pocolog_cpp::LogFile(growingLog.getFileName(), false));
+        BOOST_TEST(index.extend({getInputStreams(*grownFile)}, {&firstFileMutex}) == numAppended);
+        BOOST_TEST(index.getSize() == numSamples + numAppended);
+        logFile = std::move(grownFile);
+    }
+
+    // each stream continues where its indexed samples ended
+    std::vector<size_t> nextPositions(index.getStreams().size(), 0);
+    bool continuesStreams = true;
+    for(size_t i = 0; i < index.getSize(); i++)
+    {
+        continuesStreams &= index.getPosInStream(i) == nextPositions[index.getStreamIdx(i)]++;
+    }
+
+    BOOST_TEST(continuesStreams);
+    for(size_t streamIdx = 0; streamIdx < nextPositions.size(); streamIdx++)
+    {
+        BOOST_TEST(nextPositions[streamIdx] == index.getStreams()[streamIdx]->getSize());
+    }
+
+    // a logfile that did not grow appends nothing
+    BOOST_TEST(index.extend({getInputStreams(*logFile)}, {&firstFileMutex}) == 0);
+    BOOST_TEST(index.getSize() == 849);
+
+    index.clear();
+    logFile.reset();
+    boost::filesystem::remove_all(folder);
+}
+
+BOOST_AUTO_TEST_CASE(TestExtendSampleIndexWithLateSamples)
+{
+    // the logfile starts with all samples of its first stream, the other streams are written later
+    size_t firstStreamIdx;
+    size_t numFirstSamples;
+    {
+        pocolog_cpp::LogFile sourceFile(logFolder + "trajectory_follower_Logger.0.log", false);
+        const auto sourceStreams = getInputStreams(sourceFile);
+        const auto firstStream = std::min_element(
+            sourceStreams.begin(), sourceStreams.end(),
+            [](pocolog_cpp::InputDataStream* a, pocolog_cpp::InputDataStream* b) { return a->getIndex() < b->getIndex(); });
+        firstStreamIdx = (*firstStream)->getIndex();
+        numFirstSamples = (*firstStream)->getSize();
+    }
+
+    const boost::filesystem::path folder = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(folder);
+    GrowingLogFile growingLog(logFolder + "trajectory_follower_Logger.0.log", (folder / "growing.log").string(), numFirstSamples, true);
+
+    SampleIndex index;
+    index.setReserve(1000);
+    std::unique_ptr<pocolog_cpp::LogFile> logFile(new pocolog_cpp::LogFile(growingLog.getFileName(), false));
+    BOOST_REQUIRE(index.build({getInputStreams(*logFile)}, {&firstFileMutex}));
+    const base::Time lastIndexedTime = index.getSampleTime(index.getSize() - 1);
+
+    BOOST_REQUIRE(growingLog.grow(849 - numFirstSamples));
+    logFile.reset(new pocolog_cpp::LogFile(growingLog.getFileName(), false));
+    const auto grownStreams = getInputStreams(*logFile);
+    BOOST_TEST(index.extend({grownStreams}, {&firstFileMutex}) == 849 - numFirstSamples);
+
+    // the late samples follow the indexed samples at the last indexed time
+    size_t numLateSamples = 0;
+    for(pocolog_cpp::InputDataStream* stream : grownStreams)
+    {
+        for(size_t pos = 0; stream->getIndex() != firstStreamIdx && pos < stream->getSize(); pos++)
+        {
+            numLateSamples += stream->getFileIndex().getSampleTime(pos) < lastIndexedTime;
+        }
+    }
+    BOOST_TEST(numLateSamples > 0);
+    BOOST_TEST(index.getNumLateSamples() == numLateSamples);
+    BOOST_TEST(isOrderedByTime(index));
+
+    index.clear();
+    BOOST_TEST(index.getNumLateSamples() == 0);
+    logFile.reset();
+    boost::filesystem::remove_all(folder);
+}
@@ -0,0 +1,138 @@
+#include "SampleTable.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <cstring>
+#include <sstream>
+
+BOOST_AUTO_TEST_CASE(TestSampleTableAppend)
+{
+    SampleTable table;
+    const size_t numSamples = 3 * SampleTable::blockSize + 10;
+    table.reset(numSamples, 3);
+
+    for(size_t i = 0; i < numSamples; i++)
+    {
+        table.append(i * 100, i % 3);
+    }
+
+    BOOST_TEST(table.getSize() == numSamples);
+    for(size_t i = 0; i < numSamples; i++)
+    {
+        BOOST_REQUIRE(table.getTime(i) == static_cast<int64_t>(i * 100));
+        BOOST_REQUIRE(table.getStreamIdx(i) == i % 3);
+        BOOST_REQUIRE(table.getPosInStream(i) == i / 3);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TestSampleTableClampsTime)
+{
+    SampleTable table;
+    table.reset(3, 1);
+    table.append(100, 0);
+    table.append(50, 0);
+    table.append(200, 0);
+
+    BOOST_TEST(table.getTime(1) == 100);
+    BOOST_TEST(table.getTime(2) == 200);
+}
+
+BOOST_AUTO_TEST_CASE(TestSampleTableOverflow)
+{
+    // gaps beyond the 32 bit offsets of a block, e.g. between the sessions of an endurance run
+    const int64_t day = 24ll * 3600 * 1000 * 1000;
+    SampleTable table;
+    table.reset(4, 2);
+    table.append(-day, 1);
+    table.append(0, 0);
+    table.append(1, 1);
+    table.append(7 * day, 1);
+
+    BOOST_TEST(table.getTime(0) == -day);
+    BOOST_TEST(table.getTime(1) == 0);
+    BOOST_TEST(table.getTime(2) == 1);
+    BOOST_TEST(table.getTime(3) == 7 * day);
+    BOOST_TEST(table.getPosInStream(3) == 2);
+    BOOST_TEST(table.getIndexForTime(2, 4) == 3);
+}
+
+BOOST_AUTO_TEST_CASE(TestSampleTableIndexForTime)
+{
+    SampleTable table;
+    table.reset(2 * SampleTable::blockSize, 1);
+    for(size_t i = 0; i < 2 * SampleTable::blockSize; i++)
+    {
+        table.append(i / 2 * 10, 0);
+    }
+
+    BOOST_TEST(table.getIndexForTime(-5, table.getSize()) == 0);
+    BOOST_TEST(table.getIndexForTime(10, table.getSize()) == 2);
+    BOOST_TEST(table.getIndexForTime(15, table.getSize()) == 4);
+    BOOST_TEST(table.getIndexForTime(10, 1) == 1);
+    BOOST_TEST(table.getIndexForTime(1000000, table.getSize()) == table.getSize());
+}
+
+BOOST_AUTO_TEST_CASE(TestSampleTableWriteAndMap)
+{
+    SampleTable table;
+    const size_t numSamples = SampleTable::blockSize + 3;
+    table.reset(numSamples, 5);
+    for(size_t i = 0; i < numSamples; i++)
+    {
+        table.append(i == numSamples - 1 ? 1ll << 40 : i, i * 7 % 5);
+    }
+
+    std::ostringstream stream;
+    table.write(stream);
+    const std::string written = stream.str();
+    std::vector<uint64_t> memory((written.size() + 7) / 8);
+    std::memcpy(memory.data(), written.data(), written.size());
+    const char* mapped = reinterpret_cast<const char*>(memory.data());
+
+    SampleTable mappedTable;
+    BOOST_TEST(!mappedTable.map(mapped, written.size(), numSamples, 4));
+    BOOST_TEST(!mappedTable.map(mapped, written.size() - 1, numSamples, 5));
+    BOOST_REQUIRE(mappedTable.map(mapped, written.size(), numSamples, 5));
+
+    BOOST_TEST(mappedTable.getSize() == numSamples);
+    for(size_t i = 0; i < numSamples; i++)
+    {
+        BOOST_REQUIRE(mappedTable.getTime(i) == table.getTime(i));
+        BOOST_REQUIRE(mappedTable.getStreamIdx(i) == table.getStreamIdx(i));
+        BOOST_REQUIRE(mappedTable.getPosInStream(i) == table.getPosInStream(i));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TestSampleTableMemoryUsage)
+{
+    SampleTable table;
+    const size_t numSamples = 1000 * SampleTable::blockSize;
+    table.reset(numSamples, 100);
+    for(size_t i = 0; i < numSamples; i++)
+    {
+        table.append(i, i % 100);
+    }
+
+    // 8 bytes per sample, 8 bytes for the time and 400 bytes for the stream positions of every block
+    BOOST_TEST(table.getMemoryUsage() < numSamples * 8.2);
+}
+
+BOOST_AUTO_TEST_CASE(TestSampleTableCapacity)
+{
+    // a large reserve, as used for logfiles that are still being written, only costs memory once it is appended to
+    SampleTable table;
+    const size_t capacity = 100000 * SampleTable::blockSize;
+    table.reset(capacity, 10);
+    BOOST_TEST(table.getCapacity() == capacity);
+    BOOST_TEST(table.getMemoryUsage() < 1000);
+
+    table.append(10, 3);
+    for(size_t i = 1; i < 2 * SampleTable::blockSize; i++)
+    {
+        table.append(10 + i, i % 10);
+    }
+
+    BOOST_TEST(table.getTime(0) == 10);
+    BOOST_TEST(table.getStreamIdx(0) == 3);
+    BOOST_TEST(table.getPosInStream(2 * SampleTable::blockSize - 1) == 2 * SampleTable::blockSize / 10);
+    BOOST_TEST(table.getMemoryUsage() < 2 * SampleTable::blockSize * 8.2);
+}
@@ -0,0 +1,87 @@
+#include "ReplayScheduler.hpp"
+#include "SpeedController.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+/**
+ * @brief Simulates the replay of a 1 kHz stream whose samples take a fixed time to publish, so that the highest
+ * sustainable speed is the inverse of the publish time in milliseconds.
+ *
+ * @param controller: Controller of the replay speed.
+ * @param publishDuration: Wall time needed to publish a sample.
+ * @param duration: Simulated wall time.
+ * @return std::chrono::nanoseconds Largest lateness in the last quarter of the simulated wall time.
+ */
+static std::chrono::nanoseconds simulateReplay(SpeedController& controller, std::chrono::nanoseconds publishDuration, std::chrono::seconds duration)
+{
+    const auto start = ReplayScheduler::Clock::time_point();
+    ReplayScheduler scheduler;
+    scheduler.anchor(base::Time(), controller.getSpeed(), start);
+    controller.reset(controller.getSpeed(), start);
+
+    std::chrono::nanoseconds maxLateness(0);
+    auto publishTime = start;
+    for(int64_t sample = 0; publishTime - start < duration; sample++)
+    {
+        const base::Time logTime = base::Time::fromMilliseconds(sample);
+        publishTime = std::max(scheduler.getDeadline(logTime), publishTime) + publishDuration;
+        const auto lateness = scheduler.recordPublish(logTime, publishTime);
+        if(publishTime - start > duration * 3 / 4)
+        {
+            maxLateness = std::max(maxLateness, lateness);
+        }
+
+        if(controller.record(lateness, publishTime))
+        {
+            scheduler.anchor(logTime, controller.getSpeed(), publishTime);
+        }
+    }
+
+    return maxLateness;
+}
+
+BOOST_AUTO_TEST_CASE(TestSpeedControllerConverges)
+{
+    // 100 us per sample sustain at most 10x the log rate
+    SpeedController controller(std::chrono::milliseconds(10));
+    controller.reset(1.);
+    const auto maxLateness = simulateReplay(controller, std::chrono::microseconds(100), std::chrono::seconds(120));
+
+    BOOST_TEST(controller.getSpeed() > 8.5);
+    BOOST_TEST(controller.getSpeed() < 10.5);
+    BOOST_TEST(maxLateness.count() < 4 * controller.getLagBound().count());
+}
+
+BOOST_AUTO_TEST_CASE(TestSpeedControllerSlowsDown)
+{
+    // starting far above the sustainable speed, the speed is reduced until the lag is bounded again
+    SpeedController controller(std::chrono::milliseconds(10));
+    controller.reset(100.);
+    simulateReplay(controller, std::chrono::milliseconds(1), std::chrono::seconds(120));
+
+    BOOST_TEST(controller.getSpeed() > 0.85);
+    BOOST_TEST(controller.getSpeed() < 1.05);
+}
+
+BOOST_AUTO_TEST_CASE(TestSpeedControllerLimits)
+{
+    SpeedController controller(std::chrono::milliseconds(10), std::chrono::milliseconds(500), 0.5, 4.);
+    const auto start = SpeedController::Clock::now();
+
+    controller.reset(100., start);
+    BOOST_TEST(controller.getSpeed() == 4.);
+
+    // periods without lag raise the speed up to the maximum
+    BOOST_TEST(!controller.record(std::chrono::milliseconds(0), start + std::chrono::milliseconds(100)));
+    BOOST_TEST(!controller.record(std::chrono::milliseconds(0), start + std::chrono::milliseconds(600)));
+
+    // a lag far above the bound halves the speed, down to the minimum
+    for(int period = 1; period <= 10; period++)
+    {
+        controller.record(std::chrono::seconds(1), start + period * std::chrono::seconds(1));
+    }
+    BOOST_TEST(controller.getSpeed() == 0.5);
+
+    controller.setLagBound(std::chrono::milliseconds(20));
+    BOOST_TEST(controller.getLagBound().count() == 20000000);
+}
@@ -0,0 +1,82 @@
+#include "StreamStatistics.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+
+BOOST_AUTO_TEST_CASE(TestRegularStream)
+{
+    std::vector<int64_t> times;
+    for(int64_t sample = 0; sample < 1000; sample++)
+    {
+        times.push_back(1000000 + sample * 10000);
+    }
+
+    const auto statistics = StreamStatistics::compute("task.port", times);
+    BOOST_TEST(statistics.name == "task.port");
+    BOOST_TEST(statistics.numSamples == 1000);
+    BOOST_TEST(statistics.firstTime.toMicroseconds() == 1000000);
+    BOOST_TEST(statistics.lastTime.toMicroseconds() == 1000000 + 999 * 10000);
+    BOOST_TEST(statistics.meanPeriod.toMicroseconds() == 10000);
+    BOOST_TEST(statistics.minPeriod.toMicroseconds() == 10000);
+    BOOST_TEST(statistics.maxPeriod.toMicroseconds() == 10000);
+    BOOST_TEST(statistics.jitter99.toMicroseconds() == 0);
+    BOOST_TEST(statistics.largestGaps.size() == 3);
+    BOOST_TEST(statistics.numOutOfOrder == 0);
+}
+
+BOOST_AUTO_TEST_CASE(TestIrregularStream)
+{
+    // periods of 10 ms with 1 ms jitter on every tenth sample, a dropout and a clock jump backwards
+    std::vector<int64_t> times = {0};
+    for(int sample = 1; sample < 200; sample++)
+    {
+        times.push_back(times.back() + (sample % 10 ? 10000 : 11000));
+    }
+    times.push_back(times.back() + 500000);
+    times.push_back(times.back() - 20000);
+    times.push_back(times.back() + 10000);
+
+    const auto statistics = StreamStatistics::compute("jittery", times, 2);
+    BOOST_TEST(statistics.numSamples == 203);
+    BOOST_TEST(statistics.numOutOfOrder == 1);
+    BOOST_TEST(statistics.medianPeriod.toMicroseconds() == 10000);
+    BOOST_TEST(statistics.minPeriod.toMicroseconds() == 10000);
+    BOOST_TEST(statistics.maxPeriod.toMicroseconds() == 500000);
+    BOOST_TEST(statistics.jitter50.toMicroseconds() == 0);
+    BOOST_TEST(statistics.jitter95.toMicroseconds() == 1000);
+    BOOST_TEST(statistics.jitter99.toMicroseconds() == 1000);
+
+    BOOST_REQUIRE(statistics.largestGaps.size() == 2);
+    BOOST_TEST(statistics.largestGaps[0].duration.toMicroseconds() == 500000);
+    BOOST_TEST(statistics.largestGaps[0].start.toMicroseconds() == times[199]);
+    BOOST_TEST(statistics.largestGaps[1].duration.toMicroseconds() == 11000);
+}
+
+BOOST_AUTO_TEST_CASE(TestEmptyStream)
+{
+    const auto statistics = StreamStatistics::compute("empty", {});
+    BOOST_TEST(statistics.numSamples == 0);
+    BOOST_TEST(statistics.largestGaps.empty());
+
+    const auto single = StreamStatistics::compute("single", {42});
+    BOOST_TEST(single.numSamples == 1);
+    BOOST_TEST(single.meanPeriod.isNull());
+}
+
+BOOST_AUTO_TEST_CASE(TestStatisticsOutput)
+{
+    const std::vector<StreamStatistics> statistics = {
+        StreamStatistics::compute("task.\"port\"", {0, 10000, 25000}), StreamStatistics::compute("task.other", {})};
+
+    std::ostringstream table;
+    StreamStatistics::writeTable(table, statistics);
+    BOOST_TEST(table.str().find("task.other") != std::string::npos);
+    BOOST_TEST(table.str().find("15.000") != std::string::npos);
+
+    std::ostringstream json;
+    StreamStatistics::writeJson(json, statistics);
+    BOOST_TEST(json.str().find("\"name\": \"task.\\\"port\\\"\"") != std::string::npos);
+    BOOST_TEST(json.str().find("\"largest_gaps\": [{\"start_us\": 10000, \"duration_us\": 15000}, {\"start_us\": 0, \"duration_us\": 10000}]") !=
+               std::string::npos);
+    BOOST_TEST(json.str().find("\"out_of_order\": 0}\n]") != std::string::npos);
+}
@@ -0,0 +1,89 @@
+#include "TimingFidelity.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+
+BOOST_AUTO_TEST_CASE(TestTimingFidelityStreams)
+{
+    TimingFidelity fidelity;
+    const auto start = TimingFidelity::Clock::now();
+    for(int64_t sample = 0; sample < 100; sample++)
+    {
+        const auto publishTime = start + std::chrono::milliseconds(sample);
+        fidelity.record(0, "task.fast", base::Time::fromMicroseconds(sample * 1000), std::chrono::microseconds(sample), publishTime);
+        fidelity.record(3, "task.slow", base::Time::fromMicroseconds(sample * 1000), std::chrono::milliseconds(-1), publishTime);
+    }
+
+    const auto report = fidelity.getReport();
+    BOOST_TEST(report.total.count == 200);
+    BOOST_TEST(report.streams.size() == 2);
+    BOOST_TEST(report.streams.at("task.fast").count == 100);
+    BOOST_TEST(report.streams.at("task.fast").max.count() == 99000);
+    BOOST_TEST(report.streams.at("task.slow").count == 100);
+    BOOST_TEST(report.streams.at("task.slow").max.count() == 0);
+    BOOST_TEST(fidelity.getTotal().count == 200);
+
+    fidelity.reset();
+    BOOST_TEST(fidelity.getReport().total.count == 0);
+    BOOST_TEST(fidelity.getReport().streams.empty());
+    BOOST_TEST(fidelity.getReport().timeSeries.empty());
+}
+
+BOOST_AUTO_TEST_CASE(TestTimingFidelityTimeSeries)
+{
+    TimingFidelity fidelity(std::chrono::milliseconds(10), 4);
+    const auto start = TimingFidelity::Clock::now();
+
+    // two samples in the first interval, one in the third, none in the second
+    fidelity.record(0, "task.port", base::Time::fromMicroseconds(0), std::chrono::microseconds(100), start);
+    fidelity.record(0, "task.port", base::Time::fromMicroseconds(1), std::chrono::microseconds(300), start + std::chrono::milliseconds(5));
+    fidelity.record(0, "task.port", base::Time::fromMicroseconds(2), std::chrono::microseconds(50), start + std::chrono::milliseconds(25));
+
+    auto report = fidelity.getReport();
+    BOOST_TEST(report.interval.count() == 10000000);
+    BOOST_TEST(report.timeSeries.size() == 2);
+    BOOST_TEST(report.timeSeries[0].wallTime.count() == 0);
+    BOOST_TEST(report.timeSeries[0].samples == 2);
+    BOOST_TEST(report.timeSeries[0].meanLateness.count() == 200000);
+    BOOST_TEST(report.timeSeries[0].maxLateness.count() == 300000);
+    BOOST_TEST(report.timeSeries[1].wallTime.count() == 20000000);
+    BOOST_TEST(report.timeSeries[1].logTime.toMicroseconds() == 2);
+    BOOST_TEST(report.timeSeries[1].samples == 1);
+
+    // filling the time series merges the points of each doubled interval, the current point continues the last merged one
+    for(int64_t interval = 3; interval < 8; interval++)
+    {
+        const auto publishTime = start + interval * std::chrono::milliseconds(10);
+        fidelity.record(0, "task.port", base::Time::fromMicroseconds(interval), std::chrono::microseconds(500), publishTime);
+    }
+
+    report = fidelity.getReport();
+    BOOST_TEST(report.interval.count() == 20000000);
+    BOOST_TEST(report.total.count == 8);
+    uint64_t samples = 0;
+    for(size_t point = 0; point < report.timeSeries.size(); point++)
+    {
+        BOOST_TEST(report.timeSeries[point].wallTime.count() % report.interval.count() == 0);
+        if(point)
+        {
+            BOOST_TEST(report.timeSeries[point].wallTime.count() > report.timeSeries[point - 1].wallTime.count());
+        }
+        samples += report.timeSeries[point].samples;
+    }
+    BOOST_TEST(samples == 8);
+    BOOST_TEST(report.timeSeries.size() == 4);
+    BOOST_TEST(report.timeSeries[0].samples == 2);
+    BOOST_TEST(report.timeSeries[1].samples == 2);
+    BOOST_TEST(report.timeSeries[1].meanLateness.count() == 275000);
+    BOOST_TEST(report.timeSeries[1].maxLateness.count() == 500000);
+    BOOST_TEST(report.timeSeries[2].samples == 2);
+    BOOST_TEST(report.timeSeries[3].logTime.toMicroseconds() == 6);
+
+    std::stringstream csv;
+    TimingFidelity::writeCsv(csv, report);
+    std::string line;
+    std::getline(csv, line);
+    BOOST_TEST(line == "wall_time_s,log_time_us,samples,mean_lateness_ms,max_lateness_ms");
+    std::getline(csv, line);
+    BOOST_TEST(line == "0,0,2,0.2,0.3");
+}
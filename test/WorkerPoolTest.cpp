@@ -0,0 +1,34 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE(TestWorkerPoolProcessesAllItems)
+{
+    std::vector<int> processed(100, 0);
+    WorkerPool::forEach(processed.size(), [&](size_t item) { processed[item]++; }, {}, 4);
+
+    BOOST_TEST(std::count(processed.begin(), processed.end(), 1) == 100);
+}
+
+BOOST_AUTO_TEST_CASE(TestWorkerPoolReportsProgress)
+{
+    std::atomic<size_t> processedItems(0);
+    std::vector<size_t> reports;
+    WorkerPool::forEach(10, [&](size_t item) { processedItems++; }, [&](size_t finished) { reports.push_back(finished); });
+
+    BOOST_TEST(processedItems == 10);
+    BOOST_REQUIRE(!reports.empty());
+    BOOST_TEST(std::is_sorted(reports.begin(), reports.end()));
+    BOOST_TEST(reports.back() == 10);
+}
+
+BOOST_AUTO_TEST_CASE(TestWorkerPoolWithoutItems)
+{
+    bool called = false;
+    WorkerPool::forEach(0, [&](size_t item) { called = true; });
+
+    BOOST_TEST(!called);
+}